@@ -137,6 +137,8 @@ namespace Iir {
 		m_b0 = b0/a0;
 		m_b1 = b1/a0;
 		m_b2 = b2/a0;
+		m_fixedPointGain = 1;
+		updateScalars ();
 	}
 
 	void Biquad::setOnePole (complex_t pole, complex_t zero)
@@ -217,6 +219,22 @@ namespace Iir {
 		m_b0 *= scale;
 		m_b1 *= scale;
 		m_b2 *= scale;
+		updateScalars ();
+	}
+
+	void Biquad::updateScalars ()
+	{
+		m_float = BiquadCoefficients<float>::fromDouble (m_b0, m_b1, m_b2, m_a1, m_a2);
+		m_q30 = BiquadCoefficients<Q30>::fromDouble (m_b0 * m_fixedPointGain,
+							    m_b1 * m_fixedPointGain,
+							    m_b2 * m_fixedPointGain,
+							    m_a1, m_a2);
+	}
+
+	void Biquad::setFixedPointGain (double gain)
+	{
+		m_fixedPointGain = gain;
+		updateScalars ();
 	}
 
 }
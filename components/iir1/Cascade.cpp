@@ -42,6 +42,7 @@ namespace Iir {
 		: m_numStages (0)
 		, m_maxStages (0)
 		, m_stageArray (0)
+		, m_fixedPoint (false)
 	{
 	}
 
@@ -50,6 +51,7 @@ namespace Iir {
 		m_numStages = 0;
 		m_maxStages = storage.maxStages;
 		m_stageArray = storage.stageArray;
+		m_fixedPoint = storage.fixedPoint;
 	}
 
 	complex_t Cascade::response (double normalizedFrequency) const
@@ -95,6 +97,53 @@ namespace Iir {
 	{
 		if (m_numStages < 1) return;
 		m_stageArray->applyScale (scale);
+		if (m_fixedPoint)
+			scaleForFixedPoint (m_stageArray, m_numStages);
+	}
+
+	void Cascade::scaleForFixedPoint (Biquad* stages, int numStages)
+	{
+		// Peaks are looked for on a logarithmic grid from DC to Nyquist,
+		// as low cutoffs put them close to DC; Q30 leaves a factor of two
+		// of headroom for one that falls between the points.
+		const int points = 64;
+		const double fixedPointMaxCoefficient = 1.999;
+		const double fixedPointMinLevel = 0.5;
+		const double fixedPointMaxLevel = 1.75;
+		double magnitude[points];
+		for (int i = 0; i < points; ++i)
+			magnitude[i] = 1;
+
+		double staged = 1; // Product of the gains so far.
+		for (int k = 0; k < numStages; ++k)
+		{
+			if (k == numStages - 1)
+			{
+				stages[k].setFixedPointGain (1 / staged);
+				break;
+			}
+			double peak = 0;
+			for (int i = 0; i < points; ++i)
+			{
+				const double f = (i == 0) ? 0 : 0.5 * std::pow (1e-5, 1. - (double)i / (points - 1));
+				magnitude[i] *= std::abs (stages[k].response (f));
+				peak = std::max (peak, magnitude[i]);
+			}
+			// Only move levels that would lose resolution or overflow:
+			// every gain here is made up for by the last stage, whose
+			// coefficients may not have room for it.
+			const double level = peak * staged;
+			double gain = (level > 0 && (level < fixedPointMinLevel || level > fixedPointMaxLevel))
+				? 1 / level : 1;
+			// Raise no further than the Q30 range allows.
+			const double b = std::max (std::abs (stages[k].getB0 ()),
+						   std::max (std::abs (stages[k].getB1 ()),
+							     std::abs (stages[k].getB2 ())));
+			if (gain > 1 && b * gain > fixedPointMaxCoefficient)
+				gain = std::max (1., fixedPointMaxCoefficient / b);
+			stages[k].setFixedPointGain (gain);
+			staged *= gain;
+		}
 	}
 
 
@@ -0,0 +1,118 @@
+/**
+ *
+ * "A Collection of Useful C++ Classes for Digital Signal Processing"
+ * By Vinnie Falco and Bernd Porr
+ *
+ * Official project location:
+ * https://github.com/berndporr/iir1
+ *
+ * See Documentation.cpp for contact information, notes, and bibliography.
+ *
+ * -----------------------------------------------------------------
+ *
+ * License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+ **/
+
+
+#include "Common.h"
+#include "Parallel.h"
+
+namespace Iir {
+
+	Parallel::Parallel ()
+		: m_numSections (0)
+		, m_maxSections (0)
+		, m_sectionArray (0)
+		, m_direct (0)
+	{
+	}
+
+	void Parallel::setParallelStorage (const Cascade::Storage& storage)
+	{
+		m_numSections = 0;
+		m_maxSections = storage.maxStages;
+		m_sectionArray = storage.stageArray;
+		m_direct = 0;
+	}
+
+	complex_t Parallel::response (double normalizedFrequency) const
+	{
+		complex_t ch (m_direct);
+		for (int k = 0; k < m_numSections; ++k)
+			ch += m_sectionArray[k].response (normalizedFrequency);
+		return ch;
+	}
+
+	// Numerator or denominator of a stage at z.
+	static complex_t evaluate (double c0, double c1, double c2, complex_t z)
+	{
+		const complex_t zn1 = 1. / z;
+		return c0 + zn1 * (c1 + zn1 * c2);
+	}
+
+	void Parallel::setup (const Cascade& cascade)
+	{
+		const int numStages = cascade.getNumStages ();
+		if (numStages > m_maxSections)
+			throw std::invalid_argument ("Too many stages for this parallel form.");
+		const std::vector<PoleZeroPair> pz = cascade.getPoleZeros ();
+
+		// The residue of H(z) at a pole p of stage k is the rest of the
+		// cascade at p: every numerator, every other denominator, and the
+		// factor of stage k's denominator for its other pole q.
+		double direct = 1;
+		for (int k = 0; k < numStages; ++k)
+			direct *= cascade[k].getB0 () / cascade[k].getA0 ();
+		for (int k = 0; k < numStages; ++k)
+		{
+			const Biquad& stage = cascade[k];
+			const complex_t poles[2] = { pz[k].poles.first, pz[k].poles.second };
+			complex_t residues[2] = { 0., 0. };
+			for (int i = 0; i < 2; ++i)
+			{
+				const complex_t p = poles[i];
+				if (p == 0.)
+					continue;
+				complex_t r = 1. - poles[1 - i] / p;
+				complex_t num = 1;
+				for (int m = 0; m < numStages; ++m)
+				{
+					const Biquad& s = cascade[m];
+					const double a0 = s.getA0 ();
+					num *= evaluate (s.getB0 () / a0, s.getB1 () / a0, s.getB2 () / a0, p);
+					if (m != k)
+						r *= evaluate (1, s.getA1 () / a0, s.getA2 () / a0, p);
+				}
+				residues[i] = num / r;
+			}
+
+			// r1 / (1 - p1 z^-1) + r2 / (1 - p2 z^-1) over the stage's own
+			// denominator; the imaginary parts cancel for a conjugate pair.
+			const complex_t b0 = residues[0] + residues[1];
+			const complex_t b1 = -(residues[0] * poles[1] + residues[1] * poles[0]);
+			if (!std::isfinite (b0.real ()) || !std::isfinite (b1.real ()))
+				throw std::invalid_argument ("Repeated pole, no parallel form.");
+			direct -= b0.real ();
+			m_sectionArray[k].setCoefficients (1,
+							   stage.getA1 () / stage.getA0 (),
+							   stage.getA2 () / stage.getA0 (),
+							   b0.real (), b1.real (), 0);
+		}
+		m_numSections = numStages;
+		m_direct = direct;
+
+		// A numerator of higher order than the denominator leaves terms in
+		// z^-1 that the sections cannot hold.
+		for (int i = 0; i <= 8; ++i)
+		{
+			const double f = 0.5 * i / 8;
+			const complex_t c = cascade.response (f);
+			if (std::abs (response (f) - c) > 1e-6 * (1 + std::abs (c)))
+			{
+				m_numSections = 0;
+				throw std::invalid_argument ("Cascade has no parallel form.");
+			}
+		}
+	}
+
+}
@@ -38,12 +38,32 @@
 
 #include "Common.h"
 #include "MathSupplement.h"
+#include "Scalar.h"
 #include "Types.h"
 
 namespace Iir {
 
 	struct DllExport BiquadPoleState;
 
+/**
+ * The normalised coefficients of a Biquad (a0 = 1) in the scalar type a
+ * state computes in, see Scalar.h.
+ **/
+	template <typename Scalar>
+		struct BiquadCoefficients
+	{
+		Scalar b0, b1, b2, a1, a2;
+
+		static BiquadCoefficients fromDouble(double b0, double b1, double b2,
+						     double a1, double a2)
+		{
+			typedef ScalarTraits<Scalar> T;
+			return BiquadCoefficients { T::fromCoefficient(b0), T::fromCoefficient(b1),
+					T::fromCoefficient(b2), T::fromCoefficient(a1),
+					T::fromCoefficient(a2) };
+		}
+	};
+
 /*
  * Holds coefficients for a second order Infinite Impulse Response
  * digital filter. This is the building block for all IIR filters.
@@ -92,6 +112,15 @@ namespace Iir {
                  **/
 		double getB2 () const { return m_b2*m_a0; }
 
+		/**
+                 * Returns the normalised coefficients in the scalar type
+                 * Scalar: double, float or Q30. The float and Q30 sets are
+                 * kept up to date with the double one; the Q30 set is gain
+                 * staged only in cascades whose states run in Q30.
+                 **/
+		template <typename Scalar>
+			BiquadCoefficients<Scalar> getCoefficients () const;
+
 		/** 
                  * Filter a sample with the coefficients provided here and the State provided as an argument.
                  * \param s The sample to be filtered.
@@ -152,6 +181,13 @@ namespace Iir {
                  **/
 		void applyScale (double scale);
 
+		/**
+                 * Scales the FIR coefficients of the Q30 set only, for gain
+                 * staging a fixed point cascade; see Cascade::scaleForFixedPoint().
+                 * Reset to 1 by setCoefficients().
+                 **/
+		void setFixedPointGain (double gain);
+
 	public:
 		double m_a0 = 1;
 		double m_a1 = 0;
@@ -159,8 +195,34 @@ namespace Iir {
 		double m_b1 = 0;
 		double m_b2 = 0;
 		double m_b0 = 1;
+
+	private:
+		void updateScalars ();
+
+		double m_fixedPointGain = 1;
+
+		BiquadCoefficients<float> m_float = {1, 0, 0, 0, 0};
+		BiquadCoefficients<Q30> m_q30 = {{1 << 30}, {0}, {0}, {0}, {0}};
 	};
 
+	template <>
+		inline BiquadCoefficients<double> Biquad::getCoefficients<double> () const
+	{
+		return BiquadCoefficients<double> { m_b0, m_b1, m_b2, m_a1, m_a2 };
+	}
+
+	template <>
+		inline BiquadCoefficients<float> Biquad::getCoefficients<float> () const
+	{
+		return m_float;
+	}
+
+	template <>
+		inline BiquadCoefficients<Q30> Biquad::getCoefficients<Q30> () const
+	{
+		return m_q30;
+	}
+
 //------------------------------------------------------------------------------
 
 	
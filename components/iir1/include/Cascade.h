@@ -40,7 +40,9 @@
 #include "Biquad.h"
 #include "Layout.h"
 #include "MathSupplement.h"
+#include "State.h"
 #include <stdexcept>
+#include <type_traits>
 
 namespace Iir {
 
@@ -61,15 +63,19 @@ namespace Iir {
                  * Constructor which receives the pointer to the Biquad array and the number of Biquads
                  * \param maxStages_ Number of biquads
                  * \param stageArray_ The array of the Biquads
+                 * \param fixedPoint_ Whether the states run in Q30, so that
+                 * designs gain stage the Q30 coefficients
                  **/
-		Storage (int maxStages_, Biquad* stageArray_)
+		Storage (int maxStages_, Biquad* stageArray_, bool fixedPoint_ = false)
 			: maxStages (maxStages_)
 			, stageArray (stageArray_)
+			, fixedPoint (fixedPoint_)
 		{
 		}
 
 		int maxStages;
 		Biquad* stageArray;
+		bool fixedPoint;
 	};
 
 	/**
@@ -83,7 +89,7 @@ namespace Iir {
 	/**
          * returns a reference to a biquad
          **/
-	const Biquad& operator[] (int index)
+	const Biquad& operator[] (int index) const
 	{
 		if ((index < 0) || (index >= m_numStages))
 			throw std::invalid_argument("Index out of bounds.");
@@ -101,6 +107,20 @@ namespace Iir {
          **/
 	std::vector<PoleZeroPair> getPoleZeros () const;
 
+	/**
+         * Gain stages the Q30 coefficients of a cascade: the FIR part of a
+         * stage whose output would peak below 1/2 or above 7/4 is scaled to
+         * peak at 1 instead, or as close as the Q30 coefficient range
+         * allows, and the last stage makes up the difference. Designs put
+         * the whole gain on the first stage, which for low cutoffs or high
+         * orders leaves it far below the Q30 resolution. The double and
+         * float coefficients are left as they are. Designs only do this
+         * for cascades whose states run in Q30.
+         * \param stages Array of biquads
+         * \param numStages Number of biquads in use
+         **/
+	static void scaleForFixedPoint (Biquad* stages, int numStages);
+
 	protected:
 	Cascade ();
 
@@ -114,6 +134,7 @@ namespace Iir {
 	int m_numStages;
 	int m_maxStages;
 	Biquad* m_stageArray;
+	bool m_fixedPoint;
 	};
 
 //------------------------------------------------------------------------------
@@ -124,6 +145,9 @@ namespace Iir {
  **/
 	template <int MaxStages,class StateType>
 		class DllExport CascadeStages {
+		static const bool fixedPoint =
+			std::is_same<typename StateType::Scalar, Q30>::value;
+
 	public:
 		/**
 		 * Resets all biquads (i.e. the delay lines but not the coefficients)
@@ -150,6 +174,8 @@ namespace Iir {
 					sosCoefficients[i][1],
 					sosCoefficients[i][2]);
 			}
+			if (fixedPoint)
+				Cascade::scaleForFixedPoint (m_stages, MaxStages);
 		}
 
 	public:
@@ -160,16 +186,53 @@ namespace Iir {
 		template <typename Sample>
 			inline Sample filter(const Sample in)
 		{
-			double out = in;
+			typedef ScalarTraits<typename StateType::Scalar> T;
+			typename StateType::Scalar out = T::fromSample(in);
 			StateType* state = m_states;
 			for (const auto &stage: m_stages)
 				out = (state++)->filter(out, stage);
-			return static_cast<Sample> (out);
+			return T::template toSample<Sample> (out);
+		}
+
+		/**
+		 * Filters n samples stage by stage: each biquad runs over a block of
+		 * IIR1_BLOCK_SIZE samples, with its coefficients and delay line in
+		 * registers, before the next one starts. Gives the same results as
+		 * filter() on each sample. out may be the same as in.
+		 * Not expected to be faster than filter() on an out-of-order core,
+		 * which already overlaps the stages of the per-sample loop: on the
+		 * x86 host bench_iir_block has it at about 0.6 to 1.5 times the
+		 * speed of filter(), varying from run to run and slower in about
+		 * half the cases. What it saves, reloading
+		 * each stage's coefficients and delay line every sample, is aimed
+		 * at in-order cores such as the ESP32, where it has not been
+		 * measured yet.
+		 * \param in Samples to be filtered
+		 * \param out Filtered samples
+		 * \param n Number of samples
+		 **/
+		template <typename Sample>
+			void process(const Sample* in, Sample* out, size_t n)
+		{
+			typedef ScalarTraits<typename StateType::Scalar> T;
+			typename StateType::Scalar block[IIR1_BLOCK_SIZE];
+			while (n > 0) {
+				const size_t len = n < IIR1_BLOCK_SIZE ? n : IIR1_BLOCK_SIZE;
+				for (size_t i = 0; i < len; i++)
+					block[i] = T::fromSample(in[i]);
+				for (int i = 0; i < MaxStages; i++)
+					m_states[i].process(block, len, m_stages[i]);
+				for (size_t i = 0; i < len; i++)
+					out[i] = T::template toSample<Sample> (block[i]);
+				in += len;
+				out += len;
+				n -= len;
+			}
 		}
 
 		Cascade::Storage getCascadeStorage()
 		{
-			return Cascade::Storage (MaxStages, m_stages);
+			return Cascade::Storage (MaxStages, m_stages, fixedPoint);
 		}
 
 	private:
@@ -50,6 +50,9 @@
 #include "ChebyshevI.h"
 #include "ChebyshevII.h"
 #include "Custom.h"
+#include "Modulation.h"
+#include "MultiChannel.h"
+#include "Parallel.h"
 #include "RBJ.h"
 
 #endif
@@ -0,0 +1,303 @@
+/**
+ *
+ * "A Collection of Useful C++ Classes for Digital Signal Processing"
+ * By Vinnie Falco and Bernd Porr
+ *
+ * Official project location:
+ * https://github.com/berndporr/iir1
+ *
+ * See Documentation.cpp for contact information, notes, and bibliography.
+ *
+ * -----------------------------------------------------------------
+ *
+ * License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+ **/
+
+
+#ifndef IIR1_MODULATION_H
+#define IIR1_MODULATION_H
+
+#include "Common.h"
+#include "Biquad.h"
+#include "Cascade.h"
+#include "State.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <type_traits>
+
+namespace Iir {
+
+/**
+ * Hands the newest of a series of values from one thread, the writer, to
+ * one other, the reader, without either of them waiting or locking. The
+ * writer fills a slot of its own and swaps it with the published one;
+ * the reader swaps the published one, when it is newer, with the slot it
+ * was reading. With three slots a slot is only ever in one thread's
+ * hands, so a value is never read while it is being written, and values
+ * the reader had no time for are simply overwritten.
+ **/
+	template <typename Value>
+		class DllExport CoefficientExchange
+	{
+	public:
+		CoefficientExchange ()
+			: m_published (1)
+			, m_write (2)
+			, m_read (0)
+		{
+		}
+
+		/**
+		 * Sets every slot, before the two threads start.
+		 **/
+		void init (const Value& value)
+		{
+			for (auto &slot: m_slots)
+				slot = value;
+		}
+
+		/**
+		 * The writer's slot, to be filled and then published.
+		 **/
+		Value& write ()
+		{
+			return m_slots[m_write];
+		}
+
+		/**
+		 * Publishes the writer's slot, replacing any published value the
+		 * reader has not taken yet. Writer only.
+		 **/
+		void publish ()
+		{
+			m_write = m_published.exchange (m_write | Fresh, std::memory_order_acq_rel) & Slot;
+		}
+
+		/**
+		 * Takes the published value if it came since the last call. Reader
+		 * only.
+		 * \return true if read() now gives a newer value
+		 **/
+		bool fetch ()
+		{
+			if (!(m_published.load (std::memory_order_relaxed) & Fresh))
+				return false;
+			m_read = m_published.exchange (m_read, std::memory_order_acq_rel) & Slot;
+			return true;
+		}
+
+		/**
+		 * The value the reader last took.
+		 **/
+		const Value& read () const
+		{
+			return m_slots[m_read];
+		}
+
+	private:
+		enum { Slot = 3, Fresh = 4 };
+
+		Value m_slots[3];
+		std::atomic<unsigned> m_published; // Slot, and Fresh until fetched
+		unsigned m_write; // writer's
+		unsigned m_read; // reader's
+	};
+
+//------------------------------------------------------------------------------
+
+/**
+ * A cascade whose coefficients a control thread may change while an audio
+ * thread is filtering, without clicks and without either waiting on the
+ * other. The control thread designs into a filter of its own, with any
+ * setup() that filter has, and publishes the result:
+ *
+ *   Iir::Butterworth::LowPass<4> design;       // control thread's
+ *   Iir::ModulatedCascade<2> filter;          // shared
+ *
+ *   design.setup (48000, cutoff);              // control thread
+ *   filter.publish (design);
+ *
+ *   filter.process (in, out, n);               // audio thread
+ *
+ * process() picks up the newest coefficients once per call and, unless
+ * interpolation is turned off, moves each coefficient linearly from the
+ * old value to the new one across the block, so the filter changes
+ * smoothly at any rate the control thread publishes at. Stable biquads
+ * stay stable along the way: the a1, a2 of stable sections form a convex
+ * set. The transposed form and Direct Form I follow a coefficient change
+ * best; Direct Form II's internal node is scaled by the poles, which
+ * makes it jump. Fixed point is not supported.
+ * \param MaxStages Number of biquads
+ * \param StateType The filter topology in float or double
+ **/
+	template <int MaxStages, class StateType = DEFAULT_STATE>
+		class DllExport ModulatedCascade
+	{
+	public:
+		typedef typename StateType::Scalar Scalar;
+
+		static_assert (std::is_floating_point<Scalar>::value,
+			       "Coefficients are interpolated in float or double.");
+
+		/**
+		 * One published set of coefficients. Stages the design does not
+		 * have pass their input through.
+		 **/
+		struct Coefficients
+		{
+			BiquadCoefficients<Scalar> stages[MaxStages];
+		};
+
+		/**
+		 * Starts out passing the input through.
+		 **/
+		ModulatedCascade ()
+		{
+			Coefficients unity;
+			for (auto &c: unity.stages)
+				c = BiquadCoefficients<Scalar>::fromDouble (1, 0, 0, 0, 0);
+			m_exchange.init (unity);
+			m_current = unity;
+		}
+
+		/**
+		 * Publishes the coefficients of a designed filter for the audio
+		 * thread to pick up. Never waits and never allocates. Control
+		 * thread only.
+		 * \param design Filter with up to MaxStages biquads
+		 **/
+		void publish (const Cascade& design)
+		{
+			const int numStages = design.getNumStages ();
+			if (numStages > MaxStages)
+				throw std::invalid_argument ("Too many stages for this cascade.");
+			Coefficients& c = m_exchange.write ();
+			for (int k = 0; k < MaxStages; k++)
+				c.stages[k] = (k < numStages)
+					? design[k].getCoefficients<Scalar> ()
+					: BiquadCoefficients<Scalar>::fromDouble (1, 0, 0, 0, 0);
+			m_exchange.publish ();
+		}
+
+		/**
+		 * Whether process() moves to new coefficients across the block
+		 * (the default) or at its start. Audio thread only.
+		 **/
+		void setInterpolation (bool interpolate)
+		{
+			m_interpolate = interpolate;
+		}
+
+		/**
+		 * Resets all biquads (i.e. the delay lines but not the coefficients)
+		 **/
+		void reset ()
+		{
+			for (auto &state: m_states)
+				state.reset();
+		}
+
+		/**
+		 * Filters one sample, first taking up the newest coefficients
+		 * without interpolation. Audio thread only.
+		 * \param in Sample to be filtered
+		 **/
+		template <typename Sample>
+			inline Sample filter(const Sample in)
+		{
+			if (m_exchange.fetch ())
+				m_current = m_exchange.read ();
+			Scalar out = static_cast<Scalar> (in);
+			for (int k = 0; k < MaxStages; k++)
+				out = m_states[k].filter(out, m_current.stages[k]);
+			return static_cast<Sample> (out);
+		}
+
+		/**
+		 * Filters n samples with the newest coefficients, reached at the
+		 * last sample when interpolating. Audio thread only. out may be
+		 * the same as in.
+		 * \param in Samples to be filtered
+		 * \param out Filtered samples
+		 * \param n Number of samples
+		 **/
+		template <typename Sample>
+			void process(const Sample* in, Sample* out, size_t n)
+		{
+			if (n == 0)
+				return;
+			if (!m_exchange.fetch ())
+				processSteady (in, out, n);
+			else if (!m_interpolate) {
+				m_current = m_exchange.read ();
+				processSteady (in, out, n);
+			}
+			else
+				processRamp (in, out, n, m_exchange.read ());
+		}
+
+	private:
+		template <typename Sample>
+			void processSteady(const Sample* in, Sample* out, size_t n)
+		{
+			Scalar block[IIR1_BLOCK_SIZE];
+			while (n > 0) {
+				const size_t len = n < IIR1_BLOCK_SIZE ? n : IIR1_BLOCK_SIZE;
+				for (size_t i = 0; i < len; i++)
+					block[i] = static_cast<Scalar> (in[i]);
+				for (int k = 0; k < MaxStages; k++)
+					m_states[k].process(block, len, m_current.stages[k]);
+				for (size_t i = 0; i < len; i++)
+					out[i] = static_cast<Sample> (block[i]);
+				in += len;
+				out += len;
+				n -= len;
+			}
+		}
+
+		// Steps every coefficient by an nth of the way per sample and
+		// lands on the target exactly at the last.
+		template <typename Sample>
+			void processRamp(const Sample* in, Sample* out, size_t n,
+					 const Coefficients& target)
+		{
+			Coefficients step;
+			const Scalar r = Scalar(1) / static_cast<Scalar> (n);
+			for (int k = 0; k < MaxStages; k++) {
+				const BiquadCoefficients<Scalar>& a = m_current.stages[k];
+				const BiquadCoefficients<Scalar>& b = target.stages[k];
+				step.stages[k] = BiquadCoefficients<Scalar> { (b.b0 - a.b0) * r,
+					(b.b1 - a.b1) * r, (b.b2 - a.b2) * r, (b.a1 - a.a1) * r,
+					(b.a2 - a.a2) * r };
+			}
+			for (size_t i = 0; i + 1 < n; i++) {
+				Scalar x = static_cast<Scalar> (in[i]);
+				for (int k = 0; k < MaxStages; k++) {
+					BiquadCoefficients<Scalar>& c = m_current.stages[k];
+					const BiquadCoefficients<Scalar>& d = step.stages[k];
+					c.b0 += d.b0;
+					c.b1 += d.b1;
+					c.b2 += d.b2;
+					c.a1 += d.a1;
+					c.a2 += d.a2;
+					x = m_states[k].filter(x, c);
+				}
+				out[i] = static_cast<Sample> (x);
+			}
+			m_current = target;
+			Scalar x = static_cast<Scalar> (in[n - 1]);
+			for (int k = 0; k < MaxStages; k++)
+				x = m_states[k].filter(x, m_current.stages[k]);
+			out[n - 1] = static_cast<Sample> (x);
+		}
+
+		CoefficientExchange<Coefficients> m_exchange;
+		Coefficients m_current; // audio thread's
+		StateType m_states[MaxStages];
+		bool m_interpolate = true;
+	};
+
+}
+
+#endif
@@ -0,0 +1,285 @@
+/**
+ *
+ * "A Collection of Useful C++ Classes for Digital Signal Processing"
+ * By Vinnie Falco and Bernd Porr
+ *
+ * Official project location:
+ * https://github.com/berndporr/iir1
+ *
+ * See Documentation.cpp for contact information, notes, and bibliography.
+ *
+ * -----------------------------------------------------------------
+ *
+ * License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+ **/
+
+
+#ifndef IIR1_MULTICHANNEL_H
+#define IIR1_MULTICHANNEL_H
+
+#include "Common.h"
+#include "Biquad.h"
+#include "Cascade.h"
+
+#include <stdexcept>
+#include <type_traits>
+
+/**
+ * MultiChannelCascade keeps one lane per channel in GCC vector extension
+ * types, which GCC and clang turn into SSE, AVX or NEON instructions where
+ * the target has them and into scalar code where it does not. Defining
+ * IIR1_NO_VECTOR, or a compiler without the extensions, gets plain arrays
+ * with the same results.
+ **/
+#if defined(__GNUC__) && !defined(IIR1_NO_VECTOR)
+#define IIR1_VECTOR 1
+#else
+#define IIR1_VECTOR 0
+#endif
+
+namespace Iir {
+
+/**
+ * Lanes values of Scalar that add, subtract and multiply lane by lane.
+ **/
+	template <typename Scalar, int Lanes>
+		struct DllExport ChannelVector
+	{
+#if IIR1_VECTOR
+		typedef Scalar Type __attribute__ ((vector_size (sizeof (Scalar) * Lanes)));
+#else
+		struct Type
+		{
+			Scalar lane[Lanes];
+
+			Scalar& operator[] (int i) { return lane[i]; }
+			Scalar operator[] (int i) const { return lane[i]; }
+
+			friend Type operator+ (Type a, const Type& b)
+			{
+				for (int i = 0; i < Lanes; i++)
+					a.lane[i] += b.lane[i];
+				return a;
+			}
+
+			friend Type operator- (Type a, const Type& b)
+			{
+				for (int i = 0; i < Lanes; i++)
+					a.lane[i] -= b.lane[i];
+				return a;
+			}
+
+			friend Type operator* (Type a, const Type& b)
+			{
+				for (int i = 0; i < Lanes; i++)
+					a.lane[i] *= b.lane[i];
+				return a;
+			}
+		};
+#endif
+	};
+
+/**
+ * A cascade of up to MaxStages biquads for each of Channels channels,
+ * filtered in lockstep: coefficients and state are stored a vector per
+ * coefficient and stage with a lane per channel, so one instruction steps
+ * every channel. The channels can run the same filter, as the two sides
+ * of a stereo signal, or different ones, as the bands of a crossover fed
+ * the same signal with processBands().
+ *
+ * Each channel computes what a cascade with the TransposedDirectFormIIT
+ * state in Scalar does: in float, the same output as
+ * TransposedDirectFormIIFloat.
+ * \param Channels Number of channels, a power of two
+ * \param MaxStages Number of biquads per channel
+ * \param Scalar float or double
+ **/
+	template <int Channels, int MaxStages, typename Scalar = float>
+		class DllExport MultiChannelCascade
+	{
+		static_assert (Channels > 0 && (Channels & (Channels - 1)) == 0,
+			       "Channels must be a power of two.");
+		static_assert (std::is_floating_point<Scalar>::value,
+			       "Scalar must be float or double.");
+
+	public:
+		typedef typename ChannelVector<Scalar, Channels>::Type Vector;
+
+		/**
+		 * Every channel starts out passing its input through.
+		 **/
+		MultiChannelCascade ()
+		{
+			for (int c = 0; c < Channels; c++)
+				setup (c, nullptr, 0);
+			reset ();
+		}
+
+		/**
+		 * Resets the delay lines of all channels, not the coefficients.
+		 **/
+		void reset ()
+		{
+			for (int k = 0; k < MaxStages; k++) {
+				m_s1[k] = Vector ();
+				m_s2[k] = Vector ();
+			}
+		}
+
+		/**
+		 * Sets the coefficients of one channel from an array of biquads.
+		 * The stages beyond numStages pass the channel through.
+		 * \param channel Channel from 0 to Channels - 1
+		 * \param stages Array of biquads
+		 * \param numStages Number of biquads, up to MaxStages
+		 **/
+		void setup (int channel, const Biquad* stages, int numStages)
+		{
+			checkSetup (channel, numStages);
+			for (int k = 0; k < MaxStages; k++)
+				setStage (channel, k, (k < numStages) ? &stages[k] : nullptr);
+		}
+
+		/**
+		 * Sets the coefficients of one channel from a designed filter.
+		 * \param channel Channel from 0 to Channels - 1
+		 * \param design Filter whose biquads to copy, with up to MaxStages of them
+		 **/
+		void setup (int channel, const Cascade& design)
+		{
+			checkSetup (channel, design.getNumStages ());
+			for (int k = 0; k < MaxStages; k++)
+				setStage (channel, k, (k < design.getNumStages ()) ? &design[k] : nullptr);
+		}
+
+		/**
+		 * Sets every channel to the same designed filter.
+		 * \param design Filter whose biquads to copy, with up to MaxStages of them
+		 **/
+		void setup (const Cascade& design)
+		{
+			for (int c = 0; c < Channels; c++)
+				setup (c, design);
+		}
+
+		/**
+		 * Filters one sample of every channel in place. Vectors go by
+		 * reference throughout, as wider ones than the target has
+		 * registers for are passed differently by value.
+		 * \param x Lane c holds the sample of channel c
+		 **/
+		inline void filter (Vector& x)
+		{
+			for (int k = 0; k < MaxStages; k++)
+				step (m_stages[k], m_s1[k], m_s2[k], x);
+		}
+
+		/**
+		 * Filters n frames of interleaved channels, sample i of channel c
+		 * being in[i * Channels + c], with the state in locals throughout.
+		 * out may be the same as in.
+		 * \param in Interleaved samples to be filtered
+		 * \param out Filtered interleaved samples
+		 * \param n Number of frames
+		 **/
+		template <typename Sample>
+			void process (const Sample* in, Sample* out, size_t n)
+		{
+			Vector s1[MaxStages], s2[MaxStages];
+			load (s1, s2);
+			for (size_t i = 0; i < n; i++, in += Channels, out += Channels) {
+				Vector x;
+				for (int c = 0; c < Channels; c++)
+					x[c] = static_cast<Scalar> (in[c]);
+				for (int k = 0; k < MaxStages; k++)
+					step (m_stages[k], s1[k], s2[k], x);
+				for (int c = 0; c < Channels; c++)
+					out[c] = static_cast<Sample> (x[c]);
+			}
+			store (s1, s2);
+		}
+
+		/**
+		 * Filters n samples of one signal through every channel, as the
+		 * bands of a crossover, into n interleaved frames: out[i * Channels
+		 * + c] is sample i through channel c.
+		 * \param in Samples to be filtered
+		 * \param out Filtered interleaved samples, Channels times as many
+		 * \param n Number of samples
+		 **/
+		template <typename Sample>
+			void processBands (const Sample* in, Sample* out, size_t n)
+		{
+			Vector s1[MaxStages], s2[MaxStages];
+			load (s1, s2);
+			for (size_t i = 0; i < n; i++, out += Channels) {
+				Vector x;
+				for (int c = 0; c < Channels; c++)
+					x[c] = static_cast<Scalar> (in[i]);
+				for (int k = 0; k < MaxStages; k++)
+					step (m_stages[k], s1[k], s2[k], x);
+				for (int c = 0; c < Channels; c++)
+					out[c] = static_cast<Sample> (x[c]);
+			}
+			store (s1, s2);
+		}
+
+	private:
+		struct Stage
+		{
+			Vector b0, b1, b2, a1, a2;
+		};
+
+		static void checkSetup (int channel, int numStages)
+		{
+			if ((channel < 0) || (channel >= Channels))
+				throw std::invalid_argument ("Channel out of range.");
+			if ((numStages < 0) || (numStages > MaxStages))
+				throw std::invalid_argument ("Too many stages for this cascade.");
+		}
+
+		// A missing stage passes the channel through.
+		void setStage (int channel, int k, const Biquad* stage)
+		{
+			const BiquadCoefficients<Scalar> c = stage
+				? stage->getCoefficients<Scalar> ()
+				: BiquadCoefficients<Scalar>::fromDouble (1, 0, 0, 0, 0);
+			m_stages[k].b0[channel] = c.b0;
+			m_stages[k].b1[channel] = c.b1;
+			m_stages[k].b2[channel] = c.b2;
+			m_stages[k].a1[channel] = c.a1;
+			m_stages[k].a2[channel] = c.a2;
+		}
+
+		static inline void step (const Stage& s, Vector& s1, Vector& s2, Vector& x)
+		{
+			const Vector y = s1 + s.b0 * x;
+			s1 = s2 + s.b1 * x - s.a1 * y;
+			s2 = s.b2 * x - s.a2 * y;
+			x = y;
+		}
+
+		void load (Vector* s1, Vector* s2) const
+		{
+			for (int k = 0; k < MaxStages; k++) {
+				s1[k] = m_s1[k];
+				s2[k] = m_s2[k];
+			}
+		}
+
+		void store (const Vector* s1, const Vector* s2)
+		{
+			for (int k = 0; k < MaxStages; k++) {
+				m_s1[k] = s1[k];
+				m_s2[k] = s2[k];
+			}
+		}
+
+		Stage m_stages[MaxStages];
+		Vector m_s1[MaxStages];
+		Vector m_s2[MaxStages];
+	};
+
+}
+
+#endif
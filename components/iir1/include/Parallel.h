@@ -0,0 +1,188 @@
+/**
+ *
+ * "A Collection of Useful C++ Classes for Digital Signal Processing"
+ * By Vinnie Falco and Bernd Porr
+ *
+ * Official project location:
+ * https://github.com/berndporr/iir1
+ *
+ * See Documentation.cpp for contact information, notes, and bibliography.
+ *
+ * -----------------------------------------------------------------
+ *
+ * License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+ **/
+
+
+#ifndef IIR1_PARALLEL_H
+#define IIR1_PARALLEL_H
+
+#include "Common.h"
+#include "Biquad.h"
+#include "Cascade.h"
+#include "State.h"
+#include <stdexcept>
+
+namespace Iir {
+
+/**
+ * Holds the coefficients of a filter in parallel form: a direct gain plus
+ * a sum of sections, each a first order numerator over one stage's
+ * denominator,
+ *
+ *  H(z) = d + sum over k of (b0k + b1k z^-1) / (1 + a1k z^-1 + a2k z^-2)
+ *
+ * which is the partial fraction expansion of a cascade. The sections all
+ * take the same input and none waits for another, where each stage of a
+ * cascade waits for the one before it.
+ **/
+	class DllExport Parallel
+	{
+	public:
+	/**
+         * Returns the number of sections kept here
+         **/
+	int getNumSections () const
+	{
+		return m_numSections;
+	}
+
+	/**
+         * Returns the gain of the direct path, added to the sections
+         **/
+	double getDirectGain () const
+	{
+		return m_direct;
+	}
+
+	/**
+         * returns a reference to a section
+         **/
+	const Biquad& operator[] (int index) const
+	{
+		if ((index < 0) || (index >= m_numSections))
+			throw std::invalid_argument("Index out of bounds.");
+		return m_sectionArray[index];
+	}
+
+	/**
+         * Calculate filter response at the given normalized frequency
+         * \param normalizedFrequency Frequency from 0 to 0.5 (Nyquist)
+         **/
+	complex_t response (double normalizedFrequency) const;
+
+	protected:
+	Parallel ();
+
+	void setParallelStorage (const Cascade::Storage& storage);
+
+	/**
+         * Expands a cascade into partial fractions, with the poles from
+         * Cascade::getPoleZeros(). Each stage gives one section with its
+         * own denominator; a pole at the origin, as of a one pole stage,
+         * takes no part. Throws if the cascade has no parallel form with
+         * first order numerators, which is when a pole is repeated or the
+         * numerator has a higher order than the denominator, or if the
+         * result does not match the cascade's response.
+         * \param cascade Designed filter
+         **/
+	void setup (const Cascade& cascade);
+
+	private:
+	int m_numSections;
+	int m_maxSections;
+	Biquad* m_sectionArray;
+	double m_direct;
+	};
+
+//------------------------------------------------------------------------------
+
+/**
+ * Storage and state for a parallel form of up to MaxStages sections,
+ * set up from a cascade with that many stages:
+ *
+ *   Iir::Butterworth::LowPass<8> cascade;
+ *   cascade.setup (48000, 1000);
+ *   Iir::ParallelStages<4> parallel;
+ *   parallel.setup (cascade);
+ *
+ * Residues grow as poles crowd together, so high orders at low cutoffs
+ * lose more to rounding than the cascade does; the sections can also
+ * need more range than Q30 has.
+ * \param MaxStages Number of sections
+ * \param StateType The filter topology: DirectFormI, DirectFormII, ...
+ **/
+	template <int MaxStages, class StateType = DEFAULT_STATE>
+		class DllExport ParallelStages : public Parallel
+	{
+	public:
+		ParallelStages ()
+		{
+			setParallelStorage (Cascade::Storage (MaxStages, m_sections));
+			m_directScalar = ScalarTraits<Scalar>::fromCoefficient (0);
+		}
+
+		/**
+		 * Sets up the sections from a cascade and resets them.
+		 * \param cascade Designed filter with up to MaxStages stages
+		 **/
+		void setup (const Cascade& cascade)
+		{
+			Parallel::setup (cascade);
+			m_directScalar = ScalarTraits<Scalar>::fromCoefficient (getDirectGain ());
+			reset ();
+		}
+
+		/**
+		 * Resets all sections (the delay lines but not the coefficients)
+		 **/
+		void reset ()
+		{
+			for (auto &state: m_states)
+				state.reset();
+		}
+
+		/**
+                 * Filters one sample through all sections and returns their sum
+                 * \param in Sample to be filtered
+                 **/
+		template <typename Sample>
+			inline Sample filter(const Sample in)
+		{
+			typedef ScalarTraits<Scalar> T;
+			const Scalar x = T::fromSample(in);
+			typename T::Acc acc = T::mul(m_directScalar, x);
+			for (int k = 0; k < getNumSections(); k++)
+				acc += T::widen(m_states[k].filter(x, m_sections[k]));
+			return T::template toSample<Sample> (T::round(acc));
+		}
+
+		/**
+		 * Filters n samples, giving the same results as filter() on each.
+		 * It goes sample by sample rather than a block through each
+		 * section in turn as CascadeStages::process() does: the sections
+		 * of one sample are already independent. Whether that makes it
+		 * faster than the cascade depends on the core and the order;
+		 * measure before choosing it for speed. out may be the same as in.
+		 * \param in Samples to be filtered
+		 * \param out Filtered samples
+		 * \param n Number of samples
+		 **/
+		template <typename Sample>
+			void process(const Sample* in, Sample* out, size_t n)
+		{
+			for (size_t i = 0; i < n; i++)
+				out[i] = filter(in[i]);
+		}
+
+	private:
+		typedef typename StateType::Scalar Scalar;
+
+		Biquad m_sections[MaxStages];
+		StateType m_states[MaxStages];
+		Scalar m_directScalar;
+	};
+
+}
+
+#endif
@@ -71,6 +71,22 @@ namespace RBJ {
 			inline Sample filter(Sample s) {
 			return static_cast<Sample>(state.filter((double)s,*this));
 		}
+		/// filters n samples in blocks, see CascadeStages::process()
+		template <typename Sample>
+			void process(const Sample* in, Sample* out, size_t n) {
+			double block[IIR1_BLOCK_SIZE];
+			while (n > 0) {
+				const size_t len = n < IIR1_BLOCK_SIZE ? n : IIR1_BLOCK_SIZE;
+				for (size_t i = 0; i < len; i++)
+					block[i] = in[i];
+				state.process(block, len, *this);
+				for (size_t i = 0; i < len; i++)
+					out[i] = static_cast<Sample>(block[i]);
+				in += len;
+				out += len;
+				n -= len;
+			}
+		}
 		/// resets the delay lines to zero
 		void reset() {
 			state.reset();
@@ -0,0 +1,123 @@
+/**
+ *
+ * "A Collection of Useful C++ Classes for Digital Signal Processing"
+ * By Vinnie Falco and Bernd Porr
+ *
+ * Official project location:
+ * https://github.com/berndporr/iir1
+ *
+ * See Documentation.cpp for contact information, notes, and bibliography.
+ *
+ * -----------------------------------------------------------------
+ *
+ * License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+ **/
+
+#ifndef IIR1_SCALAR_H
+#define IIR1_SCALAR_H
+
+#include "Common.h"
+
+#include <stdint.h>
+#include <type_traits>
+
+namespace Iir {
+
+/**
+ * Fixed point with one integer bit and 30 fraction bits: -2 up to just
+ * below 2. Samples in -1..1 are taken in at half scale, so a signal inside
+ * the cascade can reach 4 times full scale before it saturates: a full
+ * scale square wave or step through a high pass overshoots to just over
+ * twice it. A design whose impulse response sums to more than 4 in
+ * absolute value, such as a high Q resonance, can still saturate on the
+ * worst input. Coefficients outside -2..2 saturate, so designs with more
+ * gain than that in one section need float.
+ **/
+	struct DllExport Q30
+	{
+		int32_t v;
+	};
+
+/**
+ * The arithmetic the states in State.h do in each scalar type. A product
+ * goes into an accumulator of type Acc and round() brings the sum back
+ * down; for floating point both are no-ops.
+ **/
+	template <typename Scalar>
+		struct ScalarTraits
+	{
+		typedef Scalar Acc;
+
+		static Scalar fromCoefficient(double c) { return static_cast<Scalar>(c); }
+
+		template <typename Sample>
+			static Scalar fromSample(Sample x) { return static_cast<Scalar>(x); }
+
+		template <typename Sample>
+			static Sample toSample(Scalar x) { return static_cast<Sample>(x); }
+
+		static Acc widen(Scalar x) { return x; }
+
+		static Acc mul(Scalar a, Scalar b) { return a * b; }
+
+		static Scalar round(Acc acc) { return acc; }
+	};
+
+/**
+ * Products are Q2.60 in a 64 bit accumulator, so a section sums five of
+ * them without rounding and rounds once, with saturation, at the end.
+ **/
+	template <>
+		struct ScalarTraits<Q30>
+	{
+		typedef int64_t Acc;
+
+		static const int Shift = 30;
+		// Samples come in at half scale; see Q30.
+		static const int SampleShift = Shift - 1;
+
+		static Q30 saturate(int64_t v)
+		{
+			if (v > INT32_MAX)
+				v = INT32_MAX;
+			else if (v < INT32_MIN)
+				v = INT32_MIN;
+			return Q30 { static_cast<int32_t>(v) };
+		}
+
+		static Q30 fromCoefficient(double c)
+		{
+			return saturate(std::llround(c * (1 << Shift)));
+		}
+
+		// In float for float samples, which is all the FPU of a small
+		// target does in hardware.
+		template <typename Sample>
+			static Q30 fromSample(Sample x)
+		{
+			typedef typename std::conditional<std::is_same<Sample, float>::value,
+				float, double>::type Real;
+			return saturate(static_cast<int64_t>(static_cast<Real>(x) * Real(1 << SampleShift)));
+		}
+
+		template <typename Sample>
+			static Sample toSample(Q30 x)
+		{
+			typedef typename std::conditional<std::is_same<Sample, float>::value,
+				float, double>::type Real;
+			return static_cast<Sample>(static_cast<Real>(x.v) * (Real(1) / Real(1 << SampleShift)));
+		}
+
+		static Acc widen(Q30 x) { return static_cast<int64_t>(x.v) * (int64_t(1) << Shift); }
+
+		static Acc mul(Q30 a, Q30 b) { return static_cast<int64_t>(a.v) * b.v; }
+
+		static Q30 round(Acc acc)
+		{
+			return saturate((acc + (int64_t(1) << (Shift - 1))) >> Shift);
+		}
+	};
+
+}
+
+#endif
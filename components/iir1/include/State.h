@@ -40,9 +40,22 @@
 #include "Biquad.h"
 
 #include <stdexcept>
+#include <type_traits>
 
 #define DEFAULT_STATE DirectFormII
 
+/**
+ * Samples a cascade filters through one stage before moving on to the
+ * next with process(), held on the stack in the state's scalar type.
+ * Short blocks let an out-of-order core start on the next stage while the
+ * last one finishes, which keeps process() close to filter() there; on an
+ * in-order one the coefficient and state loads would be what is saved, and
+ * longer blocks save a little more. See CascadeStages::process().
+ **/
+#ifndef IIR1_BLOCK_SIZE
+#define IIR1_BLOCK_SIZE 8
+#endif
+
 namespace Iir {
 
 /**
@@ -52,28 +65,46 @@ namespace Iir {
  *
  *  y[n] = (b0/a0)*x[n] + (b1/a0)*x[n-1] + (b2/a0)*x[n-2]
  *                      - (a1/a0)*y[n-1] - (a2/a0)*y[n-2]  
+ *
+ * The states compute in ScalarType: double, float or Q30 (see Scalar.h).
+ * With Q30 the whole sum of a Direct Form I section is accumulated in 64
+ * bits and rounded once, which makes it the form to use in fixed point.
  **/
-	class DllExport DirectFormI
+	template <typename ScalarType>
+		class DllExport DirectFormIT
 	{
 	public:
-		DirectFormI ()
+		typedef ScalarType Scalar;
+
+		DirectFormIT ()
 		{
 			reset();
 		}
 
 		void reset ()
 		{
-			m_x1 = 0;
-			m_x2 = 0;
-			m_y1 = 0;
-			m_y2 = 0;
+			m_x1 = Scalar();
+			m_x2 = Scalar();
+			m_y1 = Scalar();
+			m_y2 = Scalar();
 		}
 
-			inline double filter(const double in,
+			inline Scalar filter(const Scalar in,
 					     const Biquad& s)
 		{
-			double out = s.m_b0*in + s.m_b1*m_x1 + s.m_b2*m_x2
-				- s.m_a1*m_y1 - s.m_a2*m_y2;
+			return filter(in, s.getCoefficients<Scalar>());
+		}
+
+		/**
+		 * filter() with the coefficients given directly, as when they
+		 * change from one sample to the next.
+		 **/
+			inline Scalar filter(const Scalar in,
+					     const BiquadCoefficients<Scalar>& c)
+		{
+			typedef ScalarTraits<Scalar> T;
+			Scalar out = T::round(T::mul(c.b0, in) + T::mul(c.b1, m_x1) + T::mul(c.b2, m_x2)
+				- T::mul(c.a1, m_y1) - T::mul(c.a2, m_y2));
 			m_x2 = m_x1;
 			m_y2 = m_y1;
 			m_x1 = in;
@@ -82,11 +113,41 @@ namespace Iir {
 			return out;
 		}
 
+		/**
+		 * Filters n samples in place with the coefficients and the delay
+		 * line held in locals throughout, giving the same results as
+		 * filter() on each.
+		 **/
+		void process(Scalar* x, size_t n, const Biquad& s)
+		{
+			process(x, n, s.getCoefficients<Scalar>());
+		}
+
+		void process(Scalar* x, size_t n, const BiquadCoefficients<Scalar>& c)
+		{
+			typedef ScalarTraits<Scalar> T;
+			Scalar x1 = m_x1, x2 = m_x2, y1 = m_y1, y2 = m_y2;
+			for (size_t i = 0; i < n; i++) {
+				const Scalar in = x[i];
+				const Scalar y = T::round(T::mul(c.b0, in) + T::mul(c.b1, x1)
+					+ T::mul(c.b2, x2) - T::mul(c.a1, y1) - T::mul(c.a2, y2));
+				x2 = x1;
+				y2 = y1;
+				x1 = in;
+				y1 = y;
+				x[i] = y;
+			}
+			m_x1 = x1;
+			m_x2 = x2;
+			m_y1 = y1;
+			m_y2 = y2;
+		}
+
 	protected:
-		double m_x2 = 0; // x[n-2]
-		double m_y2 = 0; // y[n-2]
-		double m_x1 = 0; // x[n-1]
-		double m_y1 = 0; // y[n-1]
+		Scalar m_x2 = Scalar(); // x[n-2]
+		Scalar m_y2 = Scalar(); // y[n-2]
+		Scalar m_x1 = Scalar(); // x[n-1]
+		Scalar m_y1 = Scalar(); // y[n-1]
 	};
 
 //------------------------------------------------------------------------------
@@ -99,26 +160,41 @@ namespace Iir {
  *  v[n] =         x[n] - (a1/a0)*v[n-1] - (a2/a0)*v[n-2]
  *  y(n) = (b0/a0)*v[n] + (b1/a0)*v[n-1] + (b2/a0)*v[n-2]
  *
+ * Not available in Q30: v[n] would be rounded before it feeds the zeros,
+ * and exceeds the Q30 range where the poles have gain.
  **/
-	class DllExport DirectFormII
+	template <typename ScalarType>
+		class DllExport DirectFormIIT
 	{
 	public:
-		DirectFormII ()
+		typedef ScalarType Scalar;
+
+		static_assert (!std::is_same<Scalar, Q30>::value,
+			       "Direct Form II overflows in Q30; use Direct Form I.");
+
+		DirectFormIIT ()
 		{
 			reset ();
 		}
 
 		void reset ()
 		{
-			m_v1 = 0;
-			m_v2 = 0;
+			m_v1 = Scalar();
+			m_v2 = Scalar();
 		}
 
-			double filter(const double in,
+			Scalar filter(const Scalar in,
 				      const Biquad& s)
 		{
-			double w   = in - s.m_a1*m_v1 - s.m_a2*m_v2;
-			double out =      s.m_b0*w    + s.m_b1*m_v1 + s.m_b2*m_v2;
+			return filter(in, s.getCoefficients<Scalar>());
+		}
+
+			Scalar filter(const Scalar in,
+				      const BiquadCoefficients<Scalar>& c)
+		{
+			typedef ScalarTraits<Scalar> T;
+			Scalar w   = T::round(T::widen(in) - T::mul(c.a1, m_v1) - T::mul(c.a2, m_v2));
+			Scalar out = T::round(T::mul(c.b0, w) + T::mul(c.b1, m_v1) + T::mul(c.b2, m_v2));
 
 			m_v2 = m_v1;
 			m_v1 = w;
@@ -126,51 +202,121 @@ namespace Iir {
 			return out;
 		}
 
+		/**
+		 * Block version of filter(), see DirectFormIT::process().
+		 **/
+		void process(Scalar* x, size_t n, const Biquad& s)
+		{
+			process(x, n, s.getCoefficients<Scalar>());
+		}
+
+		void process(Scalar* x, size_t n, const BiquadCoefficients<Scalar>& c)
+		{
+			typedef ScalarTraits<Scalar> T;
+			Scalar v1 = m_v1, v2 = m_v2;
+			for (size_t i = 0; i < n; i++) {
+				const Scalar w = T::round(T::widen(x[i]) - T::mul(c.a1, v1) - T::mul(c.a2, v2));
+				x[i] = T::round(T::mul(c.b0, w) + T::mul(c.b1, v1) + T::mul(c.b2, v2));
+				v2 = v1;
+				v1 = w;
+			}
+			m_v1 = v1;
+			m_v2 = v2;
+		}
+
 	private:
-		double m_v1 = 0; // v[-1]
-		double m_v2 = 0; // v[-2]
+		Scalar m_v1 = Scalar(); // v[-1]
+		Scalar m_v2 = Scalar(); // v[-2]
 	};
 
 
 //------------------------------------------------------------------------------
 
-	class DllExport TransposedDirectFormII
+	template <typename ScalarType>
+		class DllExport TransposedDirectFormIIT
 	{
 	public:
-		TransposedDirectFormII ()
+		typedef ScalarType Scalar;
+
+		TransposedDirectFormIIT ()
 		{
 			reset ();
 		}
 
 		void reset ()
 		{
-			m_s1 = 0;
-			m_s1_1 = 0;
-			m_s2 = 0;
-			m_s2_1 = 0;
+			m_s1 = Scalar();
+			m_s1_1 = Scalar();
+			m_s2 = Scalar();
+			m_s2_1 = Scalar();
 		}
 
-			inline double filter(const double in,
+			inline Scalar filter(const Scalar in,
 					     const Biquad& s)
 		{
-			double out;
+			return filter(in, s.getCoefficients<Scalar>());
+		}
 
-			out = m_s1_1 + s.m_b0*in;
-			m_s1 = m_s2_1 + s.m_b1*in - s.m_a1*out;
-			m_s2 = s.m_b2*in - s.m_a2*out;
+			inline Scalar filter(const Scalar in,
+					     const BiquadCoefficients<Scalar>& c)
+		{
+			typedef ScalarTraits<Scalar> T;
+			Scalar out;
+
+			out = T::round(T::widen(m_s1_1) + T::mul(c.b0, in));
+			m_s1 = T::round(T::widen(m_s2_1) + T::mul(c.b1, in) - T::mul(c.a1, out));
+			m_s2 = T::round(T::mul(c.b2, in) - T::mul(c.a2, out));
 			m_s1_1 = m_s1;
 			m_s2_1 = m_s2;
 
 			return out;
 		}
 
+		/**
+		 * Block version of filter(), see DirectFormIT::process().
+		 **/
+		void process(Scalar* x, size_t n, const Biquad& s)
+		{
+			process(x, n, s.getCoefficients<Scalar>());
+		}
+
+		void process(Scalar* x, size_t n, const BiquadCoefficients<Scalar>& c)
+		{
+			typedef ScalarTraits<Scalar> T;
+			Scalar s1 = m_s1_1, s2 = m_s2_1;
+			for (size_t i = 0; i < n; i++) {
+				const Scalar in = x[i];
+				const Scalar y = T::round(T::widen(s1) + T::mul(c.b0, in));
+				s1 = T::round(T::widen(s2) + T::mul(c.b1, in) - T::mul(c.a1, y));
+				s2 = T::round(T::mul(c.b2, in) - T::mul(c.a2, y));
+				x[i] = y;
+			}
+			m_s1 = m_s1_1 = s1;
+			m_s2 = m_s2_1 = s2;
+		}
+
 	private:
-		double m_s1 = 0;
-		double m_s1_1 = 0;
-		double m_s2 = 0;
-		double m_s2_1 = 0;
+		Scalar m_s1 = Scalar();
+		Scalar m_s1_1 = Scalar();
+		Scalar m_s2 = Scalar();
+		Scalar m_s2_1 = Scalar();
 	};
 
+/**
+ * The forms in double, as iir1 has always computed, and in single
+ * precision and Q30 fixed point (no Direct Form II, see above).
+ **/
+	typedef DirectFormIT<double> DirectFormI;
+	typedef DirectFormIIT<double> DirectFormII;
+	typedef TransposedDirectFormIIT<double> TransposedDirectFormII;
+
+	typedef DirectFormIT<float> DirectFormIFloat;
+	typedef DirectFormIIT<float> DirectFormIIFloat;
+	typedef TransposedDirectFormIIT<float> TransposedDirectFormIIFloat;
+
+	typedef DirectFormIT<Q30> DirectFormIQ30;
+	typedef TransposedDirectFormIIT<Q30> TransposedDirectFormIIQ30;
+
 }
 
 #endif
@@ -0,0 +1,139 @@
+/*
+ * A receiver as the firmware was before packet types, listening to a
+ * current sender. It takes every packet whose CRC16 over the whole packet
+ * (check field as zero) matches as audio and plays the ESPNOW_SEND_LEN
+ * bytes after the 6-byte {seq_num, crc} header, exactly as that firmware
+ * did. Each packet is also parsed the current way to see what it really
+ * is, and the run fails (exit status 2) if the old receiver drops an audio
+ * packet, plays anything that is not audio, or plays bytes other than the
+ * primary payload. Run it against the redundant stream, stamped or not:
+ *
+ *   baseline_rx -n 2000 & war_tx -R -n 2000; wait $!
+ *
+ *   baseline_rx [-n packets] [-p local_port] [-r remote_port]
+ */
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "esp_crc.h"
+#include "esp_host.h"
+#include "esp_now.h"
+
+#include "war_espnow.h"
+
+/* The old firmware's packet: the header and nothing after the payload. */
+#define BASELINE_HEADER_LEN 6
+#define BASELINE_SEND_LEN ESPNOW_DEFAULT_SEND_LEN
+/* Gives up once a started stream goes quiet for this long. */
+#define IDLE_US 2000000
+
+static atomic_ulong datagrams, played, audio, redundant, control;
+static atomic_ulong audio_dropped, control_played, wrong_payload, unparsed;
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig)
+{
+    stop = 1;
+}
+
+/* The old espnow_data_parse(): the CRC16 with the field zeroed. */
+static bool baseline_parse(const uint8_t *data, int len)
+{
+    uint8_t packet[ESP_NOW_MAX_DATA_LEN];
+    if (len < BASELINE_HEADER_LEN)
+        return false;
+    memcpy(packet, data, len);
+    uint16_t crc;
+    memcpy(&crc, packet + 4, sizeof(crc));
+    memset(packet + 4, 0, sizeof(crc));
+    return esp_crc16_le(UINT16_MAX, packet, len) == crc;
+}
+
+static void recv_cb(const uint8_t *mac_addr, const uint8_t *data, int len)
+{
+    atomic_fetch_add(&datagrams, 1);
+    bool plays = baseline_parse(data, len);
+    atomic_fetch_add(&played, plays);
+
+    uint8_t state = 0;
+    uint32_t seq = 0;
+    int magic = 0;
+    const espnow_data_t *packet = espnow_data_parse(data, (uint16_t)len, &state, &seq, &magic);
+    if (packet == NULL)
+    {
+        atomic_fetch_add(&unparsed, 1);
+        return;
+    }
+    const espnow_trailer_t *trailer = ESPNOW_TRAILER(packet, len);
+    if (ESPNOW_TYPE(trailer->type) != ESPNOW_PACKET_AUDIO)
+    {
+        atomic_fetch_add(&control, 1);
+        atomic_fetch_add(&control_played, plays);
+        return;
+    }
+    atomic_fetch_add(&audio, 1);
+    atomic_fetch_add(&redundant, !!(trailer->flags & ESPNOW_FLAG_REDUNDANT));
+    if (!plays)
+        atomic_fetch_add(&audio_dropped, 1);
+    // What it plays has to be the primary payload, whole.
+    else if (len < BASELINE_HEADER_LEN + BASELINE_SEND_LEN + ESPNOW_TRAILER_LEN ||
+        memcmp(data + BASELINE_HEADER_LEN, packet->payload, BASELINE_SEND_LEN) != 0 ||
+        ESPNOW_FLAG_CODEC(trailer->flags) != CODEC_PCM16)
+        atomic_fetch_add(&wrong_payload, 1);
+}
+
+int main(int argc, char **argv)
+{
+    long packets = -1;
+    uint16_t local_port = 3334, remote_port = 3333;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:p:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': packets = strtol(optarg, NULL, 0); break;
+        case 'p': local_port = (uint16_t)atoi(optarg); break;
+        case 'r': remote_port = (uint16_t)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n packets] [-p local_port] [-r remote_port]\n",
+                argv[0]);
+            return 1;
+        }
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    esp_now_host_set_endpoint("127.0.0.1", local_port, remote_port);
+    ESP_ERROR_CHECK( esp_now_init() );
+    ESP_ERROR_CHECK( esp_now_register_recv_cb(recv_cb) );
+
+    unsigned long seen = 0;
+    int idle_us = 0;
+    while (!stop && (packets < 0 || (long)atomic_load(&audio) < packets))
+    {
+        usleep(10000);
+        unsigned long now = atomic_load(&datagrams);
+        idle_us = now == seen ? idle_us + 10000 : 0;
+        seen = now;
+        if (seen && idle_us >= IDLE_US)
+            break;
+    }
+    esp_now_deinit();
+
+    printf("%lu datagrams: %lu audio (%lu with the redundant copy), %lu other, "
+           "%lu failing their check\n", atomic_load(&datagrams), atomic_load(&audio),
+        atomic_load(&redundant), atomic_load(&control), atomic_load(&unparsed));
+    printf("baseline receiver played %lu: %lu audio dropped, %lu other played, "
+           "%lu not the primary payload\n", atomic_load(&played),
+        atomic_load(&audio_dropped), atomic_load(&control_played),
+        atomic_load(&wrong_payload));
+    bool ok = atomic_load(&audio) && !atomic_load(&audio_dropped) &&
+        !atomic_load(&control_played) && !atomic_load(&wrong_payload);
+    printf("%s\n", ok ? "compatible" : "NOT COMPATIBLE");
+    return ok ? 0 : 2;
+}
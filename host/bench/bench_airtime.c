@@ -0,0 +1,131 @@
+/*
+ * Airtime model for ESP-NOW audio packets. For each MS_PER_PACKET setting,
+ * and for the ESPNOW_AGGREGATE packet size, prints the packet rate and how
+ * much of the channel the stream occupies at a few PHY rates. Each packet
+ * pays DIFS, the mean contention backoff, the PHY preamble and the
+ * vendor-specific action frame around the payload; -u adds SIFS + ACK for
+ * unicast. -d is how many times each packet is sent (the sender sends
+ * every packet twice).
+ *
+ *   bench_airtime [-d sends_per_packet] [-u] [-r samplerate]
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "war_config.h"
+#include "war_espnow.h"
+
+// 802.11 MAC header + category + OUI + random + vendor IE header + FCS.
+#define ACTION_FRAME_OVERHEAD   (24 + 1 + 3 + 4 + 7 + 4)
+#define ACK_LEN                 14
+
+typedef struct {
+    const char *name;
+    double mbps;
+    bool ofdm;
+} phy_t;
+
+static const phy_t phys[] = {
+    {"1M", 1.0, false},     // ESP-NOW default
+    {"11M", 11.0, false},
+    {"24M", 24.0, true},
+    {"54M", 54.0, true},
+};
+
+static double frame_us(const phy_t *phy, int bytes)
+{
+    if (!phy->ofdm)
+        return 192.0 + bytes * 8.0 / phy->mbps;     // long preamble
+    // 16 service + 6 tail bits in 4 us symbols, 6 us signal extension.
+    double bits_per_symbol = phy->mbps * 4.0;
+    return 20.0 + 4.0 * ceil((16 + 8.0 * bytes + 6) / bits_per_symbol) + 6.0;
+}
+
+static double packet_us(const phy_t *phy, int payload, bool unicast)
+{
+    // DSSS: 20 us slots, CWmin 31. OFDM (short slot): 9 us slots, CWmin 15.
+    double slot = phy->ofdm ? 9.0 : 20.0;
+    double difs = 10.0 + 2.0 * slot;
+    double backoff = (phy->ofdm ? 15 : 31) / 2.0 * slot;
+    double t = difs + backoff + frame_us(phy, payload + ACTION_FRAME_OVERHEAD);
+    if (unicast)
+    {
+        const phy_t basic = {"", phy->ofdm ? 24.0 : 1.0, phy->ofdm};
+        t += 10.0 + frame_us(&basic, ACK_LEN);
+    }
+    return t;
+}
+
+static void row(const char *label, int samples, int extra, int samplerate,
+    int sends, bool unicast)
+{
+    int payload = ESPNOW_OVERHEAD + samples * (int)sizeof(int16_t) + extra;
+    int packets = (payload + ESP_NOW_MAX_DATA_LEN - 1) / ESP_NOW_MAX_DATA_LEN;
+    double period_us = samples * 1e6 / samplerate;
+    double pps = 1e6 / period_us * packets * sends;
+
+    printf("%-10s %7d %7d %7.2f %5s %8.0f", label, samples, payload,
+        period_us * 0.001, packets == 1 ? "yes" : "split", pps);
+    for (size_t i = 0; i < sizeof(phys) / sizeof(phys[0]); i++)
+    {
+        // A split packet is modelled as full frames plus the remainder.
+        int last = payload - (packets - 1) * ESP_NOW_MAX_DATA_LEN;
+        double us = (packets - 1) * packet_us(&phys[i], ESP_NOW_MAX_DATA_LEN, unicast) +
+            packet_us(&phys[i], last, unicast);
+        printf(" %7.0f %5.1f%%", us, us * sends / period_us * 100.0);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    int sends = 2;
+    bool unicast = false;
+    int samplerate = SAMPLERATE;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:ur:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd': sends = atoi(optarg); break;
+        case 'u': unicast = true; break;
+        case 'r': samplerate = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-d sends_per_packet] [-u] [-r samplerate]\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    printf("%d Hz mono, %d send(s) per packet, %s\n", samplerate, sends,
+        unicast ? "unicast" : "broadcast");
+    printf("%-10s %7s %7s %7s %5s %8s", "setting", "samples", "bytes", "ms",
+        "fits", "pkt/s");
+    for (size_t i = 0; i < sizeof(phys) / sizeof(phys[0]); i++)
+        printf(" %4s us %6s", phys[i].name, "busy");
+    printf("\n");
+
+    char label[16];
+    for (int ms = 1; ms <= 5; ms++)
+    {
+        snprintf(label, sizeof(label), "%d ms", ms);
+        row(label, samplerate / 1000 * ms, 0, samplerate, sends, unicast);
+    }
+
+    // The ESPNOW_AGGREGATE sizes, worked out for this sample rate.
+    int granule = samplerate / 8000;
+    int plain = (ESP_NOW_MAX_DATA_LEN - ESPNOW_OVERHEAD - (int)sizeof(fec_header_t)) /
+        (int)sizeof(int16_t);
+    int redundant = (ESP_NOW_MAX_DATA_LEN - ESPNOW_OVERHEAD) * 2 / 5;
+    row("aggregate", plain / granule * granule, 0, samplerate, sends, unicast);
+    redundant = redundant / granule * granule;
+    row("agg+red", redundant, REDUNDANT_LEN(redundant), samplerate, sends, unicast);
+
+    printf("build default: %d samples per packet, every %u us\n",
+        (int)ESPNOW_DEFAULT_SAMPLES, (unsigned)ESPNOW_DEFAULT_PACKET_US);
+    return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * Capture pacing: the old free-running timer against I2S DMA completion
+ * events, as a discrete-event simulation on the I2S clock.
+ *
+ *  timer  a TIMER_GROUP_0 alarm every packet_us, off the I2S clock by ppm,
+ *         notifies main_task, which calls i2s_read(portMAX_DELAY) for one
+ *         packet from 4 DMA buffers of 240 frames. A read blocks until the
+ *         buffer holding its newest frame completes; a task that fell
+ *         behind sees a notification count above one and skips the tick,
+ *         and the driver drops the oldest buffer once 3 are waiting.
+ *  dma    each of 4 DMA buffers is one packet; its I2S_EVENT_RX_DONE wakes
+ *         main_task, and the read returns at once.
+ *
+ * Both wake with the same ISR-to-task jitter and spend the same time in
+ * the mixer and the send path. Latency runs from the moment a packet's
+ * newest frame was sampled to the send; the interval is the spacing of
+ * consecutive sends.
+ *
+ *   bench_capture [-s seconds] [-P frames] [-j wake_jitter_us] [-S seed]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "war_config.h"
+#include "war_espnow.h"
+#include "war_mixer.h"
+
+#define TIMER_DMA_LEN   240
+#define PROC_US         40.0
+#define PROC_SPREAD_US  20.0
+
+typedef struct {
+    double sum, sq, max;
+    uint32_t n;
+} stat_t;
+
+typedef struct {
+    stat_t latency, interval;
+    uint32_t sent, skipped, dropped;
+} capture_result_t;
+
+static void stat_add(stat_t *stat, double value)
+{
+    stat->sum += value;
+    stat->sq += value * value;
+    if (value > stat->max)
+        stat->max = value;
+    stat->n++;
+}
+
+static double stat_avg(const stat_t *stat)
+{
+    return stat->n ? stat->sum / stat->n : 0.0;
+}
+
+static double stat_dev(const stat_t *stat)
+{
+    if (stat->n == 0)
+        return 0.0;
+    double avg = stat->sum / stat->n;
+    return sqrt(fmax(stat->sq / stat->n - avg * avg, 0.0));
+}
+
+static double gaussian(void)
+{
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double wake_delay(double jitter)
+{
+    return fabs(gaussian()) * jitter;
+}
+
+static double proc_time(void)
+{
+    return (PROC_US + PROC_SPREAD_US * rand() / RAND_MAX) * 1e-6;
+}
+
+static void send_at(capture_result_t *r, double send, double sampled, double *last)
+{
+    stat_add(&r->latency, (send - sampled) * 1e6);
+    if (*last > 0.0)
+        stat_add(&r->interval, (send - *last) * 1e6);
+    *last = send;
+    r->sent++;
+}
+
+/* The legacy driver keeps dma_buf_count - 1 finished buffers queued. */
+typedef struct {
+    double rate;
+    uint32_t len, cap;
+    uint64_t next;      // Oldest buffer not taken off the queue.
+    uint64_t cur;       // Buffer being read.
+    uint32_t left;      // Frames left in it.
+    uint32_t dropped;
+} dma_t;
+
+static uint64_t dma_done(const dma_t *dma, double t)
+{
+    return (uint64_t)floor(t * dma->rate / dma->len);
+}
+
+/* Reads frames at t, blocking on the DMA; returns when the read is done
+ * and sets when its newest frame was sampled. */
+static double dma_read(dma_t *dma, uint32_t frames, double t, double *sampled)
+{
+    while (frames > 0)
+    {
+        if (dma->left == 0)
+        {
+            uint64_t done = dma_done(dma, t);
+            if (done > dma->next + dma->cap)
+            {
+                dma->dropped += (uint32_t)(done - dma->cap - dma->next) * dma->len;
+                dma->next = done - dma->cap;
+            }
+            if (dma->next >= done)
+                t = (double)(dma->next + 1) * dma->len / dma->rate;
+            dma->cur = dma->next++;
+            dma->left = dma->len;
+        }
+        uint32_t take = frames < dma->left ? frames : dma->left;
+        dma->left -= take;
+        frames -= take;
+    }
+    uint64_t newest = dma->cur * dma->len + (dma->len - dma->left) - 1;
+    *sampled = (double)(newest + 1) / dma->rate;
+    return t;
+}
+
+static capture_result_t run_timer(double seconds, uint32_t rate, uint32_t frames,
+    double ppm, double jitter)
+{
+    capture_result_t r = {0};
+    dma_t dma = {.rate = rate, .len = TIMER_DMA_LEN, .cap = MIXER_DMA_BUFFERS - 1};
+    double period = (double)frames / rate / (1.0 + ppm * 1e-6);
+    double t0 = period * rand() / RAND_MAX;
+    uint64_t ticks = (uint64_t)(seconds / period);
+    double free_at = 0.0, last = 0.0;
+
+    for (uint64_t k = 0; k < ticks;)
+    {
+        double wake = fmax(free_at, t0 + k * period + wake_delay(jitter));
+        // Every tick up to now is in the notification count.
+        uint64_t count = 1;
+        while (k + count < ticks && t0 + (k + count) * period <= wake)
+            count++;
+        k += count;
+        if (count != 1)
+        {
+            r.skipped += (uint32_t)count;
+            free_at = wake;
+            continue;
+        }
+        double sampled;
+        double done = dma_read(&dma, frames, wake, &sampled) + proc_time();
+        send_at(&r, done, sampled, &last);
+        free_at = done;
+    }
+    r.dropped = dma.dropped;
+    return r;
+}
+
+static capture_result_t run_dma(double seconds, uint32_t rate, uint32_t frames,
+    double jitter)
+{
+    capture_result_t r = {0};
+    double period = (double)frames / rate;
+    uint64_t buffers = (uint64_t)(seconds / period);
+    double free_at = 0.0, last = 0.0;
+
+    for (uint64_t k = 0; k < buffers; k++)
+    {
+        double sampled = (k + 1) * period;
+        // Events the task is too late for wait in the queue; it never falls
+        // MIXER_DMA_BUFFERS behind here, so none are dropped.
+        double wake = fmax(free_at, sampled + wake_delay(jitter));
+        double done = wake + proc_time();
+        send_at(&r, done, sampled, &last);
+        free_at = done;
+    }
+    return r;
+}
+
+static void print_result(const char *mode, double ppm, double seconds,
+    const capture_result_t *r)
+{
+    printf("%6s %6.0f %9.1f %8.1f %8.1f %8.1f %8.1f %8.1f %7u %7u\n", mode, ppm,
+        r->sent / seconds, stat_avg(&r->latency), stat_dev(&r->latency),
+        r->latency.max, stat_dev(&r->interval), r->interval.max, r->skipped,
+        r->dropped);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 300.0;
+    uint32_t frames = ESPNOW_DEFAULT_FRAMES;
+    double jitter = 15e-6;
+    unsigned seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:P:j:S:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': seconds = atof(optarg); break;
+        case 'P': frames = (uint32_t)atoi(optarg); break;
+        case 'j': jitter = atof(optarg) * 1e-6; break;
+        case 'S': seed = (unsigned)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-s seconds] [-P frames] [-j wake_jitter_us] "
+                            "[-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    static const double ppms[] = {0, 20, -20, 100, -100};
+    printf("capture at %d Hz, %u frames per packet, %.0f s, wake jitter %.0f us; "
+           "times in us\n", SAMPLERATE, frames, seconds, jitter * 1e6);
+    printf("%6s %6s %9s %8s %8s %8s %8s %8s %7s %7s\n", "mode", "ppm", "packets/s",
+        "latency", "lat dev", "lat max", "int dev", "int max", "skipped", "dropped");
+    for (size_t p = 0; p < sizeof(ppms) / sizeof(ppms[0]); p++)
+    {
+        srand(seed);
+        capture_result_t r = run_timer(seconds, SAMPLERATE, frames, ppms[p], jitter);
+        print_result("timer", ppms[p], seconds, &r);
+    }
+    // One clock: there is no offset to sweep.
+    srand(seed);
+    capture_result_t r = run_dma(seconds, SAMPLERATE, frames, jitter);
+    print_result("dma", 0.0, seconds, &r);
+    return 0;
+}
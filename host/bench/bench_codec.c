@@ -0,0 +1,192 @@
+/*
+ * Payload codec cost and quality. A reference signal is cut into packets
+ * and every codec in war_codec.h encodes and decodes each one. Reports the
+ * encoded size and payload bitrate, time and cycles per frame for each
+ * direction, SNR against the reference and the largest sample error.
+ *
+ *   bench_codec [-i reference.wav] [-r rounds]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "driver/i2s.h"
+#include "esp_host.h"
+
+#include "war_codec.h"
+#include "war_config.h"
+#include "war_espnow.h"
+
+#define FRAME       ESPNOW_DEFAULT_SAMPLES
+#define SYNTH_SECS  10
+
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint64_t nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Plucked-string-like notes: decaying harmonics with a little vibrato. */
+static size_t synth_reference(int16_t **out)
+{
+    size_t n = SAMPLERATE * SYNTH_SECS / FRAME * FRAME;
+    int16_t *ref = malloc(n * sizeof(int16_t));
+    const double notes[] = {82.4, 110.0, 146.8, 196.0, 246.9, 329.6};
+    double phase = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        double t = (double)i / SAMPLERATE;
+        int note = (int)(t / 0.5) % 6;
+        double local = fmod(t, 0.5);
+        double f = notes[note] * (1.0 + 0.003 * sin(2 * M_PI * 5.0 * t));
+        phase += 2 * M_PI * f / SAMPLERATE;
+        double v = 0.0;
+        for (int h = 1; h <= 6; h++)
+            v += sin(h * phase) / h;
+        ref[i] = (int16_t)(9000.0 * exp(-3.0 * local) * v);
+    }
+    *out = ref;
+    return n;
+}
+
+static size_t load_reference(int16_t **out, const char *path)
+{
+    i2s_config_t config = {
+        .mode = (i2s_mode_t) (I2S_MODE_MASTER | I2S_MODE_RX),
+        .sample_rate = SAMPLERATE,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+    };
+    ESP_ERROR_CHECK( i2s_driver_install(I2S_NUM_0, &config, 0, NULL) );
+    ESP_ERROR_CHECK( i2s_host_set_source(I2S_NUM_0, path, false) );
+
+    size_t cap = SAMPLERATE, n = 0;
+    int16_t *ref = malloc(cap * sizeof(int16_t));
+    int16_t stereo[FRAME * 2];
+    size_t bytes_read;
+    for (;;)
+    {
+        i2s_read(I2S_NUM_0, stereo, sizeof(stereo), &bytes_read, portMAX_DELAY);
+        if (i2s_host_source_done(I2S_NUM_0))
+            break;
+        if (n + FRAME > cap)
+            ref = realloc(ref, (cap *= 2) * sizeof(int16_t));
+        // The channel mixer_read() transmits.
+        for (int i = 0; i < FRAME; i++)
+            ref[n + i] = stereo[2 * i + 1];
+        n += FRAME;
+    }
+    i2s_driver_uninstall(I2S_NUM_0);
+    *out = ref;
+    return n;
+}
+
+static double snr_db(double signal, double noise)
+{
+    if (noise <= 0.0)
+        return 99.0;
+    return 10.0 * log10((signal + 1e-9) / noise);
+}
+
+static void run(codec_id_t id, const int16_t *ref, size_t n, int rounds)
+{
+    codec_t codec;
+    uint8_t coded[CODEC_MAX_BYTES(FRAME)];
+    int16_t frame[FRAME];
+    size_t frames = n / FRAME;
+    uint64_t enc_ns = 0, enc_cyc = 0, dec_ns = 0, dec_cyc = 0, bytes = 0;
+    double sig = 0.0, noise = 0.0;
+    int max_err = 0;
+    size_t failed = 0;
+
+    for (int round = 0; round < rounds; round++)
+    {
+        codec_init(&codec, id);
+        for (size_t f = 0; f < frames; f++)
+        {
+            const int16_t *r = ref + f * FRAME;
+            uint64_t t0 = nanos(), c0 = cycles();
+            size_t len = codec_encode(&codec, r, FRAME, coded);
+            enc_cyc += cycles() - c0;
+            enc_ns += nanos() - t0;
+
+            t0 = nanos();
+            c0 = cycles();
+            bool ok = codec_decode(id, coded, len, frame, FRAME);
+            dec_cyc += cycles() - c0;
+            dec_ns += nanos() - t0;
+
+            if (round > 0)
+                continue;
+            bytes += len;
+            if (!ok)
+            {
+                failed++;
+                memset(frame, 0, sizeof(frame));
+            }
+            for (int i = 0; i < FRAME; i++)
+            {
+                int d = frame[i] - r[i];
+                sig += (double)r[i] * r[i];
+                noise += (double)d * d;
+                if (abs(d) > max_err)
+                    max_err = abs(d);
+            }
+        }
+    }
+
+    double total = (double)frames * rounds;
+    double avg = (double)bytes / frames;
+    printf("%-8s %8.1f %6.2f %8.0f %9.0f %10.0f %9.0f %10.0f %7.2f %7d%s\n",
+        codec_name(id), avg, (double)FRAME * sizeof(int16_t) / avg,
+        avg * 8.0 * 1e3 / ESPNOW_DEFAULT_PACKET_US, enc_ns / total, enc_cyc / total,
+        dec_ns / total, dec_cyc / total, snr_db(sig, noise), max_err,
+        failed ? " DECODE FAILED" : "");
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    int rounds = 20;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'i': input = optarg; break;
+        case 'r': rounds = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-i reference.wav] [-r rounds]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (rounds < 1)
+        rounds = 1;
+
+    int16_t *ref;
+    size_t n = input ? load_reference(&ref, input) : synth_reference(&ref);
+
+    printf("%zu frames of %d samples (%u us), %d rounds\n", n / FRAME, FRAME,
+        (unsigned)ESPNOW_DEFAULT_PACKET_US, rounds);
+    printf("%-8s %8s %6s %8s %9s %10s %9s %10s %7s %7s\n", "codec", "B/frame",
+        "ratio", "kbit/s", "enc ns", "enc cyc", "dec ns", "dec cyc", "SNR dB",
+        "max err");
+    for (int id = 0; id < CODEC_COUNT; id++)
+        run((codec_id_t)id, ref, n, rounds);
+
+    free(ref);
+    return 0;
+}
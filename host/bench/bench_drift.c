@@ -0,0 +1,258 @@
+/*
+ * Drift estimator and resampler against synthetic clock drift.
+ *
+ * First the resampler on its own: a sine played out at a fixed ratio is
+ * compared with the same sine evaluated at the resampled positions (SNR)
+ * and timed. Then a closed loop per drift setting: the sender's packet
+ * clock runs off by that many ppm, packets arrive with Gaussian jitter and
+ * random loss, and the receiver plays out on its own clock through the
+ * jitter buffer, once plainly and once through drift_t and resampler_t.
+ * Without correction the jitter buffer drops or stretches whole packets to
+ * keep up; with it the buffer should stay at its target.
+ *
+ *   bench_drift [-s seconds] [-j jitter_us] [-l loss_pct] [-S seed]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "war_config.h"
+#include "war_drift.h"
+#include "war_espnow.h"
+#include "war_jitter.h"
+
+#define FRAMES      ESPNOW_DEFAULT_FRAMES
+#define PACKET_US   ESPNOW_DEFAULT_PACKET_US
+
+typedef struct {
+    uint32_t seq;
+    int64_t arrival;
+} arrival_t;
+
+static int compare_arrival(const void *a, const void *b)
+{
+    int64_t d = ((const arrival_t *)a)->arrival - ((const arrival_t *)b)->arrival;
+    return d < 0 ? -1 : d > 0;
+}
+
+static double gaussian(void)
+{
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Sine source for the resampler test, one packet per pull. */
+typedef struct {
+    double freq;
+    uint64_t frame;
+} sine_t;
+
+static double sine_at(double freq, double frame)
+{
+    return 16000.0 * sin(2.0 * M_PI * freq * frame / SAMPLERATE);
+}
+
+static void pull_sine(void *ctx, int16_t *packet)
+{
+    sine_t *sine = ctx;
+    for (int i = 0; i < FRAMES; i++)
+        packet[i] = (int16_t)lrint(sine_at(sine->freq, (double)sine->frame++));
+}
+
+static void bench_resampler(void)
+{
+    static const double freqs[] = {100, 1000, 5000, 10000, 16000};
+    static const float ppms[] = {100.f, -1000.f};
+    static resampler_t rs;
+    const int packets = 2000;
+    int16_t out[FRAMES];
+
+    printf("resampler, %d frames per packet at %d Hz\n", FRAMES, SAMPLERATE);
+    printf("%8s %8s %9s %8s\n", "freq", "ppm", "SNR dB", "ns/frame");
+    for (size_t p = 0; p < sizeof(ppms) / sizeof(ppms[0]); p++)
+    {
+        for (size_t f = 0; f < sizeof(freqs) / sizeof(freqs[0]); f++)
+        {
+            sine_t sine = {.freq = freqs[f]};
+            resampler_init(&rs, 1, FRAMES);
+            resampler_set_ppm(&rs, ppms[p]);
+            double step = (double)rs.step / 4294967296.0;
+            double signal = 0.0, noise = 0.0, ns = 0.0;
+            for (int k = 0; k < packets; k++)
+            {
+                double start = now_ns();
+                resampler_read(&rs, out, FRAMES, pull_sine, &sine);
+                ns += now_ns() - start;
+                if (k < 2)
+                    continue;
+                for (int i = 0; i < FRAMES; i++)
+                {
+                    double want = sine_at(sine.freq, ((double)k * FRAMES + i) * step);
+                    signal += want * want;
+                    noise += (out[i] - want) * (out[i] - want);
+                }
+            }
+            printf("%8.0f %8.0f %9.1f %8.2f\n", freqs[f], ppms[p],
+                10.0 * log10(signal / noise), ns / packets / FRAMES);
+        }
+    }
+}
+
+typedef struct {
+    uint32_t drops, stretches, underruns, lost;
+    double fill_accum, fill_sq, fill_max;
+    uint32_t fill_count;
+    float transit_ppm, ppm;
+} loop_result_t;
+
+static jitter_buffer_t jitter;
+static uint8_t jitter_storage[JITTER_SLOTS * ESPNOW_MAX_SEND_LEN];
+static int64_t playout_now;
+
+static void pull_jitter(void *ctx, int16_t *packet)
+{
+    jitter_pop(&jitter, (uint8_t *)packet, playout_now);
+}
+
+static loop_result_t run_loop(const arrival_t *trace, size_t count,
+    double seconds, bool correct)
+{
+    static drift_t drift;
+    static resampler_t rs;
+    const jitter_config_t config = {
+        .packet_us = PACKET_US,
+        .min_depth = 1,
+        .max_depth = 16,
+        .jitter_multiplier = 3.f,
+    };
+    jitter_init(&jitter, jitter_storage, FRAMES * sizeof(int16_t), &config);
+    drift_init(&drift, PACKET_US);
+    resampler_init(&rs, 1, FRAMES);
+
+    loop_result_t result = {0};
+    int16_t payload[FRAMES] = {0};
+    int16_t out[FRAMES];
+    size_t next = 0;
+    long ticks = (long)(seconds * 1e6 / PACKET_US);
+    for (long tick = 0; tick < ticks; tick++)
+    {
+        playout_now = (int64_t)tick * PACKET_US;
+        while (next < count && trace[next].arrival <= playout_now)
+        {
+            jitter_push(&jitter, trace[next].seq, (const uint8_t *)payload,
+                trace[next].arrival);
+            if (correct)
+                drift_arrival(&drift, trace[next].seq, trace[next].arrival);
+            next++;
+        }
+
+        float fill = (float)jitter_depth(&jitter) * FRAMES;
+        // The buffer rests one packet over its target before a pop, and the
+        // resampler pulls at any phase of the packet clock: half a packet more.
+        float target = ((float)jitter.target_depth + 1.5f) * FRAMES;
+        if (correct)
+        {
+            fill += resampler_buffered(&rs);
+            resampler_set_ppm(&rs, drift_update(&drift, fill, target, FRAMES));
+            resampler_read(&rs, out, FRAMES, pull_jitter, NULL);
+        }
+        else
+        {
+            pull_jitter(NULL, out);
+        }
+
+        // Settled half only.
+        if (tick > ticks / 2)
+        {
+            double err = fill - target;
+            result.fill_accum += err;
+            result.fill_sq += err * err;
+            if (fabs(err) > result.fill_max)
+                result.fill_max = fabs(err);
+            result.fill_count++;
+        }
+    }
+    result.drops = jitter.stats.dropped;
+    result.stretches = jitter.stats.stretched;
+    result.underruns = jitter.stats.underruns;
+    result.lost = jitter.stats.lost;
+    result.transit_ppm = drift.transit_ppm;
+    result.ppm = drift.ppm;
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 600.0;
+    double jitter_us = 300.0;
+    double loss_pct = 1.0;
+    unsigned seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:j:l:S:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': seconds = atof(optarg); break;
+        case 'j': jitter_us = atof(optarg); break;
+        case 'l': loss_pct = atof(optarg); break;
+        case 'S': seed = (unsigned)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-s seconds] [-j jitter_us] [-l loss_pct] "
+                            "[-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bench_resampler();
+
+    static const double drifts[] = {0, 20, -50, 200, -500};
+    printf("\nclosed loop, %.0f s, jitter %.0f us, loss %.1f%%; "
+           "fill error over the second half in frames\n",
+        seconds, jitter_us, loss_pct);
+    printf("%7s %9s %9s %8s %8s %8s %6s %6s %7s %6s\n", "drift", "mode", "estimate",
+        "applied", "fill avg", "fill rms", "max", "drops", "stretch", "under");
+    for (size_t d = 0; d < sizeof(drifts) / sizeof(drifts[0]); d++)
+    {
+        // A sender running fast by drift ppm sends each packet that much
+        // sooner on the receiver's clock.
+        size_t cap = (size_t)(seconds * 1e6 / PACKET_US * (1.0 + fabs(drifts[d]) * 1e-6)) + 16;
+        arrival_t *trace = malloc(cap * sizeof(arrival_t));
+        size_t n = 0;
+        srand(seed);
+        for (uint32_t seq = 0; seq < cap; seq++)
+        {
+            if (rand() < loss_pct / 100.0 * RAND_MAX)
+                continue;
+            double sent = (double)seq * PACKET_US / (1.0 + drifts[d] * 1e-6);
+            trace[n].seq = seq;
+            trace[n].arrival = (int64_t)(sent + 1000.0 + fabs(gaussian() * jitter_us));
+            n++;
+        }
+        qsort(trace, n, sizeof(arrival_t), compare_arrival);
+
+        for (int correct = 0; correct <= 1; correct++)
+        {
+            loop_result_t r = run_loop(trace, n, seconds, correct);
+            double avg = r.fill_accum / r.fill_count;
+            printf("%7.0f %9s %9.1f %8.1f %8.1f %8.1f %6.0f %6u %7u %6u\n", drifts[d],
+                correct ? "resample" : "plain", correct ? r.transit_ppm : 0.f,
+                correct ? r.ppm : 0.f, avg,
+                sqrt(r.fill_sq / r.fill_count), r.fill_max, r.drops, r.stretches,
+                r.underruns);
+        }
+        free(trace);
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef __BENCH_IIR_H__
+#define __BENCH_IIR_H__
+
+/*
+ * What the iir1 benches share: the clock they time with, the noise they
+ * filter and their one option,
+ *
+ *   [-s seconds_of_audio]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "war_config.h"
+
+static inline uint64_t nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* White noise from a fixed LCG, peaking at gain. */
+static inline std::vector<float> noise(size_t n, float gain = 1.f)
+{
+    std::vector<float> x(n);
+    uint32_t seed = 1;
+    for (auto &v : x)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        v = gain * (float)(int32_t)seed / 2147483648.f;
+    }
+    return x;
+}
+
+/* Samples of audio to run, from -s or seconds without it: whole blocks of
+ * block, and more than a second. Exits on any other option. */
+static inline size_t bench_samples(int argc, char **argv, double seconds, size_t block)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "s:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': seconds = atof(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-s seconds_of_audio]\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    size_t n = (size_t)(seconds * SAMPLERATE) / block * block;
+    if (n < (size_t)SAMPLERATE)
+        n = SAMPLERATE / block * block + block;
+    return n;
+}
+
+#endif
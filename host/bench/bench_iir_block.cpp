@@ -0,0 +1,127 @@
+/*
+ * iir1 block processing against the per-sample path. Butterworth low
+ * passes of order 2 to 16 filter the same noise once with filter() per
+ * sample and once with process() in blocks of 16 to 1024 samples, and the
+ * throughput of each is reported in Msamples/s with the speedup. Every run
+ * also checks the two outputs match; so does one filter each of
+ * ChebyshevI, ChebyshevII, RBJ and a Custom SOS cascade, in every state
+ * form.
+ *
+ *   bench_iir_block [-s seconds_of_audio]
+ */
+#include <stdio.h>
+
+#include <vector>
+
+#include "Iir.h"
+#include "bench_iir.h"
+
+static bool mismatches = false;
+
+static void check(const char *name, const std::vector<float> &a, const std::vector<float> &b,
+    size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (a[i] != b[i])
+        {
+            printf("%s: process() differs from filter() at %zu: %g != %g\n", name, i,
+                (double)b[i], (double)a[i]);
+            mismatches = true;
+            return;
+        }
+    }
+}
+
+/* Runs filter() per sample into ref and process() in blocks into out. */
+template <class Filter>
+static void compare(const char *name, Filter &f, const std::vector<float> &in)
+{
+    std::vector<float> ref(in.size()), out(in.size());
+    f.reset();
+    for (size_t i = 0; i < in.size(); i++)
+        ref[i] = f.filter(in[i]);
+    f.reset();
+    for (size_t i = 0; i < in.size(); i += 100)
+        f.process(&in[i], &out[i], in.size() - i < 100 ? in.size() - i : 100);
+    check(name, ref, out, in.size());
+}
+
+template <int Order>
+static void bench(const std::vector<float> &in)
+{
+    static const size_t blocks[] = {16, 64, 256, 1024};
+    Iir::Butterworth::LowPass<Order> f;
+    f.setup(SAMPLERATE, 4000.);
+    std::vector<float> ref(in.size()), out(in.size());
+
+    f.reset();
+    uint64_t t0 = nanos();
+    for (size_t i = 0; i < in.size(); i++)
+        ref[i] = f.filter(in[i]);
+    double sample_rate = in.size() * 1e3 / (nanos() - t0);
+
+    printf("%5d %12.2f", Order, sample_rate);
+    for (size_t block : blocks)
+    {
+        f.reset();
+        t0 = nanos();
+        size_t n = in.size() / block * block;
+        for (size_t i = 0; i < n; i += block)
+            f.process(&in[i], &out[i], block);
+        double block_rate = n * 1e3 / (nanos() - t0);
+        printf(" %8.2f %5.2fx", block_rate, block_rate / sample_rate);
+        char name[32];
+        snprintf(name, sizeof(name), "butterworth %d/%zu", Order, block);
+        check(name, ref, out, n);
+    }
+    printf("\n");
+}
+
+template <class StateType>
+static void compare_designs(const char *form, const std::vector<float> &in)
+{
+    char name[64];
+    Iir::ChebyshevI::BandPass<6, StateType> cheby1;
+    cheby1.setup(SAMPLERATE, 2000., 1000., 1.);
+    snprintf(name, sizeof(name), "chebyshev I %s", form);
+    compare(name, cheby1, in);
+
+    Iir::ChebyshevII::HighPass<8, StateType> cheby2;
+    cheby2.setup(SAMPLERATE, 500., 40.);
+    snprintf(name, sizeof(name), "chebyshev II %s", form);
+    compare(name, cheby2, in);
+
+    const double sos[2][6] = {
+        {0.0675, 0.1349, 0.0675, 1.0, -1.1430, 0.4128},
+        {1.0, 2.0, 1.0, 1.0, -1.4432, 0.7408},
+    };
+    Iir::Custom::SOSCascade<2, StateType> custom(sos);
+    snprintf(name, sizeof(name), "custom %s", form);
+    compare(name, custom, in);
+}
+
+int main(int argc, char **argv)
+{
+    // One sample over, so the last block of compare() is a short one.
+    std::vector<float> in = noise(bench_samples(argc, argv, 20., 1) + 1);
+
+    compare_designs<Iir::DirectFormI>("DFI", in);
+    compare_designs<Iir::DirectFormII>("DFII", in);
+    compare_designs<Iir::TransposedDirectFormII>("TDFII", in);
+    Iir::RBJ::LowShelf rbj;
+    rbj.setup(SAMPLERATE, 300., 6.);
+    compare("rbj", rbj, in);
+
+    printf("%zu samples; Msamples/s per sample, then in blocks of 16, 64, 256, 1024\n",
+        in.size());
+    printf("%5s %12s %15s %15s %15s %15s\n", "order", "filter()", "16", "64", "256",
+        "1024");
+    bench<2>(in);
+    bench<4>(in);
+    bench<6>(in);
+    bench<8>(in);
+    bench<12>(in);
+    bench<16>(in);
+    return mismatches ? 2 : 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * Coefficient updates while audio runs. First a writer thread publishes
+ * numbered values through Iir::CoefficientExchange as fast as it can while
+ * a reader takes them, and every value read is checked for being whole and
+ * no older than the one before. Then a sine goes through filters whose
+ * cutoff a 5 Hz LFO sweeps from 125 Hz to 8 kHz, updated every block, as
+ * an Iir::ModulatedCascade (order 4 Butterworth) and a
+ * CFilterButterworth24db, each with and without interpolation. A click
+ * shows as a second difference larger than any sine of that frequency
+ * passing at unity gain can have, so the largest is reported as a ratio to
+ * that bound, and the interpolated ones must stay near it. Last, a control
+ * thread designs and publishes every block while an audio thread filters,
+ * which has to see no heap calls (malloc/calloc/realloc/free are wrapped
+ * at link time, operator new is replaced) and no output that is not
+ * finite; its slowest block is reported.
+ *
+ *   bench_iir_modulation [-s seconds_of_audio]
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "FilterButterworth24db.h"
+#include "Iir.h"
+#include "bench_iir.h"
+
+#define BLOCK 64
+#define SINE_HZ 1000.
+#define SINE_GAIN 0.5f
+#define LFO_HZ 5.
+#define MAX_CLICK_RATIO 1.5
+
+static thread_local unsigned long heap_calls;
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size)
+{
+    heap_calls++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    heap_calls++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    heap_calls++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+    heap_calls++;
+    __real_free(ptr);
+}
+}
+
+void *operator new(size_t size)
+{
+    heap_calls++;
+    void *p = __real_malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    heap_calls++;
+    __real_free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    heap_calls++;
+    __real_free(p);
+}
+
+static bool failed = false;
+
+/* Cutoff of the LFO sweep at sample i: 125 Hz to 8 kHz on a log scale. */
+static double cutoff_at(size_t i)
+{
+    return 1000. * pow(8., sin(2. * M_PI * LFO_HZ * i / SAMPLERATE));
+}
+
+struct Numbered
+{
+    uint32_t seq;
+    uint32_t check[15];
+};
+
+static void exchange(double seconds)
+{
+    Iir::CoefficientExchange<Numbered> x;
+    x.init(Numbered());
+    std::atomic<bool> done(false);
+    uint32_t published = 0;
+
+    std::thread writer([&] {
+        uint64_t end = nanos() + (uint64_t)(seconds * 1e9);
+        while (nanos() < end)
+        {
+            Numbered &v = x.write();
+            v.seq = ++published;
+            for (int i = 0; i < 15; i++)
+                v.check[i] = v.seq * (2654435761u + i);
+            x.publish();
+            // Lets a reader on the same core have a turn now and then.
+            if (!(published % 16))
+                std::this_thread::yield();
+        }
+        done = true;
+    });
+
+    unsigned long fetched = 0, torn = 0, older = 0;
+    uint32_t last = 0;
+    while (!done)
+    {
+        if (!x.fetch())
+            continue;
+        fetched++;
+        const Numbered &v = x.read();
+        for (int i = 0; i < 15; i++)
+        {
+            if (v.check[i] != v.seq * (2654435761u + i))
+            {
+                torn++;
+                break;
+            }
+        }
+        if (v.seq < last)
+            older++;
+        last = v.seq;
+    }
+    writer.join();
+
+    printf("exchange: %u published, %lu fetched, %lu torn, %lu out of order\n", published,
+        fetched, torn, older);
+    if (torn || older || !fetched)
+        failed = true;
+}
+
+/* Largest second difference of out over the bound for a unity gain sine. */
+static double click_ratio(const std::vector<float> &out)
+{
+    const double bound = 4. * pow(sin(M_PI * SINE_HZ / SAMPLERATE), 2.) * SINE_GAIN;
+    double max = 0.;
+    // The first LFO period starts from rest.
+    for (size_t i = SAMPLERATE / 10; i < out.size(); i++)
+    {
+        double d2 = fabs((double)out[i] - 2. * out[i - 1] + out[i - 2]);
+        if (!(d2 <= max))
+            max = d2;
+    }
+    return max / bound;
+}
+
+typedef Iir::ModulatedCascade<2, Iir::TransposedDirectFormIIFloat> Modulated;
+
+static double sweep_iir(const std::vector<float> &in, bool interpolate)
+{
+    Iir::Butterworth::LowPass<4> design;
+    Modulated filter;
+    filter.setInterpolation(interpolate);
+    std::vector<float> out(in.size());
+    for (size_t i = 0; i < in.size(); i += BLOCK)
+    {
+        design.setup(SAMPLERATE, cutoff_at(i + BLOCK));
+        filter.publish(design);
+        filter.process(&in[i], &out[i], BLOCK);
+    }
+    return click_ratio(out);
+}
+
+static double sweep_24db(const std::vector<float> &in, bool interpolate)
+{
+    CFilterButterworth24db filter;
+    filter.SetSampleRate(SAMPLERATE);
+    filter.SetInterpolation(interpolate);
+    std::vector<float> out(in.size());
+    for (size_t i = 0; i < in.size(); i += BLOCK)
+    {
+        filter.Set(cutoff_at(i + BLOCK), 0.f);
+        filter.Process(&in[i], &out[i], BLOCK);
+    }
+    return click_ratio(out);
+}
+
+static void sweeps(const std::vector<float> &in)
+{
+    printf("\nLFO sweep every %d samples, largest second difference over a unity sine's\n",
+        BLOCK);
+    printf("%-24s %10s %10s\n", "filter", "stepped", "ramped");
+    double iir_stepped = sweep_iir(in, false), iir_ramped = sweep_iir(in, true);
+    printf("%-24s %10.2f %10.2f\n", "ModulatedCascade", iir_stepped, iir_ramped);
+    double db24_stepped = sweep_24db(in, false), db24_ramped = sweep_24db(in, true);
+    printf("%-24s %10.2f %10.2f\n", "CFilterButterworth24db", db24_stepped, db24_ramped);
+    if (!(iir_ramped < MAX_CLICK_RATIO) || !(db24_ramped < MAX_CLICK_RATIO))
+    {
+        printf("interpolated sweep clicks (limit %.2f)\n", MAX_CLICK_RATIO);
+        failed = true;
+    }
+}
+
+/* Runs audio() over in a block at a time on this thread while control(i)
+ * runs on another once per block, for the block starting at sample i. The
+ * audio thread yields after each block, as it would wait for the next. */
+template <class Control, class Audio>
+static void live(const char *name, const std::vector<float> &in, Control control, Audio audio)
+{
+    std::atomic<size_t> position(0);
+    std::atomic<bool> done(false);
+    unsigned long publishes = 0;
+    std::thread controller([&] {
+        size_t seen = SIZE_MAX;
+        while (!done)
+        {
+            size_t i = position.load(std::memory_order_relaxed);
+            if (i == seen)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            seen = i;
+            control(i);
+            publishes++;
+        }
+    });
+
+    std::vector<float> out(in.size());
+    uint64_t worst = 0;
+    unsigned long calls = heap_calls;
+    for (size_t i = 0; i < in.size(); i += BLOCK)
+    {
+        uint64_t t0 = nanos();
+        audio(&in[i], &out[i]);
+        uint64_t ns = nanos() - t0;
+        if (ns > worst)
+            worst = ns;
+        position.store(i + BLOCK, std::memory_order_relaxed);
+        std::this_thread::yield();
+    }
+    calls = heap_calls - calls;
+    done = true;
+    controller.join();
+
+    size_t bad = 0;
+    for (float v : out)
+        bad += !std::isfinite(v);
+    printf("%-24s %10lu %12.1f %10lu %10zu\n", name, publishes, worst / 1e3, calls, bad);
+    if (calls || bad)
+        failed = true;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_samples(argc, argv, 5., BLOCK);
+    std::vector<float> in(n);
+    for (size_t i = 0; i < n; i++)
+        in[i] = SINE_GAIN * (float)sin(2. * M_PI * SINE_HZ * i / SAMPLERATE);
+
+    exchange(1.);
+    sweeps(in);
+
+    printf("\ncontrol thread publishing every block of %d from the audio thread\n", BLOCK);
+    printf("%-24s %10s %12s %10s %10s\n", "filter", "publishes", "worst us", "heap calls",
+        "not finite");
+    {
+        Iir::Butterworth::LowPass<4> design;
+        Modulated filter;
+        live("ModulatedCascade", in,
+            [&](size_t i) {
+                design.setup(SAMPLERATE, cutoff_at(i));
+                filter.publish(design);
+            },
+            [&](const float *x, float *y) { filter.process(x, y, BLOCK); });
+    }
+    {
+        CFilterButterworth24db filter;
+        filter.SetSampleRate(SAMPLERATE);
+        live("CFilterButterworth24db", in,
+            [&](size_t i) { filter.Set(cutoff_at(i), 0.f); },
+            [&](const float *x, float *y) { filter.Process(x, y, BLOCK); });
+    }
+    return failed ? 2 : 0;
+}
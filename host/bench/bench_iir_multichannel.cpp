@@ -0,0 +1,136 @@
+/*
+ * iir1 MultiChannelCascade against a filter object per channel. An order 8
+ * Butterworth low pass in float filters 2 to 16 interleaved channels of
+ * noise three ways: a LowPass per channel with filter() per sample, a
+ * LowPass per channel with process() over planar copies of the channels
+ * (made ahead of time and not counted), and one MultiChannelCascade over
+ * the interleaved frames. Then a four band crossover splits one signal
+ * with a filter per band and with processBands(). Costs are in ns per
+ * sample of each channel, and every MultiChannelCascade output is checked
+ * against the filter per channel, which in float it matches exactly.
+ *
+ *   bench_iir_multichannel [-s seconds_of_audio]
+ */
+#include <stdio.h>
+
+#include <vector>
+
+#include "Iir.h"
+#include "bench_iir.h"
+
+#define ORDER 8
+#define BLOCK 64
+
+typedef Iir::Butterworth::LowPass<ORDER, Iir::TransposedDirectFormIIFloat> LowPass;
+
+static bool mismatches = false;
+
+static void check(const char *name, const std::vector<float> &ref, const std::vector<float> &out)
+{
+    for (size_t i = 0; i < ref.size(); i++)
+    {
+        if (ref[i] != out[i])
+        {
+            printf("%s: MultiChannelCascade differs at %zu: %g != %g\n", name, i,
+                (double)out[i], (double)ref[i]);
+            mismatches = true;
+            return;
+        }
+    }
+}
+
+template <int Channels>
+static void bench(const std::vector<float> &signal)
+{
+    const size_t frames = signal.size() / Channels / BLOCK * BLOCK;
+    const size_t n = frames * Channels;
+    std::vector<float> in(signal.begin(), signal.begin() + n), ref(n), out(n);
+
+    std::vector<LowPass> filters(Channels);
+    for (auto &f : filters)
+        f.setup(SAMPLERATE, 4000.);
+    uint64_t t0 = nanos();
+    for (size_t i = 0; i < n; i += Channels)
+        for (int c = 0; c < Channels; c++)
+            ref[i + c] = filters[c].filter(in[i + c]);
+    double per_sample = (double)(nanos() - t0) / n;
+
+    std::vector<std::vector<float>> planar(Channels, std::vector<float>(frames));
+    for (size_t i = 0; i < frames; i++)
+        for (int c = 0; c < Channels; c++)
+            planar[c][i] = in[i * Channels + c];
+    for (auto &f : filters)
+        f.reset();
+    t0 = nanos();
+    for (int c = 0; c < Channels; c++)
+        for (size_t i = 0; i < frames; i += BLOCK)
+            filters[c].process(&planar[c][i], &planar[c][i], BLOCK);
+    double per_block = (double)(nanos() - t0) / n;
+
+    Iir::MultiChannelCascade<Channels, (ORDER + 1) / 2> multi;
+    multi.setup(filters[0]);
+    t0 = nanos();
+    for (size_t i = 0; i < frames; i += BLOCK)
+        multi.process(&in[i * Channels], &out[i * Channels], BLOCK);
+    double per_multi = (double)(nanos() - t0) / n;
+
+    printf("%8d %12.2f %12.2f %12.2f %7.2fx %7.2fx\n", Channels, per_sample, per_block,
+        per_multi, per_sample / per_multi, per_block / per_multi);
+    char name[32];
+    snprintf(name, sizeof(name), "%d channels", Channels);
+    check(name, ref, out);
+}
+
+static void crossover(const std::vector<float> &in)
+{
+    typedef Iir::TransposedDirectFormIIFloat State;
+    Iir::Butterworth::LowPass<2, State> low;
+    Iir::Butterworth::BandPass<2, State> low_mid, high_mid;
+    Iir::Butterworth::HighPass<4, State> high;
+    low.setup(SAMPLERATE, 200.);
+    low_mid.setup(SAMPLERATE, 600., 800.);
+    high_mid.setup(SAMPLERATE, 3000., 4000.);
+    high.setup(SAMPLERATE, 5000.);
+    const Iir::Cascade *bands[] = {&low, &low_mid, &high_mid, &high};
+
+    const size_t n = in.size() / BLOCK * BLOCK;
+    std::vector<float> ref(n * 4), out(n * 4);
+    uint64_t t0 = nanos();
+    for (size_t i = 0; i < n; i++)
+    {
+        ref[i * 4 + 0] = low.filter(in[i]);
+        ref[i * 4 + 1] = low_mid.filter(in[i]);
+        ref[i * 4 + 2] = high_mid.filter(in[i]);
+        ref[i * 4 + 3] = high.filter(in[i]);
+    }
+    double per_sample = (double)(nanos() - t0) / (n * 4);
+
+    Iir::MultiChannelCascade<4, 2> multi;
+    for (int c = 0; c < 4; c++)
+        multi.setup(c, *bands[c]);
+    t0 = nanos();
+    for (size_t i = 0; i < n; i += BLOCK)
+        multi.processBands(&in[i], &out[i * 4], BLOCK);
+    double per_multi = (double)(nanos() - t0) / (n * 4);
+
+    printf("\n4 band crossover, ns per band sample: filter() %.2f, processBands() %.2f, "
+           "%.2fx\n", per_sample, per_multi, per_sample / per_multi);
+    check("crossover", ref, out);
+}
+
+int main(int argc, char **argv)
+{
+    // The same number of samples in all, spread over more channels.
+    std::vector<float> in = noise(bench_samples(argc, argv, 20., 1) * 2 + 16 * BLOCK);
+
+    printf("order %d Butterworth in float, ns per channel sample; speedup of "
+           "MultiChannelCascade\n", ORDER);
+    printf("%8s %12s %12s %12s %8s %8s\n", "channels", "filter()", "process()", "multi",
+        "filter", "process");
+    bench<2>(in);
+    bench<4>(in);
+    bench<8>(in);
+    bench<16>(in);
+    crossover(in);
+    return mismatches ? 2 : 0;
+}
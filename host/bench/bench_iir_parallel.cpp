@@ -0,0 +1,135 @@
+/*
+ * iir1 parallel form against the cascade it is expanded from. High order
+ * Butterworth and Chebyshev low passes filter white noise at -6 dBFS as a
+ * cascade and as ParallelStages, each with filter() per sample and with
+ * process() in blocks, and the throughput of each is reported with the
+ * parallel form's speedup; the cascade and parallel form here are the
+ * double ones, fed and read in double. The error columns give, in dBFS
+ * against the double cascade, what the double parallel form adds and what
+ * the float cascade and float parallel form (Transposed Direct Form II) do,
+ * so the cost of the residues' conditioning shows next to that of single
+ * precision. Every parallel run also checks process() matches filter().
+ *
+ *   bench_iir_parallel [-s seconds_of_audio]
+ */
+#include <math.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "Iir.h"
+#include "bench_iir.h"
+
+#define BLOCK 64
+
+static bool mismatches = false;
+
+/* Msamples/s of filter() per sample into out. */
+template <class Filter, typename Sample>
+static double run_filter(Filter &f, const std::vector<Sample> &in, std::vector<Sample> &out)
+{
+    f.reset();
+    uint64_t t0 = nanos();
+    for (size_t i = 0; i < in.size(); i++)
+        out[i] = f.filter(in[i]);
+    return in.size() * 1e3 / (nanos() - t0);
+}
+
+/* Msamples/s of process() in blocks into out. */
+template <class Filter, typename Sample>
+static double run_process(Filter &f, const std::vector<Sample> &in, std::vector<Sample> &out)
+{
+    f.reset();
+    uint64_t t0 = nanos();
+    for (size_t i = 0; i < in.size(); i += BLOCK)
+        f.process(&in[i], &out[i], BLOCK);
+    return in.size() * 1e3 / (nanos() - t0);
+}
+
+/* Error power of out against ref in dBFS, past the first half second. */
+template <typename Sample>
+static double error_db(const std::vector<double> &ref, const std::vector<Sample> &out)
+{
+    double err = 0.;
+    for (size_t i = SAMPLERATE / 2; i < ref.size(); i++)
+    {
+        double d = (double)out[i] - ref[i];
+        err += d * d;
+    }
+    err /= ref.size() - SAMPLERATE / 2;
+    return err > 0. ? 10. * log10(err) : -999.;
+}
+
+/* The double runs take and give doubles, so the parallel form's error
+ * against the cascade is not lost under float rounding. */
+template <template <int, class> class Design, int Order, class Setup>
+static void compare(const char *name, Setup setup, const std::vector<float> &in)
+{
+    const int stages = (Order + 1) / 2;
+    std::vector<double> in_double(in.begin(), in.end());
+    std::vector<double> ref(in.size()), out(in.size()), block(in.size());
+
+    Design<Order, Iir::DirectFormII> cascade;
+    setup(cascade);
+    double cascade_filter = run_filter(cascade, in_double, ref);
+    double cascade_process = run_process(cascade, in_double, out);
+
+    Iir::ParallelStages<stages, Iir::DirectFormII> parallel;
+    parallel.setup(cascade);
+    double parallel_filter = run_filter(parallel, in_double, out);
+    double parallel_process = run_process(parallel, in_double, block);
+    if (out != block)
+    {
+        printf("%s: parallel process() differs from filter()\n", name);
+        mismatches = true;
+    }
+    double parallel_err = error_db(ref, out);
+
+    std::vector<float> out_float(in.size());
+    Design<Order, Iir::TransposedDirectFormIIFloat> cascade_float;
+    setup(cascade_float);
+    run_process(cascade_float, in, out_float);
+    double cascade_float_err = error_db(ref, out_float);
+
+    Iir::ParallelStages<stages, Iir::TransposedDirectFormIIFloat> parallel_float;
+    parallel_float.setup(cascade_float);
+    run_process(parallel_float, in, out_float);
+    double parallel_float_err = error_db(ref, out_float);
+
+    printf("%-16s %8.1f %8.1f %8.1f %8.1f %5.2fx %5.2fx %8.1f %8.1f %8.1f\n", name,
+        cascade_filter, cascade_process, parallel_filter, parallel_process,
+        parallel_filter / cascade_filter, parallel_process / cascade_process, parallel_err,
+        cascade_float_err, parallel_float_err);
+}
+
+template <int Order, class State>
+using ButterworthLowPass = Iir::Butterworth::LowPass<Order, State>;
+template <int Order, class State>
+using ChebyshevILowPass = Iir::ChebyshevI::LowPass<Order, State>;
+template <int Order, class State>
+using ChebyshevIILowPass = Iir::ChebyshevII::LowPass<Order, State>;
+
+int main(int argc, char **argv)
+{
+    std::vector<float> in = noise(bench_samples(argc, argv, 10., BLOCK), 0.5f);
+
+    printf("Msamples/s of the cascade and the parallel form, speedup, then error in dBFS "
+           "against the double cascade\n");
+    printf("%-16s %8s %8s %8s %8s %6s %6s %8s %8s %8s\n", "design", "c filt", "c proc",
+        "p filt", "p proc", "filt", "proc", "p dbl", "c float", "p float");
+    compare<ButterworthLowPass, 8>("butter lp8 1k",
+        [](Iir::Butterworth::LowPassBase &f) { f.setup(8, SAMPLERATE, 1000.); }, in);
+    compare<ButterworthLowPass, 12>("butter lp12 4k",
+        [](Iir::Butterworth::LowPassBase &f) { f.setup(12, SAMPLERATE, 4000.); }, in);
+    compare<ButterworthLowPass, 16>("butter lp16 1k",
+        [](Iir::Butterworth::LowPassBase &f) { f.setup(16, SAMPLERATE, 1000.); }, in);
+    compare<ButterworthLowPass, 16>("butter lp16 200",
+        [](Iir::Butterworth::LowPassBase &f) { f.setup(16, SAMPLERATE, 200.); }, in);
+    compare<ChebyshevILowPass, 8>("cheby1 lp8 2k",
+        [](Iir::ChebyshevI::LowPassBase &f) { f.setup(8, SAMPLERATE, 2000., 1.); }, in);
+    compare<ChebyshevILowPass, 12>("cheby1 lp12 4k",
+        [](Iir::ChebyshevI::LowPassBase &f) { f.setup(12, SAMPLERATE, 4000., 1.); }, in);
+    compare<ChebyshevIILowPass, 12>("cheby2 lp12 4k",
+        [](Iir::ChebyshevII::LowPassBase &f) { f.setup(12, SAMPLERATE, 4000., 60.); }, in);
+    return mismatches ? 2 : 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * iir1 accuracy in float and Q30 fixed point against the double
+ * reference. Each design filters white noise at -6 dBFS, a -60 dBFS sine,
+ * and a full scale square wave and step (-0.999 to 0.999), with every state
+ * form in double, float and Q30 (Direct Form II has no Q30 form). The
+ * output is compared with the double Direct Form II one: the error is
+ * reported in dBFS (the noise floor the scalar type adds) and as SNR
+ * against the reference output, with the largest single error, throughput,
+ * and the samples off by more than 1e-3 (sat). In Q30 those are
+ * saturation; the float Direct Form II ones on a step at a low cutoff are
+ * its rounding. The low cutoffs put poles close to z = 1, where
+ * coefficient quantisation hurts most.
+ *
+ *   bench_iir_precision [-s seconds_of_audio]
+ */
+#include <math.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "Iir.h"
+#include "bench_iir.h"
+
+#define BLOCK 64
+// An error this large in Q30 is not rounding: it ran out of range.
+#define SATURATED 1e-3
+
+static std::vector<float> sine(size_t n, float gain, double freq)
+{
+    std::vector<float> x(n);
+    for (size_t i = 0; i < n; i++)
+        x[i] = gain * (float)sin(2 * M_PI * freq * i / SAMPLERATE);
+    return x;
+}
+
+static std::vector<float> square(size_t n, float gain, size_t period)
+{
+    std::vector<float> x(n);
+    for (size_t i = 0; i < n; i++)
+        x[i] = i % period < period / 2 ? gain : -gain;
+    return x;
+}
+
+/* From -gain to gain, once the first half second has passed. */
+static std::vector<float> step(size_t n, float gain)
+{
+    std::vector<float> x(n);
+    for (size_t i = 0; i < n; i++)
+        x[i] = i < SAMPLERATE * 3 / 4 ? -gain : gain;
+    return x;
+}
+
+static double db(double power)
+{
+    return power > 0. ? 10. * log10(power) : -999.;
+}
+
+template <class Filter>
+static std::vector<float> run(Filter &f, const std::vector<float> &in, double *msps)
+{
+    std::vector<float> out(in.size());
+    f.reset();
+    uint64_t t0 = nanos();
+    for (size_t i = 0; i + BLOCK <= in.size(); i += BLOCK)
+        f.process(&in[i], &out[i], BLOCK);
+    *msps = in.size() * 1e3 / (nanos() - t0);
+    return out;
+}
+
+static void report(const char *design, const char *signal, const char *form,
+    const std::vector<float> &ref, const std::vector<float> &out, double msps)
+{
+    double sig = 0., err = 0., max = 0.;
+    size_t saturated = 0;
+    // Skip the first half second, where the filters are still settling.
+    for (size_t i = SAMPLERATE / 2; i < ref.size(); i++)
+    {
+        double d = (double)out[i] - ref[i];
+        sig += (double)ref[i] * ref[i];
+        err += d * d;
+        if (fabs(d) > max)
+            max = fabs(d);
+        saturated += fabs(d) > SATURATED;
+    }
+    size_t n = ref.size() - SAMPLERATE / 2;
+    printf("%-18s %-6s %-12s %10.1f %9.1f %10.2e %8.1f %6zu\n", design, signal, form,
+        db(err / n), db(sig / err), max, msps, saturated);
+}
+
+template <template <int, class> class Design, int Order, class Setup>
+static void compare(const char *design, Setup setup, const char *signal,
+    const std::vector<float> &in)
+{
+    double msps;
+    Design<Order, Iir::DirectFormII> reference;
+    setup(reference);
+    std::vector<float> ref = run(reference, in, &msps);
+
+#define FORM(state)                                     \
+    {                                                   \
+        Design<Order, Iir::state> f;                    \
+        setup(f);                                       \
+        std::vector<float> out = run(f, in, &msps);     \
+        report(design, signal, #state, ref, out, msps); \
+    }
+    FORM(DirectFormI)
+    FORM(DirectFormIFloat)
+    FORM(DirectFormIIFloat)
+    FORM(TransposedDirectFormIIFloat)
+    FORM(DirectFormIQ30)
+    FORM(TransposedDirectFormIIQ30)
+#undef FORM
+}
+
+template <int Order, class State>
+using ButterworthLowPass = Iir::Butterworth::LowPass<Order, State>;
+template <int Order, class State>
+using ButterworthHighPass = Iir::Butterworth::HighPass<Order, State>;
+template <int Order, class State>
+using ChebyshevIBandPass = Iir::ChebyshevI::BandPass<Order, State>;
+template <int Order, class State>
+using ChebyshevIIHighPass = Iir::ChebyshevII::HighPass<Order, State>;
+
+static void designs(const char *signal, const std::vector<float> &in)
+{
+    compare<ButterworthLowPass, 4>("butter lp4 4k",
+        [](Iir::Butterworth::LowPassBase &f) { f.setup(4, SAMPLERATE, 4000.); }, signal, in);
+    compare<ButterworthLowPass, 4>("butter lp4 100",
+        [](Iir::Butterworth::LowPassBase &f) { f.setup(4, SAMPLERATE, 100.); }, signal, in);
+    compare<ButterworthLowPass, 8>("butter lp8 1k",
+        [](Iir::Butterworth::LowPassBase &f) { f.setup(8, SAMPLERATE, 1000.); }, signal, in);
+    compare<ButterworthHighPass, 4>("butter hp4 100",
+        [](Iir::Butterworth::HighPassBase &f) { f.setup(4, SAMPLERATE, 100.); }, signal, in);
+    compare<ChebyshevIBandPass, 4>("cheby1 bp4 1k",
+        [](Iir::ChebyshevI::BandPassBase &f) { f.setup(4, SAMPLERATE, 1000., 200., 1.); },
+        signal, in);
+    compare<ChebyshevIIHighPass, 6>("cheby2 hp6 50",
+        [](Iir::ChebyshevII::HighPassBase &f) { f.setup(6, SAMPLERATE, 50., 40.); },
+        signal, in);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = bench_samples(argc, argv, 5., BLOCK);
+    printf("%-18s %-6s %-12s %10s %9s %10s %8s %6s\n", "design", "signal", "form",
+        "err dBFS", "SNR dB", "max err", "Msmp/s", "sat");
+    designs("noise", noise(n, 0.5f));
+    designs("sine", sine(n, 0.001f, 997.));
+    // Full scale: a high pass overshoots these to about twice the input.
+    designs("square", square(n, 0.999f, 100));
+    designs("step", step(n, 0.999f));
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Sample-format kernel benchmark. Runs every variant of every kernel in
+ * war_kernels.h over a range of buffer sizes and reports ns per sample
+ * (per frame for the stereo kernels), with the variant the kern_* names
+ * use marked. Outputs are checked against the portable variant first.
+ *
+ *   bench_kernels [-s samples] [-t target_ms]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "war_kernels.h"
+
+#define MAX_SAMPLES 8192
+
+enum {
+    K_DEINTERLEAVE,
+    K_INTERLEAVE,
+    K_EXTRACT,
+    K_SUM_MONO,
+    K_I16_TO_FLOAT,
+    K_FLOAT_TO_I16,
+    K_GAIN_CLIP,
+    K_COUNT,
+};
+
+static const char* const kernel_names[K_COUNT] = {
+    "deinterleave", "interleave", "extract", "sum_mono",
+    "i16_to_float", "float_to_i16", "gain_clip",
+};
+
+static int16_t src_i16[2 * MAX_SAMPLES];
+static float src_f[MAX_SAMPLES];
+static int16_t out_a[2 * MAX_SAMPLES], out_b[2 * MAX_SAMPLES];
+static float outf_a[MAX_SAMPLES];
+
+static uint64_t nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void call(const kern_ops_t* ops, int k, size_t n, int16_t* out, float* outf)
+{
+    switch (k)
+    {
+    case K_DEINTERLEAVE: ops->deinterleave(src_i16, out, out + n, n); break;
+    case K_INTERLEAVE: ops->interleave(src_i16, src_i16 + n, out, n); break;
+    case K_EXTRACT: ops->extract(src_i16, 1, out, n); break;
+    case K_SUM_MONO: ops->sum_mono(src_i16, out, n); break;
+    case K_I16_TO_FLOAT: ops->i16_to_float(src_i16, outf, n); break;
+    case K_FLOAT_TO_I16: ops->float_to_i16(src_f, out, n); break;
+    case K_GAIN_CLIP: ops->gain_clip(src_f, outf, n, 1.7f); break;
+    }
+}
+
+static bool same(const kern_ops_t* ops, int k, size_t n)
+{
+    float ref_f[MAX_SAMPLES];
+    memset(out_a, 0, sizeof(out_a));
+    memset(out_b, 0, sizeof(out_b));
+    call(&kern_variants[0], k, n, out_a, ref_f);
+    call(ops, k, n, out_b, outf_a);
+    if (k == K_I16_TO_FLOAT || k == K_GAIN_CLIP)
+        return memcmp(ref_f, outf_a, n * sizeof(float)) == 0;
+    return memcmp(out_a, out_b, sizeof(out_a)) == 0;
+}
+
+static double ns_per_sample(const kern_ops_t* ops, int k, size_t n, double target_ns)
+{
+    // Calibrate a repeat count, then keep the best of five runs.
+    long reps = 1;
+    for (;;)
+    {
+        uint64_t t0 = nanos();
+        for (long r = 0; r < reps; r++)
+            call(ops, k, n, out_b, outf_a);
+        if (nanos() - t0 > target_ns / 10 || reps > (1L << 30))
+            break;
+        reps *= 2;
+    }
+    double best = 1e30;
+    for (int run = 0; run < 5; run++)
+    {
+        uint64_t t0 = nanos();
+        for (long r = 0; r < reps; r++)
+        {
+            call(ops, k, n, out_b, outf_a);
+            __asm__ volatile("" ::: "memory");
+        }
+        double ns = (double)(nanos() - t0) / reps / n;
+        if (ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    size_t sizes[8] = {16, 96, 240, 1024, 4096};
+    int size_count = 5;
+    double target_ms = 20.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:t:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            sizes[0] = (size_t)atoi(optarg);
+            size_count = 1;
+            break;
+        case 't': target_ms = atof(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-s samples] [-t target_ms]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (sizes[0] < 1 || sizes[0] > MAX_SAMPLES)
+        sizes[0] = 96;
+
+    srand(1);
+    for (size_t i = 0; i < 2 * MAX_SAMPLES; i++)
+        src_i16[i] = (int16_t)(rand() & 0xffff);
+    for (size_t i = 0; i < MAX_SAMPLES; i++)
+        src_f[i] = 2.5f * ((float)rand() / RAND_MAX - 0.5f);
+    src_f[0] = 1.0f;
+    src_f[1] = -1.0f;
+    src_f[2] = 0.5f / 32768.f;
+    src_f[3] = -0.5f / 32768.f;
+
+    printf("ns per sample, * marks the build's choice (%s)\n", kern_selected);
+    printf("%-13s %-9s", "kernel", "variant");
+    for (int s = 0; s < size_count; s++)
+        printf(" %8zu", sizes[s]);
+    printf("\n");
+
+    int failed = 0;
+    for (int k = 0; k < K_COUNT; k++)
+    {
+        for (int v = 0; v < KERN_VARIANT_COUNT; v++)
+        {
+            const kern_ops_t* ops = &kern_variants[v];
+            bool selected = strcmp(ops->name, kern_selected) == 0;
+            printf("%-13s %c%-8s", v == 0 ? kernel_names[k] : "", selected ? '*' : ' ',
+                ops->name);
+            for (int s = 0; s < size_count; s++)
+            {
+                if (!same(ops, k, sizes[s]))
+                {
+                    printf(" %8s", "MISMATCH");
+                    failed++;
+                    continue;
+                }
+                printf(" %8.3f", ns_per_sample(ops, k, sizes[s], target_ms * 1e6));
+            }
+            printf("\n");
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Channel layout cost. Packs packets of random L/R frames with every
+ * layout in war_layout.h and unpacks them again, reporting time and cycles
+ * per packet each way, the share of the packet period that takes, and the
+ * largest error against the source channels. The "ms-scalar" row runs a
+ * plain per-sample mid/side loop to compare the vector kernel against.
+ *
+ *   bench_layout [-f frames] [-r rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "war_config.h"
+#include "war_espnow.h"
+#include "war_layout.h"
+
+#define MAX_FRAMES 1024
+
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint64_t nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void scalar_pack(const int16_t *lr, size_t frames, int16_t *out)
+{
+    for (size_t i = 0; i < frames; i++)
+    {
+        int32_t l = lr[2 * i], r = lr[2 * i + 1];
+        out[i] = (int16_t)((l + r) >> 1);
+        out[frames + i] = (int16_t)((l - r) >> 1);
+    }
+}
+
+static void scalar_unpack(int16_t *frame, size_t frames)
+{
+    for (size_t i = 0; i < frames; i++)
+    {
+        int32_t m = frame[i], s = frame[frames + i];
+        int32_t l = m + s, r = m - s;
+        frame[i] = (int16_t)(l > INT16_MAX ? INT16_MAX : l < INT16_MIN ? INT16_MIN : l);
+        frame[frames + i] = (int16_t)(r > INT16_MAX ? INT16_MAX : r < INT16_MIN ? INT16_MIN : r);
+    }
+}
+
+static int expect(channel_layout_t layout, const int16_t *lr, size_t i, int ch)
+{
+    int32_t l = lr[2 * i], r = lr[2 * i + 1];
+    switch (layout)
+    {
+    case LAYOUT_MONO_RIGHT: return r;
+    case LAYOUT_MONO_LEFT: return l;
+    case LAYOUT_MONO_SUM: return (l + r) >> 1;
+    default: return ch ? r : l;
+    }
+}
+
+static void run(const char *name, int layout, const int16_t *src, size_t frames,
+    size_t packets, int rounds)
+{
+    int16_t out[2 * MAX_FRAMES];
+    uint64_t pack_ns = 0, pack_cyc = 0, unpack_ns = 0, unpack_cyc = 0;
+    int max_err = 0;
+    channel_layout_t id = layout < 0 ? LAYOUT_MID_SIDE : (channel_layout_t)layout;
+    int channels = LAYOUT_CHANNELS(id);
+
+    for (int round = 0; round < rounds; round++)
+    {
+        for (size_t p = 0; p < packets; p++)
+        {
+            const int16_t *lr = src + 2 * frames * p;
+            uint64_t t0 = nanos(), c0 = cycles();
+            if (layout < 0)
+                scalar_pack(lr, frames, out);
+            else
+                layout_pack(id, lr, frames, out);
+            pack_cyc += cycles() - c0;
+            pack_ns += nanos() - t0;
+
+            t0 = nanos();
+            c0 = cycles();
+            if (layout < 0)
+                scalar_unpack(out, frames);
+            else
+                layout_unpack(id, out, frames);
+            unpack_cyc += cycles() - c0;
+            unpack_ns += nanos() - t0;
+
+            if (round > 0)
+                continue;
+            for (size_t i = 0; i < frames; i++)
+            {
+                for (int ch = 0; ch < channels; ch++)
+                {
+                    int err = abs(out[ch * frames + i] - expect(id, lr, i, ch));
+                    if (err > max_err)
+                        max_err = err;
+                }
+            }
+        }
+    }
+
+    double total = (double)packets * rounds;
+    double us = (pack_ns + unpack_ns) / total * 1e-3;
+    printf("%-11s %8.0f %9.0f %10.0f %11.0f %8.3f %7d\n", name, pack_ns / total,
+        pack_cyc / total, unpack_ns / total, unpack_cyc / total,
+        100.0 * us / (frames * 1e6 / SAMPLERATE), max_err);
+}
+
+int main(int argc, char **argv)
+{
+    size_t frames = ESPNOW_DEFAULT_FRAMES;
+    int rounds = 200;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f': frames = (size_t)atoi(optarg); break;
+        case 'r': rounds = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-f frames] [-r rounds]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (frames < 1 || frames > MAX_FRAMES)
+        frames = ESPNOW_DEFAULT_FRAMES;
+    if (rounds < 1)
+        rounds = 1;
+
+    // Full-scale noise, with the extremes mixed in.
+    size_t packets = 1000;
+    int16_t *src = malloc(packets * frames * 2 * sizeof(int16_t));
+    srand(1);
+    for (size_t i = 0; i < packets * frames * 2; i++)
+        src[i] = (int16_t)(rand() & 0xffff);
+    src[0] = INT16_MIN;
+    src[1] = INT16_MAX;
+    src[2] = INT16_MAX;
+    src[3] = INT16_MIN;
+
+    printf("%zu packets of %zu frames (%.0f us), %d rounds\n", packets, frames,
+        frames * 1e6 / SAMPLERATE, rounds);
+    printf("%-11s %8s %9s %10s %11s %8s %7s\n", "layout", "pack ns", "pack cyc",
+        "unpack ns", "unpack cyc", "% budget", "max err");
+    for (int id = 0; id < LAYOUT_COUNT; id++)
+        run(layout_name((channel_layout_t)id), id, src, frames, packets, rounds);
+    run("ms-scalar", -1, src, frames, packets, rounds);
+
+    free(src);
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Bytes copied per packet on the capture path, mixer_read() through
+ * espnow_data_prepare(). Runs the real transmitter pipeline flat out and
+ * reads the copy counters of the stand-in queues, then logs the stages'
+ * profile (see war_profile.h).
+ *
+ *   bench_packet_copy [packets]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "esp_host.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+
+#include "war_espnow.h"
+#include "war_mixer.h"
+#include "war_profile.h"
+
+int main(int argc, char **argv)
+{
+    long packets = argc > 1 ? strtol(argv[1], NULL, 0) : 20000;
+
+    esp_now_host_set_endpoint("127.0.0.1", 3390, 3391);
+    ESP_ERROR_CHECK( espnow_init(false) );
+    i2s_host_set_unpaced(I2S_NUM_0, true);
+    mixer_init();
+
+    int64_t start = esp_timer_get_time();
+    for (long i = 0; i < packets; i++)
+        mixer_read();
+    int64_t elapsed = esp_timer_get_time() - start;
+    vTaskDelay(pdMS_TO_TICKS(50));
+
+    // i2s_read() and the mono extraction write every byte once per packet
+    // regardless of how the packet reaches the sender.
+    double dma = mixer.mix_buf_len * sizeof(int16_t);
+    double extract = ESPNOW_DEFAULT_SEND_LEN;
+    double queued = (double)(queue_host_bytes_copied(espnow_data_queue) +
+                             queue_host_bytes_copied(espnow_free_queue)) / packets;
+
+    printf("packets:               %ld\n", packets);
+    printf("payload bytes:         %u\n", (unsigned)ESPNOW_DEFAULT_SEND_LEN);
+    printf("i2s_read -> mix_buf:   %.1f B/packet\n", dma);
+    printf("mono extraction:       %.1f B/packet\n", extract);
+    printf("queue copies:          %.1f B/packet\n", queued);
+    printf("total copied:          %.1f B/packet\n", dma + extract + queued);
+    printf("mixer_read:            %.2f us/packet\n", (double)elapsed / packets);
+    fflush(stdout);
+    profile_log(ESPNOW_DEFAULT_PACKET_US);
+    return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * Packet-loss concealment cost and quality. A reference signal is cut into
+ * packets, packets are dropped by a Gilbert-style loss model, and each PLC
+ * mode rebuilds the stream. Reports time and cycles per concealed frame and
+ * SNR against the reference, over the whole stream and as segmental SNR
+ * over the concealed frames (each frame clamped to [-10, 35] dB). The "+red"
+ * row plays the redundant copy from the next packet (war_redundant.h) when
+ * that one arrived, and pitch concealment otherwise.
+ *
+ * Last, streams of 1 ms packets at every multiple of 8 kHz up to 96 kHz
+ * go through espnow_set_stream(), which a receiver's stream packets pass
+ * too. Each one it takes is concealed in every mode, and the run fails
+ * (exit status 2) if it takes a rate the concealer cannot handle.
+ *
+ *   bench_plc [-i reference.wav] [-l loss_pct] [-b mean_burst] [-S seed]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "driver/i2s.h"
+#include "esp_host.h"
+
+#include "war_config.h"
+#include "war_espnow.h"
+#include "war_plc.h"
+#include "war_redundant.h"
+
+#define FRAME       ESPNOW_DEFAULT_SAMPLES
+#define SYNTH_SECS  10
+
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint64_t nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Plucked-string-like notes: decaying harmonics with a little vibrato. */
+static size_t synth_reference(int16_t **out)
+{
+    size_t n = SAMPLERATE * SYNTH_SECS / FRAME * FRAME;
+    int16_t *ref = malloc(n * sizeof(int16_t));
+    const double notes[] = {82.4, 110.0, 146.8, 196.0, 246.9, 329.6};
+    double phase = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        double t = (double)i / SAMPLERATE;
+        int note = (int)(t / 0.5) % 6;
+        double local = fmod(t, 0.5);
+        double f = notes[note] * (1.0 + 0.003 * sin(2 * M_PI * 5.0 * t));
+        phase += 2 * M_PI * f / SAMPLERATE;
+        double v = 0.0;
+        for (int h = 1; h <= 6; h++)
+            v += sin(h * phase) / h;
+        ref[i] = (int16_t)(9000.0 * exp(-3.0 * local) * v);
+    }
+    *out = ref;
+    return n;
+}
+
+static size_t load_reference(int16_t **out, const char *path)
+{
+    i2s_config_t config = {
+        .mode = (i2s_mode_t) (I2S_MODE_MASTER | I2S_MODE_RX),
+        .sample_rate = SAMPLERATE,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+    };
+    ESP_ERROR_CHECK( i2s_driver_install(I2S_NUM_0, &config, 0, NULL) );
+    ESP_ERROR_CHECK( i2s_host_set_source(I2S_NUM_0, path, false) );
+
+    size_t cap = SAMPLERATE, n = 0;
+    int16_t *ref = malloc(cap * sizeof(int16_t));
+    int16_t stereo[FRAME * 2];
+    size_t bytes_read;
+    for (;;)
+    {
+        i2s_read(I2S_NUM_0, stereo, sizeof(stereo), &bytes_read, portMAX_DELAY);
+        if (i2s_host_source_done(I2S_NUM_0))
+            break;
+        if (n + FRAME > cap)
+            ref = realloc(ref, (cap *= 2) * sizeof(int16_t));
+        // The channel mixer_read() transmits.
+        for (int i = 0; i < FRAME; i++)
+            ref[n + i] = stereo[2 * i + 1];
+        n += FRAME;
+    }
+    i2s_driver_uninstall(I2S_NUM_0);
+    *out = ref;
+    return n;
+}
+
+static double snr_db(double signal, double noise)
+{
+    if (noise <= 0.0)
+        return 99.0;
+    return 10.0 * log10((signal + 1e-9) / noise);
+}
+
+/* Conceals a 220 Hz tone at each stream rate espnow_set_stream() takes. */
+static bool check_rates(void)
+{
+    bool ok = true;
+    printf("\nstream rates taken:");
+    for (uint32_t rate = 8000; rate <= 96000; rate += 8000)
+    {
+        uint16_t frames = (uint16_t)(rate / 1000);
+        if (!espnow_set_stream(rate, frames))
+            continue;
+        printf(" %u", rate);
+        if (rate > PLC_MAX_SAMPLE_RATE)
+            ok = false;
+        for (int mode = PLC_SILENCE; ok && mode <= PLC_PITCH; mode++)
+        {
+            plc_t *plc = malloc(sizeof(plc_t));
+            plc_init(plc, (plc_mode_t)mode, frames * ESPNOW_CHANNELS, rate);
+            int16_t frame[PLC_MAX_FRAME];
+            for (int f = 0; f < 20; f++)
+            {
+                for (size_t i = 0; i < plc->frame_len; i++)
+                    frame[i] = (int16_t)(8000.0 *
+                        sin(2 * M_PI * 220.0 * (f * plc->frame_len + i) / rate));
+                if (f % 5 == 4)
+                    plc_conceal(plc, frame);
+                else
+                    plc_good(plc, frame);
+            }
+            free(plc);
+        }
+    }
+    printf("\n%s\n", ok ? "all concealed" : "TAKES A RATE ABOVE PLC_MAX_SAMPLE_RATE");
+    return ok;
+}
+
+static void run(const char *name, int mode, const int16_t *ref, size_t n,
+    const bool *lost, bool redundant)
+{
+    plc_t *plc = malloc(sizeof(plc_t));
+    if (mode >= 0)
+        plc_init(plc, (plc_mode_t)mode, FRAME, SAMPLERATE);
+
+    double sig = 0.0, noise = 0.0, seg = 0.0;
+    uint64_t ns = 0, cyc = 0;
+    size_t concealed = 0;
+    int16_t frame[FRAME];
+    for (size_t f = 0; f < n / FRAME; f++)
+    {
+        const int16_t *r = ref + f * FRAME;
+        if (redundant && lost[f] && f + 1 < n / FRAME && !lost[f + 1])
+        {
+            uint8_t coded[REDUNDANT_LEN(FRAME)];
+            redundant_encode(r, FRAME, coded);
+            redundant_decode(coded, FRAME, frame);
+            plc_good(plc, frame);
+        }
+        else if (!lost[f])
+        {
+            memcpy(frame, r, sizeof(frame));
+            if (mode >= 0)
+                plc_good(plc, frame);
+        }
+        else if (mode >= 0)
+        {
+            uint64_t t0 = nanos(), c0 = cycles();
+            plc_conceal(plc, frame);
+            cyc += cycles() - c0;
+            ns += nanos() - t0;
+        }
+        else
+        {
+            memset(frame, 0, sizeof(frame));
+        }
+
+        double fs = 0.0, fn = 0.0;
+        for (int i = 0; i < FRAME; i++)
+        {
+            double d = (double)frame[i] - r[i];
+            fs += (double)r[i] * r[i];
+            fn += d * d;
+        }
+        sig += fs;
+        noise += fn;
+        if (lost[f])
+        {
+            double s = snr_db(fs, fn);
+            seg += s < -10.0 ? -10.0 : s > 35.0 ? 35.0 : s;
+            concealed++;
+        }
+    }
+    printf("%-8s %10.0f %12.0f %10.2f %12.2f\n", name,
+        concealed ? (double)ns / concealed : 0.0,
+        concealed ? (double)cyc / concealed : 0.0,
+        snr_db(sig, noise), concealed ? seg / concealed : 0.0);
+    free(plc);
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    double loss_pct = 5.0, burst = 1.5;
+    unsigned seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:l:b:S:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'i': input = optarg; break;
+        case 'l': loss_pct = atof(optarg); break;
+        case 'b': burst = atof(optarg); break;
+        case 'S': seed = (unsigned)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-i reference.wav] [-l loss_pct] "
+                            "[-b mean_burst] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int16_t *ref;
+    size_t n = input ? load_reference(&ref, input) : synth_reference(&ref);
+    size_t frames = n / FRAME;
+
+    // Two-state loss model: enter a burst with p, stay in it with 1 - 1/burst.
+    bool *lost = calloc(frames, sizeof(bool));
+    double stay = burst > 1.0 ? 1.0 - 1.0 / burst : 0.0;
+    double p = loss_pct / 100.0 * (1.0 - stay) / (1.0 - loss_pct / 100.0);
+    srand(seed);
+    size_t lost_count = 0;
+    for (size_t f = 1; f < frames; f++)
+    {
+        double u = rand() / (double)RAND_MAX;
+        lost[f] = lost[f - 1] ? u < stay : u < p;
+        lost_count += lost[f];
+    }
+
+    printf("%zu frames of %d samples, %zu lost (%.1f%%)\n", frames, FRAME,
+        lost_count, 100.0 * lost_count / frames);
+    printf("%-8s %10s %12s %10s %12s\n", "mode", "ns/frame", "cycles/frame",
+        "SNR dB", "segSNR dB");
+    run("none", -1, ref, n, lost, false);
+    run(plc_mode_name(PLC_SILENCE), PLC_SILENCE, ref, n, lost, false);
+    run(plc_mode_name(PLC_REPEAT), PLC_REPEAT, ref, n, lost, false);
+    run(plc_mode_name(PLC_PITCH), PLC_PITCH, ref, n, lost, false);
+    run("pitch+red", PLC_PITCH, ref, n, lost, true);
+    bool ok = check_rates();
+
+    free(lost);
+    free(ref);
+    return ok ? 0 : 2;
+}
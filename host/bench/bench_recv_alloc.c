@@ -0,0 +1,120 @@
+/*
+ * Heap calls on the receive path. Valid audio packets go straight into
+ * espnow_recv_cb(), as the Wi-Fi task would deliver them, espnow_task()
+ * files them into the jitter buffer and the main loop plays them out.
+ * malloc/calloc/realloc/free are wrapped at link time, so every call from
+ * the firmware sources and the stand-ins is counted; once the pipeline is
+ * warm there must be none. Exits non-zero if any are seen. The receive
+ * stages' profile (see war_profile.h) is logged at the end.
+ *
+ *   bench_recv_alloc [packets]
+ */
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_host.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+
+#include "war_espnow.h"
+#include "war_profile.h"
+
+#define WARMUP_PACKETS 1000
+
+static atomic_ulong heap_calls;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size)
+{
+    atomic_fetch_add(&heap_calls, 1);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    atomic_fetch_add(&heap_calls, 1);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    atomic_fetch_add(&heap_calls, 1);
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+    atomic_fetch_add(&heap_calls, 1);
+    __real_free(ptr);
+}
+
+static jitter_buffer_t jitter;
+static uint8_t jitter_storage[JITTER_SLOTS * ESPNOW_DEFAULT_SEND_LEN];
+
+int main(int argc, char **argv)
+{
+    long packets = argc > 1 ? strtol(argv[1], NULL, 0) : 20000;
+    const uint8_t mac[ESP_NOW_ETH_ALEN] = {0x02, 0, 0, 0, 0, 0x02};
+
+    esp_now_host_set_endpoint("127.0.0.1", 3392, 3393);
+    ESP_ERROR_CHECK( espnow_init(true) );
+    const jitter_config_t config = {
+        .packet_us = ESPNOW_DEFAULT_PACKET_US,
+        .min_depth = 2,
+        .max_depth = 8,
+        .jitter_multiplier = 3.f,
+    };
+    jitter_init(&jitter, jitter_storage, ESPNOW_DEFAULT_SEND_LEN, &config);
+    espnow_set_jitter_buffer(&jitter);
+    espnow_set_rbuf_state(ESPNOW_RBUF_ACTIVE);
+
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    uint8_t out[ESPNOW_DEFAULT_SEND_LEN];
+    espnow_data_t *packet = (espnow_data_t *)frame;
+    const int len = ESPNOW_OVERHEAD + ESPNOW_DEFAULT_SEND_LEN;
+    unsigned long warm = 0;
+    static latency_hist_t cb_hist;
+    latency_hist_init(&cb_hist);
+    for (long i = 0; i < packets; i++)
+    {
+        if (i == WARMUP_PACKETS)
+            warm = atomic_load(&heap_calls);
+
+        packet->seq_num = (uint32_t)i;
+        memset(packet->payload, (uint8_t)i, ESPNOW_DEFAULT_SEND_LEN);
+        espnow_data_seal(packet, len - ESPNOW_TRAILER_LEN, ESPNOW_PACKET_AUDIO, 0);
+
+        {
+            PROFILE_SCOPE(&cb_hist);
+            espnow_recv_cb(mac, frame, len);
+        }
+
+        // Let espnow_task() keep up, then play one packet out.
+        while (uxQueueMessagesWaiting(espnow_queue) > ESPNOW_QUEUE_SIZE / 2)
+            vTaskDelay(1);
+        espnow_jitter_pop(out);
+    }
+    vTaskDelay(pdMS_TO_TICKS(20));
+    unsigned long steady = atomic_load(&heap_calls) - warm;
+
+    printf("packets:                %ld (%d warm-up)\n", packets, WARMUP_PACKETS);
+    printf("espnow_recv_cb:         %.0f ns/packet, p99 %u\n",
+        (double)cb_hist.sum / cb_hist.count * 1000 / PROFILE_TICKS_PER_US,
+        latency_percentile(&cb_hist, 99.f) * 1000 / PROFILE_TICKS_PER_US);
+    static uint8_t buf[TELEMETRY_SNAPSHOT_MAX];
+    static telemetry_snapshot_t snap;
+    telemetry_parse(buf, telemetry_take(buf, sizeof(buf)), &snap);
+    printf("receive slots:          %d, max in use %u, dropped %u\n", ESPNOW_RECV_SLOTS,
+        snap.peaks[TELEMETRY_RX_SLOTS_USED],
+        snap.counters[TELEMETRY_RX_POOL_EMPTY] + snap.counters[TELEMETRY_RX_QUEUE_FULL]);
+    printf("steady-state heap calls: %lu\n", steady);
+    fflush(stdout);
+    profile_log(ESPNOW_DEFAULT_PACKET_US);
+    return steady == 0 ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+/*
+ * ringbuf_i16 throughput against the previous per-sample implementation,
+ * plus concurrent SPSC and MPMC runs that check every sample arrives in
+ * order (SPSC) or exactly once (MPMC).
+ *
+ *   bench_ringbuf [megasamples]
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_timer.h"
+
+#include "ringbuf_i16.h"
+#include "ringbuf_i16_mpmc.h"
+
+#define RING_SIZE   1024
+#define BLOCK       96
+#define MPMC_SLOTS  16
+#define PRODUCERS   2
+#define CONSUMERS   2
+
+/* The per-sample ring as it was before block operations. */
+typedef struct {
+    int16_t *buffer;
+    uint32_t max;
+    atomic_uint read;
+    atomic_uint write;
+} legacy_ringbuf_t;
+
+static size_t legacy_size(legacy_ringbuf_t *rbuf)
+{
+    return atomic_load(&rbuf->write) - atomic_load(&rbuf->read);
+}
+
+static void legacy_write(legacy_ringbuf_t *rbuf, int16_t val)
+{
+    if (legacy_size(rbuf) == rbuf->max)
+        atomic_fetch_add(&rbuf->read, 1);
+    rbuf->buffer[atomic_fetch_add(&rbuf->write, 1) & (rbuf->max - 1)] = val;
+}
+
+static int16_t legacy_read(legacy_ringbuf_t *rbuf)
+{
+    return rbuf->buffer[atomic_fetch_add(&rbuf->read, 1) & (rbuf->max - 1)];
+}
+
+static double mega_per_sec(uint64_t samples, int64_t us)
+{
+    return (double)samples / (double)us;
+}
+
+static void bench_single_thread(uint64_t total)
+{
+    int16_t storage[RING_SIZE];
+    int16_t in[BLOCK], out[BLOCK];
+    for (int i = 0; i < BLOCK; i++)
+        in[i] = (int16_t)i;
+    uint64_t blocks = total / BLOCK;
+    int64_t sink = 0;
+
+    legacy_ringbuf_t legacy = {storage, RING_SIZE};
+    int64_t start = esp_timer_get_time();
+    for (uint64_t b = 0; b < blocks; b++)
+    {
+        for (int i = 0; i < BLOCK; i++)
+            legacy_write(&legacy, in[i]);
+        for (int i = 0; i < BLOCK; i++)
+            out[i] = legacy_read(&legacy);
+        sink += out[b % BLOCK];
+    }
+    int64_t legacy_us = esp_timer_get_time() - start;
+
+    ringbuf_i16_handle_t rbuf = ringbuf_i16_init(storage, RING_SIZE);
+    start = esp_timer_get_time();
+    for (uint64_t b = 0; b < blocks; b++)
+    {
+        ringbuf_i16_write_n(rbuf, in, BLOCK);
+        ringbuf_i16_read_n(rbuf, out, BLOCK);
+        sink += out[b % BLOCK];
+    }
+    int64_t block_us = esp_timer_get_time() - start;
+    ringbuf_i16_free(rbuf);
+
+    printf("single thread, %d-sample blocks (checksum %lld)\n", BLOCK, (long long)sink);
+    printf("  per-sample (previous): %8.1f Msamples/s\n", mega_per_sec(blocks * BLOCK, legacy_us));
+    printf("  write_n/read_n:        %8.1f Msamples/s\n", mega_per_sec(blocks * BLOCK, block_us));
+}
+
+typedef struct {
+    ringbuf_i16_handle_t rbuf;
+    uint64_t total;
+    uint64_t errors;
+} spsc_args_t;
+
+static void *spsc_producer(void *arg)
+{
+    spsc_args_t *args = arg;
+    int16_t block[BLOCK];
+    uint64_t sent = 0;
+    while (sent < args->total)
+    {
+        for (int i = 0; i < BLOCK; i++)
+            block[i] = (int16_t)(sent + i);
+        size_t n = args->total - sent < BLOCK ? args->total - sent : BLOCK;
+        size_t done = 0;
+        while (done < n)
+        {
+            size_t written = ringbuf_i16_write_n(args->rbuf, block + done, n - done);
+            if (written == 0)
+                sched_yield();
+            done += written;
+        }
+        sent += n;
+    }
+    return NULL;
+}
+
+static void *spsc_consumer(void *arg)
+{
+    spsc_args_t *args = arg;
+    int16_t block[BLOCK * 2];
+    uint64_t received = 0;
+    while (received < args->total)
+    {
+        size_t n = ringbuf_i16_read_n(args->rbuf, block, sizeof(block) / sizeof(block[0]));
+        if (n == 0)
+            sched_yield();
+        for (size_t i = 0; i < n; i++)
+            args->errors += block[i] != (int16_t)(received + i);
+        received += n;
+    }
+    return NULL;
+}
+
+static void bench_spsc(uint64_t total)
+{
+    int16_t storage[RING_SIZE];
+    spsc_args_t args = {ringbuf_i16_init(storage, RING_SIZE), total, 0};
+    pthread_t producer, consumer;
+
+    int64_t start = esp_timer_get_time();
+    pthread_create(&consumer, NULL, spsc_consumer, &args);
+    pthread_create(&producer, NULL, spsc_producer, &args);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+    int64_t us = esp_timer_get_time() - start;
+    ringbuf_i16_free(args.rbuf);
+
+    printf("SPSC, producer and consumer threads\n");
+    printf("  write_n/read_n:        %8.1f Msamples/s, %llu out-of-order samples\n",
+           mega_per_sec(total, us), (unsigned long long)args.errors);
+}
+
+typedef struct {
+    ringbuf_i16_mpmc_handle_t rbuf;
+    uint64_t blocks;
+    int id;
+    atomic_ullong *popped;
+    uint64_t checksum;
+} mpmc_args_t;
+
+static void *mpmc_producer(void *arg)
+{
+    mpmc_args_t *args = arg;
+    int16_t block[BLOCK];
+    for (uint64_t b = 0; b < args->blocks; b++)
+    {
+        for (int i = 0; i < BLOCK; i++)
+            block[i] = (int16_t)(args->id * 7919 + b + i);
+        while (!ringbuf_i16_mpmc_push(args->rbuf, block))
+            sched_yield();
+    }
+    return NULL;
+}
+
+static void *mpmc_consumer(void *arg)
+{
+    mpmc_args_t *args = arg;
+    int16_t block[BLOCK];
+    while (atomic_load(args->popped) < args->blocks)
+    {
+        if (!ringbuf_i16_mpmc_pop(args->rbuf, block))
+        {
+            sched_yield();
+            continue;
+        }
+        atomic_fetch_add(args->popped, 1);
+        for (int i = 0; i < BLOCK; i++)
+            args->checksum += (uint16_t)block[i];
+    }
+    return NULL;
+}
+
+static void bench_mpmc(uint64_t total)
+{
+    int16_t storage[MPMC_SLOTS * BLOCK];
+    ringbuf_i16_mpmc_handle_t rbuf = ringbuf_i16_mpmc_init(storage, MPMC_SLOTS, BLOCK);
+    uint64_t blocks = total / BLOCK / PRODUCERS;
+    atomic_ullong popped = 0;
+
+    uint64_t expected = 0;
+    for (int p = 0; p < PRODUCERS; p++)
+        for (uint64_t b = 0; b < blocks; b++)
+            for (int i = 0; i < BLOCK; i++)
+                expected += (uint16_t)(int16_t)(p * 7919 + b + i);
+
+    mpmc_args_t producers[PRODUCERS], consumers[CONSUMERS];
+    pthread_t threads[PRODUCERS + CONSUMERS];
+    int64_t start = esp_timer_get_time();
+    for (int c = 0; c < CONSUMERS; c++)
+    {
+        consumers[c] = (mpmc_args_t){rbuf, blocks * PRODUCERS, c, &popped, 0};
+        pthread_create(&threads[PRODUCERS + c], NULL, mpmc_consumer, &consumers[c]);
+    }
+    for (int p = 0; p < PRODUCERS; p++)
+    {
+        producers[p] = (mpmc_args_t){rbuf, blocks, p, &popped, 0};
+        pthread_create(&threads[p], NULL, mpmc_producer, &producers[p]);
+    }
+    for (int t = 0; t < PRODUCERS + CONSUMERS; t++)
+        pthread_join(threads[t], NULL);
+    int64_t us = esp_timer_get_time() - start;
+    ringbuf_i16_mpmc_free(rbuf);
+
+    uint64_t checksum = 0;
+    for (int c = 0; c < CONSUMERS; c++)
+        checksum += consumers[c].checksum;
+    printf("MPMC, %d producers / %d consumers\n", PRODUCERS, CONSUMERS);
+    printf("  push/pop:              %8.1f Msamples/s, checksum %s\n",
+           mega_per_sec(blocks * PRODUCERS * BLOCK, us),
+           checksum == expected ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t total = (argc > 1 ? strtoull(argv[1], NULL, 0) : 20) * 1000000ULL;
+    bench_single_thread(total);
+    bench_spsc(total);
+    bench_mpmc(total);
+    return 0;
+}
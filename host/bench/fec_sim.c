@@ -0,0 +1,229 @@
+/*
+ * FEC loss simulator. Audio packets and the parity war_fec.c sends for them
+ * go through a Gilbert-style loss model in send order; the receiver side
+ * runs the real decoder. Reports the bandwidth overhead, the residual audio
+ * loss after recovery, how long recovered packets waited for their parity
+ * and the encode/decode cost. Every rebuilt payload is checked byte for byte.
+ *
+ *   fec_sim [-n packets] [-l loss_pct] [-b mean_burst] [-F xor:K|rs:K:M] [-S seed]
+ *
+ * Without -F a fixed set of schemes is compared.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "war_config.h"
+#include "war_espnow.h"
+#include "war_fec.h"
+
+static uint64_t nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void make_payload(uint8_t *out, uint32_t seq)
+{
+    uint32_t x = seq * 2654435761u + 1;
+    for (size_t i = 0; i < ESPNOW_DEFAULT_SEND_LEN; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        out[i] = (uint8_t)x;
+    }
+}
+
+typedef struct {
+    double stay;
+    double enter;
+    bool lost;
+} channel_t;
+
+static void channel_init(channel_t *ch, double loss_pct, double burst)
+{
+    // Two-state loss model: enter a burst with p, stay in it with 1 - 1/burst.
+    ch->stay = burst > 1.0 ? 1.0 - 1.0 / burst : 0.0;
+    ch->enter = loss_pct / 100.0 * (1.0 - ch->stay) / (1.0 - loss_pct / 100.0);
+    ch->lost = false;
+}
+
+static bool channel_lost(channel_t *ch)
+{
+    double u = rand() / (double)RAND_MAX;
+    ch->lost = ch->lost ? u < ch->stay : u < ch->enter;
+    return ch->lost;
+}
+
+static const char *fec_name(const fec_config_t *config, char *buf, size_t len)
+{
+    switch (config->scheme)
+    {
+    case FEC_XOR: snprintf(buf, len, "xor:%u", config->k); break;
+    case FEC_RS: snprintf(buf, len, "rs:%u:%u", config->k, config->m); break;
+    default: snprintf(buf, len, "none"); break;
+    }
+    return buf;
+}
+
+static void run(const fec_config_t *config, long packets, double loss_pct,
+    double burst, unsigned seed)
+{
+    fec_encoder_t *enc = malloc(sizeof(fec_encoder_t));
+    fec_decoder_t *dec = malloc(sizeof(fec_decoder_t));
+    fec_encoder_init(enc, config, ESPNOW_DEFAULT_SEND_LEN);
+    fec_decoder_init(dec, ESPNOW_DEFAULT_SEND_LEN);
+
+    channel_t ch;
+    channel_init(&ch, loss_pct, burst);
+    srand(seed);
+
+    uint8_t payload[ESPNOW_DEFAULT_SEND_LEN];
+    uint8_t expect[ESPNOW_DEFAULT_SEND_LEN];
+    uint32_t recovered[FEC_MAX_M];
+    long sent = 0, air_lost = 0, audio_lost = 0, rebuilt = 0, corrupt = 0;
+    long delay_accum = 0, delay_max = 0;
+    uint64_t enc_ns = 0, dec_ns = 0;
+    for (uint32_t seq = 0; seq < (uint32_t)packets; seq++)
+    {
+        make_payload(payload, seq);
+        uint64_t t0 = nanos();
+        bool group_done = fec_encoder_add(enc, seq, payload, sizeof(payload));
+        enc_ns += nanos() - t0;
+
+        sent++;
+        if (channel_lost(&ch))
+        {
+            air_lost++;
+            audio_lost++;
+        }
+        else
+        {
+            fec_decoder_add_data(dec, seq, payload, sizeof(payload));
+        }
+
+        for (uint8_t j = 0; group_done && j < config->m; j++)
+        {
+            sent++;
+            if (channel_lost(&ch))
+            {
+                air_lost++;
+                continue;
+            }
+            fec_header_t header = {
+                .scheme = config->scheme,
+                .k = config->k,
+                .m = config->m,
+                .index = j,
+            };
+            uint32_t base = fec_encoder_base_seq(enc);
+            t0 = nanos();
+            int count = fec_decoder_add_parity(dec, base, &header,
+                fec_encoder_parity(enc, j), fec_encoder_parity_len(enc), recovered);
+            dec_ns += nanos() - t0;
+            for (int i = 0; i < count; i++)
+            {
+                make_payload(expect, recovered[i]);
+                if (memcmp(expect, fec_decoder_payload(dec, recovered[i]), ESPNOW_DEFAULT_SEND_LEN))
+                    corrupt++;
+                long delay = seq - recovered[i];
+                delay_accum += delay;
+                if (delay > delay_max)
+                    delay_max = delay;
+            }
+            rebuilt += count;
+            audio_lost -= count;
+        }
+    }
+
+    char name[16];
+    printf("%-8s %8.1f %8.2f %9.3f %8ld %8.1f %6.1f %8.0f %8.0f%s\n",
+        fec_name(config, name, sizeof(name)),
+        100.0 * (sent - packets) / packets,
+        100.0 * air_lost / sent,
+        100.0 * audio_lost / packets,
+        rebuilt,
+        rebuilt ? (double)delay_accum / rebuilt * ESPNOW_DEFAULT_PACKET_US * 0.001 : 0.0,
+        (double)delay_max * ESPNOW_DEFAULT_PACKET_US * 0.001,
+        (double)enc_ns / packets,
+        rebuilt ? (double)dec_ns / rebuilt : 0.0,
+        corrupt ? "  CORRUPT" : "");
+    free(enc);
+    free(dec);
+}
+
+static bool parse_fec(const char *arg, fec_config_t *config)
+{
+    unsigned k = 0, m = 1;
+    if (sscanf(arg, "xor:%u", &k) == 1)
+        config->scheme = FEC_XOR;
+    else if (sscanf(arg, "rs:%u:%u", &k, &m) == 2)
+        config->scheme = FEC_RS;
+    else
+        return false;
+    config->k = (uint8_t)k;
+    config->m = (uint8_t)m;
+    return k <= FEC_MAX_K && m <= FEC_MAX_M && fec_config_valid(config);
+}
+
+int main(int argc, char **argv)
+{
+    long packets = 500000;
+    double loss_pct = 5.0, burst = 1.5;
+    unsigned seed = 1;
+    fec_config_t single = {.scheme = FEC_NONE};
+    bool have_single = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:l:b:F:S:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': packets = strtol(optarg, NULL, 0); break;
+        case 'l': loss_pct = atof(optarg); break;
+        case 'b': burst = atof(optarg); break;
+        case 'F':
+            if (!parse_fec(optarg, &single))
+            {
+                fprintf(stderr, "bad FEC config: %s\n", optarg);
+                return 1;
+            }
+            have_single = true;
+            break;
+        case 'S': seed = (unsigned)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n packets] [-l loss_pct] [-b mean_burst] "
+                            "[-F xor:K|rs:K:M] [-S seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("%ld audio packets of %u B, %.1f%% loss, mean burst %.1f\n", packets,
+        (unsigned)ESPNOW_DEFAULT_SEND_LEN, loss_pct, burst);
+    printf("%-8s %8s %8s %9s %8s %8s %6s %8s %8s\n", "scheme", "ovh %", "air %",
+        "audio %", "rebuilt", "wait ms", "max", "enc ns", "dec ns");
+
+    if (have_single)
+    {
+        run(&single, packets, loss_pct, burst, seed);
+        return 0;
+    }
+
+    const fec_config_t schemes[] = {
+        {FEC_NONE, 0, 0},
+        {FEC_XOR, 2, 1},
+        {FEC_XOR, 4, 1},
+        {FEC_XOR, 8, 1},
+        {FEC_RS, 4, 2},
+        {FEC_RS, 8, 2},
+        {FEC_RS, 8, 3},
+        {FEC_RS, 16, 4},
+    };
+    for (size_t i = 0; i < sizeof(schemes) / sizeof(schemes[0]); i++)
+        run(&schemes[i], packets, loss_pct, burst, seed);
+    return 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * Replays packet arrival times through the jitter buffer against an ideal
+ * playout clock and compares the adaptive target depth with a fixed one.
+ *
+ * A trace is one "seq arrival_us" pair per line ('#' starts a comment).
+ * Without -t a synthetic trace is generated: Gaussian jitter, random loss
+ * and occasional delay spikes, which -w saves in the same format. With -r
+ * the sender restarts its sequence from 0 that many seconds in. With -c
+ * every packet is sent that many times, each copy -C packets after the one
+ * before, as war_tx -C/-S does; copies are lost and delayed independently
+ * and must not raise the jitter estimate (jit_us) over a single send:
+ *
+ *   jitter_replay -j 50 -l 0 -k 0 -c 2 -C 4
+ *
+ * A sequence
+ * going back JITTER_SLOTS or more in a trace counts as a restart, and the
+ * longest wait from a restart's first arrival to its first packet played
+ * is reported.
+ *
+ *   jitter_replay [-t trace.txt] [-s seconds] [-j jitter_us] [-l loss_pct]
+ *                 [-k spike_pct] [-K spike_us] [-S seed] [-f fixed_depth]
+ *                 [-r restart_seconds] [-c copies] [-C copy_spacing]
+ *                 [-w out_trace.txt]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "war_config.h"
+#include "war_espnow.h"
+#include "war_jitter.h"
+
+#define PACKET_US   ESPNOW_DEFAULT_PACKET_US
+#define PAYLOAD_LEN 4
+
+typedef struct {
+    uint32_t seq;
+    int64_t arrival;
+    uint8_t epoch; // restarts before this packet
+} arrival_t;
+
+static int compare_arrival(const void *a, const void *b)
+{
+    int64_t d = ((const arrival_t *)a)->arrival - ((const arrival_t *)b)->arrival;
+    return d < 0 ? -1 : d > 0;
+}
+
+static double gaussian(void)
+{
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static size_t synth_trace(arrival_t **out, double seconds, double jitter_us,
+    double loss_pct, double spike_pct, double spike_us, double restart_s, int copies,
+    int spacing)
+{
+    size_t count = (size_t)(seconds * 1000000.0 / PACKET_US);
+    size_t restart = restart_s >= 0.0 ? (size_t)(restart_s * 1000000.0 / PACKET_US) : count;
+    arrival_t *trace = malloc(count * copies * sizeof(arrival_t));
+    size_t n = 0;
+    for (size_t k = 0; k < count; k++)
+    {
+        for (int c = 0; c < copies; c++)
+        {
+            if (rand() < loss_pct / 100.0 * RAND_MAX)
+                continue;
+            double delay = 1000.0 + fabs(gaussian() * jitter_us);
+            if (rand() < spike_pct / 100.0 * RAND_MAX)
+                delay += spike_us * (0.5 + rand() / (double)RAND_MAX);
+            trace[n].seq = (uint32_t)(k < restart ? k : k - restart);
+            trace[n].arrival = (int64_t)(k + (size_t)c * spacing) * PACKET_US + (int64_t)delay;
+            n++;
+        }
+    }
+    *out = trace;
+    return n;
+}
+
+static size_t load_trace(arrival_t **out, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+    size_t cap = 1024, n = 0;
+    arrival_t *trace = malloc(cap * sizeof(arrival_t));
+    char line[128];
+    while (fgets(line, sizeof(line), f))
+    {
+        unsigned long seq;
+        long long arrival;
+        if (line[0] == '#' || sscanf(line, "%lu %lld", &seq, &arrival) != 2)
+            continue;
+        if (n == cap)
+            trace = realloc(trace, (cap *= 2) * sizeof(arrival_t));
+        trace[n].seq = (uint32_t)seq;
+        trace[n].arrival = arrival;
+        n++;
+    }
+    fclose(f);
+    *out = trace;
+    return n;
+}
+
+/* Marks each arrival with the restarts before it, in arrival order. */
+static void mark_epochs(arrival_t *trace, size_t n)
+{
+    uint8_t epoch = 0;
+    uint32_t highest = trace[0].seq;
+    for (size_t i = 0; i < n; i++)
+    {
+        if ((int32_t)(trace[i].seq - highest) <= -JITTER_SLOTS)
+        {
+            epoch++;
+            highest = trace[i].seq;
+        }
+        else if ((int32_t)(trace[i].seq - highest) > 0)
+        {
+            highest = trace[i].seq;
+        }
+        trace[i].epoch = epoch;
+    }
+}
+
+static void replay(const char *name, const arrival_t *trace, size_t n,
+    const jitter_config_t *config)
+{
+    static uint8_t storage[JITTER_SLOTS * PAYLOAD_LEN];
+    jitter_buffer_t jb;
+    jitter_init(&jb, storage, PAYLOAD_LEN, config);
+
+    uint8_t payload[PAYLOAD_LEN] = {0}, out[PAYLOAD_LEN];
+    uint32_t last_seq = trace[n - 1].seq;
+    int64_t now = trace[0].arrival;
+    size_t i = 0;
+    uint64_t depth_accum = 0, ticks = 0;
+    // The payload carries the epoch, so a pop tells which stream it is from.
+    uint8_t epoch = 0;
+    int64_t epoch_start = 0, recover_max = 0;
+    while (i < n || (int32_t)(jb.play_seq - last_seq) <= 0)
+    {
+        while (i < n && trace[i].arrival <= now)
+        {
+            if (trace[i].epoch != payload[0])
+            {
+                payload[0] = trace[i].epoch;
+                epoch_start = trace[i].arrival;
+            }
+            jitter_push(&jb, trace[i].seq, payload, trace[i].arrival);
+            i++;
+        }
+        if (jitter_pop(&jb, out, now) == JITTER_OK && out[0] != epoch)
+        {
+            epoch = out[0];
+            if (now - epoch_start > recover_max)
+                recover_max = now - epoch_start;
+        }
+        depth_accum += jitter_depth(&jb);
+        ticks++;
+        now += PACKET_US;
+        if (ticks > 4 * (uint64_t)n + 1000)
+            break;
+    }
+
+    const jitter_stats_t *s = &jb.stats;
+    printf("%-9s %7u %6u %6u %6u %7u %7u %8.2f %8.2f %7.2f %6.1f %6u", name,
+        s->played, s->lost, s->late, s->underruns, s->dropped, s->stretched,
+        s->latency_count ? s->latency_accum / (double)s->latency_count / 1000.0 : 0.0,
+        s->latency_max / 1000.0, (double)depth_accum / ticks, jb.jitter_us, s->resyncs);
+    if (trace[n - 1].epoch == 0)
+        printf(" %9s\n", "-");
+    else if (epoch != trace[n - 1].epoch)
+        printf(" %9s\n", "never");
+    else
+        printf(" %9.2f\n", recover_max / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+    const char *trace_path = NULL, *write_path = NULL;
+    double seconds = 60.0, jitter_us = 300.0, loss_pct = 1.0;
+    double spike_pct = 0.2, spike_us = 8000.0, restart_s = -1.0;
+    unsigned seed = 1;
+    int fixed_depth = 8, copies = 1, spacing = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:s:j:l:k:K:S:f:r:c:C:w:")) != -1)
+    {
+        switch (opt)
+        {
+        case 't': trace_path = optarg; break;
+        case 's': seconds = atof(optarg); break;
+        case 'j': jitter_us = atof(optarg); break;
+        case 'l': loss_pct = atof(optarg); break;
+        case 'k': spike_pct = atof(optarg); break;
+        case 'K': spike_us = atof(optarg); break;
+        case 'S': seed = (unsigned)atoi(optarg); break;
+        case 'f': fixed_depth = atoi(optarg); break;
+        case 'r': restart_s = atof(optarg); break;
+        case 'c': copies = atoi(optarg) > 1 ? atoi(optarg) : 1; break;
+        case 'C': spacing = atoi(optarg) > 0 ? atoi(optarg) : 0; break;
+        case 'w': write_path = optarg; break;
+        default:
+            fprintf(stderr, "see the comment at the top of jitter_replay.c\n");
+            return 1;
+        }
+    }
+
+    arrival_t *trace;
+    size_t n;
+    if (trace_path)
+    {
+        n = load_trace(&trace, trace_path);
+    }
+    else
+    {
+        srand(seed);
+        n = synth_trace(&trace, seconds, jitter_us, loss_pct, spike_pct, spike_us,
+            restart_s, copies, spacing);
+    }
+    if (n == 0)
+    {
+        fprintf(stderr, "empty trace\n");
+        return 1;
+    }
+    qsort(trace, n, sizeof(arrival_t), compare_arrival);
+    mark_epochs(trace, n);
+
+    if (write_path)
+    {
+        FILE *f = fopen(write_path, "w");
+        fprintf(f, "# seq arrival_us\n");
+        for (size_t i = 0; i < n; i++)
+            fprintf(f, "%u %lld\n", trace[i].seq, (long long)trace[i].arrival);
+        fclose(f);
+    }
+
+    printf("%zu arrivals, %d us packets\n", n, PACKET_US);
+    printf("%-9s %7s %6s %6s %6s %7s %7s %8s %8s %7s %6s %6s %9s\n", "mode", "played",
+        "lost", "late", "under", "dropped", "stretch", "lat_ms", "max_ms", "depth", "jit_us",
+        "resync", "recov_ms");
+
+    const jitter_config_t adaptive = {PACKET_US, 1, JITTER_SLOTS / 2, 3.f};
+    replay("adaptive", trace, n, &adaptive);
+    const jitter_config_t fixed = {PACKET_US, (uint16_t)fixed_depth,
+        (uint16_t)fixed_depth, 0.f};
+    replay("fixed", trace, n, &fixed);
+
+    free(trace);
+    return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef __DRIVER_GPIO_H__
+#define __DRIVER_GPIO_H__
+
+#include "esp_err.h"
+
+#endif // __DRIVER_GPIO_H__
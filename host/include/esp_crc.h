@@ -0,0 +1,17 @@
+#ifndef __ESP_CRC_H__
+#define __ESP_CRC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same polynomial and conventions as the ESP32 ROM crc16_le. */
+uint16_t esp_crc16_le(uint16_t crc, uint8_t const *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ESP_CRC_H__
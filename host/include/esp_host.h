@@ -0,0 +1,49 @@
+#ifndef __ESP_HOST_H__
+#define __ESP_HOST_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/i2s.h"
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Controls for the host stand-ins that have no ESP-IDF equivalent.
+ * Call these before the matching *_init / *_install function.
+ */
+
+/* ESP-NOW frames are carried as UDP datagrams on 127.0.0.1 (or ip).
+ * Each datagram is prefixed with the sender's 6-byte MAC. */
+void esp_now_host_set_endpoint(const char *ip, uint16_t local_port, uint16_t remote_port);
+void esp_now_host_set_mac(const uint8_t mac[6]);
+/* Drops loss_pct percent of outgoing frames at random. Broadcasts are not
+ * acknowledged on air, so the send callback still reports success. */
+void esp_now_host_set_loss(float loss_pct);
+/* Holds the "radio" for airtime_us per frame before it goes out, so send
+ * callbacks come back at an on-air pace (see bench_airtime). */
+void esp_now_host_set_airtime(uint32_t airtime_us);
+
+/* 16-bit PCM WAV, mono or stereo. Mono sources are duplicated onto both
+ * channels. When loop is false the source is padded with silence after EOF. */
+esp_err_t i2s_host_set_source(i2s_port_t i2s_num, const char *wav_path, bool loop);
+bool i2s_host_source_done(i2s_port_t i2s_num);
+/* RX_DONE events come as fast as the reader takes them, one per i2s_read(),
+ * instead of on the sample clock (load tests). */
+void i2s_host_set_unpaced(i2s_port_t i2s_num, bool unpaced);
+
+/* The sink is written with the given channel count; the header is patched
+ * on i2s_driver_uninstall(). */
+esp_err_t i2s_host_set_sink(i2s_port_t i2s_num, const char *wav_path, int channels);
+
+/* Bytes memcpy'd into and out of a queue since it was created. */
+uint64_t queue_host_bytes_copied(const QueueHandle_t xQueue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ESP_HOST_H__
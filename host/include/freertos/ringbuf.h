@@ -0,0 +1,35 @@
+#ifndef __FREERTOS_RINGBUF_H__
+#define __FREERTOS_RINGBUF_H__
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Ringbuffer_t* RingbufHandle_t;
+
+/* Only no-split rings are modelled: every item is stored contiguously. */
+typedef enum {
+    RINGBUF_TYPE_NOSPLIT = 0,
+} RingbufferType_t;
+
+RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferType);
+void vRingbufferDelete(RingbufHandle_t xRingbuffer);
+
+BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer, const void *pvItem,
+                           size_t xItemSize, TickType_t xTicksToWait);
+void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize,
+                         TickType_t xTicksToWait);
+void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem);
+
+size_t xRingbufferGetMaxItemSize(RingbufHandle_t xRingbuffer);
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t xRingbuffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __FREERTOS_RINGBUF_H__
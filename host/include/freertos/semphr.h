@@ -0,0 +1,19 @@
+#ifndef __FREERTOS_SEMPHR_H__
+#define __FREERTOS_SEMPHR_H__
+
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#define vSemaphoreDelete(xSemaphore) vQueueDelete((QueueHandle_t)(xSemaphore))
+
+/* A mutex is a one-item queue of zero-size tokens, as in FreeRTOS. Priority
+ * inheritance is not modelled. */
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+
+#define xSemaphoreTake(xSemaphore, xBlockTime) \
+    xQueueReceive((QueueHandle_t)(xSemaphore), NULL, xBlockTime)
+#define xSemaphoreGive(xSemaphore) \
+    xQueueSend((QueueHandle_t)(xSemaphore), NULL, 0)
+
+#endif // __FREERTOS_SEMPHR_H__
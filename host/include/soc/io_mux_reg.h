@@ -0,0 +1,10 @@
+#ifndef __SOC_IO_MUX_REG_H__
+#define __SOC_IO_MUX_REG_H__
+
+#define PIN_CTRL                    0
+#define PERIPHS_IO_MUX_GPIO0_U      0
+#define FUNC_GPIO0_CLK_OUT1         1
+
+#define PIN_FUNC_SELECT(pin_name, func) ((void)(pin_name), (void)(func))
+
+#endif // __SOC_IO_MUX_REG_H__
@@ -0,0 +1,10 @@
+#ifndef __SOC_SOC_H__
+#define __SOC_SOC_H__
+
+#include <stdint.h>
+
+/* Register access is a no-op on host. */
+#define READ_PERI_REG(addr)         ((void)(addr), 0u)
+#define WRITE_PERI_REG(addr, val)   ((void)(addr), (void)(val))
+
+#endif // __SOC_SOC_H__
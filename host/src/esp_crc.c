@@ -0,0 +1,12 @@
+#include "esp_crc.h"
+
+uint16_t esp_crc16_le(uint16_t crc, uint8_t const *buf, uint32_t len) {
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++) {
+    crc ^= buf[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+    }
+  }
+  return ~crc;
+}
@@ -0,0 +1,247 @@
+#include "esp_now.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "esp_host.h"
+#include "esp_log.h"
+#include "freertos/queue.h"
+
+/*
+ * ESP-NOW over UDP. esp_now_send() copies the frame into a small TX queue,
+ * like the Wi-Fi driver does, and a separate "Wi-Fi task" thread puts it on
+ * the socket and fires the send callback. A receive thread invokes the
+ * receive callback for every datagram, from its own context, just as the
+ * Wi-Fi task does on target.
+ */
+
+#define ESP_NOW_HOST_TX_QUEUE_LEN 8
+
+static const char *TAG = "ESP-NOW-HOST";
+
+typedef struct {
+  uint8_t mac_addr[ESP_NOW_ETH_ALEN];
+  int len;
+  uint8_t data[ESP_NOW_MAX_DATA_LEN];
+} host_frame_t;
+
+static char host_ip[INET_ADDRSTRLEN] = "127.0.0.1";
+static uint16_t host_local_port = 3333;
+static uint16_t host_remote_port = 3333;
+static uint8_t host_mac[ESP_NOW_ETH_ALEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static float host_loss = 0.f;
+static uint32_t host_airtime_us = 0;
+
+static int sock = -1;
+static bool initialized = false;
+static pthread_t rx_thread;
+static pthread_t tx_thread;
+static xQueueHandle tx_queue;
+static esp_now_recv_cb_t recv_cb;
+static esp_now_send_cb_t send_cb;
+
+static uint8_t peers[ESP_NOW_MAX_TOTAL_PEER_NUM][ESP_NOW_ETH_ALEN];
+static int peer_count = 0;
+
+void esp_now_host_set_endpoint(const char *ip, uint16_t local_port,
+                               uint16_t remote_port) {
+  if (ip) {
+    strncpy(host_ip, ip, sizeof(host_ip) - 1);
+  }
+  host_local_port = local_port;
+  host_remote_port = remote_port;
+}
+
+void esp_now_host_set_mac(const uint8_t mac[6]) {
+  memcpy(host_mac, mac, ESP_NOW_ETH_ALEN);
+}
+
+void esp_now_host_set_loss(float loss_pct) { host_loss = loss_pct / 100.f; }
+
+void esp_now_host_set_airtime(uint32_t airtime_us) {
+  host_airtime_us = airtime_us;
+}
+
+static void *rx_task(void *arg) {
+  uint8_t datagram[ESP_NOW_ETH_ALEN + ESP_NOW_MAX_DATA_LEN];
+  for (;;) {
+    ssize_t len = recv(sock, datagram, sizeof(datagram), 0);
+    if (len < 0 || !initialized) {
+      break;
+    }
+    if (len <= ESP_NOW_ETH_ALEN || recv_cb == NULL) {
+      continue;
+    }
+    recv_cb(datagram, datagram + ESP_NOW_ETH_ALEN,
+            (int)len - ESP_NOW_ETH_ALEN);
+  }
+  return NULL;
+}
+
+static void *tx_task(void *arg) {
+  struct sockaddr_in dest = {0};
+  dest.sin_family = AF_INET;
+  dest.sin_port = htons(host_remote_port);
+  inet_pton(AF_INET, host_ip, &dest.sin_addr);
+
+  uint8_t datagram[ESP_NOW_ETH_ALEN + ESP_NOW_MAX_DATA_LEN];
+  memcpy(datagram, host_mac, ESP_NOW_ETH_ALEN);
+
+  unsigned seed = 1;
+  host_frame_t frame;
+  while (xQueueReceive(tx_queue, &frame, portMAX_DELAY) == pdTRUE) {
+    if (frame.len < 0) {
+      break;
+    }
+    if (host_airtime_us) {
+      struct timespec ts = {0, host_airtime_us * 1000L};
+      nanosleep(&ts, NULL);
+    }
+    memcpy(datagram + ESP_NOW_ETH_ALEN, frame.data, frame.len);
+    ssize_t sent = frame.len;
+    if (host_loss <= 0.f || rand_r(&seed) >= host_loss * RAND_MAX) {
+      sent = sendto(sock, datagram, ESP_NOW_ETH_ALEN + frame.len, 0,
+                    (struct sockaddr *)&dest, sizeof(dest));
+    }
+    if (send_cb) {
+      send_cb(frame.mac_addr,
+              sent < 0 ? ESP_NOW_SEND_FAIL : ESP_NOW_SEND_SUCCESS);
+    }
+  }
+  return NULL;
+}
+
+esp_err_t esp_now_init(void) {
+  if (initialized) {
+    return ESP_OK;
+  }
+
+  sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (sock < 0) {
+    return ESP_ERR_ESPNOW_INTERNAL;
+  }
+  int reuse = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in local = {0};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(host_local_port);
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(sock, (struct sockaddr *)&local, sizeof(local)) < 0) {
+    ESP_LOGE(TAG, "Unable to bind UDP port %u", host_local_port);
+    close(sock);
+    sock = -1;
+    return ESP_ERR_ESPNOW_INTERNAL;
+  }
+
+  tx_queue = xQueueCreate(ESP_NOW_HOST_TX_QUEUE_LEN, sizeof(host_frame_t));
+  if (tx_queue == NULL) {
+    close(sock);
+    sock = -1;
+    return ESP_ERR_ESPNOW_NO_MEM;
+  }
+
+  initialized = true;
+  pthread_create(&rx_thread, NULL, rx_task, NULL);
+  pthread_create(&tx_thread, NULL, tx_task, NULL);
+  ESP_LOGI(TAG, "UDP %s: local %u, remote %u", host_ip, host_local_port,
+           host_remote_port);
+  return ESP_OK;
+}
+
+esp_err_t esp_now_deinit(void) {
+  if (!initialized) {
+    return ESP_OK;
+  }
+  initialized = false;
+
+  host_frame_t stop = {.len = -1};
+  xQueueSend(tx_queue, &stop, portMAX_DELAY);
+  if (!pthread_equal(pthread_self(), tx_thread)) {
+    pthread_join(tx_thread, NULL);
+  }
+  shutdown(sock, SHUT_RDWR);
+  if (!pthread_equal(pthread_self(), rx_thread)) {
+    pthread_join(rx_thread, NULL);
+  }
+  close(sock);
+  sock = -1;
+  vQueueDelete(tx_queue);
+  recv_cb = NULL;
+  send_cb = NULL;
+  peer_count = 0;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+  if (!initialized) {
+    return ESP_ERR_ESPNOW_NOT_INIT;
+  }
+  recv_cb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+  if (!initialized) {
+    return ESP_ERR_ESPNOW_NOT_INIT;
+  }
+  send_cb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_set_pmk(const uint8_t *pmk) {
+  return initialized ? ESP_OK : ESP_ERR_ESPNOW_NOT_INIT;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer) {
+  if (!initialized) {
+    return ESP_ERR_ESPNOW_NOT_INIT;
+  }
+  if (peer == NULL) {
+    return ESP_ERR_ESPNOW_ARG;
+  }
+  for (int i = 0; i < peer_count; i++) {
+    if (memcmp(peers[i], peer->peer_addr, ESP_NOW_ETH_ALEN) == 0) {
+      return ESP_ERR_ESPNOW_EXIST;
+    }
+  }
+  if (peer_count == ESP_NOW_MAX_TOTAL_PEER_NUM) {
+    return ESP_ERR_ESPNOW_FULL;
+  }
+  memcpy(peers[peer_count++], peer->peer_addr, ESP_NOW_ETH_ALEN);
+  return ESP_OK;
+}
+
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data,
+                       size_t len) {
+  if (!initialized) {
+    return ESP_ERR_ESPNOW_NOT_INIT;
+  }
+  if (peer_addr == NULL || data == NULL || len == 0 ||
+      len > ESP_NOW_MAX_DATA_LEN) {
+    return ESP_ERR_ESPNOW_ARG;
+  }
+
+  bool known = false;
+  for (int i = 0; i < peer_count && !known; i++) {
+    known = memcmp(peers[i], peer_addr, ESP_NOW_ETH_ALEN) == 0;
+  }
+  if (!known) {
+    return ESP_ERR_ESPNOW_NOT_FOUND;
+  }
+
+  host_frame_t frame;
+  memcpy(frame.mac_addr, peer_addr, ESP_NOW_ETH_ALEN);
+  frame.len = (int)len;
+  memcpy(frame.data, data, len);
+  if (xQueueSend(tx_queue, &frame, 0) != pdTRUE) {
+    return ESP_ERR_ESPNOW_NO_MEM;
+  }
+  return ESP_OK;
+}
@@ -0,0 +1,144 @@
+#include "esp_timer.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "host_port.h"
+
+/* Each timer owns a thread that sleeps to absolute CLOCK_MONOTONIC deadlines,
+ * so a periodic timer does not accumulate drift from callback run time. */
+struct esp_timer {
+  esp_timer_create_args_t args;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  uint64_t period_us;
+  bool armed;
+  bool periodic;
+  bool running;
+  uint64_t generation;
+};
+
+static struct timespec time_origin;
+static pthread_once_t time_origin_once = PTHREAD_ONCE_INIT;
+
+static void time_origin_init(void) {
+  clock_gettime(CLOCK_MONOTONIC, &time_origin);
+}
+
+int64_t esp_timer_get_time(void) {
+  pthread_once(&time_origin_once, time_origin_init);
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)(now.tv_sec - time_origin.tv_sec) * 1000000 +
+         (now.tv_nsec - time_origin.tv_nsec) / 1000;
+}
+
+static void timespec_add_us(struct timespec *ts, uint64_t us) {
+  ts->tv_sec += us / 1000000;
+  ts->tv_nsec += (us % 1000000) * 1000;
+  if (ts->tv_nsec >= 1000000000L) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000L;
+  }
+}
+
+static void *timer_thread(void *arg) {
+  esp_timer_handle_t timer = arg;
+  struct timespec deadline;
+
+  pthread_mutex_lock(&timer->lock);
+  while (timer->running) {
+    while (timer->running && !timer->armed) {
+      pthread_cond_wait(&timer->changed, &timer->lock);
+    }
+    if (!timer->running) {
+      break;
+    }
+    uint64_t generation = timer->generation;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    timespec_add_us(&deadline, timer->period_us);
+
+    while (timer->armed && timer->generation == generation) {
+      if (pthread_cond_timedwait(&timer->changed, &timer->lock, &deadline) == 0) {
+        continue;
+      }
+      pthread_mutex_unlock(&timer->lock);
+      timer->args.callback(timer->args.arg);
+      pthread_mutex_lock(&timer->lock);
+      if (!timer->periodic) {
+        timer->armed = false;
+      }
+      timespec_add_us(&deadline, timer->period_us);
+    }
+  }
+  pthread_mutex_unlock(&timer->lock);
+  return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args,
+                           esp_timer_handle_t *out_handle) {
+  if (create_args == NULL || create_args->callback == NULL || out_handle == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  esp_timer_handle_t timer = calloc(1, sizeof(struct esp_timer));
+  if (timer == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  timer->args = *create_args;
+  timer->running = true;
+  pthread_mutex_init(&timer->lock, NULL);
+  host_cond_init(&timer->changed);
+  if (pthread_create(&timer->thread, NULL, timer_thread, timer) != 0) {
+    free(timer);
+    return ESP_FAIL;
+  }
+  *out_handle = timer;
+  return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t timer, uint64_t us, bool periodic) {
+  pthread_mutex_lock(&timer->lock);
+  if (timer->armed) {
+    pthread_mutex_unlock(&timer->lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->period_us = us;
+  timer->periodic = periodic;
+  timer->armed = true;
+  timer->generation++;
+  pthread_cond_signal(&timer->changed);
+  pthread_mutex_unlock(&timer->lock);
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  return timer_arm(timer, timeout_us, false);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+  return timer_arm(timer, period, true);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  pthread_mutex_lock(&timer->lock);
+  bool was_armed = timer->armed;
+  timer->armed = false;
+  timer->generation++;
+  pthread_cond_signal(&timer->changed);
+  pthread_mutex_unlock(&timer->lock);
+  return was_armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  pthread_mutex_lock(&timer->lock);
+  timer->running = false;
+  timer->armed = false;
+  pthread_cond_signal(&timer->changed);
+  pthread_mutex_unlock(&timer->lock);
+  pthread_join(timer->thread, NULL);
+  pthread_mutex_destroy(&timer->lock);
+  pthread_cond_destroy(&timer->changed);
+  free(timer);
+  return ESP_OK;
+}
@@ -0,0 +1,37 @@
+#include "host_port.h"
+
+#include <errno.h>
+
+void host_cond_init(pthread_cond_t *cond) {
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+void host_deadline(struct timespec *ts, TickType_t ticks) {
+  clock_gettime(CLOCK_MONOTONIC, ts);
+  if (ticks == portMAX_DELAY) {
+    return;
+  }
+  uint64_t ns = (uint64_t)ticks * (1000000000ULL / configTICK_RATE_HZ);
+  ts->tv_sec += ns / 1000000000ULL;
+  ts->tv_nsec += ns % 1000000000ULL;
+  if (ts->tv_nsec >= 1000000000L) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000L;
+  }
+}
+
+bool host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock,
+                    TickType_t ticks, const struct timespec *deadline) {
+  if (ticks == portMAX_DELAY) {
+    pthread_cond_wait(cond, lock);
+    return true;
+  }
+  if (ticks == 0) {
+    return false;
+  }
+  return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
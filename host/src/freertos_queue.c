@@ -0,0 +1,133 @@
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include <string.h>
+
+#include "esp_host.h"
+#include "host_port.h"
+
+struct QueueDefinition {
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+  uint8_t *storage;
+  UBaseType_t length;
+  UBaseType_t item_size;
+  UBaseType_t head;
+  UBaseType_t count;
+  uint64_t bytes_copied;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize) {
+  QueueHandle_t q = calloc(1, sizeof(struct QueueDefinition));
+  if (q == NULL) {
+    return NULL;
+  }
+  q->storage = malloc((size_t)uxQueueLength * uxItemSize + 1);
+  if (q->storage == NULL) {
+    free(q);
+    return NULL;
+  }
+  q->length = uxQueueLength;
+  q->item_size = uxItemSize;
+  pthread_mutex_init(&q->lock, NULL);
+  host_cond_init(&q->not_empty);
+  host_cond_init(&q->not_full);
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t xQueue) {
+  pthread_mutex_destroy(&xQueue->lock);
+  pthread_cond_destroy(&xQueue->not_empty);
+  pthread_cond_destroy(&xQueue->not_full);
+  free(xQueue->storage);
+  free(xQueue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue,
+                      TickType_t xTicksToWait) {
+  struct timespec deadline;
+  host_deadline(&deadline, xTicksToWait);
+
+  pthread_mutex_lock(&xQueue->lock);
+  while (xQueue->count == xQueue->length) {
+    if (!host_cond_wait(&xQueue->not_full, &xQueue->lock, xTicksToWait,
+                        &deadline)) {
+      pthread_mutex_unlock(&xQueue->lock);
+      return errQUEUE_FULL;
+    }
+  }
+  UBaseType_t tail = (xQueue->head + xQueue->count) % xQueue->length;
+  if (xQueue->item_size) {
+    memcpy(xQueue->storage + (size_t)tail * xQueue->item_size, pvItemToQueue,
+           xQueue->item_size);
+  }
+  xQueue->count++;
+  xQueue->bytes_copied += xQueue->item_size;
+  pthread_cond_signal(&xQueue->not_empty);
+  pthread_mutex_unlock(&xQueue->lock);
+  return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue,
+                             BaseType_t *pxHigherPriorityTaskWoken) {
+  if (pxHigherPriorityTaskWoken) {
+    *pxHigherPriorityTaskWoken = pdFALSE;
+  }
+  return xQueueSend(xQueue, pvItemToQueue, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer,
+                         TickType_t xTicksToWait) {
+  struct timespec deadline;
+  host_deadline(&deadline, xTicksToWait);
+
+  pthread_mutex_lock(&xQueue->lock);
+  while (xQueue->count == 0) {
+    if (!host_cond_wait(&xQueue->not_empty, &xQueue->lock, xTicksToWait,
+                        &deadline)) {
+      pthread_mutex_unlock(&xQueue->lock);
+      return pdFALSE;
+    }
+  }
+  if (xQueue->item_size) {
+    memcpy(pvBuffer,
+           xQueue->storage + (size_t)xQueue->head * xQueue->item_size,
+           xQueue->item_size);
+  }
+  xQueue->head = (xQueue->head + 1) % xQueue->length;
+  xQueue->count--;
+  xQueue->bytes_copied += xQueue->item_size;
+  pthread_cond_signal(&xQueue->not_full);
+  pthread_mutex_unlock(&xQueue->lock);
+  return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+  if (mutex != NULL) {
+    xQueueSend(mutex, NULL, 0);
+  }
+  return mutex;
+}
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t xQueue) {
+  pthread_mutex_lock(&xQueue->lock);
+  UBaseType_t count = xQueue->count;
+  pthread_mutex_unlock(&xQueue->lock);
+  return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(const QueueHandle_t xQueue) {
+  pthread_mutex_lock(&xQueue->lock);
+  UBaseType_t spaces = xQueue->length - xQueue->count;
+  pthread_mutex_unlock(&xQueue->lock);
+  return spaces;
+}
+
+uint64_t queue_host_bytes_copied(const QueueHandle_t xQueue) {
+  pthread_mutex_lock(&xQueue->lock);
+  uint64_t bytes = xQueue->bytes_copied;
+  pthread_mutex_unlock(&xQueue->lock);
+  return bytes;
+}
@@ -0,0 +1,216 @@
+#include "freertos/ringbuf.h"
+
+#include <string.h>
+
+#include "host_port.h"
+
+/*
+ * No-split byte ring. Items are stored as an 8-byte header followed by the
+ * payload padded to 4 bytes. An item that does not fit before the end of
+ * the storage is placed at offset 0, leaving a wrap marker (or a gap
+ * smaller than a header) behind. Space is reclaimed in order as items are
+ * returned, matching the ESP-IDF semantics that a received item stays
+ * valid until vRingbufferReturnItem().
+ */
+
+#define RB_HEADER_SIZE  8
+#define RB_FLAG_WRAP    0x1
+#define RB_FLAG_FREE    0x2
+
+#define RB_ALIGN(len) (((len) + 3) & ~(size_t)3)
+
+typedef struct {
+  uint32_t len;
+  uint32_t flags;
+} rb_header_t;
+
+struct Ringbuffer_t {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  uint8_t *storage;
+  size_t size;
+  size_t write;
+  size_t read;
+  size_t free;
+  size_t used;
+  size_t unread;
+};
+
+RingbufHandle_t xRingbufferCreate(size_t xBufferSize,
+                                  RingbufferType_t xBufferType) {
+  if (xBufferType != RINGBUF_TYPE_NOSPLIT || xBufferSize < 2 * RB_HEADER_SIZE) {
+    return NULL;
+  }
+  RingbufHandle_t rb = calloc(1, sizeof(struct Ringbuffer_t));
+  if (rb == NULL) {
+    return NULL;
+  }
+  rb->size = RB_ALIGN(xBufferSize);
+  rb->storage = malloc(rb->size);
+  if (rb->storage == NULL) {
+    free(rb);
+    return NULL;
+  }
+  pthread_mutex_init(&rb->lock, NULL);
+  host_cond_init(&rb->changed);
+  return rb;
+}
+
+void vRingbufferDelete(RingbufHandle_t xRingbuffer) {
+  pthread_mutex_destroy(&xRingbuffer->lock);
+  pthread_cond_destroy(&xRingbuffer->changed);
+  free(xRingbuffer->storage);
+  free(xRingbuffer);
+}
+
+size_t xRingbufferGetMaxItemSize(RingbufHandle_t xRingbuffer) {
+  return xRingbuffer->size / 2 - RB_HEADER_SIZE;
+}
+
+/* Contiguous space the writer can use for an item of need bytes, wrapping
+ * to offset 0 when the tail is too short. Caller holds the lock. */
+static size_t rb_contiguous_free(RingbufHandle_t rb, size_t need,
+                                 size_t *tail_gap) {
+  *tail_gap = 0;
+  if (rb->used == 0) {
+    return rb->size;
+  }
+  if (rb->write == rb->free) {
+    return 0;
+  }
+  if (rb->write < rb->free) {
+    return rb->free - rb->write;
+  }
+  size_t end = rb->size - rb->write;
+  if (need <= end || rb->free <= end) {
+    return end;
+  }
+  *tail_gap = end;
+  return rb->free;
+}
+
+static bool rb_try_place(RingbufHandle_t rb, const void *item, size_t len) {
+  size_t need = RB_HEADER_SIZE + RB_ALIGN(len);
+  if (rb->used == 0) {
+    rb->write = rb->read = rb->free = 0;
+  }
+
+  size_t tail_gap;
+  size_t avail = rb_contiguous_free(rb, need, &tail_gap);
+  if (need > avail) {
+    return false;
+  }
+  if (tail_gap) {
+    if (tail_gap >= RB_HEADER_SIZE) {
+      rb_header_t *marker = (rb_header_t *)(rb->storage + rb->write);
+      marker->len = 0;
+      marker->flags = RB_FLAG_WRAP;
+    }
+    rb->used += tail_gap;
+    rb->write = 0;
+  }
+
+  rb_header_t *hdr = (rb_header_t *)(rb->storage + rb->write);
+  hdr->len = (uint32_t)len;
+  hdr->flags = 0;
+  memcpy(hdr + 1, item, len);
+  rb->write += need;
+  if (rb->write == rb->size) {
+    rb->write = 0;
+  }
+  rb->used += need;
+  rb->unread++;
+  return true;
+}
+
+BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer, const void *pvItem,
+                           size_t xItemSize, TickType_t xTicksToWait) {
+  if (xItemSize > xRingbufferGetMaxItemSize(xRingbuffer)) {
+    return pdFALSE;
+  }
+
+  struct timespec deadline;
+  host_deadline(&deadline, xTicksToWait);
+
+  pthread_mutex_lock(&xRingbuffer->lock);
+  while (!rb_try_place(xRingbuffer, pvItem, xItemSize)) {
+    if (!host_cond_wait(&xRingbuffer->changed, &xRingbuffer->lock,
+                        xTicksToWait, &deadline)) {
+      pthread_mutex_unlock(&xRingbuffer->lock);
+      return pdFALSE;
+    }
+  }
+  pthread_cond_broadcast(&xRingbuffer->changed);
+  pthread_mutex_unlock(&xRingbuffer->lock);
+  return pdTRUE;
+}
+
+/* Skips a wrap marker or short tail gap at *off. Caller holds the lock. */
+static void rb_skip_wrap(RingbufHandle_t rb, size_t *off, bool reclaim) {
+  size_t end = rb->size - *off;
+  if (end < RB_HEADER_SIZE ||
+      (((rb_header_t *)(rb->storage + *off))->flags & RB_FLAG_WRAP)) {
+    if (reclaim) {
+      rb->used -= end;
+    }
+    *off = 0;
+  }
+}
+
+void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize,
+                         TickType_t xTicksToWait) {
+  struct timespec deadline;
+  host_deadline(&deadline, xTicksToWait);
+
+  pthread_mutex_lock(&xRingbuffer->lock);
+  while (xRingbuffer->unread == 0) {
+    if (!host_cond_wait(&xRingbuffer->changed, &xRingbuffer->lock,
+                        xTicksToWait, &deadline)) {
+      pthread_mutex_unlock(&xRingbuffer->lock);
+      return NULL;
+    }
+  }
+  rb_skip_wrap(xRingbuffer, &xRingbuffer->read, false);
+  rb_header_t *hdr = (rb_header_t *)(xRingbuffer->storage + xRingbuffer->read);
+  xRingbuffer->read += RB_HEADER_SIZE + RB_ALIGN(hdr->len);
+  if (xRingbuffer->read == xRingbuffer->size) {
+    xRingbuffer->read = 0;
+  }
+  xRingbuffer->unread--;
+  pthread_mutex_unlock(&xRingbuffer->lock);
+
+  *pxItemSize = hdr->len;
+  return hdr + 1;
+}
+
+void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem) {
+  pthread_mutex_lock(&xRingbuffer->lock);
+  ((rb_header_t *)pvItem - 1)->flags |= RB_FLAG_FREE;
+
+  while (xRingbuffer->used > 0) {
+    rb_skip_wrap(xRingbuffer, &xRingbuffer->free, true);
+    rb_header_t *hdr = (rb_header_t *)(xRingbuffer->storage + xRingbuffer->free);
+    if (!(hdr->flags & RB_FLAG_FREE)) {
+      break;
+    }
+    size_t len = RB_HEADER_SIZE + RB_ALIGN(hdr->len);
+    xRingbuffer->used -= len;
+    xRingbuffer->free += len;
+    if (xRingbuffer->free == xRingbuffer->size) {
+      xRingbuffer->free = 0;
+    }
+  }
+  pthread_cond_broadcast(&xRingbuffer->changed);
+  pthread_mutex_unlock(&xRingbuffer->lock);
+}
+
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t xRingbuffer) {
+  pthread_mutex_lock(&xRingbuffer->lock);
+  size_t tail_gap;
+  size_t avail = rb_contiguous_free(xRingbuffer, xRingbuffer->size, &tail_gap);
+  pthread_mutex_unlock(&xRingbuffer->lock);
+
+  size_t max_item = xRingbufferGetMaxItemSize(xRingbuffer);
+  avail = avail > RB_HEADER_SIZE ? avail - RB_HEADER_SIZE : 0;
+  return avail < max_item ? avail : max_item;
+}
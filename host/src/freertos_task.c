@@ -0,0 +1,145 @@
+#include "freertos/task.h"
+
+#include <string.h>
+
+#include "host_port.h"
+
+struct tskTaskControlBlock {
+  pthread_t thread;
+  TaskFunction_t code;
+  void *param;
+  pthread_mutex_t lock;
+  pthread_cond_t notified;
+  uint32_t notify_count;
+  BaseType_t core;
+  char name[16];
+};
+
+static __thread TaskHandle_t current_task = NULL;
+static struct timespec tick_origin;
+static pthread_once_t tick_origin_once = PTHREAD_ONCE_INIT;
+
+static void tick_origin_init(void) {
+  clock_gettime(CLOCK_MONOTONIC, &tick_origin);
+}
+
+static TaskHandle_t task_alloc(const char *name) {
+  TaskHandle_t task = calloc(1, sizeof(struct tskTaskControlBlock));
+  if (task == NULL) {
+    return NULL;
+  }
+  pthread_mutex_init(&task->lock, NULL);
+  host_cond_init(&task->notified);
+  strncpy(task->name, name, sizeof(task->name) - 1);
+  return task;
+}
+
+static void *task_entry(void *arg) {
+  TaskHandle_t task = arg;
+  current_task = task;
+  task->code(task->param);
+  return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode,
+                                   const char *const pcName,
+                                   const uint32_t usStackDepth,
+                                   void *const pvParameters,
+                                   UBaseType_t uxPriority,
+                                   TaskHandle_t *const pvCreatedTask,
+                                   const BaseType_t xCoreID) {
+  (void)usStackDepth;
+  (void)uxPriority;
+
+  TaskHandle_t task = task_alloc(pcName);
+  if (task == NULL) {
+    return pdFAIL;
+  }
+  task->core = xCoreID == tskNO_AFFINITY ? 0 : xCoreID;
+  task->code = pvTaskCode;
+  task->param = pvParameters;
+  if (pvCreatedTask) {
+    *pvCreatedTask = task;
+  }
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  int err = pthread_create(&task->thread, &attr, task_entry, task);
+  pthread_attr_destroy(&attr);
+  return err == 0 ? pdPASS : pdFAIL;
+}
+
+BaseType_t xPortGetCoreID(void) {
+  return current_task ? current_task->core : 0;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+  if (xTaskToDelete == NULL || xTaskToDelete == current_task) {
+    pthread_exit(NULL);
+  }
+  pthread_cancel(xTaskToDelete->thread);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay) {
+  struct timespec ts;
+  host_deadline(&ts, xTicksToDelay);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+  }
+}
+
+TickType_t xTaskGetTickCount(void) {
+  pthread_once(&tick_origin_once, tick_origin_init);
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64_t ms = (int64_t)(now.tv_sec - tick_origin.tv_sec) * 1000 +
+               (now.tv_nsec - tick_origin.tv_nsec) / 1000000;
+  return (TickType_t)(ms * configTICK_RATE_HZ / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  if (current_task == NULL) {
+    // Threads not started through xTaskCreate (e.g. main) get a handle on
+    // first use so they can still receive notifications.
+    current_task = task_alloc("host");
+    current_task->thread = pthread_self();
+  }
+  return current_task;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit,
+                          TickType_t xTicksToWait) {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  struct timespec deadline;
+  host_deadline(&deadline, xTicksToWait);
+
+  pthread_mutex_lock(&task->lock);
+  while (task->notify_count == 0) {
+    if (!host_cond_wait(&task->notified, &task->lock, xTicksToWait,
+                        &deadline)) {
+      break;
+    }
+  }
+  uint32_t value = task->notify_count;
+  if (value) {
+    task->notify_count = xClearCountOnExit ? 0 : value - 1;
+  }
+  pthread_mutex_unlock(&task->lock);
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+  pthread_mutex_lock(&xTaskToNotify->lock);
+  xTaskToNotify->notify_count++;
+  pthread_cond_signal(&xTaskToNotify->notified);
+  pthread_mutex_unlock(&xTaskToNotify->lock);
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify,
+                            BaseType_t *pxHigherPriorityTaskWoken) {
+  xTaskNotifyGive(xTaskToNotify);
+  if (pxHigherPriorityTaskWoken) {
+    *pxHigherPriorityTaskWoken = pdFALSE;
+  }
+}
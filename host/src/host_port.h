@@ -0,0 +1,21 @@
+#ifndef __HOST_PORT_H__
+#define __HOST_PORT_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+
+/* Condition variables are created on CLOCK_MONOTONIC so tick timeouts are
+ * immune to wall-clock steps. */
+void host_cond_init(pthread_cond_t *cond);
+
+/* Absolute CLOCK_MONOTONIC deadline ticks from now. */
+void host_deadline(struct timespec *ts, TickType_t ticks);
+
+/* Waits on cond until signalled or the deadline passes. portMAX_DELAY
+ * waits forever; returns false on timeout. */
+bool host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock,
+                    TickType_t ticks, const struct timespec *deadline);
+
+#endif // __HOST_PORT_H__
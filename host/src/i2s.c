@@ -0,0 +1,328 @@
+#include "driver/i2s.h"
+
+#include <string.h>
+
+#include "esp_host.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/*
+ * I2S backed by WAV files. RX returns interleaved 16-bit L/R frames from
+ * the source; TX appends to the sink with the channel count the host app
+ * asked for. Neither side blocks. An RX port installed with an event queue
+ * stands in for the DMA clock: an esp_timer posts I2S_EVENT_RX_DONE every
+ * dma_buf_len frames, and readers pace themselves on those events as they
+ * do on target.
+ */
+
+static const char *TAG = "I2S-HOST";
+
+typedef struct {
+  bool installed;
+  i2s_config_t config;
+
+  FILE *source;
+  long source_data;
+  uint32_t source_bytes;
+  uint32_t source_pos;
+  int source_channels;
+  bool source_loop;
+  bool source_done;
+
+  FILE *sink;
+  int sink_channels;
+  uint32_t sink_bytes;
+
+  QueueHandle_t events;
+  esp_timer_handle_t dma_timer;
+  bool unpaced;
+} i2s_host_port_t;
+
+static i2s_host_port_t ports[I2S_NUM_MAX];
+
+typedef struct {
+  char riff[4];
+  uint32_t riff_size;
+  char wave[4];
+} __attribute__((packed)) wav_riff_t;
+
+typedef struct {
+  char id[4];
+  uint32_t size;
+} __attribute__((packed)) wav_chunk_t;
+
+typedef struct {
+  uint16_t format;
+  uint16_t channels;
+  uint32_t sample_rate;
+  uint32_t byte_rate;
+  uint16_t block_align;
+  uint16_t bits_per_sample;
+} __attribute__((packed)) wav_fmt_t;
+
+esp_err_t i2s_host_set_source(i2s_port_t i2s_num, const char *wav_path,
+                              bool loop) {
+  i2s_host_port_t *port = &ports[i2s_num];
+  FILE *f = fopen(wav_path, "rb");
+  if (f == NULL) {
+    ESP_LOGE(TAG, "Unable to open %s", wav_path);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  wav_riff_t riff;
+  wav_fmt_t fmt = {0};
+  wav_chunk_t chunk;
+  if (fread(&riff, sizeof(riff), 1, f) != 1 ||
+      memcmp(riff.riff, "RIFF", 4) || memcmp(riff.wave, "WAVE", 4)) {
+    fclose(f);
+    return ESP_ERR_INVALID_ARG;
+  }
+  while (fread(&chunk, sizeof(chunk), 1, f) == 1) {
+    if (memcmp(chunk.id, "fmt ", 4) == 0) {
+      if (fread(&fmt, sizeof(fmt), 1, f) != 1) {
+        break;
+      }
+      fseek(f, chunk.size - sizeof(fmt) + (chunk.size & 1), SEEK_CUR);
+    } else if (memcmp(chunk.id, "data", 4) == 0) {
+      break;
+    } else {
+      fseek(f, chunk.size + (chunk.size & 1), SEEK_CUR);
+    }
+  }
+  if (fmt.format != 1 || fmt.bits_per_sample != 16 || fmt.channels < 1 ||
+      fmt.channels > 2 || memcmp(chunk.id, "data", 4)) {
+    ESP_LOGE(TAG, "%s: only 16-bit PCM mono/stereo WAV is supported", wav_path);
+    fclose(f);
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+
+  if (port->source) {
+    fclose(port->source);
+  }
+  port->source = f;
+  port->source_data = ftell(f);
+  port->source_bytes = chunk.size;
+  port->source_pos = 0;
+  port->source_channels = fmt.channels;
+  port->source_loop = loop;
+  port->source_done = false;
+  ESP_LOGI(TAG, "Source %s: %u Hz, %u ch, %u frames", wav_path,
+           fmt.sample_rate, fmt.channels,
+           (unsigned)(chunk.size / (fmt.channels * sizeof(int16_t))));
+  return ESP_OK;
+}
+
+bool i2s_host_source_done(i2s_port_t i2s_num) {
+  return ports[i2s_num].source_done;
+}
+
+void i2s_host_set_unpaced(i2s_port_t i2s_num, bool unpaced) {
+  ports[i2s_num].unpaced = unpaced;
+}
+
+/* Like the driver's ISR, makes room by dropping the oldest event. */
+static void dma_post(i2s_host_port_t *port, i2s_event_type_t type) {
+  i2s_event_t event = {
+      .type = type,
+      .size = port->config.dma_buf_len * 2 * sizeof(int16_t),
+  };
+  if (uxQueueSpacesAvailable(port->events) == 0) {
+    i2s_event_t dropped;
+    xQueueReceive(port->events, &dropped, 0);
+  }
+  xQueueSendFromISR(port->events, &event, NULL);
+}
+
+static void dma_timer_cb(void *arg) {
+  dma_post(arg, I2S_EVENT_RX_DONE);
+}
+
+static esp_err_t dma_timer_start(i2s_host_port_t *port) {
+  uint64_t period = (uint64_t)port->config.dma_buf_len * 1000000 /
+                    port->config.sample_rate;
+  return esp_timer_start_periodic(port->dma_timer, period);
+}
+
+static void wav_write_header(FILE *f, int channels, int sample_rate,
+                             uint32_t data_bytes) {
+  wav_riff_t riff = {{'R', 'I', 'F', 'F'},
+                     data_bytes + 4 + 2 * sizeof(wav_chunk_t) + sizeof(wav_fmt_t),
+                     {'W', 'A', 'V', 'E'}};
+  wav_chunk_t fmt_chunk = {{'f', 'm', 't', ' '}, sizeof(wav_fmt_t)};
+  wav_fmt_t fmt = {1, (uint16_t)channels, (uint32_t)sample_rate,
+                   (uint32_t)(sample_rate * channels * sizeof(int16_t)),
+                   (uint16_t)(channels * sizeof(int16_t)), 16};
+  wav_chunk_t data_chunk = {{'d', 'a', 't', 'a'}, data_bytes};
+
+  fseek(f, 0, SEEK_SET);
+  fwrite(&riff, sizeof(riff), 1, f);
+  fwrite(&fmt_chunk, sizeof(fmt_chunk), 1, f);
+  fwrite(&fmt, sizeof(fmt), 1, f);
+  fwrite(&data_chunk, sizeof(data_chunk), 1, f);
+}
+
+esp_err_t i2s_host_set_sink(i2s_port_t i2s_num, const char *wav_path,
+                            int channels) {
+  i2s_host_port_t *port = &ports[i2s_num];
+  if (channels < 1 || channels > 2) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  FILE *f = fopen(wav_path, "wb");
+  if (f == NULL) {
+    ESP_LOGE(TAG, "Unable to create %s", wav_path);
+    return ESP_ERR_NOT_FOUND;
+  }
+  port->sink = f;
+  port->sink_channels = channels;
+  port->sink_bytes = 0;
+  wav_write_header(f, channels, port->config.sample_rate, 0);
+  return ESP_OK;
+}
+
+esp_err_t i2s_driver_install(i2s_port_t i2s_num, const i2s_config_t *i2s_config,
+                             int queue_size, void *i2s_queue) {
+  if (i2s_num >= I2S_NUM_MAX || i2s_config == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (i2s_config->bits_per_sample != I2S_BITS_PER_SAMPLE_16BIT) {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  i2s_host_port_t *port = &ports[i2s_num];
+  port->config = *i2s_config;
+  port->installed = true;
+
+  if (queue_size > 0 && i2s_queue != NULL) {
+    port->events = xQueueCreate(queue_size, sizeof(i2s_event_t));
+    if (port->events == NULL) {
+      return ESP_ERR_NO_MEM;
+    }
+    *(QueueHandle_t *)i2s_queue = port->events;
+    if (!(i2s_config->mode & I2S_MODE_RX)) {
+      return ESP_OK;
+    }
+    if (port->unpaced) {
+      dma_post(port, I2S_EVENT_RX_DONE);
+      return ESP_OK;
+    }
+    const esp_timer_create_args_t timer_args = {
+        .callback = dma_timer_cb,
+        .arg = port,
+        .name = "i2s_dma",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &port->dma_timer);
+    if (err == ESP_OK) {
+      err = dma_timer_start(port);
+    }
+    return err;
+  }
+  return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t i2s_num) {
+  i2s_host_port_t *port = &ports[i2s_num];
+  if (port->dma_timer) {
+    esp_timer_stop(port->dma_timer);
+    esp_timer_delete(port->dma_timer);
+    port->dma_timer = NULL;
+  }
+  if (port->events) {
+    vQueueDelete(port->events);
+    port->events = NULL;
+  }
+  if (port->sink) {
+    wav_write_header(port->sink, port->sink_channels, port->config.sample_rate,
+                     port->sink_bytes);
+    fclose(port->sink);
+    port->sink = NULL;
+  }
+  if (port->source) {
+    fclose(port->source);
+    port->source = NULL;
+  }
+  port->installed = false;
+  return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t i2s_num, const i2s_pin_config_t *pin) {
+  return ports[i2s_num].installed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t i2s_num) {
+  return ports[i2s_num].installed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t i2s_set_sample_rates(i2s_port_t i2s_num, uint32_t rate) {
+  if (!ports[i2s_num].installed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  i2s_host_port_t *port = &ports[i2s_num];
+  port->config.sample_rate = (int)rate;
+  if (port->dma_timer) {
+    esp_timer_stop(port->dma_timer);
+    return dma_timer_start(port);
+  }
+  return ESP_OK;
+}
+
+/* Reads up to frames source frames as stereo, returns frames read. */
+static size_t source_read(i2s_host_port_t *port, int16_t *dest, size_t frames) {
+  size_t done = 0;
+  while (done < frames && !port->source_done) {
+    size_t frame_bytes = port->source_channels * sizeof(int16_t);
+    size_t left = (port->source_bytes - port->source_pos) / frame_bytes;
+    if (left == 0) {
+      if (!port->source_loop) {
+        port->source_done = true;
+        break;
+      }
+      fseek(port->source, port->source_data, SEEK_SET);
+      port->source_pos = 0;
+      continue;
+    }
+    size_t n = frames - done < left ? frames - done : left;
+    int16_t *out = dest + done * 2;
+    size_t got = fread(out, frame_bytes, n, port->source);
+    if (got == 0) {
+      port->source_bytes = port->source_pos;
+      continue;
+    }
+    if (port->source_channels == 1) {
+      for (size_t i = got; i-- > 0;) {
+        out[2 * i] = out[2 * i + 1] = out[i];
+      }
+    }
+    port->source_pos += got * frame_bytes;
+    done += got;
+  }
+  return done;
+}
+
+esp_err_t i2s_read(i2s_port_t i2s_num, void *dest, size_t size,
+                   size_t *bytes_read, TickType_t ticks_to_wait) {
+  i2s_host_port_t *port = &ports[i2s_num];
+  if (!port->installed || !(port->config.mode & I2S_MODE_RX)) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  size_t frames = size / (2 * sizeof(int16_t));
+  size_t got = port->source ? source_read(port, dest, frames) : 0;
+  memset((int16_t *)dest + got * 2, 0, size - got * 2 * sizeof(int16_t));
+  *bytes_read = size;
+  if (port->events && port->unpaced) {
+    dma_post(port, I2S_EVENT_RX_DONE);
+  }
+  return ESP_OK;
+}
+
+esp_err_t i2s_write(i2s_port_t i2s_num, const void *src, size_t size,
+                    size_t *bytes_written, TickType_t ticks_to_wait) {
+  i2s_host_port_t *port = &ports[i2s_num];
+  if (!port->installed || !(port->config.mode & I2S_MODE_TX)) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (port->sink) {
+    fwrite(src, 1, size, port->sink);
+    port->sink_bytes += size;
+  }
+  *bytes_written = size;
+  return ESP_OK;
+}
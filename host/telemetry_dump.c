@@ -0,0 +1,113 @@
+/*
+ * Decodes the telemetry snapshots (see war_telemetry.h) in a console log,
+ * the firmware's or war_tx/war_rx -T's, and prints the values that are not
+ * zero: counters with their rate over the snapshot's interval, peaks, and
+ * histograms as count, average, percentiles and maximum. Other lines are
+ * passed through.
+ *
+ *   telemetry_dump [log]
+ *   war_tx -T 1000 2>&1 | telemetry_dump
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "war_telemetry.h"
+
+#define LOG_MARKER "Telemetry: "
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/* Hex up to the first other character, as the log may colour the line. */
+static size_t hex_decode(const char *hex, uint8_t *out, size_t len)
+{
+    size_t n = 0;
+    while (n < len)
+    {
+        int hi = hex_digit(hex[2 * n]);
+        int lo = hi < 0 ? -1 : hex_digit(hex[2 * n + 1]);
+        if (lo < 0)
+            break;
+        out[n++] = (uint8_t)(hi << 4 | lo);
+    }
+    return n;
+}
+
+static void print_snapshot(const telemetry_snapshot_t *snap)
+{
+    double seconds = snap->header.interval_us * 1e-6;
+    printf("--- snapshot %u at %.3f s, over %.3f s\n", snap->header.seq,
+        snap->header.time_us * 1e-6, seconds);
+    for (int i = 0; i < TELEMETRY_COUNTERS; i++)
+    {
+        uint32_t value = snap->counters[i];
+        if (value)
+            printf("%-24s %10u %12.1f/s\n", telemetry_counter_name((telemetry_counter_t)i),
+                value, seconds > 0.0 ? value / seconds : 0.0);
+    }
+    for (int i = 0; i < TELEMETRY_PEAKS; i++)
+    {
+        if (snap->peaks[i])
+            printf("%-24s %10u peak\n", telemetry_peak_name((telemetry_peak_t)i),
+                snap->peaks[i]);
+    }
+    for (int i = 0; i < TELEMETRY_HISTS; i++)
+    {
+        const uint32_t *hist = snap->hists[i];
+        uint32_t count = telemetry_hist_count(hist);
+        if (count == 0)
+            continue;
+        printf("%-24s %10u avg %.1f, p50 %u, p90 %u, p99 %u, max %u\n",
+            telemetry_hist_name((telemetry_hist_t)i), count,
+            (double)hist[TELEMETRY_HIST_SUM] / count,
+            telemetry_hist_percentile(hist, 50.f), telemetry_hist_percentile(hist, 90.f),
+            telemetry_hist_percentile(hist, 99.f), hist[TELEMETRY_HIST_MAX]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    if (argc > 2)
+    {
+        fprintf(stderr, "usage: %s [log]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2 && (in = fopen(argv[1], "r")) == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    static char line[4 * TELEMETRY_SNAPSHOT_MAX];
+    static uint8_t data[TELEMETRY_SNAPSHOT_MAX];
+    static telemetry_snapshot_t snap;
+    int bad = 0;
+    while (fgets(line, sizeof(line), in) != NULL)
+    {
+        const char *hex = strstr(line, LOG_MARKER);
+        if (hex == NULL)
+        {
+            fputs(line, stdout);
+            continue;
+        }
+        size_t len = hex_decode(hex + strlen(LOG_MARKER), data, sizeof(data));
+        if (!telemetry_parse(data, len, &snap))
+        {
+            fprintf(stderr, "undecodable snapshot: %s", line);
+            bad++;
+            continue;
+        }
+        print_snapshot(&snap);
+        fflush(stdout);
+    }
+    if (in != stdin)
+        fclose(in);
+    return bad ? 2 : 0;
+}
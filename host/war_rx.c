@@ -0,0 +1,321 @@
+/*
+ * Host receiver. espnow_task() runs in receiver mode and pushes payloads
+ * into a no-split ringbuffer; a playout timer pulls one packet per packet
+ * period and writes it to a mono WAV sink, writing silence and counting a
+ * missed audio callback when the ringbuffer is empty. With -j the adaptive
+ * jitter buffer replaces the ringbuffer, and -c conceals lost packets
+ * (silence, repeat or pitch). Two-channel builds (ESPNOW_LAYOUT) write a
+ * stereo WAV. Playout starts on the default stream and follows the
+ * sender's sample rate and packet length once its stream packet arrives.
+ * -d resamples playout by the estimated clock drift (see war_drift.h) to
+ * hold the buffer at its target.
+ * -t measures latency (see war_latency.h): one-way from the timestamps of
+ * war_tx -t, capture to output from the impulses of war_tx -I. With -B the
+ * exit status is 2 when the 99th percentile, of the impulses if there were
+ * any, exceeds budget_us, so a run over UDP catches latency regressions:
+ *
+ *   war_rx -j -t -B 50000 -n 2500 & war_tx -t -I -n 3000; wait $!
+ *
+ * -T logs a telemetry snapshot every period_ms for telemetry_dump (see
+ * war_telemetry.h). The stage profile (see war_profile.h) is logged at
+ * exit.
+ *
+ *   war_rx [-o output.wav] [-n packets] [-j] [-c plc_mode] [-d] [-t]
+ *          [-B budget_us] [-T period_ms] [-p local_port] [-r remote_port]
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "driver/i2s.h"
+#include "esp_host.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/ringbuf.h"
+#include "freertos/task.h"
+
+#include "war_config.h"
+#include "war_espnow.h"
+#include "war_profile.h"
+
+#define RX_RBUF_PACKETS 8
+#define RX_RBUF_ITEM_LEN(send_len) ((send_len) + 8)
+#define RX_RBUF_LEN (RX_RBUF_PACKETS * RX_RBUF_ITEM_LEN(ESPNOW_MAX_SEND_LEN))
+/* Ringbuffer level drift correction aims for. */
+#define RX_RBUF_TARGET 2
+
+static const char *TAG = "Host RX";
+
+static jitter_buffer_t jitter;
+static uint8_t jitter_storage[JITTER_SLOTS * ESPNOW_MAX_SEND_LEN];
+static plc_t plc[ESPNOW_CHANNELS];
+static drift_t drift;
+static resampler_t resampler;
+static latency_t latency;
+
+static bool use_jitter = false;
+static RingbufHandle_t rbuf;
+static long underruns = 0;
+
+static volatile sig_atomic_t stop = 0;
+static TaskHandle_t xMainTaskNotify = NULL;
+static esp_timer_handle_t playout_timer = NULL;
+
+static void on_signal(int sig)
+{
+    stop = 1;
+}
+
+/* Payloads are planar for two channels, I2S wants frames. */
+static void play(const int16_t *frame, size_t frames)
+{
+    size_t bytes_written = 0;
+    int16_t lr[ESPNOW_MAX_SAMPLES];
+    if (ESPNOW_CHANNELS == 2)
+    {
+        layout_interleave(frame, frames, lr);
+        frame = lr;
+    }
+    i2s_write(I2S_NUM_0, frame, frames * ESPNOW_CHANNELS * sizeof(int16_t),
+        &bytes_written, 0);
+}
+
+static void log_latency(const char *name, const latency_hist_t *hist)
+{
+    ESP_LOGI(TAG, "%s: %u samples, p50 %u us, p90 %u, p99 %u, p99.9 %u, max %u%s",
+        name, hist->count, latency_percentile(hist, 50.f),
+        latency_percentile(hist, 90.f), latency_percentile(hist, 99.f),
+        latency_percentile(hist, 99.9f), hist->max,
+        hist->early ? " (some below zero)" : "");
+}
+
+/* The sender's stream differs from ours: play out at its packet rate. */
+static void on_stream(const espnow_stream_t *stream)
+{
+    i2s_set_sample_rates(I2S_NUM_0, stream->samplerate);
+    esp_timer_stop(playout_timer);
+    esp_timer_start_periodic(playout_timer, stream->packet_us);
+}
+
+/* The next packet from the jitter buffer or ringbuffer, else silence. ctx
+ * is the stream copied for this packet. */
+static void pull_packet(void *ctx, int16_t *packet)
+{
+    const espnow_stream_t *stream = ctx;
+    size_t item_size = 0;
+    void *item = NULL;
+    if (use_jitter)
+    {
+        if (espnow_jitter_pop((uint8_t *)packet) == JITTER_UNDERRUN)
+            underruns++;
+    }
+    else if ((item = xRingbufferReceive(rbuf, &item_size, 0)) != NULL)
+    {
+        // Items queued before a new stream can be shorter or longer.
+        size_t len = item_size < stream->send_len ? item_size : stream->send_len;
+        memcpy(packet, item, len);
+        memset((uint8_t *)packet + len, 0, stream->send_len - len);
+        vRingbufferReturnItem(rbuf, item);
+    }
+    else
+    {
+        memset(packet, 0, stream->send_len);
+        telemetry_count(TELEMETRY_UNDERRUNS, 1);
+        underruns++;
+    }
+}
+
+/* One packet resampled by the drift estimate. The fill level counts what
+ * the resampler holds on top of the buffered packets, so the targets carry
+ * half a packet more for it pulling at any phase of the packet clock. The
+ * jitter buffer also rests one packet over its target before a pop. */
+static void pull_resampled(const espnow_stream_t *stream, int16_t *packet)
+{
+    if (resampler.in_frames != stream->frames)
+        resampler_init(&resampler, ESPNOW_CHANNELS, stream->frames);
+
+    float fill, target;
+    if (use_jitter)
+    {
+        uint32_t depth;
+        uint16_t target_depth;
+        espnow_jitter_level(&depth, &target_depth);
+        fill = (float)depth * stream->frames;
+        target = ((float)target_depth + 1.5f) * stream->frames;
+    }
+    else
+    {
+        size_t used = RX_RBUF_LEN - xRingbufferGetCurFreeSize(rbuf);
+        fill = (float)used / RX_RBUF_ITEM_LEN(stream->send_len) * stream->frames;
+        target = ((float)RX_RBUF_TARGET + 0.5f) * stream->frames;
+    }
+    fill += resampler_buffered(&resampler);
+    resampler_set_ppm(&resampler,
+        drift_update(&drift, fill, target, stream->frames));
+    resampler_read(&resampler, packet, stream->frames, pull_packet, (void *)stream);
+}
+
+static void playout_timer_cb(void *arg)
+{
+    if (xMainTaskNotify)
+        xTaskNotifyGive(xMainTaskNotify);
+}
+
+int main(int argc, char **argv)
+{
+    const char *output = NULL;
+    long packets = -1;
+    bool use_drift = false;
+    bool use_latency = false;
+    uint32_t budget_us = 0;
+    uint32_t telemetry_ms = 0;
+    int plc_mode = -1;
+    uint16_t local_port = 3334, remote_port = 3333;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:n:jc:dtB:T:p:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'o': output = optarg; break;
+        case 'n': packets = strtol(optarg, NULL, 0); break;
+        case 'j': use_jitter = true; break;
+        case 'c':
+            for (int m = PLC_SILENCE; m <= PLC_PITCH; m++)
+                if (strcmp(optarg, plc_mode_name((plc_mode_t)m)) == 0)
+                    plc_mode = m;
+            break;
+        case 'd': use_drift = true; break;
+        case 't': use_latency = true; break;
+        case 'B': budget_us = (uint32_t)atoi(optarg); break;
+        case 'T': telemetry_ms = (uint32_t)atoi(optarg); break;
+        case 'p': local_port = (uint16_t)atoi(optarg); break;
+        case 'r': remote_port = (uint16_t)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-o output.wav] [-n packets] "
+                            "[-j] [-c silence|repeat|pitch] [-d] [-t] [-B budget_us] [-T period_ms] "
+                            "[-p local_port] [-r remote_port]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    const espnow_stream_t *stream = espnow_get_stream();
+    i2s_config_t i2s_config = {
+        .mode = (i2s_mode_t) (I2S_MODE_MASTER | I2S_MODE_TX),
+        .sample_rate = (int)stream->samplerate,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = ESPNOW_CHANNELS == 2 ? I2S_CHANNEL_FMT_RIGHT_LEFT
+                                               : I2S_CHANNEL_FMT_ONLY_RIGHT,
+        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
+        .dma_buf_count = 4,
+        .dma_buf_len = stream->samples,
+    };
+    ESP_ERROR_CHECK( i2s_driver_install(I2S_NUM_0, &i2s_config, 0, NULL) );
+    if (output)
+        ESP_ERROR_CHECK( i2s_host_set_sink(I2S_NUM_0, output, ESPNOW_CHANNELS) );
+
+    rbuf = xRingbufferCreate(RX_RBUF_LEN, RINGBUF_TYPE_NOSPLIT);
+    espnow_set_rbuf(rbuf, RX_RBUF_LEN);
+    if (use_jitter)
+    {
+        const jitter_config_t jitter_config = {
+            .packet_us = stream->packet_us,
+            .min_depth = 1,
+            .max_depth = 16,
+            .jitter_multiplier = 3.f,
+        };
+        jitter_init(&jitter, jitter_storage, stream->send_len, &jitter_config);
+        espnow_set_jitter_buffer(&jitter);
+        if (plc_mode >= 0)
+        {
+            for (int c = 0; c < ESPNOW_CHANNELS; c++)
+                plc_init(&plc[c], (plc_mode_t)plc_mode, stream->frames, stream->samplerate);
+            espnow_set_plc(plc);
+        }
+    }
+    xMainTaskNotify = xTaskGetCurrentTaskHandle();
+    const esp_timer_create_args_t timer_args = {
+        .callback = playout_timer_cb,
+        .name = "playout",
+    };
+    ESP_ERROR_CHECK( esp_timer_create(&timer_args, &playout_timer) );
+    ESP_ERROR_CHECK( esp_timer_start_periodic(playout_timer, stream->packet_us) );
+
+    if (use_drift)
+    {
+        drift_init(&drift, stream->packet_us);
+        resampler_init(&resampler, ESPNOW_CHANNELS, stream->frames);
+        espnow_set_drift(&drift);
+    }
+    if (use_latency)
+    {
+        latency_init(&latency);
+        espnow_set_latency(&latency);
+    }
+    esp_now_host_set_endpoint("127.0.0.1", local_port, remote_port);
+    espnow_set_stream_cb(on_stream);
+    ESP_ERROR_CHECK( espnow_init(true) );
+    espnow_set_rbuf_state(ESPNOW_RBUF_ACTIVE);
+    if (telemetry_ms > 0)
+        telemetry_start(telemetry_ms, espnow_telemetry_collect, telemetry_sink_log);
+
+    espnow_stream_t current = *stream;
+    long played = 0;
+    while (!stop && (packets < 0 || played < packets))
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // espnow_task() may switch streams while this packet is pulled.
+        espnow_copy_stream(&current);
+        int16_t packet[ESPNOW_MAX_SAMPLES];
+        if (use_drift)
+            pull_resampled(&current, packet);
+        else
+            pull_packet(&current, packet);
+        // The WAV sink has no DMA queue: what is written is out.
+        if (use_latency)
+            latency_output(&latency, packet, current.frames, current.samplerate,
+                (uint32_t)esp_timer_get_time());
+        play(packet, current.frames);
+        played++;
+    }
+
+    esp_timer_stop(playout_timer);
+    esp_timer_delete(playout_timer);
+    espnow_set_rbuf_state(ESPNOW_RBUF_INACTIVE);
+
+    ESP_LOGI(TAG, "%ld packets played, %ld underruns", played, underruns);
+    profile_log(current.packet_us);
+    if (use_drift)
+        ESP_LOGI(TAG, "Drift correction %.1f ppm, transit estimate %.1f ppm%s",
+            drift.ppm, drift.transit_ppm, drift.transit_valid ? "" : " (none yet)");
+    i2s_driver_uninstall(I2S_NUM_0);
+
+    if (!use_latency)
+        return 0;
+    ESP_LOGI(TAG, "Clock offset %s, round trip %u us, jitter %.1f us",
+        latency.offset_valid ? "found" : "not found", latency.rtt, latency.jitter);
+    log_latency("Capture to arrival", &latency.transit);
+    log_latency("Capture to output", &latency.impulse);
+    if (budget_us == 0)
+        return 0;
+    const latency_hist_t *gate = latency.impulse.count ? &latency.impulse : &latency.transit;
+    if (gate->count == 0)
+    {
+        ESP_LOGE(TAG, "No latency samples to check against %u us", budget_us);
+        return 2;
+    }
+    if (latency_percentile(gate, 99.f) > budget_us)
+    {
+        ESP_LOGE(TAG, "Latency p99 %u us over the %u us budget",
+            latency_percentile(gate, 99.f), budget_us);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * Host transmitter. Runs the same pipeline as main.c: mixer_read() waits
+ * for an I2S DMA buffer, drops it to mono and queues it for espnow_task().
+ * I2S reads from a WAV file with the DMA clock simulated by the stand-in
+ * driver, and ESP-NOW frames go out over UDP.
+ *
+ *   war_tx [-i input.wav] [-l] [-n packets] [-f] [-F xor:K|rs:K:M]
+ *          [-R] [-c codec] [-k integrity] [-m layout] [-s samplerate] [-P frames]
+ *          [-t] [-I] [-L loss_pct] [-W window] [-C copies] [-S spacing]
+ *          [-A airtime_us] [-T period_ms] [-p local_port] [-r remote_port]
+ *
+ * -l loops the input, -f drops the DMA clock and runs as fast as the sender
+ * drains espnow_data_queue (load test). -F sends parity after every K audio
+ * packets (see war_fec.h), -R adds the redundant copy of the previous frame
+ * (see war_redundant.h), -c picks the payload codec by name (pcm16, adpcm,
+ * rice; see war_codec.h), -k the packet check (crc16, crc32, header,
+ * none; see war_integrity.h), -m the channel layout by name with as many
+ * channels as ESPNOW_LAYOUT (see war_layout.h), -s/-P set the stream the
+ * firmware keeps in NVS (espnow_set_stream()), -t stamps packets with their
+ * capture time and -I sends impulses instead of audio (see war_latency.h),
+ * -L drops that share of frames on the way out.
+ * -W/-C/-S set the sender window and duplicate policy
+ * (espnow_sender_config_t) and -A holds each frame for airtime_us on the
+ * way out. -T logs a telemetry snapshot every period_ms for telemetry_dump
+ * (see war_telemetry.h) instead of the capture summary at exit. The
+ * stage profile (see war_profile.h) is logged at exit either way.
+ *
+ *   war_tx -T 1000 2>&1 | telemetry_dump
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "esp_host.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "war_config.h"
+#include "war_espnow.h"
+#include "war_mixer.h"
+#include "war_profile.h"
+
+static const char *TAG = "Host TX";
+
+static bool parse_fec(const char *arg, fec_config_t *config)
+{
+    unsigned k = 0, m = 1;
+    if (sscanf(arg, "xor:%u", &k) == 1)
+        config->scheme = FEC_XOR;
+    else if (sscanf(arg, "rs:%u:%u", &k, &m) == 2)
+        config->scheme = FEC_RS;
+    else
+        return false;
+    config->k = (uint8_t)k;
+    config->m = (uint8_t)m;
+    return k <= FEC_MAX_K && m <= FEC_MAX_M && fec_config_valid(config);
+}
+
+static bool parse_codec(const char *arg, codec_id_t *codec)
+{
+    for (int id = 0; id < CODEC_COUNT; id++)
+    {
+        if (strcmp(arg, codec_name((codec_id_t)id)) == 0)
+        {
+            *codec = (codec_id_t)id;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_integrity(const char *arg, integrity_mode_t *mode)
+{
+    for (int id = 0; id < INTEGRITY_COUNT; id++)
+    {
+        if (strcmp(arg, integrity_name((integrity_mode_t)id)) == 0)
+        {
+            *mode = (integrity_mode_t)id;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_layout(const char *arg, channel_layout_t *layout)
+{
+    for (int id = 0; id < LAYOUT_COUNT; id++)
+    {
+        if (strcmp(arg, layout_name((channel_layout_t)id)) == 0 &&
+            LAYOUT_CHANNELS(id) == ESPNOW_CHANNELS)
+        {
+            *layout = (channel_layout_t)id;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    bool loop = false;
+    bool fast = false;
+    long packets = -1;
+    uint16_t local_port = 3333, remote_port = 3334;
+    fec_config_t fec = {.scheme = FEC_NONE};
+    codec_id_t codec = CODEC_PCM16;
+    integrity_mode_t integrity = (integrity_mode_t)ESPNOW_INTEGRITY;
+    channel_layout_t layout = (channel_layout_t)ESPNOW_LAYOUT;
+    uint32_t samplerate = SAMPLERATE;
+    uint16_t frames = ESPNOW_DEFAULT_FRAMES;
+    bool impulse = false;
+    uint32_t telemetry_ms = 0;
+    espnow_sender_config_t sender = {
+        .window = ESPNOW_SEND_WINDOW,
+        .copies = ESPNOW_SEND_COPIES,
+        .spacing = ESPNOW_SEND_SPACING,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:ln:fF:Rc:k:m:s:P:tIL:W:C:S:A:T:p:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'i': input = optarg; break;
+        case 'l': loop = true; break;
+        case 'n': packets = strtol(optarg, NULL, 0); break;
+        case 'f': fast = true; break;
+        case 'F':
+            if (!parse_fec(optarg, &fec))
+            {
+                fprintf(stderr, "bad FEC config: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'R': espnow_set_redundancy(true); break;
+        case 'c':
+            if (!parse_codec(optarg, &codec))
+            {
+                fprintf(stderr, "unknown codec: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'k':
+            if (!parse_integrity(optarg, &integrity))
+            {
+                fprintf(stderr, "unknown integrity mode: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'm':
+            if (!parse_layout(optarg, &layout))
+            {
+                fprintf(stderr, "unknown layout for %d channels: %s\n",
+                    (int)ESPNOW_CHANNELS, optarg);
+                return 1;
+            }
+            break;
+        case 's': samplerate = (uint32_t)atoi(optarg); break;
+        case 'P': frames = (uint16_t)atoi(optarg); break;
+        case 't': espnow_set_timestamps(true); break;
+        case 'I': impulse = true; break;
+        case 'L': esp_now_host_set_loss(atof(optarg)); break;
+        case 'W': sender.window = (uint8_t)atoi(optarg); break;
+        case 'C': sender.copies = (uint8_t)atoi(optarg); break;
+        case 'S': sender.spacing = (uint8_t)atoi(optarg); break;
+        case 'A': esp_now_host_set_airtime((uint32_t)atoi(optarg)); break;
+        case 'T': telemetry_ms = (uint32_t)atoi(optarg); break;
+        case 'p': local_port = (uint16_t)atoi(optarg); break;
+        case 'r': remote_port = (uint16_t)atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-i input.wav] [-l] [-n packets] [-f] "
+                            "[-F xor:K|rs:K:M] [-R] [-c codec] [-k integrity] [-m layout] [-s samplerate] [-P frames] [-t] [-I] [-L loss_pct] [-W window] [-C copies] "
+                            "[-S spacing] [-A airtime_us] [-T period_ms] [-p local_port] [-r remote_port]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    esp_now_host_set_endpoint("127.0.0.1", local_port, remote_port);
+    espnow_set_fec(&fec);
+    espnow_set_codec(codec);
+    espnow_set_integrity(integrity);
+    espnow_set_sender(&sender);
+    if (!espnow_set_stream(samplerate, frames))
+        return 1;
+    ESP_ERROR_CHECK( espnow_init(false) );
+    if (telemetry_ms > 0)
+        telemetry_start(telemetry_ms, espnow_telemetry_collect, telemetry_sink_log);
+
+    i2s_host_set_unpaced(I2S_NUM_0, fast);
+    mixer_init();
+    mixer_set_layout(layout);
+    mixer_set_impulse(impulse);
+    if (input)
+        ESP_ERROR_CHECK( i2s_host_set_source(I2S_NUM_0, input, loop) );
+
+    int64_t start = esp_timer_get_time();
+    long sent = 0;
+    while (packets < 0 || sent < packets)
+    {
+        if (input && i2s_host_source_done(I2S_NUM_0))
+            break;
+        mixer_read();
+        sent++;
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    // Let espnow_task drain what is still queued.
+    vTaskDelay(pdMS_TO_TICKS(50));
+
+    ESP_LOGI(TAG, "%ld packets in %.3f s (%.1f packets/s)", sent,
+             elapsed * 0.000001, sent / (elapsed * 0.000001));
+    if (telemetry_ms == 0)
+    {
+        static uint8_t buf[TELEMETRY_SNAPSHOT_MAX];
+        static telemetry_snapshot_t snap;
+        telemetry_parse(buf, telemetry_take(buf, sizeof(buf)), &snap);
+        const uint32_t *capture = snap.hists[TELEMETRY_CAPTURE_US];
+        uint32_t count = telemetry_hist_count(capture);
+        if (count)
+            ESP_LOGI(TAG, "Capture to send avg %.1f us, p99 %u, max %u",
+                     (float)capture[TELEMETRY_HIST_SUM] / count,
+                     telemetry_hist_percentile(capture, 99.f),
+                     capture[TELEMETRY_HIST_MAX]);
+    }
+    profile_log(espnow_get_stream()->packet_us);
+    i2s_driver_uninstall(I2S_NUM_0);
+    return 0;
+}
@@ -10,9 +10,12 @@ CFilterButterworth24db::CFilterButterworth24db(void)
     this->history2 = 0.f;
     this->history3 = 0.f;
     this->history4 = 0.f;
+    this->interpolate = true;
 
     this->SetSampleRate(44100.f);
     this->Set(22050.f, 0.0);
+    this->exchange.fetch();
+    this->current = this->exchange.read();
 }
 
 CFilterButterworth24db::~CFilterButterworth24db(void)
@@ -46,6 +49,7 @@ void CFilterButterworth24db::Set(float cutoff, float q)
 
     float wp = this->t2 * tanf(this->t3 * cutoff);
     float bd, bd_tmp, b1, b2;
+    Coefficients& c = this->exchange.write();
 
     q *= BUDDA_Q_SCALE;
     q += 1.f;
@@ -57,29 +61,36 @@ void CFilterButterworth24db::Set(float cutoff, float q)
 
     bd = 1.f / (bd_tmp + this->t2 * b1);
 
-    this->gain = bd * 0.5f;
+    c.gain = bd * 0.5f;
 
-    this->coef2 = (2.f - this->t1 * b2);
+    c.coef2 = (2.f - this->t1 * b2);
 
-    this->coef0 = this->coef2 * bd;
-    this->coef1 = (bd_tmp - this->t2 * b1) * bd;
+    c.coef0 = c.coef2 * bd;
+    c.coef1 = (bd_tmp - this->t2 * b1) * bd;
 
     b1 = (1.847759f / q) / wp;
 
     bd = 1.f / (bd_tmp + this->t2 * b1);
 
-    this->gain *= bd;
-    this->coef2 *= bd;
-    this->coef3 = (bd_tmp - this->t2 * b1) * bd;
+    c.gain *= bd;
+    c.coef2 *= bd;
+    c.coef3 = (bd_tmp - this->t2 * b1) * bd;
+
+    this->exchange.publish();
 }
 
-float CFilterButterworth24db::Run(float input)
+void CFilterButterworth24db::SetInterpolation(bool interpolate)
 {
-    float output = input * this->gain;
+    this->interpolate = interpolate;
+}
+
+inline float CFilterButterworth24db::Step(float input, const Coefficients& c)
+{
+    float output = input * c.gain;
     float new_hist;
 
-    output -= this->history1 * this->coef0;
-    new_hist = output - this->history2 * this->coef1;
+    output -= this->history1 * c.coef0;
+    new_hist = output - this->history2 * c.coef1;
 
     output = new_hist + this->history1 * 2.f;
     output += this->history2;
@@ -87,8 +98,8 @@ float CFilterButterworth24db::Run(float input)
     this->history2 = this->history1;
     this->history1 = new_hist;
 
-    output -= this->history3 * this->coef2;
-    new_hist = output - this->history4 * this->coef3;
+    output -= this->history3 * c.coef2;
+    new_hist = output - this->history4 * c.coef3;
 
     output = new_hist + this->history3 * 2.f;
     output += this->history4;
@@ -97,4 +108,51 @@ float CFilterButterworth24db::Run(float input)
     this->history3 = new_hist;
 
     return output;
-}
\ No newline at end of file
+}
+
+float CFilterButterworth24db::Run(float input)
+{
+    if (this->exchange.fetch())
+        this->current = this->exchange.read();
+    return this->Step(input, this->current);
+}
+
+void CFilterButterworth24db::Process(const float* input, float* output, size_t n)
+{
+    if (n == 0)
+        return;
+    if (!this->exchange.fetch())
+    {
+        for (size_t i = 0; i < n; i++)
+            output[i] = this->Step(input[i], this->current);
+        return;
+    }
+    const Coefficients& target = this->exchange.read();
+    if (!this->interpolate)
+    {
+        this->current = target;
+        for (size_t i = 0; i < n; i++)
+            output[i] = this->Step(input[i], this->current);
+        return;
+    }
+
+    // An nth of the way per sample, landing on the target at the last.
+    float r = 1.f / n;
+    Coefficients& c = this->current;
+    Coefficients d = {
+        (target.gain - c.gain) * r, (target.coef0 - c.coef0) * r,
+        (target.coef1 - c.coef1) * r, (target.coef2 - c.coef2) * r,
+        (target.coef3 - c.coef3) * r,
+    };
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        c.gain += d.gain;
+        c.coef0 += d.coef0;
+        c.coef1 += d.coef1;
+        c.coef2 += d.coef2;
+        c.coef3 += d.coef3;
+        output[i] = this->Step(input[i], c);
+    }
+    c = target;
+    output[n - 1] = this->Step(input[n - 1], c);
+}
@@ -1,6 +1,14 @@
 #ifndef __FILTERBUTTERWORTH24DB_H__
 #define __FILTERBUTTERWORTH24DB_H__
 
+#include <stddef.h>
+
+#include "Modulation.h"
+
+/* Set() and SetSampleRate() belong to a control thread and Run() and
+ * Process() to an audio thread, which may run at once: Set() works out the
+ * coefficients on its own thread and publishes them, and the audio thread
+ * takes up the newest at its next call without either waiting. */
 class CFilterButterworth24db
 {
 public:
@@ -8,14 +16,31 @@ public:
     ~CFilterButterworth24db(void);
     void SetSampleRate(float fs);
     void Set(float cutoff, float q);
+    // Whether Process() moves to new coefficients across the block (the
+    // default) or at its start.
+    void SetInterpolation(bool interpolate);
     float Run(float input);
+    void Process(const float* input, float* output, size_t n);
 
 private:
+    struct Coefficients
+    {
+        float gain;
+        float coef0, coef1, coef2, coef3;
+    };
+
+    float Step(float input, const Coefficients& c);
+
+    // Control thread's.
     float t0, t1, t2, t3;
-    float coef0, coef1, coef2, coef3;
-    float history1, history2, history3, history4;
-    float gain;
     float min_cutoff, max_cutoff;
+
+    Iir::CoefficientExchange<Coefficients> exchange;
+
+    // Audio thread's.
+    Coefficients current;
+    float history1, history2, history3, history4;
+    bool interpolate;
 };
 
 #endif // __FILTERBUTTERWORTH24DB_H__
@@ -12,19 +12,21 @@
 #include "esp_system.h"
 #include "esp_spi_flash.h"
 #include "nvs_flash.h"
-#include "driver/timer.h"
+#include "nvs.h"
 #include "esp_log.h"
 
 #include "war_config.h"
 #include "war_wifi.h"
 #include "war_espnow.h"
 #include "war_mixer.h"
+#include "war_profile.h"
 #include "es8388_i2c.h"
 
-static TaskHandle_t xMainTaskNotify = NULL;
+#define NVS_NAMESPACE "war"
 
-void audio_timer_init();
+void stream_init();
 void main_task(void *pvParam);
+void main_collect();
 
 void app_main(void)
 {
@@ -38,64 +40,81 @@ void app_main(void)
 
     war_wifi_init();
 
+    const fec_config_t fec = {
+        .scheme = ESPNOW_FEC_SCHEME,
+        .k = ESPNOW_FEC_K,
+        .m = ESPNOW_FEC_SCHEME == FEC_RS ? ESPNOW_FEC_M : 1,
+    };
+    espnow_set_fec(&fec);
+    espnow_set_redundancy(ESPNOW_REDUNDANT);
+    espnow_set_timestamps(ESPNOW_TIMESTAMP);
+    espnow_set_codec(ESPNOW_CODEC);
+    espnow_set_integrity(ESPNOW_INTEGRITY);
+    const espnow_sender_config_t sender = {
+        .window = ESPNOW_SEND_WINDOW,
+        .copies = ESPNOW_SEND_COPIES,
+        .spacing = ESPNOW_SEND_SPACING,
+    };
+    espnow_set_sender(&sender);
+    stream_init();
     ESP_ERROR_CHECK( espnow_init(false) );
 
     es_i2c_init();
     mixer_init();
-    audio_timer_init();
+    mixer_set_impulse(LATENCY_IMPULSE);
+    if (TELEMETRY_PERIOD_MS > 0)
+        telemetry_start(TELEMETRY_PERIOD_MS, main_collect, telemetry_sink_log);
 
     xTaskCreatePinnedToCore(main_task, "Main Task", 2 * 1024, NULL, 4, NULL, 1);
 }
 
-void IRAM_ATTR timer_group0_isr(void *para)
+/* Sample rate and frames per packet come from NVS, so latency can be traded
+ * against per-packet overhead per installation without reflashing. Missing
+ * keys are written with the build defaults so they can be edited in place;
+ * a stream espnow_set_stream() rejects falls back to the defaults. */
+void stream_init()
 {
-    timer_spinlock_take(TIMER_GROUP_0);
+    uint32_t samplerate = SAMPLERATE;
+    uint16_t frames = ESPNOW_DEFAULT_FRAMES;
 
-    timer_group_clr_intr_status_in_isr(TIMER_GROUP_0, TIMER_0);
-    timer_group_enable_alarm_in_isr(TIMER_GROUP_0, TIMER_0);
-
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    if (xMainTaskNotify)
-        vTaskNotifyGiveFromISR(xMainTaskNotify, &xHigherPriorityTaskWoken);
-
-    timer_spinlock_give(TIMER_GROUP_0);
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK)
+    {
+        if (nvs_get_u32(nvs, "samplerate", &samplerate) == ESP_ERR_NVS_NOT_FOUND)
+            nvs_set_u32(nvs, "samplerate", samplerate);
+        if (nvs_get_u16(nvs, "packet_frames", &frames) == ESP_ERR_NVS_NOT_FOUND)
+            nvs_set_u16(nvs, "packet_frames", frames);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    else
+    {
+        ESP_LOGW("Main", "NVS open failed: %s", esp_err_to_name(err));
+    }
 
-    if (xHigherPriorityTaskWoken) portYIELD_FROM_ISR();
+    if (!espnow_set_stream(samplerate, frames))
+        espnow_set_stream(SAMPLERATE, ESPNOW_DEFAULT_FRAMES);
+    ESP_LOGI("Main", "Stream: %u Hz, %u frames per packet",
+        espnow_get_stream()->samplerate, espnow_get_stream()->frames);
 }
 
-void audio_timer_init()
+/* On the telemetry task, so the warnings for stages over their budget are
+ * formatted off the audio path. */
+void main_collect()
 {
-    ESP_LOGI("Main", "Audio Timer init finished.");
-    timer_config_t config;
-    config.divider = 16,
-    config.counter_dir = TIMER_COUNT_UP;
-    config.counter_en = TIMER_PAUSE;
-    config.alarm_en = TIMER_ALARM_EN;
-    config.auto_reload = TIMER_AUTORELOAD_EN;
-    config.intr_type = TIMER_INTR_LEVEL;
-
-    timer_init(TIMER_GROUP_0, TIMER_0, &config);
-    timer_set_counter_value(TIMER_GROUP_0, TIMER_0, 0x00000000ULL);
-
-    const uint64_t alarm_value = ((float)MS_PER_PACKET / 1000.f) * (TIMER_BASE_CLK / 16);
-    timer_set_alarm_value(TIMER_GROUP_0, TIMER_0, alarm_value);
-    timer_enable_intr(TIMER_GROUP_0, TIMER_0);
-    timer_isr_register(TIMER_GROUP_0, TIMER_0, timer_group0_isr,
-        (void*) TIMER_0, ESP_INTR_FLAG_IRAM, NULL);
-
-    timer_start(TIMER_GROUP_0, TIMER_0);
+    espnow_telemetry_collect();
+    espnow_stream_t stream;
+    espnow_copy_stream(&stream);
+    profile_check(stream.packet_us);
 }
 
+/* Paced by the I2S DMA: mixer_read() blocks until the next packet's worth
+ * of frames has been captured. */
 void main_task(void *pvParam)
 {
-    xMainTaskNotify = xTaskGetCurrentTaskHandle();
-    uint32_t notification_val;
     for (;;)
     {
-        notification_val = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-        if (notification_val == 1)
-        {
-            mixer_read(); 
-        }
+        mixer_read();
     }
-}
\ No newline at end of file
+}
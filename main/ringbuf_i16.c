@@ -1,6 +1,7 @@
 #include "ringbuf_i16.h"
 #include "assert.h"
 #include <stdatomic.h>
+#include <string.h>
 #include "esp_log.h"
 
 struct ringbuf_i16_t
@@ -47,32 +48,72 @@ void ringbuf_i16_reset(ringbuf_i16_handle_t rbuf)
     atomic_init(&rbuf->write, 0);
 }
 
-void ringbuf_i16_write(ringbuf_i16_handle_t rbuf, int16_t val)
+bool ringbuf_i16_write(ringbuf_i16_handle_t rbuf, int16_t val)
 {
-    if (ringbuf_i16_full(rbuf))
-        atomic_fetch_add(&rbuf->read, 1);
+    return ringbuf_i16_write_n(rbuf, &val, 1) == 1;
+}
 
-    rbuf->buffer[ringbuf_i16_mask(rbuf, atomic_fetch_add(&rbuf->write, 1))] = val;
+size_t ringbuf_i16_write_buf(ringbuf_i16_handle_t rbuf, const int16_t *buf, size_t size)
+{
+    return ringbuf_i16_write_n(rbuf, buf, size);
 }
 
-void ringbuf_i16_write_buf(ringbuf_i16_handle_t rbuf, int16_t *buf, size_t size)
+size_t ringbuf_i16_write_n(ringbuf_i16_handle_t rbuf, const int16_t *buf, size_t n)
 {
-    for (int i = 0; i < size; i++)
-    {
-        ringbuf_i16_write(rbuf, buf[i]);
-    }
+    // Our own index needs no ordering; the acquire on `read` makes sure the
+    // consumer is done with the slots before we overwrite them.
+    uint32_t write = atomic_load_explicit(&rbuf->write, memory_order_relaxed);
+    uint32_t read = atomic_load_explicit(&rbuf->read, memory_order_acquire);
+
+    size_t free = rbuf->max - (write - read);
+    if (n > free)
+        n = free;
+
+    uint32_t index = ringbuf_i16_mask(rbuf, write);
+    size_t first = rbuf->max - index;
+    if (first > n)
+        first = n;
+    memcpy(rbuf->buffer + index, buf, first * sizeof(int16_t));
+    memcpy(rbuf->buffer, buf + first, (n - first) * sizeof(int16_t));
+
+    // Publish the samples before the new write index.
+    atomic_store_explicit(&rbuf->write, write + n, memory_order_release);
+    return n;
 }
 
 int16_t ringbuf_i16_read(ringbuf_i16_handle_t rbuf)
 {
     assert(!ringbuf_i16_empty(rbuf));
 
-    return rbuf->buffer[ringbuf_i16_mask(rbuf, atomic_fetch_add(&rbuf->read, 1))];
+    int16_t val = 0;
+    ringbuf_i16_read_n(rbuf, &val, 1);
+    return val;
+}
+
+size_t ringbuf_i16_read_n(ringbuf_i16_handle_t rbuf, int16_t *buf, size_t n)
+{
+    uint32_t read = atomic_load_explicit(&rbuf->read, memory_order_relaxed);
+    uint32_t write = atomic_load_explicit(&rbuf->write, memory_order_acquire);
+
+    size_t used = write - read;
+    if (n > used)
+        n = used;
+
+    uint32_t index = ringbuf_i16_mask(rbuf, read);
+    size_t first = rbuf->max - index;
+    if (first > n)
+        first = n;
+    memcpy(buf, rbuf->buffer + index, first * sizeof(int16_t));
+    memcpy(buf + first, rbuf->buffer, (n - first) * sizeof(int16_t));
+
+    // Release the slots only after they have been copied out.
+    atomic_store_explicit(&rbuf->read, read + n, memory_order_release);
+    return n;
 }
 
 bool ringbuf_i16_empty(ringbuf_i16_handle_t rbuf)
 {
-    return atomic_load(&rbuf->read) == atomic_load(&rbuf->write);
+    return ringbuf_i16_size(rbuf) == 0;
 }
 
 bool ringbuf_i16_full(ringbuf_i16_handle_t rbuf)
@@ -82,10 +123,15 @@ bool ringbuf_i16_full(ringbuf_i16_handle_t rbuf)
 
 size_t ringbuf_i16_size(ringbuf_i16_handle_t rbuf)
 {
-    return atomic_load(&rbuf->write) - atomic_load(&rbuf->read);
+    uint32_t read = atomic_load_explicit(&rbuf->read, memory_order_acquire);
+    uint32_t write = atomic_load_explicit(&rbuf->write, memory_order_acquire);
+    // The producer may have refilled slots the consumer freed after `read`
+    // was sampled.
+    uint32_t size = write - read;
+    return size > rbuf->max ? rbuf->max : size;
 }
 
 size_t ringbuf_i16_avail(ringbuf_i16_handle_t rbuf)
 {
     return (rbuf->max - ringbuf_i16_size(rbuf));
-}
\ No newline at end of file
+}
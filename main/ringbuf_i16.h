@@ -3,11 +3,19 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * Single-producer/single-consumer ring of int16_t samples. The producer
+ * only ever stores `write` and the consumer only ever stores `read`, so
+ * one writer task and one reader task can run concurrently without locks.
+ * A full ring drops the samples that do not fit; the write calls return
+ * how many were accepted.
+ */
 typedef struct ringbuf_i16_t ringbuf_i16_t;
 typedef ringbuf_i16_t* ringbuf_i16_handle_t;
 
@@ -15,14 +23,19 @@ ringbuf_i16_handle_t ringbuf_i16_init(int16_t* buffer, size_t size);
 
 void ringbuf_i16_free(ringbuf_i16_handle_t rbuf);
 
+// Not safe while a producer or consumer is active.
 void ringbuf_i16_reset(ringbuf_i16_handle_t rbuf);
 
-void ringbuf_i16_write(ringbuf_i16_handle_t rbuf, int16_t val);
+bool ringbuf_i16_write(ringbuf_i16_handle_t rbuf, int16_t val);
 
-void ringbuf_i16_write_buf(ringbuf_i16_handle_t rbuf, int16_t* buf, size_t size);
+size_t ringbuf_i16_write_buf(ringbuf_i16_handle_t rbuf, const int16_t* buf, size_t size);
+
+size_t ringbuf_i16_write_n(ringbuf_i16_handle_t rbuf, const int16_t* buf, size_t n);
 
 int16_t ringbuf_i16_read(ringbuf_i16_handle_t rbuf);
 
+size_t ringbuf_i16_read_n(ringbuf_i16_handle_t rbuf, int16_t* buf, size_t n);
+
 bool ringbuf_i16_empty(ringbuf_i16_handle_t rbuf);
 
 bool ringbuf_i16_full(ringbuf_i16_handle_t rbuf);
@@ -0,0 +1,114 @@
+#include "ringbuf_i16_mpmc.h"
+#include "assert.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Slot i is free for the producer at position pos when seq[i] == pos, and
+ * holds a block for the consumer at position pos when seq[i] == pos + 1.
+ * After popping, the consumer advances seq[i] by a full lap.
+ */
+struct ringbuf_i16_mpmc_t
+{
+    int16_t *buffer;
+    atomic_uint *seq;
+    uint32_t slots;
+    uint32_t block_len;
+    atomic_uint head;
+    atomic_uint tail;
+};
+
+ringbuf_i16_mpmc_handle_t ringbuf_i16_mpmc_init(int16_t *buffer, size_t slots, size_t block_len)
+{
+    assert(buffer && slots && block_len);
+    assert((slots & (slots - 1)) == 0);
+
+    ringbuf_i16_mpmc_handle_t rbuf = malloc(sizeof(ringbuf_i16_mpmc_t));
+    assert(rbuf);
+    rbuf->seq = malloc(slots * sizeof(atomic_uint));
+    assert(rbuf->seq);
+
+    rbuf->buffer = buffer;
+    rbuf->slots = slots;
+    rbuf->block_len = block_len;
+    for (uint32_t i = 0; i < slots; i++)
+        atomic_init(&rbuf->seq[i], i);
+    atomic_init(&rbuf->head, 0);
+    atomic_init(&rbuf->tail, 0);
+
+    return rbuf;
+}
+
+void ringbuf_i16_mpmc_free(ringbuf_i16_mpmc_handle_t rbuf)
+{
+    assert(rbuf);
+    free(rbuf->seq);
+    free(rbuf);
+}
+
+bool ringbuf_i16_mpmc_push(ringbuf_i16_mpmc_handle_t rbuf, const int16_t *block)
+{
+    unsigned int pos = atomic_load_explicit(&rbuf->head, memory_order_relaxed);
+    for (;;)
+    {
+        uint32_t index = pos & (rbuf->slots - 1);
+        uint32_t seq = atomic_load_explicit(&rbuf->seq[index], memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&rbuf->head, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+            {
+                memcpy(rbuf->buffer + index * rbuf->block_len, block,
+                    rbuf->block_len * sizeof(int16_t));
+                atomic_store_explicit(&rbuf->seq[index], pos + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&rbuf->head, memory_order_relaxed);
+        }
+    }
+}
+
+bool ringbuf_i16_mpmc_pop(ringbuf_i16_mpmc_handle_t rbuf, int16_t *block)
+{
+    unsigned int pos = atomic_load_explicit(&rbuf->tail, memory_order_relaxed);
+    for (;;)
+    {
+        uint32_t index = pos & (rbuf->slots - 1);
+        uint32_t seq = atomic_load_explicit(&rbuf->seq[index], memory_order_acquire);
+        int32_t diff = (int32_t)(seq - (pos + 1));
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&rbuf->tail, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+            {
+                memcpy(block, rbuf->buffer + index * rbuf->block_len,
+                    rbuf->block_len * sizeof(int16_t));
+                atomic_store_explicit(&rbuf->seq[index], pos + rbuf->slots,
+                    memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&rbuf->tail, memory_order_relaxed);
+        }
+    }
+}
+
+size_t ringbuf_i16_mpmc_block_len(ringbuf_i16_mpmc_handle_t rbuf)
+{
+    return rbuf->block_len;
+}
@@ -0,0 +1,38 @@
+#ifndef __RINGBUF_I16_MPMC_H__
+#define __RINGBUF_I16_MPMC_H__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Bounded multi-producer/multi-consumer ring of fixed-size sample blocks,
+ * for fanning several sources into one consumer (or spreading blocks over
+ * several workers). Each slot carries a sequence number, so producers and
+ * consumers claim slots with a single compare-and-swap and never wait on
+ * each other beyond that. Push fails when the ring is full, pop when it is
+ * empty.
+ */
+typedef struct ringbuf_i16_mpmc_t ringbuf_i16_mpmc_t;
+typedef ringbuf_i16_mpmc_t* ringbuf_i16_mpmc_handle_t;
+
+// buffer must hold slots * block_len samples; slots must be a power of two.
+ringbuf_i16_mpmc_handle_t ringbuf_i16_mpmc_init(int16_t* buffer, size_t slots, size_t block_len);
+
+void ringbuf_i16_mpmc_free(ringbuf_i16_mpmc_handle_t rbuf);
+
+bool ringbuf_i16_mpmc_push(ringbuf_i16_mpmc_handle_t rbuf, const int16_t* block);
+
+bool ringbuf_i16_mpmc_pop(ringbuf_i16_mpmc_handle_t rbuf, int16_t* block);
+
+size_t ringbuf_i16_mpmc_block_len(ringbuf_i16_mpmc_handle_t rbuf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RINGBUF_I16_MPMC_H__
@@ -0,0 +1,334 @@
+#include "war_codec.h"
+#include "assert.h"
+#include <string.h>
+
+#define ADPCM_HEADER    4
+#define RICE_HEADER     3
+#define RICE_RAW        0xff
+#define RICE_MAX_K      16
+// Quotients this long are sent as an escape plus the raw zigzag value.
+#define RICE_ESCAPE     24
+#define RICE_RAW_BITS   18
+
+static const int8_t adpcm_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+static const int16_t adpcm_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41,
+    45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190,
+    209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724,
+    796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272,
+    2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132,
+    7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+    22385, 24623, 27086, 29794, 32767,
+};
+
+static int32_t clamp16(int32_t x)
+{
+    return x > INT16_MAX ? INT16_MAX : x < INT16_MIN ? INT16_MIN : x;
+}
+
+static int adpcm_next_index(int index, uint8_t nibble)
+{
+    index += adpcm_index_table[nibble];
+    return index < 0 ? 0 : index > 88 ? 88 : index;
+}
+
+static int32_t adpcm_delta(int step, uint8_t nibble)
+{
+    int32_t delta = step >> 3;
+    if (nibble & 4)
+        delta += step;
+    if (nibble & 2)
+        delta += step >> 1;
+    if (nibble & 1)
+        delta += step >> 2;
+    return (nibble & 8) ? -delta : delta;
+}
+
+static size_t adpcm_encode(codec_t* codec, const int16_t* frame, size_t samples, uint8_t* out)
+{
+    int32_t predictor = frame[0];
+    int index = codec->adpcm_index;
+    out[0] = (uint8_t)(predictor & 0xff);
+    out[1] = (uint8_t)((uint16_t)predictor >> 8);
+    out[2] = (uint8_t)index;
+    out[3] = 0;
+
+    uint8_t* data = out + ADPCM_HEADER;
+    for (size_t i = 1; i < samples; i++)
+    {
+        int step = adpcm_step_table[index];
+        int32_t diff = frame[i] - predictor;
+        uint8_t nibble = 0;
+        if (diff < 0)
+        {
+            nibble = 8;
+            diff = -diff;
+        }
+        if (diff >= step)
+        {
+            nibble |= 4;
+            diff -= step;
+        }
+        if (diff >= step >> 1)
+        {
+            nibble |= 2;
+            diff -= step >> 1;
+        }
+        if (diff >= step >> 2)
+            nibble |= 1;
+
+        predictor = clamp16(predictor + adpcm_delta(step, nibble));
+        index = adpcm_next_index(index, nibble);
+
+        size_t n = i - 1;
+        if (n & 1)
+            data[n >> 1] |= nibble << 4;
+        else
+            data[n >> 1] = nibble;
+    }
+    codec->adpcm_index = (uint8_t)index;
+    return ADPCM_HEADER + samples / 2;
+}
+
+static bool adpcm_decode(const uint8_t* in, size_t len, int16_t* frame, size_t samples)
+{
+    if (len < ADPCM_HEADER + samples / 2 || in[2] > 88)
+        return false;
+    int32_t predictor = (int16_t)(in[0] | (in[1] << 8));
+    int index = in[2];
+    frame[0] = (int16_t)predictor;
+
+    const uint8_t* data = in + ADPCM_HEADER;
+    for (size_t i = 1; i < samples; i++)
+    {
+        size_t n = i - 1;
+        uint8_t nibble = (n & 1) ? data[n >> 1] >> 4 : data[n >> 1] & 0x0f;
+        predictor = clamp16(predictor + adpcm_delta(adpcm_step_table[index], nibble));
+        index = adpcm_next_index(index, nibble);
+        frame[i] = (int16_t)predictor;
+    }
+    return true;
+}
+
+typedef struct {
+    uint8_t* out;
+    size_t limit;
+    size_t pos;
+    uint32_t acc;
+    int bits;
+    bool overflow;
+} bit_writer_t;
+
+static void bits_put(bit_writer_t* w, uint32_t value, int count)
+{
+    while (count > 0)
+    {
+        int take = count > 16 ? 16 : count;
+        count -= take;
+        w->acc = (w->acc << take) | ((value >> count) & ((1u << take) - 1));
+        w->bits += take;
+        while (w->bits >= 8)
+        {
+            w->bits -= 8;
+            if (w->pos == w->limit)
+            {
+                w->overflow = true;
+                return;
+            }
+            w->out[w->pos++] = (uint8_t)(w->acc >> w->bits);
+        }
+    }
+}
+
+static void bits_flush(bit_writer_t* w)
+{
+    if (w->bits > 0)
+        bits_put(w, 0, 8 - w->bits);
+}
+
+typedef struct {
+    const uint8_t* in;
+    size_t len;
+    size_t pos;
+    uint32_t acc;
+    int bits;
+} bit_reader_t;
+
+static bool bits_get(bit_reader_t* r, int count, uint32_t* value)
+{
+    uint32_t v = 0;
+    while (count > 0)
+    {
+        if (r->bits == 0)
+        {
+            if (r->pos == r->len)
+                return false;
+            r->acc = r->in[r->pos++];
+            r->bits = 8;
+        }
+        int take = count < r->bits ? count : r->bits;
+        r->bits -= take;
+        v = (v << take) | ((r->acc >> r->bits) & ((1u << take) - 1));
+        count -= take;
+    }
+    *value = v;
+    return true;
+}
+
+static int32_t rice_predict(const int16_t* frame, size_t i)
+{
+    if (i == 1)
+        return frame[0];
+    return 2 * (int32_t)frame[i - 1] - frame[i - 2];
+}
+
+static uint32_t zigzag(int32_t x)
+{
+    return ((uint32_t)x << 1) ^ (uint32_t)(x >> 31);
+}
+
+static int32_t unzigzag(uint32_t u)
+{
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+static size_t rice_encode(const int16_t* frame, size_t samples, uint8_t* out)
+{
+    // Parameter from the mean residual: 2^k close to it.
+    uint64_t sum = 0;
+    for (size_t i = 1; i < samples; i++)
+        sum += zigzag(frame[i] - rice_predict(frame, i));
+    int k = 0;
+    while (k < RICE_MAX_K && ((uint64_t)(samples - 1) << (k + 1)) <= sum)
+        k++;
+
+    out[0] = (uint8_t)k;
+    out[1] = (uint8_t)(frame[0] & 0xff);
+    out[2] = (uint8_t)((uint16_t)frame[0] >> 8);
+    bit_writer_t w = {
+        .out = out + RICE_HEADER,
+        .limit = 2 * samples - RICE_HEADER,
+    };
+    for (size_t i = 1; i < samples && !w.overflow; i++)
+    {
+        uint32_t u = zigzag(frame[i] - rice_predict(frame, i));
+        uint32_t q = u >> k;
+        if (q >= RICE_ESCAPE)
+        {
+            bits_put(&w, (1u << RICE_ESCAPE) - 1, RICE_ESCAPE);
+            bits_put(&w, u, RICE_RAW_BITS);
+            continue;
+        }
+        bits_put(&w, ((1u << q) - 1) << 1, q + 1);
+        bits_put(&w, u & ((1u << k) - 1), k);
+    }
+    bits_flush(&w);
+
+    if (w.overflow)
+    {
+        out[0] = RICE_RAW;
+        memcpy(out + 1, frame, samples * sizeof(int16_t));
+        return CODEC_MAX_BYTES(samples);
+    }
+    return RICE_HEADER + w.pos;
+}
+
+static bool rice_decode(const uint8_t* in, size_t len, int16_t* frame, size_t samples)
+{
+    if (len < 1)
+        return false;
+    if (in[0] == RICE_RAW)
+    {
+        if (len < CODEC_MAX_BYTES(samples))
+            return false;
+        memcpy(frame, in + 1, samples * sizeof(int16_t));
+        return true;
+    }
+    int k = in[0];
+    if (len < RICE_HEADER || k > RICE_MAX_K)
+        return false;
+    frame[0] = (int16_t)(in[1] | (in[2] << 8));
+
+    bit_reader_t r = {.in = in + RICE_HEADER, .len = len - RICE_HEADER};
+    for (size_t i = 1; i < samples; i++)
+    {
+        uint32_t q = 0, bit, u;
+        while (q < RICE_ESCAPE)
+        {
+            if (!bits_get(&r, 1, &bit))
+                return false;
+            if (!bit)
+                break;
+            q++;
+        }
+        if (q == RICE_ESCAPE)
+        {
+            if (!bits_get(&r, RICE_RAW_BITS, &u))
+                return false;
+        }
+        else
+        {
+            uint32_t low = 0;
+            if (k && !bits_get(&r, k, &low))
+                return false;
+            u = (q << k) | low;
+        }
+        frame[i] = (int16_t)clamp16(rice_predict(frame, i) + unzigzag(u));
+    }
+    return true;
+}
+
+void codec_init(codec_t* codec, codec_id_t id)
+{
+    assert(codec && id < CODEC_COUNT);
+    codec->id = id;
+    codec->adpcm_index = 0;
+}
+
+size_t codec_encode(codec_t* codec, const int16_t* frame, size_t samples, uint8_t* out)
+{
+    assert(samples >= 2 && (samples & 1) == 0);
+    switch (codec->id)
+    {
+    case CODEC_IMA_ADPCM:
+        return adpcm_encode(codec, frame, samples, out);
+    case CODEC_RICE:
+        return rice_encode(frame, samples, out);
+    default:
+        memcpy(out, frame, samples * sizeof(int16_t));
+        return samples * sizeof(int16_t);
+    }
+}
+
+bool codec_decode(codec_id_t id, const uint8_t* in, size_t len, int16_t* frame, size_t samples)
+{
+    switch (id)
+    {
+    case CODEC_PCM16:
+        if (len < samples * sizeof(int16_t))
+            return false;
+        memcpy(frame, in, samples * sizeof(int16_t));
+        return true;
+    case CODEC_IMA_ADPCM:
+        return adpcm_decode(in, len, frame, samples);
+    case CODEC_RICE:
+        return rice_decode(in, len, frame, samples);
+    default:
+        return false;
+    }
+}
+
+const char* codec_name(codec_id_t id)
+{
+    switch (id)
+    {
+    case CODEC_PCM16: return "pcm16";
+    case CODEC_IMA_ADPCM: return "adpcm";
+    case CODEC_RICE: return "rice";
+    default: return "unknown";
+    }
+}
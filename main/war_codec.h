@@ -0,0 +1,55 @@
+#ifndef __WAR_CODEC_H__
+#define __WAR_CODEC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Per-packet audio codecs for mono 16-bit frames. Every encoded frame
+ * decodes on its own, so a lost packet never takes the next one with it,
+ * and decoders ignore trailing zero padding (FEC rebuilds packets padded
+ * to the longest one in their group).
+ *
+ *  CODEC_PCM16      raw samples
+ *  CODEC_IMA_ADPCM  4 bits per sample after a 4-byte header carrying the
+ *                   first sample and the step index, about 3.7:1
+ *  CODEC_RICE       lossless: fixed second-order prediction, residuals Rice
+ *                   coded with one parameter per frame; frames that would
+ *                   grow fall back to raw samples behind a marker byte
+ */
+
+/* Largest encoded frame of any codec (the Rice fallback). */
+#define CODEC_MAX_BYTES(samples) (2 * (samples) + 1)
+
+typedef enum {
+    CODEC_PCM16,
+    CODEC_IMA_ADPCM,
+    CODEC_RICE,
+    CODEC_COUNT,
+} codec_id_t;
+
+typedef struct {
+    codec_id_t id;
+    uint8_t adpcm_index;
+} codec_t;
+
+void codec_init(codec_t* codec, codec_id_t id);
+
+// Returns the encoded size, at most CODEC_MAX_BYTES(samples).
+size_t codec_encode(codec_t* codec, const int16_t* frame, size_t samples, uint8_t* out);
+
+// False if the frame is malformed; frame is then left undefined.
+bool codec_decode(codec_id_t id, const uint8_t* in, size_t len, int16_t* frame, size_t samples);
+
+const char* codec_name(codec_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_CODEC_H__
@@ -3,7 +3,50 @@
 
 #include <stdint.h>
 
+/* Default stream, see espnow_set_stream(). The transmitter reads its
+ * stream from NVS and only falls back to these when none is stored. */
 #define MS_PER_PACKET   2
 #define SAMPLERATE      48000
 
+/* Instead of MS_PER_PACKET worth of audio, put as many samples into each
+ * packet as an ESP-NOW frame holds (see war_espnow.h): fewer, longer
+ * packets for a little more latency. */
+#define ESPNOW_AGGREGATE    0
+
+/* Parity sent after every ESPNOW_FEC_K audio packets, see war_fec.h.
+ * ESPNOW_FEC_M only applies to FEC_RS. */
+#define ESPNOW_FEC_SCHEME   FEC_NONE
+#define ESPNOW_FEC_K        8
+#define ESPNOW_FEC_M        2
+
+/* Carry a low-resolution copy of the previous frame in every packet. */
+#define ESPNOW_REDUNDANT    0
+
+/* Stamp every audio packet with its capture time, and replace the audio
+ * with an impulse every LATENCY_IMPULSE_US (loopback test mode); see
+ * war_latency.h. */
+#define ESPNOW_TIMESTAMP    0
+#define LATENCY_IMPULSE     0
+
+/* Payload codec, see war_codec.h. */
+#define ESPNOW_CODEC        CODEC_PCM16
+
+/* Check on every packet, see war_integrity.h. The 802.11 FCS already
+ * catches corruption in the air; INTEGRITY_HEADER or INTEGRITY_NONE save
+ * the pass over the payload on both ends. */
+#define ESPNOW_INTEGRITY    INTEGRITY_CRC16
+
+/* Channels to transmit, see war_layout.h. Two-channel layouts double the
+ * payload: at 48 kHz use MS_PER_PACKET 1 or ESPNOW_AGGREGATE. */
+#define ESPNOW_LAYOUT       LAYOUT_MONO_RIGHT
+
+/* Sender pipelining, see espnow_sender_config_t. */
+#define ESPNOW_SEND_WINDOW  2
+#define ESPNOW_SEND_COPIES  2
+#define ESPNOW_SEND_SPACING 0
+
+/* A telemetry snapshot on the console every TELEMETRY_PERIOD_MS, 0 for
+ * none; decode with host/telemetry_dump, see war_telemetry.h. */
+#define TELEMETRY_PERIOD_MS 10000
+
 #endif // __WAR_CONFIG_H__
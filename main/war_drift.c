@@ -0,0 +1,237 @@
+#include "war_drift.h"
+#include "assert.h"
+#include <math.h>
+#include <string.h>
+
+static float drift_clamp(float ppm)
+{
+    if (ppm > DRIFT_MAX_PPM)
+        return DRIFT_MAX_PPM;
+    if (ppm < -DRIFT_MAX_PPM)
+        return -DRIFT_MAX_PPM;
+    return ppm;
+}
+
+void drift_init(drift_t* drift, uint32_t packet_us)
+{
+    assert(drift && packet_us > 0);
+    memset(drift, 0, sizeof(drift_t));
+    drift->packet_us = packet_us;
+}
+
+void drift_restart(drift_t* drift, uint32_t packet_us)
+{
+    assert(packet_us > 0);
+    drift->packet_us = packet_us;
+    drift->block_open = false;
+    drift->block_count = 0;
+    drift->transit_valid = false;
+}
+
+// Slope of the least-squares line through the stored block minima.
+static float drift_fit(const drift_t* drift)
+{
+    uint8_t n = drift->block_count;
+    uint8_t first = (drift->block_head + DRIFT_BLOCKS - n) % DRIFT_BLOCKS;
+    int64_t t0 = drift->block_time[first];
+    int64_t y0 = drift->block_transit[first];
+
+    float t_mean = 0.f, y_mean = 0.f;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        uint8_t k = (first + i) % DRIFT_BLOCKS;
+        t_mean += (float)(drift->block_time[k] - t0);
+        y_mean += (float)(drift->block_transit[k] - y0);
+    }
+    t_mean /= n;
+    y_mean /= n;
+
+    float sty = 0.f, stt = 0.f;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        uint8_t k = (first + i) % DRIFT_BLOCKS;
+        float t = (float)(drift->block_time[k] - t0) - t_mean;
+        float y = (float)(drift->block_transit[k] - y0) - y_mean;
+        sty += t * y;
+        stt += t * t;
+    }
+    return stt > 0.f ? sty / stt : 0.f;
+}
+
+void drift_arrival(drift_t* drift, uint32_t seq, int64_t now_us)
+{
+    int64_t transit = now_us - (int64_t)seq * drift->packet_us;
+
+    if (drift->block_count > 0)
+    {
+        uint8_t last = (drift->block_head + DRIFT_BLOCKS - 1) % DRIFT_BLOCKS;
+        int64_t step = transit - drift->block_transit[last];
+        if (step > DRIFT_RESET_US || step < -DRIFT_RESET_US)
+        {
+            drift->resets++;
+            drift_restart(drift, drift->packet_us);
+        }
+    }
+
+    if (!drift->block_open)
+    {
+        drift->block_open = true;
+        drift->block_start = now_us;
+        drift->block_min = transit;
+        return;
+    }
+    if (transit < drift->block_min)
+        drift->block_min = transit;
+    if (now_us - drift->block_start < DRIFT_BLOCK_US)
+        return;
+
+    drift->block_time[drift->block_head] = drift->block_start;
+    drift->block_transit[drift->block_head] = drift->block_min;
+    drift->block_head = (drift->block_head + 1) % DRIFT_BLOCKS;
+    if (drift->block_count < DRIFT_BLOCKS)
+        drift->block_count++;
+    drift->block_open = false;
+
+    if (drift->block_count >= DRIFT_MIN_BLOCKS)
+    {
+        // A faster sender's packets arrive ever earlier against its seq.
+        drift->transit_ppm = drift_clamp(-drift_fit(drift) * 1e6f);
+        drift->transit_valid = true;
+    }
+}
+
+float drift_update(drift_t* drift, float fill_frames, float target_frames,
+    size_t frames)
+{
+    float err = fill_frames - target_frames;
+    drift->fill_avg += (err - drift->fill_avg) / DRIFT_FILL_SMOOTH;
+    drift->integral = drift_clamp(drift->integral +
+        DRIFT_FILL_KI * drift->fill_avg * (float)frames);
+
+    float ppm = drift->transit_valid ? drift->transit_ppm : 0.f;
+    ppm += DRIFT_FILL_KP * drift->fill_avg + drift->integral;
+    drift->ppm = drift_clamp(ppm);
+    return drift->ppm;
+}
+
+/* Kaiser-windowed sinc, one row per phase plus the next integer offset, so
+ * every phase can be interpolated with its successor. Rows sum to one. */
+static float resampler_table[RESAMPLER_PHASES + 1][RESAMPLER_TAPS];
+static bool resampler_table_ready = false;
+
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static void resampler_table_init(void)
+{
+    const double half = RESAMPLER_TAPS / 2;
+    for (int p = 0; p <= RESAMPLER_PHASES; p++)
+    {
+        double x = (double)p / RESAMPLER_PHASES;
+        double sum = 0.0;
+        for (int k = 0; k < RESAMPLER_TAPS; k++)
+        {
+            double d = (k - (half - 1)) - x;
+            double t = 2.0 * RESAMPLER_CUTOFF * d;
+            double sinc = t == 0.0 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+            double w = d / half;
+            double kaiser = w * w < 1.0 ?
+                bessel_i0(RESAMPLER_KAISER_BETA * sqrt(1.0 - w * w)) /
+                bessel_i0(RESAMPLER_KAISER_BETA) : 0.0;
+            resampler_table[p][k] = (float)(sinc * kaiser);
+            sum += resampler_table[p][k];
+        }
+        for (int k = 0; k < RESAMPLER_TAPS; k++)
+            resampler_table[p][k] /= (float)sum;
+    }
+    resampler_table_ready = true;
+}
+
+void resampler_init(resampler_t* rs, uint8_t channels, uint16_t in_frames)
+{
+    assert(rs && channels >= 1 && channels <= RESAMPLER_MAX_CHANNELS);
+    assert(in_frames >= 1 && in_frames <= RESAMPLER_MAX_FRAMES);
+    if (!resampler_table_ready)
+        resampler_table_init();
+
+    memset(rs, 0, sizeof(resampler_t));
+    rs->channels = channels;
+    rs->in_frames = in_frames;
+    // Silent history ahead of the first packet.
+    rs->fill = RESAMPLER_TAPS / 2 - 1;
+    rs->pos = rs->fill;
+    rs->step = 1ULL << 32;
+}
+
+void resampler_set_ppm(resampler_t* rs, float ppm)
+{
+    rs->step = (uint64_t)llround((1.0 + ppm * 1e-6) * 4294967296.0);
+}
+
+float resampler_buffered(const resampler_t* rs)
+{
+    return (float)(rs->fill - rs->pos) - rs->frac * (1.f / 4294967296.f);
+}
+
+// Keeps the history taps and what follows, then appends a packet.
+static void resampler_refill(resampler_t* rs, resampler_pull_t pull, void* ctx)
+{
+    uint16_t first = rs->pos - (RESAMPLER_TAPS / 2 - 1);
+    uint16_t keep = rs->fill - first;
+    for (uint8_t ch = 0; ch < rs->channels; ch++)
+        memmove(rs->buf[ch], rs->buf[ch] + first, keep * sizeof(int16_t));
+    rs->pos -= first;
+    rs->fill = keep;
+
+    pull(ctx, rs->packet);
+    for (uint8_t ch = 0; ch < rs->channels; ch++)
+        memcpy(rs->buf[ch] + rs->fill, rs->packet + ch * rs->in_frames,
+            rs->in_frames * sizeof(int16_t));
+    rs->fill += rs->in_frames;
+}
+
+void resampler_read(resampler_t* rs, int16_t* out, size_t frames,
+    resampler_pull_t pull, void* ctx)
+{
+    const int shift = 32 - RESAMPLER_PHASE_BITS;
+    float coeff[RESAMPLER_TAPS];
+    for (size_t i = 0; i < frames; i++)
+    {
+        while (rs->pos + RESAMPLER_TAPS / 2 >= rs->fill)
+            resampler_refill(rs, pull, ctx);
+
+        // The phase's row, interpolated towards the next one.
+        uint32_t phase = rs->frac >> shift;
+        float t = (rs->frac & ((1u << shift) - 1)) * (1.f / (1u << shift));
+        const float* a = resampler_table[phase];
+        const float* b = resampler_table[phase + 1];
+        for (int k = 0; k < RESAMPLER_TAPS; k++)
+            coeff[k] = a[k] + t * (b[k] - a[k]);
+
+        for (uint8_t ch = 0; ch < rs->channels; ch++)
+        {
+            const int16_t* x = rs->buf[ch] + rs->pos - (RESAMPLER_TAPS / 2 - 1);
+            float v = 0.f;
+            for (int k = 0; k < RESAMPLER_TAPS; k++)
+                v += coeff[k] * x[k];
+            v = v < 0.f ? v - 0.5f : v + 0.5f;
+            if (v > INT16_MAX)
+                v = INT16_MAX;
+            if (v < INT16_MIN)
+                v = INT16_MIN;
+            out[ch * frames + i] = (int16_t)v;
+        }
+
+        uint64_t next = (uint64_t)rs->frac + rs->step;
+        rs->pos += (uint16_t)(next >> 32);
+        rs->frac = (uint32_t)next;
+    }
+}
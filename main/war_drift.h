@@ -0,0 +1,127 @@
+#ifndef __WAR_DRIFT_H__
+#define __WAR_DRIFT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Clock drift compensation for the receiver. The sender's packets are
+ * paced by its own timer and APLL, playout by the receiver's clock; left
+ * alone the playout buffer slowly fills or drains and the jitter buffer
+ * has to drop or stretch whole packets.
+ *
+ * drift_t estimates the mismatch in parts per million from two signals:
+ *
+ *  transit  arrival time minus seq * packet_us. Jitter only ever delays a
+ *           packet, so the lowest transit of each DRIFT_BLOCK_US block
+ *           tracks the clock offset; the slope of a least-squares line
+ *           through the last DRIFT_BLOCKS of them is the drift.
+ *  fill     frames buffered against the target, through a slow PI loop
+ *           that pulls the buffer back to target and absorbs whatever the
+ *           slope misses (or all of it where there are no timestamps).
+ *
+ * resampler_t plays out at (1 + ppm / 1e6) input frames per output frame
+ * through a polyphase Kaiser-windowed sinc, RESAMPLER_TAPS taps and
+ * RESAMPLER_PHASES phases with linear interpolation between neighbouring
+ * phases, pulling whole packets from the playout buffer as it goes. It
+ * holds about half a packet on top of the buffer, so aim the fill half a
+ * packet above the level the buffer rests at without it.
+ *
+ * drift_arrival() and drift_update() may run on different tasks; they only
+ * share transit_ppm, a single word.
+ */
+
+#define DRIFT_BLOCK_US          1000000
+#define DRIFT_BLOCKS            16
+#define DRIFT_MIN_BLOCKS        4
+/* A transit step this large is a restarted sender, not drift. */
+#define DRIFT_RESET_US          50000
+#define DRIFT_MAX_PPM           1000.f
+/* Fill loop gains in ppm per frame off target, and per frame off target per
+ * frame played: about a 40 s time constant, close to critically damped. */
+#define DRIFT_FILL_SMOOTH       64.f
+#define DRIFT_FILL_KP           0.5f
+#define DRIFT_FILL_KI           1.25e-7f
+
+#define RESAMPLER_MAX_CHANNELS  2
+#define RESAMPLER_MAX_FRAMES    480
+#define RESAMPLER_TAPS          16
+#define RESAMPLER_PHASE_BITS    6
+#define RESAMPLER_PHASES        (1 << RESAMPLER_PHASE_BITS)
+/* In cycles per sample. Above 80 dB SNR to about 0.2 (10 kHz at 48 kHz),
+ * rolling off past 0.3. */
+#define RESAMPLER_CUTOFF        0.45
+#define RESAMPLER_KAISER_BETA   8.0
+
+typedef struct {
+    uint32_t packet_us;
+
+    // Arrival side, see drift_arrival().
+    bool block_open;
+    int64_t block_start;
+    int64_t block_min;
+    int64_t block_time[DRIFT_BLOCKS];
+    int64_t block_transit[DRIFT_BLOCKS];
+    uint8_t block_head;
+    uint8_t block_count;
+    volatile float transit_ppm;
+    volatile bool transit_valid;
+    uint32_t resets;
+
+    // Playout side, see drift_update().
+    float fill_avg;
+    float integral;
+    float ppm;
+} drift_t;
+
+void drift_init(drift_t* drift, uint32_t packet_us);
+
+// Starts the transit estimate over, for a new stream. The fill loop keeps
+// running.
+void drift_restart(drift_t* drift, uint32_t packet_us);
+
+// Feeds the arrival time of a packet, once per sequence number.
+void drift_arrival(drift_t* drift, uint32_t seq, int64_t now_us);
+
+// Feeds the playout buffer level after frames output frames and returns the
+// correction to play out with, in ppm.
+float drift_update(drift_t* drift, float fill_frames, float target_frames,
+    size_t frames);
+
+/* Fills packet with in_frames planar frames; silence when there is none. */
+typedef void (*resampler_pull_t)(void* ctx, int16_t* packet);
+
+typedef struct {
+    uint8_t channels;
+    uint16_t in_frames;
+
+    uint16_t fill;      // Frames held per channel.
+    uint16_t pos;       // Frame at or before the output point.
+    uint32_t frac;      // Output point past pos, Q0.32.
+    uint64_t step;      // Input frames per output frame, Q32.32.
+
+    int16_t packet[RESAMPLER_MAX_CHANNELS * RESAMPLER_MAX_FRAMES];
+    int16_t buf[RESAMPLER_MAX_CHANNELS][RESAMPLER_MAX_FRAMES + RESAMPLER_TAPS];
+} resampler_t;
+
+void resampler_init(resampler_t* rs, uint8_t channels, uint16_t in_frames);
+
+void resampler_set_ppm(resampler_t* rs, float ppm);
+
+// Writes frames planar output frames, pulling packets as needed.
+void resampler_read(resampler_t* rs, int16_t* out, size_t frames,
+    resampler_pull_t pull, void* ctx);
+
+// Input frames pulled but not played yet, for the fill level.
+float resampler_buffered(const resampler_t* rs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_DRIFT_H__
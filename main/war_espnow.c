@@ -1,15 +1,16 @@
 #include "war_espnow.h"
 #include "war_config.h"
 
+#include <stdatomic.h>
+#include <stddef.h>
 #include <string.h>
 
-#include "esp_crc.h"
 #include "esp_log.h"
+#include "war_profile.h"
 
 #define ESPNOW_PMK "8u3NU3cdMdnxmnUN"
 #define ESPNOW_LMK "ZbtUUgbhnfo6WyTQ"
 #define ESPNOW_CHANNEL 8
-#define ESPNOW_SEND_LEN (48 * MS_PER_PACKET * sizeof(int16_t))
 #define ESPNOW_MAXDELAY 128
 
 static const char *TAG = "ESP-NOW";
@@ -18,9 +19,88 @@ bool is_receiver = false;
 RingbufHandle_t espnow_rbuf = NULL;
 size_t espnow_rbuf_len = 0;
 uint8_t espnow_data_state = ESPNOW_RBUF_INACTIVE;
+jitter_buffer_t *espnow_jitter = NULL;
+SemaphoreHandle_t espnow_jitter_lock = NULL;
+plc_t *espnow_plc = NULL;
+drift_t *espnow_drift = NULL;
+
+fec_config_t espnow_fec_config = {.scheme = FEC_NONE};
+fec_encoder_t *espnow_fec_enc = NULL;
+fec_decoder_t *espnow_fec_dec = NULL;
+bool espnow_parity_seen = false;
+uint32_t espnow_parity_first_seq = 0;
+uint32_t espnow_last_audio_seq = 0;
 
 xQueueHandle espnow_queue;
 xQueueHandle espnow_data_queue;
+xQueueHandle espnow_free_queue;
+xQueueHandle espnow_recv_free_queue;
+
+/* The sender's stream is fixed by espnow_init(); a receiver's follows the
+ * stream packets and only changes from espnow_task(). */
+espnow_stream_t espnow_stream;
+espnow_stream_cb_t espnow_stream_cb = NULL;
+uint8_t espnow_stream_packet[sizeof(espnow_data_t) +
+                             sizeof(espnow_stream_header_t) +
+                             ESPNOW_TRAILER_LEN];
+
+/* Packets are filled in place by the mixer; only pointers move through
+ * espnow_free_queue -> espnow_data_queue -> send jobs. The stride is set
+ * from the stream by espnow_init(). */
+uint8_t *espnow_packet_pool = NULL;
+size_t espnow_packet_stride = 0;
+/* Capture time and layout handed to espnow_packet_commit(), by pool
+ * index. */
+int64_t espnow_packet_captured[ESPNOW_PACKET_POOL_SIZE];
+uint8_t espnow_packet_layout[ESPNOW_PACKET_POOL_SIZE];
+
+/* Received frames are copied into fixed slots from espnow_recv_free_queue,
+ * so the Wi-Fi task never touches the heap. With every slot taken the new
+ * frame is dropped and counted in TELEMETRY_RX_POOL_EMPTY; espnow_queue is
+ * full by then too, so it could not have been queued anyway. */
+uint8_t *espnow_recv_pool = NULL;
+
+_Static_assert(sizeof(espnow_data_t) == ESPNOW_HEADER_LEN &&
+                   sizeof(espnow_trailer_t) == ESPNOW_TRAILER_LEN,
+               "ESPNOW_HEADER_LEN or ESPNOW_TRAILER_LEN out of date");
+_Static_assert(ESPNOW_MAX_PARITY_LEN <= ESP_NOW_MAX_DATA_LEN,
+               "packet does not fit in an ESP-NOW frame");
+_Static_assert(ESPNOW_MAX_PAYLOAD <= FEC_MAX_PAYLOAD, "packet too long for FEC");
+_Static_assert(ESPNOW_PACKET_PONG <= ESPNOW_TYPE_MASK &&
+                   INTEGRITY_COUNT <= 1 << (8 - ESPNOW_TYPE_INTEGRITY_SHIFT),
+               "packet type and integrity mode do not fit in the type byte");
+_Static_assert(ESPNOW_DEFAULT_SAMPLES <= ESPNOW_MAX_SAMPLES,
+               "default stream does not fit in an ESP-NOW frame");
+#define ESPNOW_REDUNDANT_FITS(stream)                                  \
+  (ESPNOW_OVERHEAD + (stream)->payload_max + (stream)->redundant_len <= \
+   ESP_NOW_MAX_DATA_LEN)
+#define ESPNOW_TIMESTAMP_FITS(stream)                                   \
+  (ESPNOW_OVERHEAD + (stream)->payload_max +                            \
+       (espnow_redundant ? (stream)->redundant_len : 0) +              \
+       ESPNOW_TIMESTAMP_LEN <=                                         \
+   ESP_NOW_MAX_DATA_LEN)
+
+/* Latency measurement, see war_latency.h. The sender stamps audio packets
+ * and answers pings; the receiver pings and feeds espnow_latency, all from
+ * espnow_task(). */
+bool espnow_timestamps = false;
+latency_t *espnow_latency = NULL;
+uint8_t espnow_ping_packet[sizeof(espnow_data_t) + sizeof(latency_ping_t) +
+                           ESPNOW_TRAILER_LEN];
+int64_t espnow_ping_sent = 0;
+bool espnow_pong_pending = false;
+
+bool espnow_redundant = false;
+bool espnow_redundant_valid = false;
+uint8_t espnow_redundant_prev[ESPNOW_MAX_REDUNDANT_LEN];
+int16_t espnow_redundant_frame[ESPNOW_MAX_SAMPLES];
+
+/* The sender encodes from a copy of the mixer's frame, the receiver decodes
+ * into espnow_decode_frame; both only from espnow_task(). */
+codec_t espnow_codec = {.id = CODEC_PCM16};
+integrity_mode_t espnow_integrity = INTEGRITY_CRC16;
+int16_t espnow_encode_frame[ESPNOW_MAX_SAMPLES];
+int16_t espnow_decode_frame[ESPNOW_MAX_SAMPLES];
 
 uint8_t broadcast_mac[ESP_NOW_ETH_ALEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 uint8_t receiver_mac[ESP_NOW_ETH_ALEN] = {0x7c, 0xdf, 0xa1, 0x01, 0x6b, 0x20};
@@ -29,12 +109,88 @@ uint8_t transmitter_mac[ESP_NOW_ETH_ALEN] = {0x94, 0xb9, 0x7e,
 
 uint32_t espnow_seq[ESPNOW_DATA_MAX] = {0, 0};
 
+/* Sender state, all owned by espnow_task() apart from espnow_sender_idle.
+ * Audio packets and parity become send jobs in espnow_schedule; the pump
+ * moves them to espnow_inflight while the window has room. Send callbacks
+ * come back in send order, so the oldest in-flight job is the one done. */
+enum {
+  ESPNOW_RELEASE_NONE,
+  ESPNOW_RELEASE_PACKET,
+  ESPNOW_RELEASE_PARITY,
+};
+
+typedef struct {
+  uint8_t *buffer;
+  uint16_t len;
+  uint8_t release;  // What to give back once this send has completed.
+  int64_t sent;
+  int64_t captured; // First send of an audio packet only, else 0.
+} espnow_job_t;
+
+/* A stream packet, the copies, parity and a pong. */
+#define ESPNOW_SCHEDULE_LEN (2 + ESPNOW_MAX_COPIES + FEC_MAX_M)
+#define ESPNOW_HISTORY_LEN ((ESPNOW_MAX_COPIES - 1) * ESPNOW_MAX_SPACING + 1)
+#define ESPNOW_PARITY_POOL_SIZE (ESPNOW_MAX_WINDOW + FEC_MAX_M)
+
+espnow_sender_config_t espnow_sender = {
+    .window = ESPNOW_SEND_WINDOW,
+    .copies = ESPNOW_SEND_COPIES,
+    .spacing = ESPNOW_SEND_SPACING,
+};
+espnow_job_t espnow_schedule[ESPNOW_SCHEDULE_LEN];
+uint8_t espnow_schedule_head = 0;
+uint8_t espnow_schedule_count = 0;
+espnow_job_t espnow_inflight[ESPNOW_MAX_WINDOW];
+uint8_t espnow_inflight_head = 0;
+uint8_t espnow_inflight_count = 0;
+
+/* Packets that still owe a spaced copy, by seq % ESPNOW_HISTORY_LEN. */
+espnow_data_t *espnow_history[ESPNOW_HISTORY_LEN];
+uint32_t espnow_history_seq[ESPNOW_HISTORY_LEN];
+uint16_t espnow_history_len[ESPNOW_HISTORY_LEN];
+
+uint8_t *espnow_parity_pool = NULL;
+uint8_t *espnow_parity_free[ESPNOW_PARITY_POOL_SIZE];
+uint8_t espnow_parity_free_count = 0;
+
+/* Set while espnow_task() has nothing to send, so espnow_packet_commit()
+ * knows to wake it. */
+atomic_bool espnow_sender_idle = false;
+
 espnow_send_param_t *send_param;
 
-espnow_debug_t debug = {0};
+/* Arrival of the last frame, for TELEMETRY_RX_INTERVAL_US. */
+int64_t espnow_last_recv = 0;
+/* FEC decoder counts already passed on by espnow_telemetry_collect(). */
+fec_stats_t espnow_fec_reported;
+
+static void espnow_schedule_parity(uint8_t index, uint8_t flags);
+static void espnow_send_done(esp_now_send_status_t status);
+static void espnow_recv_parity(const espnow_data_t *data, int len,
+                               int64_t now);
+static void espnow_recv_stream(const espnow_data_t *data, int len);
+static void espnow_recv_ping(const espnow_data_t *data, int len, int64_t now);
+static void espnow_recv_pong(const espnow_data_t *data, int len, int64_t now);
+static void espnow_send_ping(int64_t now);
+static bool espnow_stream_make(espnow_stream_t *stream, uint32_t samplerate,
+                               uint16_t frames);
+static void espnow_lock_create();
 
 esp_err_t espnow_init(bool receiver) {
   is_receiver = receiver;
+  if (espnow_stream.frames == 0) {
+    espnow_stream_make(&espnow_stream, SAMPLERATE, ESPNOW_DEFAULT_FRAMES);
+  }
+  if (espnow_redundant && !ESPNOW_REDUNDANT_FITS(&espnow_stream)) {
+    ESP_LOGE(TAG, "No room for the redundant payload, use shorter packets");
+    espnow_redundant = false;
+  }
+  if (espnow_timestamps && !ESPNOW_TIMESTAMP_FITS(&espnow_stream)) {
+    ESP_LOGE(TAG, "No room for the timestamp, use shorter packets");
+    espnow_timestamps = false;
+  }
+  integrity_init();
+  espnow_lock_create();
 
   espnow_queue = xQueueCreate(ESPNOW_QUEUE_SIZE, sizeof(espnow_event_t));
   if (espnow_queue == NULL) {
@@ -42,12 +198,74 @@ esp_err_t espnow_init(bool receiver) {
     return ESP_FAIL;
   }
 
-  espnow_data_queue = xQueueCreate(ESPNOW_DATA_QUEUE_SIZE, ESPNOW_SEND_LEN);
-  if (espnow_data_queue == NULL) {
+  espnow_data_queue =
+      xQueueCreate(ESPNOW_DATA_QUEUE_SIZE, sizeof(espnow_data_t *));
+  espnow_free_queue =
+      xQueueCreate(ESPNOW_PACKET_POOL_SIZE, sizeof(espnow_data_t *));
+  if (espnow_data_queue == NULL || espnow_free_queue == NULL) {
     ESP_LOGE(TAG, "Create mutex fail");
     return ESP_FAIL;
   }
 
+  espnow_packet_stride = (ESPNOW_OVERHEAD + espnow_stream.payload_max +
+                          espnow_stream.redundant_len + ESPNOW_TIMESTAMP_LEN +
+                          3) &
+                         ~(size_t)3;
+  espnow_packet_pool = malloc(ESPNOW_PACKET_POOL_SIZE * espnow_packet_stride);
+  if (espnow_packet_pool == NULL) {
+    ESP_LOGE(TAG, "Malloc packet pool fail");
+    return ESP_FAIL;
+  }
+  for (int i = 0; i < ESPNOW_PACKET_POOL_SIZE; i++) {
+    espnow_packet_release(
+        (espnow_data_t *)(espnow_packet_pool + i * espnow_packet_stride));
+  }
+
+  espnow_recv_free_queue = xQueueCreate(ESPNOW_RECV_SLOTS, sizeof(uint8_t *));
+  espnow_recv_pool = malloc(ESPNOW_RECV_SLOTS * ESP_NOW_MAX_DATA_LEN);
+  if (espnow_recv_free_queue == NULL || espnow_recv_pool == NULL) {
+    ESP_LOGE(TAG, "Malloc receive pool fail");
+    return ESP_FAIL;
+  }
+  for (int i = 0; i < ESPNOW_RECV_SLOTS; i++) {
+    espnow_recv_slot_release(espnow_recv_pool + i * ESP_NOW_MAX_DATA_LEN);
+  }
+
+  if (is_receiver) {
+    espnow_fec_dec = malloc(sizeof(fec_decoder_t));
+    if (espnow_fec_dec == NULL) {
+      ESP_LOGE(TAG, "Malloc FEC decoder fail");
+      return ESP_FAIL;
+    }
+    fec_decoder_init(espnow_fec_dec, espnow_stream.payload_max);
+  } else if (espnow_fec_config.scheme != FEC_NONE) {
+    espnow_fec_enc = malloc(sizeof(fec_encoder_t));
+    espnow_parity_pool =
+        malloc(ESPNOW_PARITY_POOL_SIZE * espnow_stream.parity_len);
+    if (espnow_fec_enc == NULL || espnow_parity_pool == NULL) {
+      ESP_LOGE(TAG, "Malloc FEC encoder fail");
+      return ESP_FAIL;
+    }
+    fec_encoder_init(espnow_fec_enc, &espnow_fec_config,
+                     espnow_stream.payload_max);
+    for (int i = 0; i < ESPNOW_PARITY_POOL_SIZE; i++) {
+      espnow_parity_free[espnow_parity_free_count++] =
+          espnow_parity_pool + i * espnow_stream.parity_len;
+    }
+  }
+
+  if (!is_receiver) {
+    espnow_data_t *buf = (espnow_data_t *)espnow_stream_packet;
+    espnow_stream_header_t *header = (espnow_stream_header_t *)buf->payload;
+    buf->seq_num = 0;
+    header->version = ESPNOW_STREAM_VERSION;
+    header->channels = ESPNOW_CHANNELS;
+    header->frames = espnow_stream.frames;
+    header->samplerate = espnow_stream.samplerate;
+    espnow_data_seal(buf, sizeof(espnow_stream_packet) - ESPNOW_TRAILER_LEN,
+                     ESPNOW_PACKET_STREAM, 0);
+  }
+
   ESP_ERROR_CHECK(esp_now_init());
   ESP_ERROR_CHECK(esp_now_register_send_cb(espnow_send_cb));
   ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_recv_cb));
@@ -79,21 +297,10 @@ esp_err_t espnow_init(bool receiver) {
     return ESP_FAIL;
   }
   send_param->state = 0;
-  send_param->resend_scheduled = false;
-  send_param->len = ESPNOW_SEND_LEN + sizeof(espnow_data_t);
-  send_param->buffer = malloc(send_param->len);
-  if (send_param->buffer == NULL) {
-    free(send_param);
-    vSemaphoreDelete(espnow_queue);
-    esp_now_deinit();
-    return ESP_FAIL;
-  }
+  send_param->len = espnow_stream.send_len + ESPNOW_OVERHEAD;
+  send_param->buffer = NULL;
   memcpy(send_param->dest_mac, peer_mac, ESP_NOW_ETH_ALEN);
 
-  debug.time = esp_timer_get_time();
-  debug.interval = 10 * 1000000;
-  debug.last_micro = debug.time;
-
   xTaskCreatePinnedToCore(espnow_task, "ESP-Now Task", 3 * 1024, NULL, 4, NULL,
                           1);
 
@@ -101,8 +308,18 @@ esp_err_t espnow_init(bool receiver) {
 }
 
 void espnow_deinit(espnow_send_param_t *send_param) {
-  free(send_param->buffer);
   free(send_param);
+  free(espnow_packet_pool);
+  espnow_packet_pool = NULL;
+  free(espnow_fec_enc);
+  free(espnow_fec_dec);
+  free(espnow_parity_pool);
+  free(espnow_recv_pool);
+  espnow_recv_pool = NULL;
+  espnow_fec_enc = NULL;
+  espnow_fec_dec = NULL;
+  espnow_parity_pool = NULL;
+  espnow_parity_free_count = 0;
   vSemaphoreDelete(espnow_queue);
   esp_now_deinit();
 }
@@ -118,6 +335,230 @@ void espnow_set_rbuf_state(uint8_t state) {
            espnow_data_state ? "Active" : "Inactive");
 }
 
+/* espnow_jitter_lock guards the jitter buffer, the concealers and a
+ * receiver's espnow_stream. */
+static void espnow_lock_create() {
+  if (espnow_jitter_lock == NULL) {
+    espnow_jitter_lock = xSemaphoreCreateMutex();
+    assert(espnow_jitter_lock);
+  }
+}
+
+/* When set, received payloads go to the jitter buffer instead of the
+ * ringbuffer and the audio side plays out with espnow_jitter_pop(). Its
+ * storage must hold JITTER_SLOTS * ESPNOW_MAX_SEND_LEN bytes, as a new
+ * stream re-initializes it in place. */
+void espnow_set_jitter_buffer(jitter_buffer_t *jb) {
+  espnow_lock_create();
+  xSemaphoreTake(espnow_jitter_lock, portMAX_DELAY);
+  espnow_jitter = jb;
+  xSemaphoreGive(espnow_jitter_lock);
+}
+
+jitter_status_t espnow_jitter_pop(uint8_t *out) {
+  xSemaphoreTake(espnow_jitter_lock, portMAX_DELAY);
+  jitter_status_t status =
+      jitter_pop(espnow_jitter, out, esp_timer_get_time());
+  if (espnow_plc != NULL) {
+    // One concealer per planar channel, so neither sees the other's block.
+    for (int c = 0; c < ESPNOW_CHANNELS; c++) {
+      int16_t *channel = (int16_t *)out + c * espnow_stream.frames;
+      if (status == JITTER_OK) {
+        plc_good(&espnow_plc[c], channel);
+      } else {
+        plc_conceal(&espnow_plc[c], channel);
+      }
+    }
+  }
+  xSemaphoreGive(espnow_jitter_lock);
+  if (status == JITTER_UNDERRUN) {
+    telemetry_count(TELEMETRY_UNDERRUNS, 1);
+  }
+  return status;
+}
+
+/* Packets buffered and the depth the jitter buffer is aiming for, for the
+ * drift estimate's fill level. */
+void espnow_jitter_level(uint32_t *depth, uint16_t *target) {
+  xSemaphoreTake(espnow_jitter_lock, portMAX_DELAY);
+  *depth = jitter_depth(espnow_jitter);
+  *target = espnow_jitter->target_depth;
+  xSemaphoreGive(espnow_jitter_lock);
+}
+
+/* Conceals every frame espnow_jitter_pop() cannot fill from a packet. plc
+ * is ESPNOW_CHANNELS concealers, one for each planar channel of the
+ * decoded frame, set up for espnow_stream_t::frames samples. It shares the
+ * jitter buffer's lock, as a new stream re-initializes both. */
+void espnow_set_plc(plc_t *plc) { espnow_plc = plc; }
+
+/* Feeds the arrival time of every new audio packet to the drift estimate,
+ * see war_drift.h. Only espnow_task() calls drift_arrival(). */
+void espnow_set_drift(drift_t *drift) { espnow_drift = drift; }
+
+/* Pings the sender to follow its clock and feeds every timestamped audio
+ * packet to lat, see war_latency.h. Call before espnow_init(). */
+void espnow_set_latency(latency_t *lat) { espnow_latency = lat; }
+
+/* Stamps every audio packet with the capture time handed to
+ * espnow_packet_commit(), for the receiver's latency measurement. Dropped
+ * by espnow_init() if the packets leave no room for it. Call before
+ * espnow_init(). */
+void espnow_set_timestamps(bool enable) { espnow_timestamps = enable; }
+
+/* Sends parity after every group of audio packets, see war_fec.h. Call
+ * before espnow_init(); receivers pick the scheme up from the parity
+ * packets and need no configuration. */
+void espnow_set_fec(const fec_config_t *config) {
+  assert(fec_config_valid(config));
+  espnow_fec_config = *config;
+}
+
+/* Every packet also carries the previous frame at reduced resolution (see
+ * war_redundant.h), so a single lost packet is covered by the next one with
+ * no added latency. Call before espnow_init(). */
+void espnow_set_redundancy(bool enable) {
+  espnow_redundant = enable;
+  espnow_redundant_valid = false;
+}
+
+/* Codec for the audio payload, see war_codec.h. Encoding happens as
+ * espnow_data_prepare() takes a frame off espnow_data_queue, so the mixer
+ * keeps writing plain samples. Receivers follow the codec bits of each
+ * packet. Call before espnow_init(). */
+void espnow_set_codec(codec_id_t codec) { codec_init(&espnow_codec, codec); }
+
+/* Integrity check of every packet sent, see war_integrity.h. Receivers
+ * follow the mode bits of each packet. Call before espnow_init(). */
+void espnow_set_integrity(integrity_mode_t mode) {
+  assert(mode < INTEGRITY_COUNT);
+  espnow_integrity = mode;
+}
+
+/* Window and duplicate-send policy, see espnow_sender_config_t. Call before
+ * espnow_init(). */
+void espnow_set_sender(const espnow_sender_config_t *config) {
+  assert(config->window >= 1 && config->window <= ESPNOW_MAX_WINDOW);
+  assert(config->copies >= 1 && config->copies <= ESPNOW_MAX_COPIES);
+  assert(config->spacing <= ESPNOW_MAX_SPACING);
+  espnow_sender = *config;
+}
+
+/* Fills in a stream and its sizes, or returns false if this build cannot
+ * carry it. A receiver checks a sender's stream here before applying it. */
+static bool espnow_stream_make(espnow_stream_t *stream, uint32_t samplerate,
+                               uint16_t frames) {
+  uint32_t samples = (uint32_t)frames * ESPNOW_CHANNELS;
+  if (samplerate == 0 || samplerate % 8000 != 0 || frames == 0 ||
+      frames % ESPNOW_GRANULE(samplerate) != 0 || samples % 2 != 0 ||
+      samples > ESPNOW_MAX_SAMPLES || samples > PLC_MAX_FRAME ||
+      samplerate > PLC_MAX_SAMPLE_RATE) {
+    return false;
+  }
+  stream->samplerate = samplerate;
+  stream->frames = frames;
+  stream->samples = samples;
+  stream->send_len = samples * sizeof(int16_t);
+  stream->payload_max = CODEC_MAX_BYTES(samples);
+  stream->redundant_len = REDUNDANT_LEN(samples);
+  stream->parity_len =
+      ESPNOW_OVERHEAD + sizeof(fec_header_t) + stream->payload_max;
+  stream->packet_us = (uint32_t)(frames * 1000000ULL / samplerate);
+  return true;
+}
+
+/* Sample rate and frames per packet. Rates are multiples of 8 kHz up to
+ * PLC_MAX_SAMPLE_RATE (48 kHz) and packets a whole number of 125 us steps holding at most
+ * ESPNOW_MAX_SAMPLES samples; returns false and keeps the stream as it is
+ * otherwise. Redundancy is dropped by espnow_init() if the packets leave
+ * no room for it. Call before espnow_init(), receivers start from this
+ * stream until the sender's arrives. */
+bool espnow_set_stream(uint32_t samplerate, uint16_t frames) {
+  espnow_stream_t stream;
+  if (!espnow_stream_make(&stream, samplerate, frames)) {
+    ESP_LOGE(TAG, "Unsupported stream: %u Hz, %u frames per packet",
+             samplerate, frames);
+    return false;
+  }
+  espnow_stream = stream;
+  return true;
+}
+
+void espnow_set_stream_cb(espnow_stream_cb_t cb) { espnow_stream_cb = cb; }
+
+const espnow_stream_t *espnow_get_stream() {
+  if (espnow_stream.frames == 0) {
+    espnow_stream_make(&espnow_stream, SAMPLERATE, ESPNOW_DEFAULT_FRAMES);
+  }
+  return &espnow_stream;
+}
+
+/* A receiver's stream changes on espnow_task() under espnow_jitter_lock,
+ * so any other task takes its copy under the lock too, once per packet. */
+void espnow_copy_stream(espnow_stream_t *stream) {
+  if (espnow_jitter_lock == NULL) {
+    *stream = *espnow_get_stream();
+    return;
+  }
+  xSemaphoreTake(espnow_jitter_lock, portMAX_DELAY);
+  *stream = espnow_stream;
+  xSemaphoreGive(espnow_jitter_lock);
+}
+
+/* Length of a packet ahead of its timestamp and trailer. */
+static int espnow_stamped_len(const espnow_data_t *data, int len) {
+  uint8_t flags = ESPNOW_TRAILER(data, len)->flags;
+  len -= ESPNOW_TRAILER_LEN;
+  return flags & ESPNOW_FLAG_TIMESTAMP ? len - (int)ESPNOW_TIMESTAMP_LEN : len;
+}
+
+/* Length of a packet's primary payload, which the redundant copy follows. */
+static int espnow_payload_len(const espnow_data_t *data, int len) {
+  uint8_t flags = ESPNOW_TRAILER(data, len)->flags;
+  len = espnow_stamped_len(data, len) - sizeof(espnow_data_t);
+  if (flags & ESPNOW_FLAG_REDUNDANT) {
+    len -= espnow_stream.redundant_len;
+  }
+  return len;
+}
+
+/* The previous frame out of a packet's redundant payload, or NULL. */
+static const int16_t *espnow_redundant_decode(const espnow_data_t *data,
+                                              int len) {
+  if (!(ESPNOW_TRAILER(data, len)->flags & ESPNOW_FLAG_REDUNDANT) ||
+      espnow_payload_len(data, len) <= 0) {
+    return NULL;
+  }
+  len = espnow_stamped_len(data, len);
+  redundant_decode((const uint8_t *)data + len - espnow_stream.redundant_len,
+                   espnow_stream.samples, espnow_redundant_frame);
+  return espnow_redundant_frame;
+}
+
+/* Samples of an encoded payload, mid/side turned back into L/R, or NULL if
+ * it does not decode or has a different channel count than this build. Raw
+ * payloads are used in place. */
+static const uint8_t *espnow_decode(uint8_t flags, const uint8_t *payload,
+                                    int len) {
+  codec_id_t codec = ESPNOW_FLAG_CODEC(flags);
+  channel_layout_t layout = ESPNOW_FLAG_LAYOUT(flags);
+  if (layout >= LAYOUT_COUNT || LAYOUT_CHANNELS(layout) != ESPNOW_CHANNELS) {
+    telemetry_count(TELEMETRY_RX_LAYOUT_MISMATCH, 1);
+    return NULL;
+  }
+  if (codec == CODEC_PCM16 && len == espnow_stream.send_len &&
+      layout != LAYOUT_MID_SIDE) {
+    return payload;
+  }
+  if (len <= 0 || !codec_decode(codec, payload, len, espnow_decode_frame,
+                                espnow_stream.samples)) {
+    telemetry_count(TELEMETRY_RX_DECODE_FAIL, 1);
+    return NULL;
+  }
+  layout_unpack(layout, espnow_decode_frame, espnow_stream.frames);
+  return (const uint8_t *)espnow_decode_frame;
+}
+
 void espnow_send_cb(const uint8_t *mac_addr, esp_now_send_status_t status) {
   espnow_event_t evt;
   espnow_event_send_cb_t *send_cb = &evt.info.send_cb;
@@ -142,48 +583,82 @@ void espnow_recv_cb(const uint8_t *mac_addr, const uint8_t *data, int len) {
     return;
   }
 
+  if (len > ESP_NOW_MAX_DATA_LEN) {
+    return;
+  }
+
   evt.id = ESPNOW_RECV_CB;
   memcpy(recv_cb->mac_addr, mac_addr, ESP_NOW_ETH_ALEN);
-  recv_cb->data = malloc(len);
-  if (recv_cb->data == NULL) {
-    ESP_LOGE(TAG, "Malloc receive data full.");
+  if (xQueueReceive(espnow_recv_free_queue, &recv_cb->data, 0) != pdTRUE) {
+    telemetry_count(TELEMETRY_RX_POOL_EMPTY, 1);
     return;
   }
+  telemetry_peak(TELEMETRY_RX_SLOTS_USED,
+                 ESPNOW_RECV_SLOTS -
+                     uxQueueMessagesWaiting(espnow_recv_free_queue));
   memcpy(recv_cb->data, data, len);
   recv_cb->data_len = len;
   if (xQueueSend(espnow_queue, &evt, ESPNOW_MAXDELAY) != pdTRUE) {
-    ESP_LOGI(TAG, "Send receive queue fail.");
-    free(recv_cb->data);
+    telemetry_count(TELEMETRY_RX_QUEUE_FULL, 1);
+    espnow_recv_slot_release(recv_cb->data);
   }
 }
 
-espnow_data_t *espnow_data_parse(uint8_t *data, uint16_t data_len,
-                                 uint8_t *state, uint32_t *seq, int *magic) {
-  espnow_data_t *buf = (espnow_data_t *)data;
-  uint16_t crc, crc_cal = 0;
+void espnow_recv_slot_release(uint8_t *slot) {
+  xQueueSend(espnow_recv_free_queue, &slot, 0);
+}
 
-  if (data_len < sizeof(espnow_data_t)) {
-    ESP_LOGE(TAG, "Receive ESPNOW data too short, len %d", data_len);
+/* Check of a packet as sent: inverted for anything but audio, see
+ * espnow_data_t. */
+static uint16_t espnow_data_check(integrity_mode_t mode, uint8_t type,
+                                  const uint8_t *data, uint16_t len) {
+  uint16_t crc = integrity_check(mode, data, len, offsetof(espnow_data_t, crc),
+                                 sizeof(espnow_data_t), ESPNOW_TRAILER_LEN);
+  return type == ESPNOW_PACKET_AUDIO ? crc : (uint16_t)~crc;
+}
+
+/* Checks a packet in place, in the mode its type bits name. */
+const espnow_data_t *espnow_data_parse(const uint8_t *data, uint16_t data_len,
+                                       uint8_t *state, uint32_t *seq,
+                                       int *magic) {
+  PROFILE_STAGE(PROFILE_RECV_PARSE);
+  const espnow_data_t *buf = (const espnow_data_t *)data;
+
+  if (data_len < ESPNOW_OVERHEAD) {
     return NULL;
   }
 
   *seq = buf->seq_num;
-  crc = buf->crc;
-  buf->crc = 0;
-  crc_cal = esp_crc16_le(UINT16_MAX, (uint8_t const *)buf, data_len);
+  uint8_t type = ESPNOW_TRAILER(data, data_len)->type;
+  uint16_t crc = espnow_data_check(ESPNOW_TYPE_INTEGRITY(type),
+                                   ESPNOW_TYPE(type), data, data_len);
 
-  if (crc_cal == crc) {
-    debug.rx_byte_count += data_len;
+  if (crc == buf->crc) {
+    telemetry_count(TELEMETRY_RX_BYTES, data_len);
     return buf;
   }
 
   return NULL;
 }
 
+/* Appends the trailer, with the integrity bits, to the len bytes of a
+ * packet ready to go and fills in its check. Returns the length to send. */
+uint16_t espnow_data_seal(espnow_data_t *buf, uint16_t len, uint8_t type,
+                          uint8_t flags) {
+  espnow_trailer_t *trailer = (espnow_trailer_t *)(buf->payload +
+                                                   len - sizeof(espnow_data_t));
+  trailer->type = ESPNOW_TYPE(type) |
+                  espnow_integrity << ESPNOW_TYPE_INTEGRITY_SHIFT;
+  trailer->flags = flags;
+  len += ESPNOW_TRAILER_LEN;
+  buf->crc = espnow_data_check(espnow_integrity, ESPNOW_TYPE(type),
+                               (const uint8_t *)buf, len);
+  return len;
+}
+
 void espnow_task(void *pvParam) {
   if (!is_receiver) {
-    espnow_data_prepare(send_param);
-    espnow_send();
+    espnow_pump();
   }
   for (;;) {
     espnow_tick();
@@ -196,6 +671,7 @@ void espnow_tick() {
   uint8_t recv_state = 0;
   uint32_t recv_seq = 0;
   uint32_t last_recv_seq = 0;
+  bool have_recv_seq = false;
   int recv_magic = 0;
   bool repeat_packet = false;
 
@@ -205,132 +681,594 @@ void espnow_tick() {
         espnow_event_send_cb_t *send_cb = &evt.info.send_cb;
 
         if (!is_receiver) {
-          debug.packet_accum += esp_timer_get_time() - debug.packet_sent;
-          debug.packet_count++;
-          if (send_param->resend_scheduled) {
-            send_param->resend_scheduled = false;
-            espnow_send();
-          } else {
-            memcpy(send_param->dest_mac, send_cb->mac_addr, ESP_NOW_ETH_ALEN);
-            espnow_data_prepare(send_param);
-            espnow_send();
-          }
+          espnow_send_done(send_cb->status);
+          memcpy(send_param->dest_mac, send_cb->mac_addr, ESP_NOW_ETH_ALEN);
+          espnow_pump();
         }
 
         break;
       }
+      case ESPNOW_DATA_READY:
+        espnow_pump();
+        break;
       case ESPNOW_RECV_CB: {
         espnow_event_recv_cb_t *recv_cb = &evt.info.recv_cb;
 
-        debug.total_packet_count++;
+        telemetry_count(TELEMETRY_RX_PACKETS, 1);
         int64_t now = esp_timer_get_time();
-        debug.micro_accum += now - debug.last_micro;
-        debug.micro_count++;
-        debug.last_micro = now;
+        if (espnow_last_recv != 0) {
+          telemetry_hist_add(TELEMETRY_RX_INTERVAL_US, now - espnow_last_recv);
+        }
+        espnow_last_recv = now;
 
-        espnow_data_t *data =
+        const espnow_data_t *data =
             espnow_data_parse(recv_cb->data, recv_cb->data_len, &recv_state,
                               &recv_seq, &recv_magic);
-        if (data) {
+        const espnow_trailer_t *trailer =
+            data ? ESPNOW_TRAILER(data, recv_cb->data_len) : NULL;
+        uint8_t type = data ? ESPNOW_TYPE(trailer->type) : 0;
+        if (data && is_receiver && type == ESPNOW_PACKET_PARITY) {
+          espnow_recv_parity(data, recv_cb->data_len, now);
+        } else if (data && type == ESPNOW_PACKET_STREAM) {
+          if (is_receiver) {
+            espnow_recv_stream(data, recv_cb->data_len);
+          }
+        } else if (data && type == ESPNOW_PACKET_PING) {
+          if (!is_receiver) {
+            espnow_recv_ping(data, recv_cb->data_len, now);
+          }
+        } else if (data && type == ESPNOW_PACKET_PONG) {
+          if (is_receiver && espnow_latency != NULL) {
+            espnow_recv_pong(data, recv_cb->data_len, now);
+          }
+        } else if (data) {
           if (is_receiver) {
-            uint16_t seq_diff = recv_seq - last_recv_seq;
-            if (seq_diff == 0) {
+            // Copies of a packet (back to back or spaced) and late packets
+            // are not newer than the last one seen.
+            int32_t seq_diff = have_recv_seq ? (int32_t)(recv_seq - last_recv_seq) : 1;
+            if (seq_diff <= -JITTER_SLOTS) {
+              ESP_LOGI(TAG, "Sequence restarted at %u", recv_seq);
+            } else if (seq_diff <= 0) {
               repeat_packet = true;
-            } else if (seq_diff != 1 && recv_seq != 0) {
-              if (recv_seq < last_recv_seq) {
-                ESP_LOGI(TAG, "Received stale packet: %u", recv_seq);
-              } else {
-                debug.missed_packet_count += seq_diff - 1;
-              }
+            } else if (seq_diff > 1) {
+              telemetry_count(TELEMETRY_RX_MISSED, seq_diff - 1);
+              telemetry_hist_add(TELEMETRY_RX_GAP, seq_diff - 1);
             }
-            if (is_receiver && espnow_rbuf != NULL && !repeat_packet) {
+            int payload_len = espnow_payload_len(data, recv_cb->data_len);
+            const uint8_t *pcm = NULL;
+            if (espnow_jitter != NULL || !repeat_packet) {
+              pcm = espnow_decode(trailer->flags, data->payload, payload_len);
+            }
+            const int16_t *redundant =
+                repeat_packet ? NULL
+                              : espnow_redundant_decode(data, recv_cb->data_len);
+            if (espnow_jitter != NULL) {
+              if (espnow_data_state == ESPNOW_RBUF_ACTIVE) {
+                PROFILE_STAGE(PROFILE_RBUF_PUSH);
+                xSemaphoreTake(espnow_jitter_lock, portMAX_DELAY);
+                if (pcm != NULL) {
+                  jitter_push(espnow_jitter, recv_seq, pcm, now);
+                }
+                if (redundant != NULL) {
+                  jitter_push_redundant(espnow_jitter, recv_seq - 1,
+                                        (const uint8_t *)redundant, now);
+                }
+                xSemaphoreGive(espnow_jitter_lock);
+              }
+            } else if (is_receiver && espnow_rbuf != NULL && !repeat_packet) {
               if (espnow_data_state == ESPNOW_RBUF_ACTIVE) {
-                if (xRingbufferSend(espnow_rbuf, data->payload, ESPNOW_SEND_LEN,
+                PROFILE_STAGE(PROFILE_RBUF_PUSH);
+                // Exactly the previous packet is missing: play its copy.
+                if (redundant != NULL && recv_seq - last_recv_seq == 2 &&
+                    xRingbufferSend(espnow_rbuf, redundant,
+                                    espnow_stream.send_len,
                                     portMAX_DELAY) != pdTRUE) {
                   ESP_LOGE(TAG, "Failed to send to ringbuffer");
                 }
+                if (pcm != NULL &&
+                    xRingbufferSend(espnow_rbuf, pcm, espnow_stream.send_len,
+                                    portMAX_DELAY) != pdTRUE) {
+                  ESP_LOGE(TAG, "Failed to send to ringbuffer");
+                }
+              }
+              telemetry_hist_add(TELEMETRY_RBUF_FREE,
+                                 xRingbufferGetCurFreeSize(espnow_rbuf));
+            }
+            // History for the FEC decoder, only kept once the sender has
+            // shown it sends parity.
+            if (espnow_parity_seen && !repeat_packet && payload_len > 0 &&
+                payload_len <= espnow_stream.payload_max) {
+              fec_decoder_add_data(espnow_fec_dec, recv_seq, data->payload,
+                                   payload_len);
+            }
+            if (!repeat_packet && espnow_drift != NULL) {
+              drift_arrival(espnow_drift, recv_seq, now);
+            }
+            if (!repeat_packet && espnow_latency != NULL) {
+              if (trailer->flags & ESPNOW_FLAG_TIMESTAMP) {
+                uint32_t captured;
+                memcpy(&captured,
+                       (const uint8_t *)trailer - ESPNOW_TIMESTAMP_LEN,
+                       ESPNOW_TIMESTAMP_LEN);
+                latency_arrival(espnow_latency, captured, (uint32_t)now);
+              }
+              if (now - espnow_ping_sent >= LATENCY_PING_US) {
+                espnow_send_ping(now);
               }
-              debug.ringbuffer_accum += xRingbufferGetCurFreeSize(espnow_rbuf);
-              debug.ringbuffer_count++;
             }
-            last_recv_seq = recv_seq;
+            if (!repeat_packet) {
+              espnow_last_audio_seq = recv_seq;
+              last_recv_seq = recv_seq;
+              have_recv_seq = true;
+            }
             repeat_packet = false;
           }
         } else {
-          ESP_LOGI(TAG, "Receive error data from: " MACSTR "",
-                   MAC2STR(recv_cb->mac_addr));
+          telemetry_count(TELEMETRY_RX_BAD, 1);
         }
-        free(recv_cb->data);
+        espnow_recv_slot_release(recv_cb->data);
         break;
       }
       default:
         ESP_LOGE(TAG, "Callback type error: %d", evt.id);
         break;
     }
-    espnow_print_debug();
   }
 }
 
-void espnow_data_prepare(espnow_send_param_t *param) {
-  espnow_data_t *buf = (espnow_data_t *)send_param->buffer;
+static espnow_job_t *espnow_schedule_job(uint8_t *buffer, uint16_t len,
+                                         uint8_t release) {
+  assert(espnow_schedule_count < ESPNOW_SCHEDULE_LEN);
+  espnow_job_t *job =
+      &espnow_schedule[(espnow_schedule_head + espnow_schedule_count++) %
+                       ESPNOW_SCHEDULE_LEN];
+  job->buffer = buffer;
+  job->len = len;
+  job->release = release;
+  job->captured = 0;
+  return job;
+}
+
+static size_t espnow_packet_index(const espnow_data_t *packet) {
+  size_t index = ((const uint8_t *)packet - espnow_packet_pool) /
+                 espnow_packet_stride;
+  assert(index < ESPNOW_PACKET_POOL_SIZE);
+  return index;
+}
+
+static int64_t *espnow_packet_captured_at(const espnow_data_t *packet) {
+  return &espnow_packet_captured[espnow_packet_index(packet)];
+}
+
+/* The new packet goes out first, then the copies that are due: of this
+ * packet when copies go back to back, of older packets when spaced. A
+ * packet goes back to the mixer with its last copy. */
+static void espnow_schedule_packet(espnow_data_t *buf, uint16_t len) {
+  uint8_t copies = espnow_sender.copies;
+  uint8_t spacing = espnow_sender.spacing;
+  uint32_t seq = buf->seq_num;
+  int64_t captured = *espnow_packet_captured_at(buf);
+
+  if (spacing == 0) {
+    for (uint8_t c = 0; c < copies; c++) {
+      espnow_job_t *job =
+          espnow_schedule_job((uint8_t *)buf, len,
+                              c == copies - 1 ? ESPNOW_RELEASE_PACKET
+                                              : ESPNOW_RELEASE_NONE);
+      if (c == 0) {
+        job->captured = captured;
+      }
+    }
+    telemetry_count(TELEMETRY_TX_COPIES, copies - 1);
+    return;
+  }
+
+  espnow_job_t *first = espnow_schedule_job(
+      (uint8_t *)buf, len,
+      copies == 1 ? ESPNOW_RELEASE_PACKET : ESPNOW_RELEASE_NONE);
+  first->captured = captured;
+  uint32_t slot = seq % ESPNOW_HISTORY_LEN;
+  espnow_history[slot] = buf;
+  espnow_history_seq[slot] = seq;
+  espnow_history_len[slot] = len;
+
+  for (uint8_t c = 1; c < copies; c++) {
+    uint32_t back = (uint32_t)c * spacing;
+    if (seq < back) {
+      break;
+    }
+    slot = (seq - back) % ESPNOW_HISTORY_LEN;
+    if (espnow_history[slot] == NULL || espnow_history_seq[slot] != seq - back) {
+      continue;
+    }
+    espnow_schedule_job((uint8_t *)espnow_history[slot],
+                        espnow_history_len[slot],
+                        c == copies - 1 ? ESPNOW_RELEASE_PACKET
+                                        : ESPNOW_RELEASE_NONE);
+    telemetry_count(TELEMETRY_TX_COPIES, 1);
+    if (c == copies - 1) {
+      espnow_history[slot] = NULL;
+    }
+  }
+}
+
+bool espnow_data_prepare(espnow_send_param_t *param, TickType_t ticks_to_wait) {
+  espnow_data_t *buf = NULL;
 
-  assert(send_param->len >= sizeof(espnow_data_t));
+  if (xQueueReceive(espnow_data_queue, &buf, ticks_to_wait) != pdTRUE) {
+    return false;
+  }
+  PROFILE_STAGE(PROFILE_PREPARE);
+  // Backlog behind this packet; grows when the radio can't keep up.
+  telemetry_hist_add(TELEMETRY_TX_QUEUE,
+                     uxQueueMessagesWaiting(espnow_data_queue));
 
   buf->seq_num = espnow_seq[0]++;
-  buf->crc = 0;
+  uint8_t flags = espnow_packet_layout[espnow_packet_index(buf)]
+                      << ESPNOW_FLAG_LAYOUT_SHIFT |
+                  espnow_codec.id << ESPNOW_FLAG_CODEC_SHIFT;
 
-  xQueueReceive(espnow_data_queue, buf->payload, portMAX_DELAY);
+  const int16_t *pcm = (const int16_t *)buf->payload;
+  size_t payload_len = espnow_stream.send_len;
+  if (espnow_codec.id != CODEC_PCM16) {
+    memcpy(espnow_encode_frame, buf->payload, espnow_stream.send_len);
+    pcm = espnow_encode_frame;
+    payload_len = codec_encode(&espnow_codec, pcm, espnow_stream.samples,
+                               buf->payload);
+  }
+  telemetry_count(TELEMETRY_CODEC_BYTES, payload_len);
+  telemetry_count(TELEMETRY_CODEC_FRAMES, 1);
 
-  buf->crc = esp_crc16_le(UINT16_MAX, (uint8_t const *)buf, send_param->len);
+  param->len = payload_len + sizeof(espnow_data_t);
+  if (espnow_redundant) {
+    if (espnow_redundant_valid) {
+      memcpy(buf->payload + payload_len, espnow_redundant_prev,
+             espnow_stream.redundant_len);
+      flags |= ESPNOW_FLAG_REDUNDANT;
+      param->len += espnow_stream.redundant_len;
+    }
+    redundant_encode(pcm, espnow_stream.samples, espnow_redundant_prev);
+    espnow_redundant_valid = true;
+  }
+  if (espnow_timestamps) {
+    uint32_t captured = (uint32_t)*espnow_packet_captured_at(buf);
+    memcpy((uint8_t *)buf + param->len, &captured, ESPNOW_TIMESTAMP_LEN);
+    flags |= ESPNOW_FLAG_TIMESTAMP;
+    param->len += ESPNOW_TIMESTAMP_LEN;
+  }
+  param->len = espnow_data_seal(buf, param->len, ESPNOW_PACKET_AUDIO, flags);
+
+  param->buffer = (uint8_t *)buf;
+  if (buf->seq_num % ESPNOW_STREAM_EVERY == 0) {
+    espnow_schedule_job(espnow_stream_packet, sizeof(espnow_stream_packet),
+                        ESPNOW_RELEASE_NONE);
+  }
+  espnow_schedule_packet(buf, param->len);
 
-  send_param->resend_scheduled = true;
+  // Parity goes out once, right after the group's last packet.
+  if (espnow_fec_enc != NULL &&
+      fec_encoder_add(espnow_fec_enc, buf->seq_num, buf->payload,
+                      payload_len)) {
+    for (uint8_t i = 0; i < espnow_fec_config.m; i++) {
+      espnow_schedule_parity(
+          i, flags & ~(ESPNOW_FLAG_REDUNDANT | ESPNOW_FLAG_TIMESTAMP));
+    }
+  }
+  return true;
+}
+
+espnow_data_t *espnow_packet_acquire(TickType_t ticks_to_wait) {
+  espnow_data_t *packet = NULL;
+  if (xQueueReceive(espnow_free_queue, &packet, ticks_to_wait) != pdTRUE) {
+    return NULL;
+  }
+  return packet;
+}
+
+BaseType_t espnow_packet_commit(espnow_data_t *packet, int64_t captured,
+                                channel_layout_t layout) {
+  PROFILE_STAGE(PROFILE_QUEUE_SEND);
+  size_t index = espnow_packet_index(packet);
+  espnow_packet_captured[index] = captured;
+  espnow_packet_layout[index] = layout;
+  if (xQueueSend(espnow_data_queue, &packet, portMAX_DELAY) != pdTRUE) {
+    return pdFALSE;
+  }
+  // Only an idle sender needs waking; a busy one picks the packet up on its
+  // next send callback.
+  if (atomic_exchange(&espnow_sender_idle, false)) {
+    espnow_event_t evt = {.id = ESPNOW_DATA_READY};
+    xQueueSend(espnow_queue, &evt, 0);
+  }
+  return pdTRUE;
 }
 
-void espnow_send() {
-  esp_err_t err =
-      esp_now_send(send_param->dest_mac, send_param->buffer, send_param->len);
+void espnow_packet_release(espnow_data_t *packet) {
+  xQueueSend(espnow_free_queue, &packet, 0);
+}
+
+/* Pings and pongs share espnow_ping_packet: a device only ever sends one
+ * of them. The receiver pings straight away, as it has no send pipeline;
+ * the sender's pong queues behind the jobs already scheduled and takes its
+ * send time as it goes out. */
+static void espnow_send_ping(int64_t now) {
+  espnow_data_t *buf = (espnow_data_t *)espnow_ping_packet;
+  latency_ping_t *ping = (latency_ping_t *)buf->payload;
+  buf->seq_num = 0;
+  ping->t1 = (uint32_t)esp_timer_get_time();
+  ping->t2 = ping->t3 = 0;
+  espnow_data_seal(buf, sizeof(espnow_ping_packet) - ESPNOW_TRAILER_LEN,
+                   ESPNOW_PACKET_PING, 0);
+  espnow_ping_sent = now;
+  esp_err_t err = esp_now_send(send_param->dest_mac, espnow_ping_packet,
+                               sizeof(espnow_ping_packet));
   if (err != ESP_OK) {
-    ESP_LOGI(TAG, "ESP-Now Send Error: %s", esp_err_to_name(err));
-    if (err != ESP_ERR_ESPNOW_NO_MEM) {
+    ESP_LOGW(TAG, "Ping failed: %s", esp_err_to_name(err));
+  }
+}
+
+/* A ping that comes in while the last pong is still on its way goes
+ * unanswered; the receiver pings again soon enough. */
+static void espnow_recv_ping(const espnow_data_t *data, int len, int64_t now) {
+  if (len != sizeof(espnow_ping_packet) || espnow_pong_pending) {
+    return;
+  }
+  espnow_data_t *buf = (espnow_data_t *)espnow_ping_packet;
+  latency_ping_t *pong = (latency_ping_t *)buf->payload;
+  buf->seq_num = 0;
+  pong->t1 = ((const latency_ping_t *)data->payload)->t1;
+  pong->t2 = (uint32_t)now;
+  espnow_pong_pending = true;
+  espnow_schedule_job(espnow_ping_packet, sizeof(espnow_ping_packet),
+                      ESPNOW_RELEASE_NONE);
+  espnow_pump();
+}
+
+static void espnow_stamp_pong() {
+  espnow_data_t *buf = (espnow_data_t *)espnow_ping_packet;
+  ((latency_ping_t *)buf->payload)->t3 = (uint32_t)esp_timer_get_time();
+  espnow_data_seal(buf, sizeof(espnow_ping_packet) - ESPNOW_TRAILER_LEN,
+                   ESPNOW_PACKET_PONG, 0);
+}
+
+/* Only the answer to the last ping counts. */
+static void espnow_recv_pong(const espnow_data_t *data, int len, int64_t now) {
+  const latency_ping_t *pong = (const latency_ping_t *)data->payload;
+  const latency_ping_t *ping =
+      (const latency_ping_t *)((espnow_data_t *)espnow_ping_packet)->payload;
+  if (len != sizeof(espnow_ping_packet) || pong->t1 != ping->t1) {
+    return;
+  }
+  latency_clock(espnow_latency, pong, (uint32_t)now);
+}
+
+/* Sends scheduled jobs, pulling in the next audio packet when the schedule
+ * runs dry, until the window is full or there is nothing left to send. */
+void espnow_pump() {
+  while (espnow_inflight_count < espnow_sender.window) {
+    if (espnow_schedule_count == 0 && !espnow_data_prepare(send_param, 0)) {
+      atomic_store(&espnow_sender_idle, true);
+      // The mixer may have committed before it saw the flag.
+      if (!espnow_data_prepare(send_param, 0)) {
+        return;
+      }
+      atomic_store(&espnow_sender_idle, false);
+    }
+
+    espnow_job_t *job = &espnow_schedule[espnow_schedule_head];
+    if (job->buffer == espnow_ping_packet) {
+      espnow_stamp_pong();
+    }
+    esp_err_t err;
+    {
+      PROFILE_STAGE(PROFILE_ESPNOW_SEND);
+      err = esp_now_send(send_param->dest_mac, job->buffer, job->len);
+    }
+    if (err == ESP_ERR_ESPNOW_NO_MEM) {
+      // The driver's queue is full; the next callback makes room.
+      telemetry_count(TELEMETRY_TX_RETRY, 1);
+      if (espnow_inflight_count > 0) {
+        return;
+      }
+      vTaskDelay(1);
+      continue;
+    }
+    if (err != ESP_OK) {
+      ESP_LOGI(TAG, "ESP-Now Send Error: %s", esp_err_to_name(err));
       espnow_deinit(send_param);
       vTaskDelete(NULL);
+      return;
     }
-  } else {
-    debug.tx_byte_count += send_param->len;
-    debug.packet_sent = esp_timer_get_time();
-  }
-}
-
-void espnow_print_debug() {
-  int64_t now = esp_timer_get_time();
-  int64_t diff = now - debug.time;
-  if (diff >= debug.interval) {
-    debug.time = now;
-    float rbuf_bytes_free_avg =
-        (float)debug.ringbuffer_accum / debug.ringbuffer_count;
-    ESP_LOGI(
-        TAG,
-        "\nTX: %0.1fKBps, RX: %0.1fKbps\n"
-        "Missed %0.2f%%(%u) of packets\n"
-        "Audio Ringbuffer Avg: %0.1f%% (%0.1fB Free)\n"
-        "RX CB: %0.1f\n"
-        "Missed USB Audio CBs: %u\n"
-        "Send/CB Delay: %0.1f(%u)",
-        ((float)debug.tx_byte_count * 0.001f) / (diff * 0.000001f),
-        ((float)debug.rx_byte_count * 0.001f) / (diff * 0.000001f),
-        ((float)debug.missed_packet_count / (float)debug.total_packet_count) *
-            100.f,
-        debug.missed_packet_count,
-        (rbuf_bytes_free_avg / (float)espnow_rbuf_len) * 100.f,
-        rbuf_bytes_free_avg, (float)debug.micro_accum / debug.micro_count,
-        debug.missed_audio_cb, (float)debug.packet_accum / debug.packet_count,
-        debug.packet_count);
-
-    debug.rx_byte_count = debug.tx_byte_count = 0;
-    debug.total_packet_count = debug.missed_packet_count = 0;
-    debug.ringbuffer_accum = debug.ringbuffer_count = 0;
-    debug.micro_accum = debug.micro_count = 0;
-    debug.missed_audio_cb = 0;
-    debug.packet_accum = debug.packet_count = 0;
-  }
-}
\ No newline at end of file
+
+    job->sent = esp_timer_get_time();
+    telemetry_count(TELEMETRY_TX_PACKETS, 1);
+    telemetry_count(TELEMETRY_TX_BYTES, job->len);
+    if (job->captured != 0) {
+      telemetry_hist_add(TELEMETRY_CAPTURE_US, job->sent - job->captured);
+    }
+    espnow_inflight[(espnow_inflight_head + espnow_inflight_count++) %
+                    ESPNOW_MAX_WINDOW] = *job;
+    telemetry_hist_add(TELEMETRY_TX_INFLIGHT, espnow_inflight_count);
+    espnow_schedule_head = (espnow_schedule_head + 1) % ESPNOW_SCHEDULE_LEN;
+    espnow_schedule_count--;
+  }
+}
+
+static void espnow_send_done(esp_now_send_status_t status) {
+  if (espnow_inflight_count == 0) {
+    return;
+  }
+  espnow_job_t *job = &espnow_inflight[espnow_inflight_head];
+  espnow_inflight_head = (espnow_inflight_head + 1) % ESPNOW_MAX_WINDOW;
+  espnow_inflight_count--;
+
+  telemetry_hist_add(TELEMETRY_TX_SEND_US, esp_timer_get_time() - job->sent);
+  if (status != ESP_NOW_SEND_SUCCESS) {
+    telemetry_count(TELEMETRY_TX_FAIL, 1);
+  }
+
+  if (job->buffer == espnow_ping_packet) {
+    espnow_pong_pending = false;
+  }
+  if (job->release == ESPNOW_RELEASE_PACKET) {
+    espnow_packet_release((espnow_data_t *)job->buffer);
+  } else if (job->release == ESPNOW_RELEASE_PARITY) {
+    espnow_parity_free[espnow_parity_free_count++] = job->buffer;
+  }
+}
+
+static void espnow_schedule_parity(uint8_t index, uint8_t flags) {
+  assert(espnow_parity_free_count > 0);
+  uint8_t *packet = espnow_parity_free[--espnow_parity_free_count];
+  espnow_data_t *buf = (espnow_data_t *)packet;
+  fec_header_t *header = (fec_header_t *)buf->payload;
+
+  buf->seq_num = fec_encoder_base_seq(espnow_fec_enc);
+  header->scheme = espnow_fec_config.scheme;
+  header->k = espnow_fec_config.k;
+  header->m = espnow_fec_config.m;
+  header->index = index;
+  size_t parity_len = fec_encoder_parity_len(espnow_fec_enc);
+  memcpy(header + 1, fec_encoder_parity(espnow_fec_enc, index), parity_len);
+  uint16_t len = espnow_data_seal(
+      buf, sizeof(espnow_data_t) + sizeof(fec_header_t) + parity_len,
+      ESPNOW_PACKET_PARITY, flags);
+
+  telemetry_count(TELEMETRY_TX_PARITY, 1);
+  espnow_schedule_job(packet, len, ESPNOW_RELEASE_PARITY);
+}
+
+/* Rebuilt packets only go to the jitter buffer: they arrive a group late and
+ * the ringbuffer path has no way to put them back in order. */
+static void espnow_recv_parity(const espnow_data_t *data, int len,
+                               int64_t now) {
+  int parity_len = len - (int)(ESPNOW_OVERHEAD + sizeof(fec_header_t));
+  if (parity_len <= 0 || len > espnow_stream.parity_len) {
+    ESP_LOGW(TAG, "Parity packet with bad length %d", len);
+    return;
+  }
+  if (!espnow_parity_seen) {
+    // Groups before this point have no history to rebuild from.
+    espnow_parity_seen = true;
+    espnow_parity_first_seq = espnow_last_audio_seq + 1;
+  }
+  telemetry_count(TELEMETRY_RX_PARITY, 1);
+  if ((int32_t)(data->seq_num - espnow_parity_first_seq) < 0) {
+    return;
+  }
+
+  const fec_header_t *header = (const fec_header_t *)data->payload;
+  uint32_t recovered[FEC_MAX_M];
+  int count = fec_decoder_add_parity(espnow_fec_dec, data->seq_num, header,
+                                     (const uint8_t *)(header + 1), parity_len,
+                                     recovered);
+  if (count == 0 || espnow_jitter == NULL ||
+      espnow_data_state != ESPNOW_RBUF_ACTIVE) {
+    return;
+  }
+  xSemaphoreTake(espnow_jitter_lock, portMAX_DELAY);
+  for (int i = 0; i < count; i++) {
+    // Rebuilt payloads are zero padded, which every codec ignores.
+    const uint8_t *pcm =
+        espnow_decode(ESPNOW_TRAILER(data, len)->flags,
+                      fec_decoder_payload(espnow_fec_dec, recovered[i]),
+                      espnow_stream.payload_max);
+    if (pcm != NULL) {
+      jitter_push(espnow_jitter, recovered[i], pcm, now);
+    }
+  }
+  xSemaphoreGive(espnow_jitter_lock);
+}
+
+/* Switches to the sender's stream. FEC history of the old one cannot be
+ * used to rebuild packets of the new one, so groups restart with the next
+ * audio packet; the jitter buffer and concealer start over empty. */
+static void espnow_recv_stream(const espnow_data_t *data, int len) {
+  const espnow_stream_header_t *header =
+      (const espnow_stream_header_t *)data->payload;
+  if (len != sizeof(espnow_stream_packet) ||
+      header->version != ESPNOW_STREAM_VERSION) {
+    ESP_LOGW(TAG, "Stream packet with bad length %d or version", len);
+    return;
+  }
+  if (header->samplerate == espnow_stream.samplerate &&
+      header->frames == espnow_stream.frames) {
+    return;
+  }
+  espnow_stream_t stream;
+  if (header->channels != ESPNOW_CHANNELS ||
+      !espnow_stream_make(&stream, header->samplerate, header->frames)) {
+    telemetry_count(TELEMETRY_RX_LAYOUT_MISMATCH, 1);
+    return;
+  }
+  ESP_LOGI(TAG, "Stream: %u Hz, %u frames per packet (%u us)",
+           stream.samplerate, stream.frames, stream.packet_us);
+
+  xSemaphoreTake(espnow_jitter_lock, portMAX_DELAY);
+  espnow_stream = stream;
+  if (espnow_fec_dec != NULL) {
+    fec_decoder_init(espnow_fec_dec, stream.payload_max);
+    espnow_parity_first_seq = espnow_last_audio_seq + 1;
+  }
+  if (espnow_jitter != NULL) {
+    jitter_config_t config = espnow_jitter->config;
+    config.packet_us = stream.packet_us;
+    jitter_init(espnow_jitter, espnow_jitter->storage, stream.send_len,
+                &config);
+    for (int c = 0; espnow_plc != NULL && c < ESPNOW_CHANNELS; c++) {
+      plc_init(&espnow_plc[c], espnow_plc[c].mode, stream.frames,
+               stream.samplerate);
+    }
+  }
+  xSemaphoreGive(espnow_jitter_lock);
+  if (espnow_drift != NULL) {
+    drift_restart(espnow_drift, stream.packet_us);
+  }
+  if (espnow_stream_cb != NULL) {
+    espnow_stream_cb(&espnow_stream);
+  }
+}
+
+/* FEC counts only grow, but start over with a new stream's decoder. */
+static uint32_t espnow_fec_delta(uint32_t count, uint32_t reported) {
+  return count >= reported ? count - reported : count;
+}
+
+/* Passes the jitter buffer's and FEC decoder's own statistics on to
+ * telemetry. Runs on the telemetry task: the jitter buffer is read under
+ * its lock like from anywhere else, the FEC decoder's counters are only
+ * read. */
+void espnow_telemetry_collect() {
+  if (espnow_jitter != NULL) {
+    xSemaphoreTake(espnow_jitter_lock, portMAX_DELAY);
+    jitter_stats_t stats = espnow_jitter->stats;
+    float jitter_us = espnow_jitter->jitter_us;
+    uint16_t target = espnow_jitter->target_depth;
+    uint32_t depth = jitter_depth(espnow_jitter);
+    jitter_stats_reset(espnow_jitter);
+    xSemaphoreGive(espnow_jitter_lock);
+
+    telemetry_count(TELEMETRY_JITTER_LATE, stats.late);
+    telemetry_count(TELEMETRY_JITTER_LOST, stats.lost);
+    telemetry_count(TELEMETRY_JITTER_DUPLICATE, stats.duplicate);
+    telemetry_count(TELEMETRY_JITTER_DROPPED, stats.dropped);
+    telemetry_count(TELEMETRY_JITTER_STRETCHED, stats.stretched);
+    telemetry_count(TELEMETRY_JITTER_RESYNCS, stats.resyncs);
+    telemetry_count(TELEMETRY_JITTER_REDUNDANT, stats.redundant);
+    telemetry_peak(TELEMETRY_JITTER_DEPTH, depth);
+    telemetry_peak(TELEMETRY_JITTER_TARGET, target);
+    telemetry_peak(TELEMETRY_JITTER_US, (uint32_t)jitter_us);
+    telemetry_peak(TELEMETRY_JITTER_LATENCY_MAX_US, (uint32_t)stats.latency_max);
+  }
+
+  if (espnow_parity_seen) {
+    fec_stats_t stats = espnow_fec_dec->stats;
+    telemetry_count(TELEMETRY_FEC_RECOVERED,
+                    espnow_fec_delta(stats.recovered,
+                                     espnow_fec_reported.recovered));
+    telemetry_count(TELEMETRY_FEC_UNRECOVERABLE,
+                    espnow_fec_delta(stats.unrecoverable,
+                                     espnow_fec_reported.unrecoverable));
+    espnow_fec_reported = stats;
+  }
+}
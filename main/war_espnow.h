@@ -5,6 +5,17 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/ringbuf.h"
+#include "war_codec.h"
+#include "war_config.h"
+#include "war_drift.h"
+#include "war_fec.h"
+#include "war_integrity.h"
+#include "war_jitter.h"
+#include "war_latency.h"
+#include "war_layout.h"
+#include "war_plc.h"
+#include "war_redundant.h"
+#include "war_telemetry.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -12,12 +23,69 @@ extern "C" {
 
 #define ESPNOW_QUEUE_SIZE           12
 #define ESPNOW_DATA_QUEUE_SIZE      5
+/* Every receive event in espnow_queue holds a slot, plus the one
+ * espnow_task() is working on. */
+#define ESPNOW_RECV_SLOTS           (ESPNOW_QUEUE_SIZE + 1)
+
+#define ESPNOW_MAX_WINDOW           4
+#define ESPNOW_MAX_COPIES           3
+#define ESPNOW_MAX_SPACING          2
+/* On top of the queue: one packet being filled by the mixer, one being
+ * scheduled, the ones in flight and the ones still waiting for a spaced
+ * copy to go out. */
+#define ESPNOW_PACKET_POOL_SIZE \
+    (ESPNOW_DATA_QUEUE_SIZE + 2 + ESPNOW_MAX_WINDOW + (ESPNOW_MAX_COPIES - 1) * ESPNOW_MAX_SPACING)
+
+/* Packets cover a whole number of 125 us steps, so at rates that are a
+ * multiple of 8 kHz the packet period is a whole number of microseconds.
+ * A packet carries espnow_stream_t::frames frames of ESPNOW_CHANNELS
+ * samples each, see war_layout.h; the sample rate and frame count are
+ * picked at runtime with espnow_set_stream(), and everything sized from
+ * them is sized once for ESPNOW_MAX_SAMPLES, the most an ESP-NOW frame
+ * holds next to the parity header with any codec (CODEC_MAX_BYTES() is one
+ * byte over raw samples).
+ * The ESPNOW_DEFAULT_* stream comes from SAMPLERATE and MS_PER_PACKET.
+ * ESPNOW_AGGREGATE grows it to ESPNOW_MAX_SAMPLES, or to what still leaves
+ * room for the redundant copy when ESPNOW_REDUNDANT is set. */
+#define ESPNOW_HEADER_LEN   6
+#define ESPNOW_TRAILER_LEN  2
+#define ESPNOW_OVERHEAD     (ESPNOW_HEADER_LEN + ESPNOW_TRAILER_LEN)
+#define ESPNOW_GRANULE(rate) ((rate) / 8000)
+#define ESPNOW_CHANNELS     LAYOUT_CHANNELS(ESPNOW_LAYOUT)
+#define ESPNOW_MAX_SAMPLES \
+    ((ESP_NOW_MAX_DATA_LEN - ESPNOW_OVERHEAD - sizeof(fec_header_t) - 1) / sizeof(int16_t))
+#define ESPNOW_MAX_SEND_LEN (ESPNOW_MAX_SAMPLES * sizeof(int16_t))
+#define ESPNOW_MAX_PAYLOAD CODEC_MAX_BYTES(ESPNOW_MAX_SAMPLES)
+#define ESPNOW_MAX_REDUNDANT_LEN REDUNDANT_LEN(ESPNOW_MAX_SAMPLES)
+#define ESPNOW_MAX_PARITY_LEN (ESPNOW_OVERHEAD + sizeof(fec_header_t) + ESPNOW_MAX_PAYLOAD)
+
+#if ESPNOW_AGGREGATE
+#if ESPNOW_REDUNDANT
+#define ESPNOW_DEFAULT_MAX_SAMPLES ((ESP_NOW_MAX_DATA_LEN - ESPNOW_OVERHEAD - 1) * 2 / 5)
+#else
+#define ESPNOW_DEFAULT_MAX_SAMPLES ESPNOW_MAX_SAMPLES
+#endif
+#define ESPNOW_DEFAULT_FRAMES \
+    (ESPNOW_DEFAULT_MAX_SAMPLES / ESPNOW_CHANNELS / ESPNOW_GRANULE(SAMPLERATE) * ESPNOW_GRANULE(SAMPLERATE))
+#else
+#define ESPNOW_DEFAULT_FRAMES (SAMPLERATE / 1000 * MS_PER_PACKET)
+#endif
+#define ESPNOW_DEFAULT_SAMPLES (ESPNOW_DEFAULT_FRAMES * ESPNOW_CHANNELS)
+#define ESPNOW_DEFAULT_PACKET_US ((uint32_t)(ESPNOW_DEFAULT_FRAMES * 1000000ULL / SAMPLERATE))
+#define ESPNOW_DEFAULT_SEND_LEN (ESPNOW_DEFAULT_SAMPLES * sizeof(int16_t))
+
+/* Senders announce their stream in a packet of its own on the first audio
+ * packet and every ESPNOW_STREAM_EVERY after, so a receiver that misses one
+ * or joins late follows within that many packets. */
+#define ESPNOW_STREAM_EVERY     100
+#define ESPNOW_STREAM_VERSION   1
 
 #define IS_BROADCAST_ADDR(addr) (memcmp(addr, broadcast_mac, ESP_NOW_ETH_ALEN) == 0)
 
 typedef enum {
     ESPNOW_SEND_CB,
     ESPNOW_RECV_CB,
+    ESPNOW_DATA_READY,
 } espnow_event_id_t;
 
 typedef struct {
@@ -27,7 +95,7 @@ typedef struct {
 
 typedef struct {
     uint8_t mac_addr[ESP_NOW_ETH_ALEN];
-    uint8_t *data;
+    uint8_t *data;                        //Receive slot, see espnow_recv_slot_release().
     int data_len;
 } espnow_event_recv_cb_t;
 
@@ -54,62 +122,156 @@ enum {
     ESPNOW_RBUF_ERROR
 };
 
-/* User defined field of ESPNOW data in this example. */
+enum {
+    ESPNOW_PACKET_AUDIO,
+    ESPNOW_PACKET_PARITY,
+    ESPNOW_PACKET_STREAM,
+    ESPNOW_PACKET_PING,                   //Receiver to sender, see war_latency.h.
+    ESPNOW_PACKET_PONG,
+};
+
+/* espnow_trailer_t::type. The top bits carry the integrity_mode_t the sender
+ * checked the packet with, so receivers check whatever they are sent;
+ * INTEGRITY_CRC16 is 0, as packets were before there was a choice. */
+#define ESPNOW_TYPE_MASK        0x3f
+#define ESPNOW_TYPE_INTEGRITY_SHIFT 6
+#define ESPNOW_TYPE(type)       ((type) & ESPNOW_TYPE_MASK)
+#define ESPNOW_TYPE_INTEGRITY(type) \
+    ((integrity_mode_t)((type) >> ESPNOW_TYPE_INTEGRITY_SHIFT))
+
+/* espnow_trailer_t::flags. The codec_id_t of the payload sits in
+ * bits 1-3 and its channel_layout_t in bits 4-6; parity packets carry the
+ * codec and layout of the packets they cover. ESPNOW_FLAG_TIMESTAMP puts
+ * the capture time, ESPNOW_TIMESTAMP_LEN bytes, after the redundant copy
+ * and ahead of the trailer. */
+#define ESPNOW_FLAG_REDUNDANT   0x01
+#define ESPNOW_FLAG_CODEC_SHIFT 1
+#define ESPNOW_FLAG_CODEC_MASK  0x0e
+#define ESPNOW_FLAG_CODEC(flags) \
+    ((codec_id_t)(((flags) & ESPNOW_FLAG_CODEC_MASK) >> ESPNOW_FLAG_CODEC_SHIFT))
+#define ESPNOW_FLAG_LAYOUT_SHIFT 4
+#define ESPNOW_FLAG_LAYOUT_MASK 0x70
+#define ESPNOW_FLAG_LAYOUT(flags) \
+    ((channel_layout_t)(((flags) & ESPNOW_FLAG_LAYOUT_MASK) >> ESPNOW_FLAG_LAYOUT_SHIFT))
+#define ESPNOW_FLAG_TIMESTAMP   0x80
+#define ESPNOW_TIMESTAMP_LEN    sizeof(uint32_t)
+
+/* User defined field of ESPNOW data in this example. The header is the one
+ * packets have always had, so receivers that predate packet types still
+ * find the primary payload right after it and play ESPNOW_SEND_LEN bytes
+ * of it; the packet type and flags go in an espnow_trailer_t in the last
+ * ESPNOW_TRAILER_LEN bytes, past anything they read. An audio packet is
+ *
+ *   header | primary payload | redundant copy | timestamp | trailer
+ *
+ * with the copy and the timestamp there when their flags say so. The check
+ * of every other packet type is sent inverted, so those receivers drop
+ * them as damaged instead of playing them. */
 typedef struct {
-    uint32_t seq_num;                     //Sequence number of ESPNOW data.
-    uint16_t crc;                         //CRC16 value of ESPNOW data.
+    uint32_t seq_num;                     //Sequence number of ESPNOW data, first packet of the group for parity.
+    uint16_t crc;                         //Check of the packet, see ESPNOW_TYPE_INTEGRITY.
     uint8_t payload[0];                   //Real payload of ESPNOW data.
 } __attribute__((packed)) espnow_data_t;
 
+typedef struct {
+    uint8_t type;                         //ESPNOW_PACKET_* and integrity mode.
+    uint8_t flags;                        //ESPNOW_FLAG_* bits.
+} __attribute__((packed)) espnow_trailer_t;
+
+/* Trailer of a packet of len bytes. */
+#define ESPNOW_TRAILER(data, len) \
+    ((const espnow_trailer_t*)((const uint8_t*)(data) + (len) - ESPNOW_TRAILER_LEN))
+
+/* Payload of an ESPNOW_PACKET_STREAM packet. */
+typedef struct {
+    uint8_t version;                      //ESPNOW_STREAM_VERSION.
+    uint8_t channels;
+    uint16_t frames;                      //Per packet.
+    uint32_t samplerate;
+} __attribute__((packed)) espnow_stream_header_t;
+
+/* The stream, and the sizes that follow from it for this build's
+ * ESPNOW_CHANNELS. */
+typedef struct {
+    uint32_t samplerate;
+    uint16_t frames;
+    uint16_t samples;
+    uint16_t send_len;                    //Decoded frame in bytes.
+    uint16_t payload_max;                 //Longest encoded payload.
+    uint16_t redundant_len;
+    uint16_t parity_len;                  //Longest parity packet.
+    uint32_t packet_us;
+} espnow_stream_t;
+
+/* Called from espnow_task() once a receiver has switched to a new stream. */
+typedef void (*espnow_stream_cb_t)(const espnow_stream_t* stream);
+
 /* Parameters of sending ESPNOW data. */
 typedef struct {
     uint8_t state;                        //Indicate that if has received broadcast ESPNOW data or not.
-    bool resend_scheduled;
     int len;                              //Length of ESPNOW data to be sent, unit: byte.
-    uint8_t *buffer;                      //Buffer pointing to ESPNOW data.
+    uint8_t *buffer;                      //Newest audio packet scheduled.
     uint8_t dest_mac[ESP_NOW_ETH_ALEN];   //MAC address of destination device.
 } espnow_send_param_t;
 
+/*
+ * The sender hands up to `window` packets to esp_now_send() before the
+ * first send callback comes back, so the radio has the next frame queued
+ * while the task is still handling the last callback. Every audio packet is
+ * sent `copies` times; with `spacing` 0 the copies go back to back, else
+ * each copy goes out `spacing` packets after the previous one, so a burst
+ * has to be that much longer to take out all of them.
+ */
 typedef struct {
-    int64_t time;
-    int32_t interval;
-
-    int64_t last_micro;
-    int64_t micro_accum;
-    int32_t micro_count; 
-
-    uint32_t rx_byte_count;
-    uint32_t tx_byte_count;
-
-    uint32_t total_packet_count;
-    uint32_t missed_packet_count;
-
-    uint32_t ringbuffer_accum;
-    uint32_t ringbuffer_count;
-
-    uint32_t missed_audio_cb;
-
-    int64_t packet_sent;
-    uint32_t packet_accum;
-    uint32_t packet_count; 
-} espnow_debug_t;
+    uint8_t window;
+    uint8_t copies;
+    uint8_t spacing;
+} espnow_sender_config_t;
 
 extern xQueueHandle espnow_queue;
 extern xQueueHandle espnow_data_queue;
-extern espnow_debug_t debug;
+extern xQueueHandle espnow_free_queue;
+extern xQueueHandle espnow_recv_free_queue;
 
 esp_err_t espnow_init(bool receiver);
 void espnow_deinit(espnow_send_param_t* send_param);
 void espnow_set_rbuf(RingbufHandle_t rbuf, size_t len);
 void espnow_set_rbuf_state(uint8_t state);
+void espnow_set_jitter_buffer(jitter_buffer_t* jb);
+jitter_status_t espnow_jitter_pop(uint8_t* out);
+void espnow_set_plc(plc_t* plc);
+void espnow_set_drift(drift_t* drift);
+void espnow_set_latency(latency_t* lat);
+void espnow_set_timestamps(bool enable);
+void espnow_jitter_level(uint32_t* depth, uint16_t* target);
+void espnow_set_fec(const fec_config_t* config);
+void espnow_set_redundancy(bool enable);
+void espnow_set_codec(codec_id_t codec);
+void espnow_set_integrity(integrity_mode_t mode);
+void espnow_set_sender(const espnow_sender_config_t* config);
+bool espnow_set_stream(uint32_t samplerate, uint16_t frames);
+void espnow_set_stream_cb(espnow_stream_cb_t cb);
+/* The stream as espnow_task() sees it. Other tasks of a receiver, whose
+ * stream follows the sender's, take a copy with espnow_copy_stream(). */
+const espnow_stream_t* espnow_get_stream();
+void espnow_copy_stream(espnow_stream_t* stream);
 void espnow_send_cb(const uint8_t *mac_addr, esp_now_send_status_t status);
 void espnow_recv_cb(const uint8_t *mac_addr, const uint8_t *data, int len);
-espnow_data_t* espnow_data_parse(uint8_t* data, uint16_t data_len, uint8_t* state, uint32_t* seq, int* magic);
-void espnow_data_prepare(espnow_send_param_t* param);
+const espnow_data_t* espnow_data_parse(const uint8_t* data, uint16_t data_len, uint8_t* state, uint32_t* seq, int* magic);
+uint16_t espnow_data_seal(espnow_data_t* buf, uint16_t len, uint8_t type, uint8_t flags);
+bool espnow_data_prepare(espnow_send_param_t* param, TickType_t ticks_to_wait);
+espnow_data_t* espnow_packet_acquire(TickType_t ticks_to_wait);
+/* captured is when the packet's newest frame was sampled, on the
+ * esp_timer_get_time() clock; see TELEMETRY_CAPTURE_US. layout is the
+ * channel_layout_t of the payload. */
+BaseType_t espnow_packet_commit(espnow_data_t* packet, int64_t captured, channel_layout_t layout);
+void espnow_packet_release(espnow_data_t* packet);
+void espnow_recv_slot_release(uint8_t* slot);
 void espnow_task();
 void espnow_tick();
-void espnow_send();
-void espnow_print_debug();
+void espnow_pump();
+// A telemetry_collect_t for telemetry_start().
+void espnow_telemetry_collect();
 
 #ifdef __cplusplus
 }
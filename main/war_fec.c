@@ -0,0 +1,329 @@
+#include "war_fec.h"
+#include "assert.h"
+#include <string.h>
+
+#define FEC_HISTORY_MASK    (FEC_HISTORY - 1)
+#define FEC_GF_POLY         0x11d
+// Cauchy points: x_j = FEC_CAUCHY_X + j for parity rows, y_i = i for data.
+#define FEC_CAUCHY_X        FEC_MAX_K
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+static bool gf_ready;
+
+static void gf_init(void)
+{
+    if (gf_ready)
+        return;
+    unsigned x = 1;
+    for (int i = 0; i < 255; i++)
+    {
+        gf_exp[i] = (uint8_t)x;
+        gf_log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100)
+            x ^= FEC_GF_POLY;
+    }
+    for (int i = 255; i < 512; i++)
+        gf_exp[i] = gf_exp[i - 255];
+    gf_ready = true;
+}
+
+static uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    if (!a || !b)
+        return 0;
+    return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+static uint8_t gf_inv(uint8_t a)
+{
+    return gf_exp[255 - gf_log[a]];
+}
+
+// dst ^= c * src
+static void gf_mul_add(uint8_t* dst, const uint8_t* src, uint8_t c, size_t len)
+{
+    if (c == 0)
+        return;
+    if (c == 1)
+    {
+        for (size_t i = 0; i < len; i++)
+            dst[i] ^= src[i];
+        return;
+    }
+    const uint8_t* exp = gf_exp + gf_log[c];
+    for (size_t i = 0; i < len; i++)
+    {
+        if (src[i])
+            dst[i] ^= exp[gf_log[src[i]]];
+    }
+}
+
+static uint8_t fec_coef(uint8_t scheme, uint8_t row, uint8_t col)
+{
+    if (scheme == FEC_XOR)
+        return 1;
+    return gf_inv((uint8_t)((FEC_CAUCHY_X + row) ^ col));
+}
+
+// In-place Gauss-Jordan inversion of an n x n matrix over GF(256).
+static bool gf_invert(uint8_t a[FEC_MAX_M][FEC_MAX_M], int n)
+{
+    uint8_t inv[FEC_MAX_M][FEC_MAX_M] = {0};
+    for (int i = 0; i < n; i++)
+        inv[i][i] = 1;
+
+    for (int col = 0; col < n; col++)
+    {
+        int pivot = col;
+        while (pivot < n && !a[pivot][col])
+            pivot++;
+        if (pivot == n)
+            return false;
+        if (pivot != col)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                uint8_t t = a[col][j]; a[col][j] = a[pivot][j]; a[pivot][j] = t;
+                t = inv[col][j]; inv[col][j] = inv[pivot][j]; inv[pivot][j] = t;
+            }
+        }
+        uint8_t scale = gf_inv(a[col][col]);
+        for (int j = 0; j < n; j++)
+        {
+            a[col][j] = gf_mul(a[col][j], scale);
+            inv[col][j] = gf_mul(inv[col][j], scale);
+        }
+        for (int row = 0; row < n; row++)
+        {
+            uint8_t f = a[row][col];
+            if (row == col || !f)
+                continue;
+            for (int j = 0; j < n; j++)
+            {
+                a[row][j] ^= gf_mul(f, a[col][j]);
+                inv[row][j] ^= gf_mul(f, inv[col][j]);
+            }
+        }
+    }
+    memcpy(a, inv, sizeof(inv));
+    return true;
+}
+
+bool fec_config_valid(const fec_config_t* config)
+{
+    switch (config->scheme)
+    {
+    case FEC_NONE:
+        return true;
+    case FEC_XOR:
+        return config->k >= 1 && config->k <= FEC_MAX_K && config->m == 1;
+    case FEC_RS:
+        return config->k >= 1 && config->k <= FEC_MAX_K &&
+            config->m >= 1 && config->m <= FEC_MAX_M;
+    }
+    return false;
+}
+
+void fec_encoder_init(fec_encoder_t* enc, const fec_config_t* config, size_t payload_len)
+{
+    assert(enc && config && fec_config_valid(config));
+    assert(payload_len <= FEC_MAX_PAYLOAD);
+    gf_init();
+
+    memset(enc, 0, sizeof(fec_encoder_t));
+    enc->config = *config;
+    enc->payload_len = payload_len;
+}
+
+bool fec_encoder_add(fec_encoder_t* enc, uint32_t seq, const uint8_t* payload, size_t len)
+{
+    assert(len <= enc->payload_len);
+    if (enc->config.scheme == FEC_NONE)
+        return false;
+
+    uint8_t k = enc->config.k;
+    uint8_t index = seq % k;
+    uint32_t base = seq - index;
+    if (enc->count == 0 || base != enc->base_seq)
+    {
+        // A group that was joined late never completes, so it never sends
+        // parity; start over cleanly at this one.
+        enc->base_seq = base;
+        enc->count = 0;
+        enc->parity_len = 0;
+        memset(enc->parity, 0, sizeof(enc->parity));
+    }
+
+    for (uint8_t j = 0; j < enc->config.m; j++)
+        gf_mul_add(enc->parity[j], payload, fec_coef(enc->config.scheme, j, index), len);
+    if (len > enc->parity_len)
+        enc->parity_len = len;
+    enc->count++;
+    return index == k - 1 && enc->count == k;
+}
+
+const uint8_t* fec_encoder_parity(const fec_encoder_t* enc, uint8_t index)
+{
+    assert(index < enc->config.m);
+    return enc->parity[index];
+}
+
+size_t fec_encoder_parity_len(const fec_encoder_t* enc)
+{
+    return enc->parity_len;
+}
+
+uint32_t fec_encoder_base_seq(const fec_encoder_t* enc)
+{
+    return enc->base_seq;
+}
+
+void fec_decoder_init(fec_decoder_t* dec, size_t payload_len)
+{
+    assert(dec && payload_len <= FEC_MAX_PAYLOAD);
+    gf_init();
+
+    memset(dec, 0, sizeof(fec_decoder_t));
+    dec->payload_len = payload_len;
+}
+
+void fec_decoder_add_data(fec_decoder_t* dec, uint32_t seq, const uint8_t* payload, size_t len)
+{
+    assert(len <= dec->payload_len);
+    uint32_t slot = seq & FEC_HISTORY_MASK;
+    memcpy(dec->data[slot], payload, len);
+    memset(dec->data[slot] + len, 0, dec->payload_len - len);
+    dec->seq[slot] = seq;
+    dec->present[slot] = true;
+    dec->stats.received++;
+}
+
+const uint8_t* fec_decoder_payload(const fec_decoder_t* dec, uint32_t seq)
+{
+    uint32_t slot = seq & FEC_HISTORY_MASK;
+    if (!dec->present[slot] || dec->seq[slot] != seq)
+        return NULL;
+    return dec->data[slot];
+}
+
+static bool fec_header_valid(const fec_header_t* header)
+{
+    fec_config_t config = {
+        .scheme = (fec_scheme_t)header->scheme,
+        .k = header->k,
+        .m = header->m,
+    };
+    return config.scheme != FEC_NONE && fec_config_valid(&config) &&
+        header->index < header->m;
+}
+
+static fec_parity_group_t* fec_find_group(fec_decoder_t* dec, uint32_t base_seq,
+    const fec_header_t* header)
+{
+    for (int i = 0; i < FEC_PARITY_GROUPS; i++)
+    {
+        fec_parity_group_t* g = &dec->groups[i];
+        if (g->mask && g->base_seq == base_seq && g->header.scheme == header->scheme &&
+            g->header.k == header->k && g->header.m == header->m)
+            return g;
+    }
+    fec_parity_group_t* g = &dec->groups[dec->next_group];
+    dec->next_group = (dec->next_group + 1) % FEC_PARITY_GROUPS;
+    g->base_seq = base_seq;
+    g->header = *header;
+    g->mask = 0;
+    g->done = false;
+    return g;
+}
+
+int fec_decoder_add_parity(fec_decoder_t* dec, uint32_t base_seq, const fec_header_t* header,
+    const uint8_t* parity, size_t len, uint32_t* recovered)
+{
+    if (!fec_header_valid(header) || len > dec->payload_len)
+        return 0;
+
+    fec_parity_group_t* g = fec_find_group(dec, base_seq, header);
+    if (g->done)
+        return 0;
+    memcpy(g->parity[header->index], parity, len);
+    memset(g->parity[header->index] + len, 0, dec->payload_len - len);
+    g->mask |= 1 << header->index;
+
+    uint8_t missing[FEC_MAX_K];
+    int lost = 0;
+    for (uint8_t i = 0; i < header->k; i++)
+    {
+        uint32_t seq = base_seq + i;
+        if (fec_decoder_payload(dec, seq))
+            continue;
+        uint32_t slot = seq & FEC_HISTORY_MASK;
+        if (dec->present[slot] && (int32_t)(dec->seq[slot] - seq) > 0)
+        {
+            // The group has already been pushed out of the history.
+            g->done = true;
+            return 0;
+        }
+        missing[lost++] = i;
+    }
+
+    int have = __builtin_popcount(g->mask);
+    if (lost == 0 || lost > have)
+    {
+        if (lost == 0 || have == header->m)
+        {
+            dec->stats.unrecoverable += lost;
+            g->done = true;
+        }
+        return 0;
+    }
+
+    // Use the first `lost` parity rows that arrived. Any square submatrix
+    // of a Cauchy matrix is invertible, so which ones doesn't matter.
+    uint8_t rows[FEC_MAX_M];
+    for (int j = 0, r = 0; r < lost; j++)
+    {
+        if (g->mask & (1 << j))
+            rows[r++] = j;
+    }
+
+    uint8_t a[FEC_MAX_M][FEC_MAX_M];
+    for (int r = 0; r < lost; r++)
+    {
+        for (int c = 0; c < lost; c++)
+            a[r][c] = fec_coef(header->scheme, rows[r], missing[c]);
+
+        // Strip the packets we do have out of the parity, leaving a
+        // combination of the lost ones only.
+        uint8_t* s = dec->syndrome[r];
+        memcpy(s, g->parity[rows[r]], dec->payload_len);
+        for (uint8_t i = 0, c = 0; i < header->k; i++)
+        {
+            if (c < lost && missing[c] == i)
+            {
+                c++;
+                continue;
+            }
+            gf_mul_add(s, fec_decoder_payload(dec, base_seq + i),
+                fec_coef(header->scheme, rows[r], i), dec->payload_len);
+        }
+    }
+    if (!gf_invert(a, lost))
+        return 0;
+
+    for (int c = 0; c < lost; c++)
+    {
+        uint32_t seq = base_seq + missing[c];
+        uint32_t slot = seq & FEC_HISTORY_MASK;
+        memset(dec->data[slot], 0, dec->payload_len);
+        for (int r = 0; r < lost; r++)
+            gf_mul_add(dec->data[slot], dec->syndrome[r], a[c][r], dec->payload_len);
+        dec->seq[slot] = seq;
+        dec->present[slot] = true;
+        recovered[c] = seq;
+    }
+    dec->stats.recovered += lost;
+    g->done = true;
+    return lost;
+}
@@ -0,0 +1,119 @@
+#ifndef __WAR_FEC_H__
+#define __WAR_FEC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Packet-level forward error correction. Audio packets are grouped by
+ * sequence number into groups of k (a group starts at seq % k == 0) and m
+ * parity packets are sent after each group:
+ *
+ *  FEC_XOR  m = 1, parity is the XOR of the k payloads
+ *  FEC_RS   m parity packets from a Cauchy Reed-Solomon code over GF(256);
+ *           any m losses in the group are recoverable
+ *
+ * Overhead is m/k extra packets, and a lost packet is rebuilt once the
+ * group's parity has arrived, i.e. up to k + m packet times later.
+ * Payloads may be shorter than payload_len; they are coded as if padded
+ * with zeros, parity is as long as the longest payload of its group, and
+ * rebuilt payloads come back padded to payload_len.
+ */
+
+#define FEC_MAX_K           16
+#define FEC_MAX_M           4
+#define FEC_MAX_PAYLOAD     240
+#define FEC_HISTORY         32
+#define FEC_PARITY_GROUPS   2
+
+typedef enum {
+    FEC_NONE,
+    FEC_XOR,
+    FEC_RS,
+} fec_scheme_t;
+
+typedef struct {
+    fec_scheme_t scheme;
+    uint8_t k;
+    uint8_t m;
+} fec_config_t;
+
+/* Leads the payload of every parity packet. */
+typedef struct {
+    uint8_t scheme;
+    uint8_t k;
+    uint8_t m;
+    uint8_t index;
+} __attribute__((packed)) fec_header_t;
+
+typedef struct {
+    fec_config_t config;
+    size_t payload_len;
+    size_t parity_len;
+    uint32_t base_seq;
+    uint8_t count;
+    uint8_t parity[FEC_MAX_M][FEC_MAX_PAYLOAD];
+} fec_encoder_t;
+
+typedef struct {
+    uint32_t base_seq;
+    fec_header_t header;
+    uint8_t mask;
+    bool done;
+    uint8_t parity[FEC_MAX_M][FEC_MAX_PAYLOAD];
+} fec_parity_group_t;
+
+typedef struct {
+    uint32_t received;
+    uint32_t recovered;
+    uint32_t unrecoverable;
+} fec_stats_t;
+
+typedef struct {
+    size_t payload_len;
+    uint32_t seq[FEC_HISTORY];
+    bool present[FEC_HISTORY];
+    uint8_t data[FEC_HISTORY][FEC_MAX_PAYLOAD];
+    fec_parity_group_t groups[FEC_PARITY_GROUPS];
+    uint8_t next_group;
+    uint8_t syndrome[FEC_MAX_M][FEC_MAX_PAYLOAD];
+    fec_stats_t stats;
+} fec_decoder_t;
+
+bool fec_config_valid(const fec_config_t* config);
+
+void fec_encoder_init(fec_encoder_t* enc, const fec_config_t* config, size_t payload_len);
+
+// Adds an audio payload. Returns true when it completes a group and
+// fec_encoder_parity() holds the group's m parity payloads.
+bool fec_encoder_add(fec_encoder_t* enc, uint32_t seq, const uint8_t* payload, size_t len);
+
+const uint8_t* fec_encoder_parity(const fec_encoder_t* enc, uint8_t index);
+
+size_t fec_encoder_parity_len(const fec_encoder_t* enc);
+
+uint32_t fec_encoder_base_seq(const fec_encoder_t* enc);
+
+void fec_decoder_init(fec_decoder_t* dec, size_t payload_len);
+
+void fec_decoder_add_data(fec_decoder_t* dec, uint32_t seq, const uint8_t* payload, size_t len);
+
+// Adds a parity payload for the group starting at base_seq. Rebuilt packets
+// are stored in the decoder and their sequence numbers written to
+// recovered (room for FEC_MAX_M); returns how many there are.
+int fec_decoder_add_parity(fec_decoder_t* dec, uint32_t base_seq, const fec_header_t* header,
+    const uint8_t* parity, size_t len, uint32_t* recovered);
+
+// Payload of a packet the decoder holds (received or rebuilt), or NULL.
+const uint8_t* fec_decoder_payload(const fec_decoder_t* dec, uint32_t seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_FEC_H__
@@ -0,0 +1,124 @@
+#include "war_integrity.h"
+#include "assert.h"
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_crc.h"
+
+#define CRC32_POLY  0xedb88320
+
+static uint32_t crc32_table[8][256];
+static bool crc32_ready;
+
+static const char* const integrity_names[INTEGRITY_COUNT] = {
+    [INTEGRITY_CRC16] = "crc16",
+    [INTEGRITY_CRC32] = "crc32",
+    [INTEGRITY_HEADER] = "header",
+    [INTEGRITY_NONE] = "none",
+};
+
+/* Table t advances a byte through t more zero bytes, so eight lookups take
+ * the CRC across eight bytes at once. */
+void integrity_init(void)
+{
+    if (crc32_ready)
+        return;
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (int b = 0; b < 8; b++)
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLY : crc >> 1;
+        crc32_table[0][i] = crc;
+    }
+    for (int t = 1; t < 8; t++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            uint32_t prev = crc32_table[t - 1][i];
+            crc32_table[t][i] = (prev >> 8) ^ crc32_table[0][prev & 0xff];
+        }
+    }
+    crc32_ready = true;
+}
+
+static inline uint32_t crc32_byte(uint32_t crc, uint8_t b)
+{
+    return (crc >> 8) ^ crc32_table[0][(crc ^ b) & 0xff];
+}
+
+uint32_t integrity_crc32_bytewise(uint32_t crc, const uint8_t* buf, size_t len)
+{
+    if (!crc32_ready)
+        integrity_init();
+    crc = ~crc;
+    while (len--)
+        crc = crc32_byte(crc, *buf++);
+    return ~crc;
+}
+
+/* Words are loaded little-endian, which both the ESP32 and the host are,
+ * and aligned, which the ESP32 needs. */
+uint32_t integrity_crc32(uint32_t crc, const uint8_t* buf, size_t len)
+{
+    if (!crc32_ready)
+        integrity_init();
+    crc = ~crc;
+    for (; len > 0 && ((uintptr_t)buf & 3); len--)
+        crc = crc32_byte(crc, *buf++);
+    for (; len >= 8; len -= 8, buf += 8)
+    {
+        const uint8_t* p = __builtin_assume_aligned(buf, 4);
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = crc32_table[7][lo & 0xff] ^ crc32_table[6][(lo >> 8) & 0xff] ^
+              crc32_table[5][(lo >> 16) & 0xff] ^ crc32_table[4][lo >> 24] ^
+              crc32_table[3][hi & 0xff] ^ crc32_table[2][(hi >> 8) & 0xff] ^
+              crc32_table[1][(hi >> 16) & 0xff] ^ crc32_table[0][hi >> 24];
+    }
+    while (len--)
+        crc = crc32_byte(crc, *buf++);
+    return ~crc;
+}
+
+uint16_t integrity_check(integrity_mode_t mode, const uint8_t* packet, size_t len,
+    size_t field, size_t header_len, size_t trailer_len)
+{
+    static const uint8_t zero[2];
+    assert(field + sizeof(zero) <= header_len && header_len + trailer_len <= len);
+    const uint8_t* rest = packet + field + sizeof(zero);
+    switch (mode)
+    {
+    case INTEGRITY_HEADER:
+    {
+        uint16_t crc = esp_crc16_le(UINT16_MAX, packet, field);
+        crc = esp_crc16_le(crc, zero, sizeof(zero));
+        crc = esp_crc16_le(crc, rest, packet + header_len - rest);
+        return esp_crc16_le(crc, packet + len - trailer_len, trailer_len);
+    }
+    case INTEGRITY_CRC16:
+    {
+        uint16_t crc = esp_crc16_le(UINT16_MAX, packet, field);
+        crc = esp_crc16_le(crc, zero, sizeof(zero));
+        return esp_crc16_le(crc, rest, packet + len - rest);
+    }
+    case INTEGRITY_CRC32:
+    {
+        uint32_t crc = integrity_crc32(0, packet, field);
+        crc = integrity_crc32(crc, zero, sizeof(zero));
+        crc = integrity_crc32(crc, rest, packet + len - rest);
+        return (uint16_t)(crc ^ crc >> 16);
+    }
+    case INTEGRITY_NONE:
+        return 0;
+    default:
+        assert(false);
+        return 0;
+    }
+}
+
+const char* integrity_name(integrity_mode_t mode)
+{
+    return mode < INTEGRITY_COUNT ? integrity_names[mode] : "unknown";
+}
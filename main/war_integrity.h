@@ -0,0 +1,58 @@
+#ifndef __WAR_INTEGRITY_H__
+#define __WAR_INTEGRITY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Integrity checks for the 16-bit check field of a packet header. The
+ * 802.11 FCS already drops frames corrupted in the air, so the check only
+ * has to catch what gets past it, and how much of the packet it covers is
+ * a choice:
+ *
+ *  INTEGRITY_CRC16   CRC16 (ROM esp_crc16_le) over the whole packet, the
+ *                    original format
+ *  INTEGRITY_CRC32   CRC32 over the whole packet, eight bytes a step
+ *                    (slice-by-8), folded to 16 bits
+ *  INTEGRITY_HEADER  CRC16 over the header and trailer only: sequence,
+ *                    type and flags
+ *  INTEGRITY_NONE    nothing; the field is sent as zero
+ *
+ * Every mode computes the check as if the field itself were zero, without
+ * writing to the packet, so a received packet can be checked in place.
+ */
+
+typedef enum {
+    INTEGRITY_CRC16,
+    INTEGRITY_CRC32,
+    INTEGRITY_HEADER,
+    INTEGRITY_NONE,
+    INTEGRITY_COUNT,
+} integrity_mode_t;
+
+/* Builds the CRC32 tables; integrity_crc32() does it on first use, call it
+ * beforehand to keep that off the audio path. */
+void integrity_init(void);
+
+// Reflected CRC32 (IEEE 802.3), chainable: start and end with crc 0.
+uint32_t integrity_crc32(uint32_t crc, const uint8_t* buf, size_t len);
+// One table lookup per byte; same result, for comparison.
+uint32_t integrity_crc32_bytewise(uint32_t crc, const uint8_t* buf, size_t len);
+
+/* Check of a packet of len bytes, the first header_len of them header and
+ * the last trailer_len trailer, whose check field is the two bytes at
+ * field. */
+uint16_t integrity_check(integrity_mode_t mode, const uint8_t* packet, size_t len,
+    size_t field, size_t header_len, size_t trailer_len);
+
+const char* integrity_name(integrity_mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_INTEGRITY_H__
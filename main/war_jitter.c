@@ -0,0 +1,234 @@
+#include "war_jitter.h"
+#include "assert.h"
+#include <math.h>
+#include <string.h>
+
+#define JITTER_MASK (JITTER_SLOTS - 1)
+
+static uint8_t* jitter_slot(jitter_buffer_t* jb, uint32_t seq)
+{
+    return jb->storage + (seq & JITTER_MASK) * jb->payload_len;
+}
+
+static void jitter_update_target(jitter_buffer_t* jb)
+{
+    float depth = ceilf(jb->config.jitter_multiplier * jb->jitter_us /
+        (float)jb->config.packet_us) + 1.f;
+    if (depth < jb->config.min_depth)
+        depth = jb->config.min_depth;
+    if (depth > jb->config.max_depth)
+        depth = jb->config.max_depth;
+    jb->target_depth = (uint16_t)depth;
+}
+
+void jitter_init(jitter_buffer_t* jb, uint8_t* storage, size_t payload_len,
+    const jitter_config_t* config)
+{
+    assert(jb && storage && payload_len && config);
+    assert(config->packet_us > 0);
+    assert(config->min_depth >= 1 && config->min_depth <= config->max_depth);
+    assert(config->max_depth < JITTER_SLOTS);
+
+    memset(jb, 0, sizeof(jitter_buffer_t));
+    jb->config = *config;
+    jb->storage = storage;
+    jb->payload_len = payload_len;
+    jitter_reset(jb);
+}
+
+void jitter_reset(jitter_buffer_t* jb)
+{
+    memset(jb->present, 0, sizeof(jb->present));
+    memset(jb->heard, 0, sizeof(jb->heard));
+    jb->started = false;
+    jb->playing = false;
+    jb->drop_holdoff = 0;
+    jb->have_transit = false;
+    jb->jitter_us = 0.f;
+    jb->target_depth = jb->config.min_depth;
+}
+
+uint32_t jitter_depth(const jitter_buffer_t* jb)
+{
+    if (!jb->started || (int32_t)(jb->highest_seq - jb->play_seq) < 0)
+        return 0;
+    return jb->highest_seq - jb->play_seq + 1;
+}
+
+static void jitter_store(jitter_buffer_t* jb, uint32_t seq, const uint8_t* payload,
+    int64_t now_us, bool degraded)
+{
+    uint32_t slot = seq & JITTER_MASK;
+    memcpy(jitter_slot(jb, seq), payload, jb->payload_len);
+    jb->slot_seq[slot] = seq;
+    jb->arrival[slot] = now_us;
+    jb->present[slot] = true;
+    jb->degraded[slot] = degraded;
+    jb->heard[slot] = !degraded;
+}
+
+jitter_push_t jitter_push(jitter_buffer_t* jb, uint32_t seq, const uint8_t* payload,
+    int64_t now_us)
+{
+    jb->stats.pushed++;
+
+    if (!jb->started)
+    {
+        jb->started = true;
+        jb->play_seq = seq;
+        jb->highest_seq = seq;
+    }
+
+    int32_t ahead = (int32_t)(seq - jb->play_seq);
+    jitter_push_t result = JITTER_PUSH_OK;
+    if (ahead >= JITTER_SLOTS || ahead <= -JITTER_SLOTS)
+    {
+        // Too far from what we have to keep it (sender restart or a long
+        // outage): start over from this packet. The transit time jumps
+        // with the sequence, so the jitter estimate starts over too.
+        memset(jb->present, 0, sizeof(jb->present));
+        memset(jb->heard, 0, sizeof(jb->heard));
+        jb->play_seq = seq;
+        jb->highest_seq = seq;
+        jb->playing = false;
+        jb->have_transit = false;
+        jb->jitter_us = 0.f;
+        jb->stats.resyncs++;
+        result = JITTER_PUSH_RESYNC;
+        ahead = 0;
+    }
+
+    // RFC 3550 interarrival jitter against the sender's nominal packet
+    // clock, from first arrivals only: a copy sent some packets after the
+    // original would count its spacing as delay.
+    uint32_t slot = seq & JITTER_MASK;
+    bool repeat = jb->heard[slot] && jb->slot_seq[slot] == seq;
+    if (!repeat)
+    {
+        int64_t transit = now_us - (int64_t)seq * jb->config.packet_us;
+        if (jb->have_transit)
+        {
+            float d = fabsf((float)(transit - jb->last_transit));
+            jb->jitter_us += (d - jb->jitter_us) / 16.f;
+        }
+        jb->last_transit = transit;
+        jb->have_transit = true;
+        jitter_update_target(jb);
+    }
+
+    // A copy of a packet already stored or already played.
+    if (repeat && (ahead < 0 || jb->present[slot]))
+    {
+        jb->stats.duplicate++;
+        return JITTER_PUSH_DUPLICATE;
+    }
+
+    if (ahead < 0)
+    {
+        // Remember a late packet too, so its copies are known as such,
+        // unless its slot already holds a newer one.
+        if (!jb->present[slot])
+        {
+            jb->slot_seq[slot] = seq;
+            jb->degraded[slot] = false;
+            jb->heard[slot] = true;
+        }
+        jb->stats.late++;
+        return JITTER_PUSH_LATE;
+    }
+
+    jitter_store(jb, seq, payload, now_us, false);
+    if ((int32_t)(seq - jb->highest_seq) > 0)
+        jb->highest_seq = seq;
+
+    return result;
+}
+
+jitter_push_t jitter_push_redundant(jitter_buffer_t* jb, uint32_t seq, const uint8_t* payload,
+    int64_t now_us)
+{
+    int32_t ahead = (int32_t)(seq - jb->play_seq);
+    if (!jb->started || ahead < 0 || (int32_t)(seq - jb->highest_seq) > 0)
+        return JITTER_PUSH_LATE;
+
+    uint32_t slot = seq & JITTER_MASK;
+    if (jb->present[slot] && jb->slot_seq[slot] == seq)
+        return JITTER_PUSH_DUPLICATE;
+
+    jitter_store(jb, seq, payload, now_us, true);
+    return JITTER_PUSH_OK;
+}
+
+jitter_status_t jitter_pop(jitter_buffer_t* jb, uint8_t* out, int64_t now_us)
+{
+    uint32_t depth = jitter_depth(jb);
+
+    if (!jb->playing)
+    {
+        if (depth < jb->target_depth)
+        {
+            memset(out, 0, jb->payload_len);
+            return JITTER_BUFFERING;
+        }
+        jb->playing = true;
+        jb->drop_holdoff = JITTER_DROP_HOLDOFF;
+    }
+
+    if (depth == 0)
+    {
+        jb->playing = false;
+        jb->stats.underruns++;
+        memset(out, 0, jb->payload_len);
+        return JITTER_UNDERRUN;
+    }
+
+    // Move the playout point one packet at a time towards the target:
+    // hold back when jitter has grown, shed latency once it calms down.
+    if (jb->drop_holdoff)
+        jb->drop_holdoff--;
+    if (!jb->drop_holdoff && depth + 1 < jb->target_depth)
+    {
+        jb->stats.stretched++;
+        jb->drop_holdoff = JITTER_DROP_HOLDOFF;
+        memset(out, 0, jb->payload_len);
+        return JITTER_BUFFERING;
+    }
+    if (!jb->drop_holdoff && depth > jb->target_depth + JITTER_DROP_HYSTERESIS)
+    {
+        uint32_t slot = jb->play_seq & JITTER_MASK;
+        jb->present[slot] = false;
+        jb->play_seq++;
+        jb->stats.dropped++;
+        jb->drop_holdoff = JITTER_DROP_HOLDOFF;
+    }
+
+    uint32_t slot = jb->play_seq & JITTER_MASK;
+    jitter_status_t status;
+    if (jb->present[slot] && jb->slot_seq[slot] == jb->play_seq)
+    {
+        memcpy(out, jitter_slot(jb, jb->play_seq), jb->payload_len);
+        int64_t latency = now_us - jb->arrival[slot];
+        jb->stats.latency_accum += latency;
+        jb->stats.latency_count++;
+        if (latency > jb->stats.latency_max)
+            jb->stats.latency_max = latency;
+        jb->stats.played++;
+        if (jb->degraded[slot])
+            jb->stats.redundant++;
+        status = JITTER_OK;
+    }
+    else
+    {
+        memset(out, 0, jb->payload_len);
+        jb->stats.lost++;
+        status = JITTER_LOST;
+    }
+    jb->present[slot] = false;
+    jb->play_seq++;
+    return status;
+}
+
+void jitter_stats_reset(jitter_buffer_t* jb)
+{
+    memset(&jb->stats, 0, sizeof(jitter_stats_t));
+}
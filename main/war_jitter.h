@@ -0,0 +1,128 @@
+#ifndef __WAR_JITTER_H__
+#define __WAR_JITTER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Receive-side jitter buffer keyed by espnow_data_t::seq_num. Packets are
+ * stored in the slot for their sequence number, so late arrivals are put
+ * back in order as long as they turn up before their playout time. The
+ * target depth follows the RFC 3550 interarrival jitter estimate, so a
+ * quiet link plays out with little delay and a noisy one buffers more.
+ *
+ * A degraded copy of a packet (the redundant payload of the next one) can
+ * fill a slot ahead of time; the real packet still replaces it if it turns
+ * up before playout.
+ *
+ * Only the first arrival of a sequence number feeds the jitter estimate:
+ * repeat copies, however far they are spaced, are not delay.
+ *
+ * A packet JITTER_SLOTS or more sequence numbers from the playout point,
+ * either way, starts the buffer over from that packet (a resync): a long
+ * outage, or the sender restarting its count from 0.
+ *
+ * The buffer holds no lock; callers pushing and popping from different
+ * tasks must serialise access (espnow_jitter_pop() does).
+ */
+
+#define JITTER_SLOTS            32
+#define JITTER_DROP_HYSTERESIS  2
+#define JITTER_DROP_HOLDOFF     50
+
+typedef enum {
+    JITTER_OK,
+    JITTER_BUFFERING,
+    JITTER_LOST,
+    JITTER_UNDERRUN,
+} jitter_status_t;
+
+typedef enum {
+    JITTER_PUSH_OK,
+    JITTER_PUSH_LATE,
+    JITTER_PUSH_DUPLICATE,
+    JITTER_PUSH_RESYNC,
+} jitter_push_t;
+
+typedef struct {
+    uint32_t packet_us;
+    uint16_t min_depth;
+    uint16_t max_depth;
+    float jitter_multiplier;
+} jitter_config_t;
+
+typedef struct {
+    uint32_t pushed;
+    uint32_t played;
+    uint32_t late;
+    uint32_t duplicate;
+    uint32_t lost;
+    uint32_t underruns;
+    uint32_t dropped;
+    uint32_t stretched;
+    uint32_t resyncs;
+    uint32_t redundant;
+
+    int64_t latency_accum;
+    uint32_t latency_count;
+    int64_t latency_max;
+} jitter_stats_t;
+
+typedef struct {
+    jitter_config_t config;
+    uint8_t* storage;
+    size_t payload_len;
+
+    uint32_t slot_seq[JITTER_SLOTS];
+    int64_t arrival[JITTER_SLOTS];
+    bool present[JITTER_SLOTS];
+    bool degraded[JITTER_SLOTS];
+    // slot_seq's own packet has arrived, played or not.
+    bool heard[JITTER_SLOTS];
+
+    bool started;
+    bool playing;
+    uint32_t play_seq;
+    uint32_t highest_seq;
+    uint32_t drop_holdoff;
+
+    bool have_transit;
+    int64_t last_transit;
+    float jitter_us;
+    uint16_t target_depth;
+
+    jitter_stats_t stats;
+} jitter_buffer_t;
+
+// storage must hold JITTER_SLOTS * payload_len bytes.
+void jitter_init(jitter_buffer_t* jb, uint8_t* storage, size_t payload_len,
+    const jitter_config_t* config);
+
+void jitter_reset(jitter_buffer_t* jb);
+
+jitter_push_t jitter_push(jitter_buffer_t* jb, uint32_t seq, const uint8_t* payload,
+    int64_t now_us);
+
+// Stores a degraded copy of seq if the slot is still empty. Does not feed
+// the jitter estimate.
+jitter_push_t jitter_push_redundant(jitter_buffer_t* jb, uint32_t seq, const uint8_t* payload,
+    int64_t now_us);
+
+// Writes payload_len bytes to out; silence unless JITTER_OK is returned.
+jitter_status_t jitter_pop(jitter_buffer_t* jb, uint8_t* out, int64_t now_us);
+
+// Packets spanned from the next one to play to the newest one received.
+uint32_t jitter_depth(const jitter_buffer_t* jb);
+
+void jitter_stats_reset(jitter_buffer_t* jb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_JITTER_H__
@@ -0,0 +1,332 @@
+#include "war_kernels.h"
+#include <string.h>
+
+#ifndef KERN_VARIANT
+#if defined(__XTENSA__)
+#define KERN_VARIANT unrolled
+#else
+#define KERN_VARIANT autovec
+#endif
+#endif
+
+#define KERN_JOIN(name, variant) name##_##variant
+#define KERN_PICK(name, variant) KERN_JOIN(name, variant)
+#define KERN_STR(x) #x
+#define KERN_NAME(x) KERN_STR(x)
+
+/* Inner loops of a fixed length are what GCC vectorizes at -O2; the tail
+ * runs the portable loop. */
+#define KERN_BLOCK 16
+
+/* Biased by 32768.5 so truncation rounds to nearest, clamped while still
+ * positive. */
+#define KERN_F2I_BIAS 32768.5f
+#define KERN_F2I_MAX  65535.f
+
+static inline int16_t sat16(int32_t x)
+{
+    return (int16_t)(x > INT16_MAX ? INT16_MAX : x < INT16_MIN ? INT16_MIN : x);
+}
+
+static inline int16_t f2i(float x)
+{
+    float v = x * 32768.f + KERN_F2I_BIAS;
+    v = v < 0.f ? 0.f : v;
+    v = v > KERN_F2I_MAX ? KERN_F2I_MAX : v;
+    return (int16_t)((int32_t)v - 32768);
+}
+
+static inline float clip1(float x)
+{
+    x = x < -1.f ? -1.f : x;
+    return x > 1.f ? 1.f : x;
+}
+
+// portable
+
+static void deinterleave_portable(const int16_t* lr, int16_t* l, int16_t* r, size_t frames)
+{
+    for (size_t i = 0; i < frames; i++)
+    {
+        l[i] = lr[2 * i];
+        r[i] = lr[2 * i + 1];
+    }
+}
+
+static void interleave_portable(const int16_t* l, const int16_t* r, int16_t* lr, size_t frames)
+{
+    for (size_t i = 0; i < frames; i++)
+    {
+        lr[2 * i] = l[i];
+        lr[2 * i + 1] = r[i];
+    }
+}
+
+static void extract_portable(const int16_t* lr, size_t channel, int16_t* out, size_t frames)
+{
+    for (size_t i = 0; i < frames; i++)
+        out[i] = lr[2 * i + channel];
+}
+
+static void sum_mono_portable(const int16_t* lr, int16_t* out, size_t frames)
+{
+    for (size_t i = 0; i < frames; i++)
+        out[i] = sat16((int32_t)lr[2 * i] + lr[2 * i + 1]);
+}
+
+static void i16_to_float_portable(const int16_t* in, float* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = in[i] * (1.f / 32768.f);
+}
+
+static void float_to_i16_portable(const float* in, int16_t* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = f2i(in[i]);
+}
+
+static void gain_clip_portable(const float* in, float* out, size_t n, float gain)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = clip1(in[i] * gain);
+}
+
+// autovec
+
+static void deinterleave_autovec(const int16_t* restrict lr, int16_t* restrict l,
+    int16_t* restrict r, size_t frames)
+{
+    size_t i = 0;
+    for (; i + KERN_BLOCK <= frames; i += KERN_BLOCK)
+    {
+        for (size_t j = i; j < i + KERN_BLOCK; j++)
+        {
+            l[j] = lr[2 * j];
+            r[j] = lr[2 * j + 1];
+        }
+    }
+    deinterleave_portable(lr + 2 * i, l + i, r + i, frames - i);
+}
+
+static void interleave_autovec(const int16_t* restrict l, const int16_t* restrict r,
+    int16_t* restrict lr, size_t frames)
+{
+    size_t i = 0;
+    for (; i + KERN_BLOCK <= frames; i += KERN_BLOCK)
+    {
+        for (size_t j = i; j < i + KERN_BLOCK; j++)
+        {
+            lr[2 * j] = l[j];
+            lr[2 * j + 1] = r[j];
+        }
+    }
+    interleave_portable(l + i, r + i, lr + 2 * i, frames - i);
+}
+
+// A strided load alone does not vectorize at -O2; whole frames as
+// little-endian words do.
+static void extract_autovec(const int16_t* restrict lr, size_t channel,
+    int16_t* restrict out, size_t frames)
+{
+    unsigned shift = 16 * channel;
+    size_t i = 0;
+    for (; i + KERN_BLOCK <= frames; i += KERN_BLOCK)
+    {
+        uint32_t words[KERN_BLOCK];
+        memcpy(words, lr + 2 * i, sizeof(words));
+        for (size_t j = 0; j < KERN_BLOCK; j++)
+            out[i + j] = (int16_t)(words[j] >> shift);
+    }
+    extract_portable(lr + 2 * i, channel, out + i, frames - i);
+}
+
+static void sum_mono_autovec(const int16_t* restrict lr, int16_t* restrict out, size_t frames)
+{
+    size_t i = 0;
+    for (; i + KERN_BLOCK <= frames; i += KERN_BLOCK)
+    {
+        for (size_t j = i; j < i + KERN_BLOCK; j++)
+            out[j] = sat16((int32_t)lr[2 * j] + lr[2 * j + 1]);
+    }
+    sum_mono_portable(lr + 2 * i, out + i, frames - i);
+}
+
+static void i16_to_float_autovec(const int16_t* restrict in, float* restrict out, size_t n)
+{
+    size_t i = 0;
+    for (; i + KERN_BLOCK <= n; i += KERN_BLOCK)
+    {
+        for (size_t j = i; j < i + KERN_BLOCK; j++)
+            out[j] = in[j] * (1.f / 32768.f);
+    }
+    i16_to_float_portable(in + i, out + i, n - i);
+}
+
+static void float_to_i16_autovec(const float* restrict in, int16_t* restrict out, size_t n)
+{
+    size_t i = 0;
+    for (; i + KERN_BLOCK <= n; i += KERN_BLOCK)
+    {
+        for (size_t j = i; j < i + KERN_BLOCK; j++)
+            out[j] = f2i(in[j]);
+    }
+    float_to_i16_portable(in + i, out + i, n - i);
+}
+
+static void gain_clip_autovec(const float* restrict in, float* restrict out, size_t n, float gain)
+{
+    size_t i = 0;
+    for (; i + KERN_BLOCK <= n; i += KERN_BLOCK)
+    {
+        for (size_t j = i; j < i + KERN_BLOCK; j++)
+            out[j] = clip1(in[j] * gain);
+    }
+    gain_clip_portable(in + i, out + i, n - i, gain);
+}
+
+// unrolled
+
+static void deinterleave_unrolled(const int16_t* lr, int16_t* l, int16_t* r, size_t frames)
+{
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4, lr += 8)
+    {
+        int16_t l0 = lr[0], r0 = lr[1], l1 = lr[2], r1 = lr[3];
+        int16_t l2 = lr[4], r2 = lr[5], l3 = lr[6], r3 = lr[7];
+        l[i] = l0; l[i + 1] = l1; l[i + 2] = l2; l[i + 3] = l3;
+        r[i] = r0; r[i + 1] = r1; r[i + 2] = r2; r[i + 3] = r3;
+    }
+    deinterleave_portable(lr, l + i, r + i, frames - i);
+}
+
+static void interleave_unrolled(const int16_t* l, const int16_t* r, int16_t* lr, size_t frames)
+{
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4, lr += 8)
+    {
+        int16_t l0 = l[i], l1 = l[i + 1], l2 = l[i + 2], l3 = l[i + 3];
+        int16_t r0 = r[i], r1 = r[i + 1], r2 = r[i + 2], r3 = r[i + 3];
+        lr[0] = l0; lr[1] = r0; lr[2] = l1; lr[3] = r1;
+        lr[4] = l2; lr[5] = r2; lr[6] = l3; lr[7] = r3;
+    }
+    interleave_portable(l + i, r + i, lr, frames - i);
+}
+
+static void extract_unrolled(const int16_t* lr, size_t channel, int16_t* out, size_t frames)
+{
+    const int16_t* src = lr + channel;
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4, src += 8)
+    {
+        int16_t s0 = src[0], s1 = src[2], s2 = src[4], s3 = src[6];
+        out[i] = s0; out[i + 1] = s1; out[i + 2] = s2; out[i + 3] = s3;
+    }
+    extract_portable(lr + 2 * i, channel, out + i, frames - i);
+}
+
+static void sum_mono_unrolled(const int16_t* lr, int16_t* out, size_t frames)
+{
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4, lr += 8)
+    {
+        int32_t s0 = lr[0] + lr[1], s1 = lr[2] + lr[3];
+        int32_t s2 = lr[4] + lr[5], s3 = lr[6] + lr[7];
+        out[i] = sat16(s0); out[i + 1] = sat16(s1);
+        out[i + 2] = sat16(s2); out[i + 3] = sat16(s3);
+    }
+    sum_mono_portable(lr, out + i, frames - i);
+}
+
+static void i16_to_float_unrolled(const int16_t* in, float* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        float f0 = in[i], f1 = in[i + 1], f2 = in[i + 2], f3 = in[i + 3];
+        out[i] = f0 * (1.f / 32768.f);
+        out[i + 1] = f1 * (1.f / 32768.f);
+        out[i + 2] = f2 * (1.f / 32768.f);
+        out[i + 3] = f3 * (1.f / 32768.f);
+    }
+    i16_to_float_portable(in + i, out + i, n - i);
+}
+
+static void float_to_i16_unrolled(const float* in, int16_t* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        int16_t s0 = f2i(in[i]), s1 = f2i(in[i + 1]);
+        int16_t s2 = f2i(in[i + 2]), s3 = f2i(in[i + 3]);
+        out[i] = s0; out[i + 1] = s1; out[i + 2] = s2; out[i + 3] = s3;
+    }
+    float_to_i16_portable(in + i, out + i, n - i);
+}
+
+static void gain_clip_unrolled(const float* in, float* out, size_t n, float gain)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        float v0 = in[i] * gain, v1 = in[i + 1] * gain;
+        float v2 = in[i + 2] * gain, v3 = in[i + 3] * gain;
+        out[i] = clip1(v0); out[i + 1] = clip1(v1);
+        out[i + 2] = clip1(v2); out[i + 3] = clip1(v3);
+    }
+    gain_clip_portable(in + i, out + i, n - i, gain);
+}
+
+#define KERN_OPS(variant) {                          \
+    .name = #variant,                                \
+    .deinterleave = deinterleave_##variant,          \
+    .interleave = interleave_##variant,              \
+    .extract = extract_##variant,                    \
+    .sum_mono = sum_mono_##variant,                  \
+    .i16_to_float = i16_to_float_##variant,          \
+    .float_to_i16 = float_to_i16_##variant,          \
+    .gain_clip = gain_clip_##variant,                \
+}
+
+const kern_ops_t kern_variants[KERN_VARIANT_COUNT] = {
+    KERN_OPS(portable),
+    KERN_OPS(autovec),
+    KERN_OPS(unrolled),
+};
+
+const char* const kern_selected = KERN_NAME(KERN_VARIANT);
+
+void kern_deinterleave(const int16_t* lr, int16_t* l, int16_t* r, size_t frames)
+{
+    KERN_PICK(deinterleave, KERN_VARIANT)(lr, l, r, frames);
+}
+
+void kern_interleave(const int16_t* l, const int16_t* r, int16_t* lr, size_t frames)
+{
+    KERN_PICK(interleave, KERN_VARIANT)(l, r, lr, frames);
+}
+
+void kern_extract(const int16_t* lr, size_t channel, int16_t* out, size_t frames)
+{
+    KERN_PICK(extract, KERN_VARIANT)(lr, channel, out, frames);
+}
+
+void kern_sum_mono(const int16_t* lr, int16_t* out, size_t frames)
+{
+    KERN_PICK(sum_mono, KERN_VARIANT)(lr, out, frames);
+}
+
+void kern_i16_to_float(const int16_t* in, float* out, size_t n)
+{
+    KERN_PICK(i16_to_float, KERN_VARIANT)(in, out, n);
+}
+
+void kern_float_to_i16(const float* in, int16_t* out, size_t n)
+{
+    KERN_PICK(float_to_i16, KERN_VARIANT)(in, out, n);
+}
+
+void kern_gain_clip(const float* in, float* out, size_t n, float gain)
+{
+    KERN_PICK(gain_clip, KERN_VARIANT)(in, out, n, gain);
+}
@@ -0,0 +1,59 @@
+#ifndef __WAR_KERNELS_H__
+#define __WAR_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sample-format kernels shared by the mixer, the layouts and DSP stages.
+ * Stereo buffers are interleaved L/R frames; floats are full scale at
+ * +-1.0. Buffers must not overlap.
+ *
+ * Every kernel comes in three variants with identical results:
+ *
+ *  portable  plain per-sample loops
+ *  autovec   fixed-size blocks the compiler turns into SIMD at -O2
+ *  unrolled  four samples per iteration by hand, for cores without SIMD
+ *
+ * The kern_* names call the variant picked at build time with
+ * -DKERN_VARIANT=portable|autovec|unrolled; by default unrolled on Xtensa
+ * and autovec elsewhere. kern_variants lists all of them for benchmarks.
+ */
+
+void kern_deinterleave(const int16_t* lr, int16_t* l, int16_t* r, size_t frames);
+void kern_interleave(const int16_t* l, const int16_t* r, int16_t* lr, size_t frames);
+// One channel (0 left, 1 right) of interleaved frames.
+void kern_extract(const int16_t* lr, size_t channel, int16_t* out, size_t frames);
+// L + R, saturated.
+void kern_sum_mono(const int16_t* lr, int16_t* out, size_t frames);
+void kern_i16_to_float(const int16_t* in, float* out, size_t n);
+// Rounded to nearest, clipped to the int16 range.
+void kern_float_to_i16(const float* in, int16_t* out, size_t n);
+// in * gain, clipped to [-1, 1].
+void kern_gain_clip(const float* in, float* out, size_t n, float gain);
+
+typedef struct {
+    const char* name;
+    void (*deinterleave)(const int16_t* lr, int16_t* l, int16_t* r, size_t frames);
+    void (*interleave)(const int16_t* l, const int16_t* r, int16_t* lr, size_t frames);
+    void (*extract)(const int16_t* lr, size_t channel, int16_t* out, size_t frames);
+    void (*sum_mono)(const int16_t* lr, int16_t* out, size_t frames);
+    void (*i16_to_float)(const int16_t* in, float* out, size_t n);
+    void (*float_to_i16)(const float* in, int16_t* out, size_t n);
+    void (*gain_clip)(const float* in, float* out, size_t n, float gain);
+} kern_ops_t;
+
+#define KERN_VARIANT_COUNT 3
+
+extern const kern_ops_t kern_variants[KERN_VARIANT_COUNT];
+extern const char* const kern_selected;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_KERNELS_H__
@@ -0,0 +1,152 @@
+#include "war_latency.h"
+#include "assert.h"
+#include <string.h>
+
+void latency_init(latency_t* lat)
+{
+    assert(lat);
+    memset(lat, 0, sizeof(latency_t));
+    latency_hist_init(&lat->transit);
+    latency_hist_init(&lat->impulse);
+}
+
+void latency_hist_init(latency_hist_t* hist)
+{
+    memset(hist, 0, sizeof(latency_hist_t));
+    hist->min = UINT32_MAX;
+}
+
+static uint16_t latency_bin(uint32_t us)
+{
+    if (us < LATENCY_SUB)
+        return (uint16_t)us;
+    int octave = 31 - __builtin_clz(us);
+    uint32_t bin = (octave - LATENCY_SUB_BITS + 1) * LATENCY_SUB +
+        ((us >> (octave - LATENCY_SUB_BITS)) - LATENCY_SUB);
+    return bin < LATENCY_BINS ? (uint16_t)bin : LATENCY_BINS - 1;
+}
+
+// Lowest latency that falls into bin.
+static uint32_t latency_bin_floor(uint32_t bin)
+{
+    if (bin < LATENCY_SUB)
+        return bin;
+    uint32_t octave = bin / LATENCY_SUB + LATENCY_SUB_BITS - 1;
+    return (bin % LATENCY_SUB + LATENCY_SUB) << (octave - LATENCY_SUB_BITS);
+}
+
+void latency_hist_add(latency_hist_t* hist, int32_t us)
+{
+    if (us < 0)
+    {
+        hist->early++;
+        us = 0;
+    }
+    hist->bins[latency_bin((uint32_t)us)]++;
+    hist->count++;
+    hist->sum += (uint32_t)us;
+    if ((uint32_t)us < hist->min)
+        hist->min = (uint32_t)us;
+    if ((uint32_t)us > hist->max)
+        hist->max = (uint32_t)us;
+}
+
+uint32_t latency_percentile(const latency_hist_t* hist, float pct)
+{
+    if (hist->count == 0)
+        return 0;
+    uint64_t want = (uint64_t)(pct * 0.01f * hist->count + 0.5f);
+    if (want == 0)
+        want = 1;
+    uint64_t seen = 0;
+    for (uint32_t bin = 0; bin < LATENCY_BINS; bin++)
+    {
+        seen += hist->bins[bin];
+        if (seen >= want)
+        {
+            uint32_t upper = latency_bin_floor(bin + 1) - 1;
+            return upper < hist->max ? upper : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+bool latency_clock(latency_t* lat, const latency_ping_t* ping, uint32_t t4)
+{
+    // Offset plus the way out, offset less the way back.
+    uint32_t out = ping->t2 - ping->t1;
+    uint32_t back = ping->t3 - t4;
+    int32_t rtt = (int32_t)(out - back);
+    if (rtt < 0 || rtt > LATENCY_MAX_RTT_US)
+        return false;
+
+    lat->clock_offset[lat->clock_head] = out - (uint32_t)(rtt / 2);
+    lat->clock_rtt[lat->clock_head] = (uint32_t)rtt;
+    lat->clock_head = (lat->clock_head + 1) % LATENCY_CLOCK_SAMPLES;
+    if (lat->clock_count < LATENCY_CLOCK_SAMPLES)
+        lat->clock_count++;
+
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < lat->clock_count; i++)
+        if (lat->clock_rtt[i] < lat->clock_rtt[best])
+            best = i;
+    lat->rtt = lat->clock_rtt[best];
+    lat->offset = lat->clock_offset[best];
+    lat->offset_valid = true;
+    return true;
+}
+
+void latency_arrival(latency_t* lat, uint32_t captured, uint32_t now)
+{
+    // Off by the clock offset, which the difference cancels.
+    int32_t transit = (int32_t)(now - captured);
+    if (lat->have_transit)
+    {
+        int32_t d = transit - lat->last_transit;
+        lat->jitter += ((float)(d < 0 ? -d : d) - lat->jitter) / 16.f;
+    }
+    lat->last_transit = transit;
+    lat->have_transit = true;
+
+    if (lat->offset_valid)
+        latency_hist_add(&lat->transit, (int32_t)(now + lat->offset - captured));
+}
+
+void latency_impulse(int16_t* samples, size_t frames, uint8_t channels,
+    uint32_t samplerate, uint32_t captured)
+{
+    memset(samples, 0, frames * channels * sizeof(int16_t));
+    for (size_t i = 0; i < frames; i++)
+    {
+        uint32_t t = captured -
+            (uint32_t)((uint64_t)(frames - 1 - i) * 1000000 / samplerate);
+        // The multiple lies within this frame's period.
+        if ((uint64_t)(t % LATENCY_IMPULSE_US) * samplerate < 1000000)
+        {
+            for (uint8_t ch = 0; ch < channels; ch++)
+                samples[ch * frames + i] = LATENCY_IMPULSE_LEVEL;
+        }
+    }
+}
+
+bool latency_output(latency_t* lat, const int16_t* samples, size_t frames,
+    uint32_t samplerate, uint32_t now)
+{
+    for (size_t i = 0; i < frames; i++)
+    {
+        if (samples[i] < LATENCY_IMPULSE_DETECT && samples[i] > -LATENCY_IMPULSE_DETECT)
+            continue;
+        uint32_t t = now + (uint32_t)((uint64_t)i * 1000000 / samplerate);
+        // Ringing after the impulse is not another one.
+        if (lat->impulse_seen && t - lat->impulse_last < LATENCY_IMPULSE_US / 2)
+            continue;
+        lat->impulse_last = t;
+        lat->impulse_seen = true;
+        if (!lat->offset_valid)
+            return false;
+        latency_hist_add(&lat->impulse,
+            (int32_t)((t + lat->offset) % LATENCY_IMPULSE_US));
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,118 @@
+#ifndef __WAR_LATENCY_H__
+#define __WAR_LATENCY_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * End-to-end latency measurement. Times are esp_timer_get_time() in us,
+ * truncated to 32 bits; only differences are ever taken.
+ *
+ *  clock    the receiver pings the sender every LATENCY_PING_US and the
+ *           pong carries the sender's receive and send times. Of the last
+ *           LATENCY_CLOCK_SAMPLES exchanges the one with the shortest round
+ *           trip gives the offset of the sender's clock.
+ *  transit  audio packets stamped with their capture time (ESPNOW_FLAG_
+ *           TIMESTAMP) give the one-way latency from capture to arrival,
+ *           and, offset or not, RFC 3550 interarrival jitter.
+ *  impulse  in the loopback test mode the sender replaces its audio with
+ *           an impulse whenever its clock crosses a multiple of
+ *           LATENCY_IMPULSE_US; the receiver finds it in what it plays out,
+ *           and the time past that multiple on the sender's clock is the
+ *           latency from capture to output.
+ *
+ * Latencies go into log-linear histograms, LATENCY_SUB bins per octave,
+ * so percentiles carry about 6% resolution from microseconds to seconds.
+ *
+ * latency_clock() and latency_arrival() run on espnow_task(),
+ * latency_output() on the playout side; they only share the offset.
+ */
+
+#define LATENCY_PING_US         250000
+#define LATENCY_CLOCK_SAMPLES   8
+/* Longer round trips say more about queueing than about the clocks. */
+#define LATENCY_MAX_RTT_US      20000
+#define LATENCY_SUB_BITS        4
+#define LATENCY_SUB             (1 << LATENCY_SUB_BITS)
+/* Up to 2^26 us; longer ones land in the last bin. */
+#define LATENCY_BINS            ((27 - LATENCY_SUB_BITS) * LATENCY_SUB)
+
+#define LATENCY_IMPULSE_US      500000
+#define LATENCY_IMPULSE_LEVEL   24576
+#define LATENCY_IMPULSE_DETECT  8192
+
+/* Payload of ESPNOW_PACKET_PING and ESPNOW_PACKET_PONG. */
+typedef struct {
+    uint32_t t1;                          //Receiver's clock as it sent the ping.
+    uint32_t t2;                          //Sender's clock as it got the ping.
+    uint32_t t3;                          //Sender's clock as it sent the pong.
+} __attribute__((packed)) latency_ping_t;
+
+typedef struct {
+    uint32_t bins[LATENCY_BINS];
+    uint32_t count;
+    uint32_t early;                       // Below zero by offset error, counted as 0.
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} latency_hist_t;
+
+typedef struct {
+    // Clock, see latency_clock().
+    uint32_t clock_offset[LATENCY_CLOCK_SAMPLES];
+    uint32_t clock_rtt[LATENCY_CLOCK_SAMPLES];
+    uint8_t clock_head;
+    uint8_t clock_count;
+    volatile uint32_t offset;             // Sender's clock minus ours.
+    volatile bool offset_valid;
+    uint32_t rtt;
+
+    // Capture to arrival, see latency_arrival().
+    latency_hist_t transit;
+    int32_t last_transit;
+    bool have_transit;
+    float jitter;
+
+    // Capture to output, see latency_output().
+    latency_hist_t impulse;
+    uint32_t impulse_last;
+    bool impulse_seen;
+} latency_t;
+
+void latency_init(latency_t* lat);
+
+void latency_hist_init(latency_hist_t* hist);
+void latency_hist_add(latency_hist_t* hist, int32_t us);
+
+// Smallest latency at or above pct percent of the samples, to the upper
+// edge of its bin; 0 without samples.
+uint32_t latency_percentile(const latency_hist_t* hist, float pct);
+
+// Feeds a ping exchange, t4 being our clock as the pong arrived. Returns
+// false if the round trip was too long to use.
+bool latency_clock(latency_t* lat, const latency_ping_t* ping, uint32_t t4);
+
+// Feeds an audio packet captured at captured on the sender's clock.
+void latency_arrival(latency_t* lat, uint32_t captured, uint32_t now);
+
+// Replaces frames planar frames captured up to captured (sender's clock)
+// with silence, and an impulse on every channel of the frame that crosses
+// a multiple of LATENCY_IMPULSE_US.
+void latency_impulse(int16_t* samples, size_t frames, uint8_t channels,
+    uint32_t samplerate, uint32_t captured);
+
+// Looks for the impulse in frames of one channel, the first of which
+// leaves the output at now. Returns true when one was found.
+bool latency_output(latency_t* lat, const int16_t* samples, size_t frames,
+    uint32_t samplerate, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_LATENCY_H__
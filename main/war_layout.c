@@ -0,0 +1,125 @@
+#include "war_layout.h"
+#include "war_kernels.h"
+#include "assert.h"
+#include <string.h>
+
+/*
+ * Mid/side runs eight frames per step on GCC vector types: native SIMD on
+ * the host, plain 32-bit code on the Xtensa cores, with no per-sample
+ * branches either way. Halving is done per operand so nothing leaves 16
+ * bits: floor((a + b) / 2) = (a >> 1) + (b >> 1) + (a & b & 1), and the
+ * same for a - b with the borrow. -32768 is nudged to -32767 so rebuilding
+ * L cannot overflow.
+ */
+typedef int16_t v8i16 __attribute__((vector_size(16)));
+
+#define LAYOUT_LANES 8
+
+static const v8i16 even_lanes = {0, 2, 4, 6, 8, 10, 12, 14};
+static const v8i16 odd_lanes = {1, 3, 5, 7, 9, 11, 13, 15};
+
+static int16_t half_sum(int16_t a, int16_t b)
+{
+    return (int16_t)((a >> 1) + (b >> 1) + (a & b & 1));
+}
+
+static int16_t half_diff(int16_t a, int16_t b)
+{
+    return (int16_t)((a >> 1) - (b >> 1) - (~a & b & 1));
+}
+
+static void pack_mid_side(const int16_t* lr, size_t frames, int16_t* mid, int16_t* side)
+{
+    size_t i = 0;
+    for (; i + LAYOUT_LANES <= frames; i += LAYOUT_LANES)
+    {
+        v8i16 a, b;
+        memcpy(&a, lr + 2 * i, sizeof(a));
+        memcpy(&b, lr + 2 * i + LAYOUT_LANES, sizeof(b));
+        v8i16 l = __builtin_shuffle(a, b, even_lanes);
+        v8i16 r = __builtin_shuffle(a, b, odd_lanes);
+        l -= (l == INT16_MIN);
+        r -= (r == INT16_MIN);
+        v8i16 m = (l >> 1) + (r >> 1) + (l & r & 1);
+        v8i16 s = (l >> 1) - (r >> 1) - (~l & r & 1);
+        memcpy(mid + i, &m, sizeof(m));
+        memcpy(side + i, &s, sizeof(s));
+    }
+    for (; i < frames; i++)
+    {
+        int16_t l = lr[2 * i] == INT16_MIN ? INT16_MIN + 1 : lr[2 * i];
+        int16_t r = lr[2 * i + 1] == INT16_MIN ? INT16_MIN + 1 : lr[2 * i + 1];
+        mid[i] = half_sum(l, r);
+        side[i] = half_diff(l, r);
+    }
+}
+
+static void unpack_mid_side(int16_t* mid_l, int16_t* side_r, size_t frames)
+{
+    size_t i = 0;
+    for (; i + LAYOUT_LANES <= frames; i += LAYOUT_LANES)
+    {
+        v8i16 m, s;
+        memcpy(&m, mid_l + i, sizeof(m));
+        memcpy(&s, side_r + i, sizeof(s));
+        v8i16 l = m + s;
+        v8i16 r = m - s;
+        memcpy(mid_l + i, &l, sizeof(l));
+        memcpy(side_r + i, &r, sizeof(r));
+    }
+    for (; i < frames; i++)
+    {
+        int16_t m = mid_l[i];
+        mid_l[i] = (int16_t)(m + side_r[i]);
+        side_r[i] = (int16_t)(m - side_r[i]);
+    }
+}
+
+void layout_pack(channel_layout_t layout, const int16_t* lr, size_t frames, int16_t* out)
+{
+    switch (layout)
+    {
+    case LAYOUT_MONO_RIGHT:
+        kern_extract(lr, 1, out, frames);
+        break;
+    case LAYOUT_MONO_LEFT:
+        kern_extract(lr, 0, out, frames);
+        break;
+    case LAYOUT_MONO_SUM:
+        for (size_t i = 0; i < frames; i++)
+            out[i] = half_sum(lr[2 * i], lr[2 * i + 1]);
+        break;
+    case LAYOUT_STEREO:
+        kern_deinterleave(lr, out, out + frames, frames);
+        break;
+    case LAYOUT_MID_SIDE:
+        pack_mid_side(lr, frames, out, out + frames);
+        break;
+    default:
+        assert(0);
+    }
+}
+
+void layout_unpack(channel_layout_t layout, int16_t* frame, size_t frames)
+{
+    if (layout == LAYOUT_MID_SIDE)
+        unpack_mid_side(frame, frame + frames, frames);
+}
+
+void layout_interleave(const int16_t* planar, size_t frames, int16_t* lr)
+{
+    kern_interleave(planar, planar + frames, lr, frames);
+}
+
+const char* layout_name(channel_layout_t layout)
+{
+    switch (layout)
+    {
+    case LAYOUT_MONO_RIGHT: return "mono-right";
+    case LAYOUT_MONO_LEFT: return "mono-left";
+    case LAYOUT_MONO_SUM: return "mono-sum";
+    case LAYOUT_STEREO: return "stereo";
+    case LAYOUT_MID_SIDE: return "mid-side";
+    default: return "unknown";
+    }
+}
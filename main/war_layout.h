@@ -0,0 +1,54 @@
+#ifndef __WAR_LAYOUT_H__
+#define __WAR_LAYOUT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Channel layouts of the transmitted audio. Input is the I2S buffer,
+ * left/right interleaved. Two-channel layouts are carried planar, the
+ * whole first channel followed by the whole second one, so codecs and the
+ * redundant copy see each channel as a continuous signal.
+ *
+ *  LAYOUT_MONO_RIGHT  right channel only
+ *  LAYOUT_MONO_LEFT   left channel only
+ *  LAYOUT_MONO_SUM    (L + R) / 2
+ *  LAYOUT_STEREO      L then R
+ *  LAYOUT_MID_SIDE    (L + R) / 2 then (L - R) / 2; a mono receiver can
+ *                     play the first half alone. Rebuilding L/R is off by
+ *                     at most one LSB on L, R is exact.
+ */
+
+typedef enum {
+    LAYOUT_MONO_RIGHT,
+    LAYOUT_MONO_LEFT,
+    LAYOUT_MONO_SUM,
+    LAYOUT_STEREO,
+    LAYOUT_MID_SIDE,
+    LAYOUT_COUNT,
+} channel_layout_t;
+
+#define LAYOUT_CHANNELS(layout) ((layout) >= LAYOUT_STEREO ? 2 : 1)
+
+// Packs frames of interleaved L/R into LAYOUT_CHANNELS(layout) * frames
+// samples.
+void layout_pack(channel_layout_t layout, const int16_t* lr, size_t frames, int16_t* out);
+
+// Turns a packed payload back into planar L/R (mono layouts are left as
+// they are), in place.
+void layout_unpack(channel_layout_t layout, int16_t* frame, size_t frames);
+
+// Planar L/R to interleaved L/R for I2S.
+void layout_interleave(const int16_t* planar, size_t frames, int16_t* lr);
+
+const char* layout_name(channel_layout_t layout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_LAYOUT_H__
@@ -1,10 +1,14 @@
 #include "war_mixer.h"
 #include "war_config.h"
 #include "war_espnow.h"
+#include "war_profile.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/i2s.h"
 #include <string.h>
+#include "assert.h"
 #include "wm_i2c.h"
 #include "math.h"
 #include "FilterButterworth24db.h"
@@ -18,35 +22,51 @@ int16_t sine_buffer[SINE_SAMPLES];
 uint16_t sine_index = 0;
 
 mixer_buffers_t mixer;
+channel_layout_t mixer_layout = (channel_layout_t)ESPNOW_LAYOUT;
 
-const size_t buffer_ms = MS_PER_PACKET;
-const size_t buffer_samples_per_ms = SAMPLERATE / 1000;
-const size_t buffer_channels = 2;
-const size_t buffer_size =
-    buffer_ms * buffer_samples_per_ms;
-const size_t stereo_buffer_size =
-    buffer_ms * buffer_samples_per_ms * buffer_channels;
+/* One I2S_EVENT_RX_DONE per DMA buffer, and a DMA buffer is one packet:
+ * capture runs on the I2S clock alone. */
+QueueHandle_t mixer_i2s_queue = NULL;
+
+bool mixer_impulse = false;
 
-uint16_t single_packet_buffer[buffer_ms * buffer_samples_per_ms];
+/* DMA buffers complete a packet apart on the I2S clock, so a wake's distance
+ * from the last anchor plus k packets is its lag plus a constant. Every
+ * MIXER_WAKE_WINDOW wakes the anchor moves up by the window's least lag,
+ * taken as none, which also follows the I2S clock drifting from
+ * esp_timer's. */
+#define MIXER_WAKE_WINDOW 64
+int64_t mixer_wake_next = 0;
+int64_t mixer_wake_min = INT64_MAX;
+uint32_t mixer_wake_count = 0;
+
+const size_t buffer_channels = 2;
+// Frames per packet, from the stream espnow_init() settled on.
+size_t buffer_size = 0;
+size_t stereo_buffer_size = 0;
 
 void mixer_init()
 {
+    const espnow_stream_t* stream = espnow_get_stream();
+    buffer_size = stream->frames;
+    stereo_buffer_size = buffer_size * buffer_channels;
+
     //I2S Config
     i2s_config_t i2s_num0_config = {
         .mode = (i2s_mode_t) (I2S_MODE_MASTER | I2S_MODE_RX),
-        .sample_rate = SAMPLERATE,
+        .sample_rate = (int)stream->samplerate,
         .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
         .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
         .communication_format = I2S_COMM_FORMAT_STAND_I2S,
         .intr_alloc_flags = 1,
-        .dma_buf_count = 4,
-        .dma_buf_len = 240,
+        .dma_buf_count = MIXER_DMA_BUFFERS,
+        .dma_buf_len = (int)stream->frames,
         .use_apll = true,
         .tx_desc_auto_clear = true,
         .fixed_mclk = 0,
     };
 
-    i2s_driver_install(I2S_NUM_0, &i2s_num0_config, 0, NULL);
+    i2s_driver_install(I2S_NUM_0, &i2s_num0_config, MIXER_DMA_BUFFERS, &mixer_i2s_queue);
     i2s_pin_config_t pin_config = {
         .bck_io_num = 27,
         .ws_io_num = 25,
@@ -60,7 +80,7 @@ void mixer_init()
     PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO0_U, FUNC_GPIO0_CLK_OUT1);
 
     //Sine Wave 440HZ
-    double delta = 1.0 / (double)SAMPLERATE;
+    double delta = 1.0 / (double)stream->samplerate;
     double freq = 440.0;
     for (int i = 0; i < SINE_SAMPLES; i++)
     {
@@ -74,58 +94,109 @@ void mixer_init()
     ESP_LOGI(MIXER_TAG, "Mixer init finished.");
 }
 
-void mixer_tick(size_t samples)
+/* Loopback test mode: packets carry silence and an impulse every
+ * LATENCY_IMPULSE_US instead of what was captured, see war_latency.h. */
+void mixer_set_impulse(bool enable)
 {
-    static uint32_t total_samples_written = 0;
-    static uint32_t time = 0;
-    if (time == 0)
-    {
-        time = esp_timer_get_time() / 1000;
-    }
+    mixer_impulse = enable;
+}
+
+/* Channels mixer_read() puts into each packet. Must have ESPNOW_CHANNELS
+ * channels, packets are sized for those. */
+void mixer_set_layout(channel_layout_t layout)
+{
+    assert(LAYOUT_CHANNELS(layout) == ESPNOW_CHANNELS);
+    mixer_layout = layout;
+}
 
+void mixer_tick(size_t samples)
+{
+    if (samples == 0)
+        return;
     size_t i2s_bytes_written = 0;
-    if (samples > 0)
+    i2s_write(I2S_NUM_0, mixer.mix_buf, SAMPLES_TO_BYTES(samples), &i2s_bytes_written, 0);
+    telemetry_count(TELEMETRY_I2S_WRITES, 1);
+    telemetry_count(TELEMETRY_I2S_SAMPLES_WRITTEN, BYTES_TO_SAMPLES(i2s_bytes_written));
+    if (i2s_bytes_written != SAMPLES_TO_BYTES(samples))
     {
-        i2s_write(I2S_NUM_0, mixer.mix_buf, SAMPLES_TO_BYTES(samples), &i2s_bytes_written, 0);
-        if (i2s_bytes_written != SAMPLES_TO_BYTES(samples))
-        {
-            ESP_LOGI(MIXER_TAG, "I2S Buffer full: %d/%d Bytes written", i2s_bytes_written, SAMPLES_TO_BYTES(samples));
-        }
+        telemetry_count(TELEMETRY_I2S_SHORT_WRITES, 1);
+        telemetry_count(TELEMETRY_I2S_SHORT_BYTES, SAMPLES_TO_BYTES(samples) - i2s_bytes_written);
     }
-    total_samples_written += BYTES_TO_SAMPLES(i2s_bytes_written);
-    uint32_t now = esp_timer_get_time() / 1000;
-    uint32_t diff = now - time;
-    if (diff > 9999)
+}
+
+static void mixer_wake(int64_t now, uint32_t packet_us)
+{
+    if (mixer_wake_next == 0)
+        mixer_wake_next = now;
+    int64_t lag = now - mixer_wake_next;
+    mixer_wake_next += packet_us;
+    if (lag < mixer_wake_min)
+        mixer_wake_min = lag;
+    telemetry_hist_add(TELEMETRY_WAKE_LAG_US, lag > 0 ? (uint32_t)lag : 0);
+    if (++mixer_wake_count == MIXER_WAKE_WINDOW)
     {
-        ESP_LOGI(MIXER_TAG, "Samples/ms: %.1f", (float)total_samples_written / (float)diff);
-        total_samples_written = 0;
-        time = now;
+        mixer_wake_next += mixer_wake_min;
+        mixer_wake_min = INT64_MAX;
+        mixer_wake_count = 0;
     }
 }
 
+// When the buffer whose event woke us was captured.
+static int64_t mixer_woken()
+{
+    PROFILE_STAGE(PROFILE_WAKE);
+    // Buffers still queued behind this one completed a packet apart, so
+    // this one was done that much before we woke.
+    int64_t now = esp_timer_get_time();
+    uint32_t packet_us = espnow_get_stream()->packet_us;
+    UBaseType_t backlog = uxQueueMessagesWaiting(mixer_i2s_queue);
+    mixer_wake(now, packet_us);
+    telemetry_hist_add(TELEMETRY_DMA_BACKLOG, backlog);
+    telemetry_count(TELEMETRY_I2S_READS, 1);
+    return now - (int64_t)backlog * packet_us;
+}
+
 void mixer_read()
 {
+    i2s_event_t event;
+    xQueueReceive(mixer_i2s_queue, &event, portMAX_DELAY);
+    if (event.type != I2S_EVENT_RX_DONE)
+    {
+        telemetry_count(TELEMETRY_I2S_EVENTS_OTHER, 1);
+        return;
+    }
+    int64_t captured = mixer_woken();
+
+    espnow_data_t* packet = espnow_packet_acquire(portMAX_DELAY);
+    int16_t* payload = (int16_t*) packet->payload;
 #define TEST_SINE 0
 #if TEST_SINE == 0
+    // The buffer is complete, so this returns at once.
     size_t bytes_read = 0;
-    size_t bytes_written = 0;
-    esp_err_t err = i2s_read(I2S_NUM_0, mixer.mix_buf,
-        mixer.mix_buf_len * sizeof(int16_t), &bytes_read, portMAX_DELAY); 
+    esp_err_t err;
+    {
+        PROFILE_STAGE(PROFILE_I2S_READ);
+        err = i2s_read(I2S_NUM_0, mixer.mix_buf,
+            mixer.mix_buf_len * sizeof(int16_t), &bytes_read, portMAX_DELAY);
+    }
     ESP_ERROR_CHECK(err);
 
-    for (int i = 0, j = 0; i < bytes_read / sizeof(int16_t); i=i+2, j++)
     {
-        //Every other sample (mono)
-        single_packet_buffer[j] = mixer.mix_buf[i+1];
+        PROFILE_STAGE(PROFILE_DOWNMIX);
+        layout_pack(mixer_layout, mixer.mix_buf, bytes_read / (2 * sizeof(int16_t)), payload);
     }
 #else
-    for (int i = 0; i < buffer_size; i++) {
-        single_packet_buffer[i] = sine_buffer[sine_index];
+    for (size_t i = 0; i < buffer_size * ESPNOW_CHANNELS; i++) {
+        payload[i] = sine_buffer[sine_index];
         sine_index++;
         if (sine_index >= SINE_SAMPLES) sine_index = 0;
     }
 #endif
-    if (xQueueSend(espnow_data_queue, single_packet_buffer, portMAX_DELAY) != pdTRUE) {
+    if (mixer_impulse)
+        latency_impulse(payload, buffer_size, ESPNOW_CHANNELS,
+            espnow_get_stream()->samplerate, (uint32_t)captured);
+    if (espnow_packet_commit(packet, captured, mixer_layout) != pdTRUE) {
         ESP_LOGI(MIXER_TAG, "Failed to send espnow data.");
+        espnow_packet_release(packet);
     }
 }
\ No newline at end of file
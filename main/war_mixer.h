@@ -3,6 +3,7 @@
 
 #include "freertos/FreeRTOS.h"
 #include "ringbuf_i16.h"
+#include "war_layout.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,6 +15,10 @@ extern "C" {
 #define SAMPLES_TO_BYTES(count) (count * sizeof(int16_t))
 #define BYTES_TO_SAMPLES(bytes) (bytes / (sizeof(int16_t)))
 
+/* DMA buffers of one packet each; capture can fall this many packets
+ * behind before the driver drops the oldest. */
+#define MIXER_DMA_BUFFERS 4
+
 struct mixer_buffers_t 
 {
     int16_t* mix_buf;
@@ -22,10 +27,13 @@ struct mixer_buffers_t
 typedef struct mixer_buffers_t mixer_buffers_t;
 extern mixer_buffers_t mixer;
 
-extern const size_t buffer_size;
+extern size_t buffer_size;
 
 void mixer_init();
+void mixer_set_layout(channel_layout_t layout);
+void mixer_set_impulse(bool enable);
 void mixer_tick(size_t samples);
+// Waits for the next DMA buffer and queues it as a packet.
 void mixer_read();
 
 #ifdef __cplusplus
@@ -0,0 +1,247 @@
+#include "war_plc.h"
+#include "assert.h"
+#include <string.h>
+
+#define PLC_PITCH_DECIMATE  4
+#define PLC_SEAM_MATCH      32
+
+static uint32_t plc_ms_to_samples(plc_t* plc, uint32_t ms)
+{
+    return plc->sample_rate / 1000 * ms;
+}
+
+static void plc_push_history(plc_t* plc, const int16_t* frame)
+{
+    memmove(plc->history, plc->history + plc->frame_len,
+        (PLC_HISTORY - plc->frame_len) * sizeof(int16_t));
+    memcpy(plc->history + PLC_HISTORY - plc->frame_len, frame,
+        plc->frame_len * sizeof(int16_t));
+}
+
+static int64_t plc_correlate(const int16_t* a, const int16_t* b, int n, int step)
+{
+    int64_t acc = 0;
+    for (int i = 0; i < n; i += step)
+        acc += (int32_t)a[i] * b[i];
+    return acc;
+}
+
+/*
+ * Picks the lag that best predicts the newest PLC_PITCH_WINDOW samples from
+ * the ones a lag earlier: a coarse search over decimated samples, then a
+ * full-rate refinement around the winner.
+ */
+static uint32_t plc_find_pitch(plc_t* plc)
+{
+    int min_lag = plc->sample_rate / PLC_PITCH_MAX_HZ;
+    int max_lag = plc->sample_rate / PLC_PITCH_MIN_HZ;
+    if (max_lag > PLC_HISTORY - PLC_PITCH_WINDOW)
+        max_lag = PLC_HISTORY - PLC_PITCH_WINDOW;
+    if (min_lag > max_lag)
+        min_lag = max_lag;
+    const int16_t* target = plc->history + PLC_HISTORY - PLC_PITCH_WINDOW;
+
+    int best = max_lag;
+    float best_score = -1.f;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        int step = pass == 0 ? PLC_PITCH_DECIMATE : 1;
+        int lo = pass == 0 ? min_lag : best - PLC_PITCH_DECIMATE;
+        int hi = pass == 0 ? max_lag : best + PLC_PITCH_DECIMATE;
+        if (lo < min_lag)
+            lo = min_lag;
+        if (hi > max_lag)
+            hi = max_lag;
+        best_score = -1.f;
+        for (int lag = lo; lag <= hi; lag += step)
+        {
+            const int16_t* past = target - lag;
+            int64_t xy = plc_correlate(target, past, PLC_PITCH_WINDOW, step);
+            int64_t yy = plc_correlate(past, past, PLC_PITCH_WINDOW, step);
+            if (xy <= 0 || yy == 0)
+                continue;
+            float score = (float)xy * (float)xy / (float)yy;
+            if (score > best_score)
+            {
+                best_score = score;
+                best = lag;
+            }
+        }
+    }
+    return best_score < 0.f ? (uint32_t)max_lag : (uint32_t)best;
+}
+
+/*
+ * Picks the lag in [min_lag, max_lag] after which the history best
+ * continues its newest PLC_SEAM_MATCH samples, by least squared difference,
+ * first over every PLC_PITCH_DECIMATE'th lag and sample and then around the
+ * best. Replaying the last lag samples then starts with one that followed a
+ * stretch like the one just played, and every wrap of the loop joins the
+ * same way, so the waveform carries on instead of jumping back to the start
+ * of the frame.
+ */
+static uint32_t plc_find_seam(plc_t* plc, int min_lag, int max_lag)
+{
+    if (max_lag > PLC_HISTORY - PLC_SEAM_MATCH)
+        max_lag = PLC_HISTORY - PLC_SEAM_MATCH;
+    if (min_lag > max_lag)
+        min_lag = max_lag;
+    const int16_t* target = plc->history + PLC_HISTORY - PLC_SEAM_MATCH;
+
+    int best = max_lag;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        int step = pass == 0 ? PLC_PITCH_DECIMATE : 1;
+        int lo = pass == 0 ? min_lag : best - PLC_PITCH_DECIMATE;
+        int hi = pass == 0 ? max_lag : best + PLC_PITCH_DECIMATE;
+        if (lo < min_lag)
+            lo = min_lag;
+        if (hi > max_lag)
+            hi = max_lag;
+        int64_t best_err = INT64_MAX;
+        for (int lag = lo; lag <= hi; lag += step)
+        {
+            const int16_t* past = target - lag;
+            int64_t err = 0;
+            for (int i = 0; i < PLC_SEAM_MATCH; i += step)
+            {
+                int32_t d = target[i] - past[i];
+                err += (int64_t)d * d;
+            }
+            if (err < best_err)
+            {
+                best_err = err;
+                best = lag;
+            }
+        }
+    }
+    return (uint32_t)best;
+}
+
+static void plc_start(plc_t* plc)
+{
+    plc->lost_samples = 0;
+    plc->source_pos = 0;
+    switch (plc->mode)
+    {
+    case PLC_PITCH:
+        plc->period = plc_find_pitch(plc);
+        break;
+    case PLC_SILENCE:
+    case PLC_REPEAT:
+    default:
+        // A stretch no shorter than half a frame that joins up with itself,
+        // which on voiced or tonal audio is a whole number of periods.
+        plc->period = plc_find_seam(plc, (plc->frame_len + 1) / 2,
+            plc->sample_rate / PLC_PITCH_MIN_HZ);
+        break;
+    }
+    plc->source_len = plc->period;
+}
+
+/* Q15 gain for the n-th concealed sample of the current loss. */
+static int32_t plc_gain(plc_t* plc, uint32_t n)
+{
+    uint32_t hold = 0, fade;
+    switch (plc->mode)
+    {
+    case PLC_SILENCE:
+        fade = plc_ms_to_samples(plc, PLC_XFADE_MS);
+        break;
+    case PLC_REPEAT:
+        fade = plc_ms_to_samples(plc, PLC_REPEAT_FADE_MS);
+        break;
+    case PLC_PITCH:
+    default:
+        hold = plc_ms_to_samples(plc, PLC_PITCH_HOLD_MS);
+        fade = plc_ms_to_samples(plc, PLC_PITCH_FADE_MS) - hold;
+        break;
+    }
+    if (n < hold)
+        return 32768;
+    n -= hold;
+    if (n >= fade)
+        return 0;
+    return (int32_t)(((uint64_t)(fade - n) << 15) / fade);
+}
+
+/* Next n samples of the continuation, at full level. */
+static void plc_generate(plc_t* plc, int16_t* out, size_t n)
+{
+    const int16_t* source = plc->history + PLC_HISTORY - plc->period;
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = source[plc->source_pos];
+        if (++plc->source_pos == plc->source_len)
+            plc->source_pos = 0;
+    }
+}
+
+void plc_init(plc_t* plc, plc_mode_t mode, size_t frame_len, uint32_t sample_rate)
+{
+    assert(plc && frame_len && frame_len <= PLC_MAX_FRAME);
+    assert(sample_rate && sample_rate <= PLC_MAX_SAMPLE_RATE);
+
+    plc->mode = mode;
+    plc->frame_len = frame_len;
+    plc->sample_rate = sample_rate;
+    plc_reset(plc);
+}
+
+void plc_reset(plc_t* plc)
+{
+    memset(plc->history, 0, sizeof(plc->history));
+    memset(&plc->stats, 0, sizeof(plc->stats));
+    plc->lost_samples = 0;
+    plc->source_len = 0;
+    plc->source_pos = 0;
+    plc->period = 0;
+}
+
+void plc_good(plc_t* plc, int16_t* frame)
+{
+    if (plc->source_len)
+    {
+        // Fade from where the concealment would have gone into the real signal.
+        int16_t tail[PLC_MAX_FRAME];
+        uint32_t xfade = plc_ms_to_samples(plc, PLC_XFADE_MS);
+        if (xfade > plc->frame_len)
+            xfade = plc->frame_len;
+        plc_generate(plc, tail, xfade);
+        for (uint32_t i = 0; i < xfade; i++)
+        {
+            int32_t gain = plc_gain(plc, plc->lost_samples + i);
+            int32_t w = (int32_t)(((i + 1) << 15) / (xfade + 1));
+            int32_t concealed = (tail[i] * gain) >> 15;
+            frame[i] = (int16_t)((concealed * (32768 - w) + frame[i] * w) >> 15);
+        }
+        plc->source_len = 0;
+        plc->stats.recovered++;
+    }
+
+    plc_push_history(plc, frame);
+    plc->stats.good++;
+}
+
+void plc_conceal(plc_t* plc, int16_t* frame)
+{
+    if (!plc->source_len)
+        plc_start(plc);
+
+    plc_generate(plc, frame, plc->frame_len);
+    for (size_t i = 0; i < plc->frame_len; i++)
+        frame[i] = (int16_t)((frame[i] * plc_gain(plc, plc->lost_samples + i)) >> 15);
+    plc->lost_samples += plc->frame_len;
+    plc->stats.concealed++;
+}
+
+const char* plc_mode_name(plc_mode_t mode)
+{
+    switch (mode)
+    {
+    case PLC_SILENCE: return "silence";
+    case PLC_REPEAT: return "repeat";
+    case PLC_PITCH: return "pitch";
+    default: return "unknown";
+    }
+}
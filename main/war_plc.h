@@ -0,0 +1,85 @@
+#ifndef __WAR_PLC_H__
+#define __WAR_PLC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Packet-loss concealment for mono 16-bit frames. Every frame that reaches
+ * the output goes through plc_good() (received) or plc_conceal() (lost), so
+ * the concealer always knows the recent output and can crossfade back into
+ * real audio when packets return.
+ *
+ *  PLC_SILENCE  carry the waveform on as PLC_REPEAT does, fading it out
+ *               over PLC_XFADE_MS, then silence
+ *  PLC_REPEAT   repeat the newest stretch of history, at least half a frame
+ *               and at most a PLC_PITCH_MIN_HZ period long, whose start best
+ *               continues the last samples played (least squared difference
+ *               over 32 of them), fading out over PLC_REPEAT_FADE_MS
+ *  PLC_PITCH    repeat the last pitch period found by autocorrelation
+ *               (G.711 Appendix I style): full level for PLC_PITCH_HOLD_MS,
+ *               then fading out by PLC_PITCH_FADE_MS
+ */
+
+#define PLC_MAX_FRAME           480
+#define PLC_HISTORY             1024
+#define PLC_XFADE_MS            1
+#define PLC_REPEAT_FADE_MS      20
+#define PLC_PITCH_HOLD_MS       10
+#define PLC_PITCH_FADE_MS       60
+#define PLC_PITCH_MIN_HZ        70
+#define PLC_PITCH_MAX_HZ        1000
+#define PLC_PITCH_WINDOW        256
+// Highest rate whose longest pitch period and search window fit in the
+// history; streams above it are refused (espnow_set_stream()).
+#define PLC_MAX_SAMPLE_RATE     ((PLC_HISTORY - PLC_PITCH_WINDOW) * PLC_PITCH_MIN_HZ)
+
+typedef enum {
+    PLC_SILENCE,
+    PLC_REPEAT,
+    PLC_PITCH,
+} plc_mode_t;
+
+typedef struct {
+    uint32_t good;
+    uint32_t concealed;
+    uint32_t recovered;
+} plc_stats_t;
+
+typedef struct {
+    plc_mode_t mode;
+    size_t frame_len;
+    uint32_t sample_rate;
+
+    int16_t history[PLC_HISTORY];
+
+    uint32_t lost_samples;
+    uint32_t source_len;
+    uint32_t source_pos;
+    uint32_t period; // newest history samples replayed in a loop
+
+    plc_stats_t stats;
+} plc_t;
+
+void plc_init(plc_t* plc, plc_mode_t mode, size_t frame_len, uint32_t sample_rate);
+
+void plc_reset(plc_t* plc);
+
+// Records a received frame, crossfading into it in place after a loss.
+void plc_good(plc_t* plc, int16_t* frame);
+
+// Fills frame with the concealment for a lost packet.
+void plc_conceal(plc_t* plc, int16_t* frame);
+
+const char* plc_mode_name(plc_mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_PLC_H__
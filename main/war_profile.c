@@ -0,0 +1,93 @@
+#include "war_profile.h"
+#include "assert.h"
+#include <string.h>
+
+#include "esp_log.h"
+
+static const char* TAG = "Profile";
+
+latency_hist_t profile_stages[PROFILE_STAGES] = {
+    [0 ... PROFILE_STAGES - 1] = {.min = UINT32_MAX},
+};
+
+static const char* const profile_stage_names[PROFILE_STAGES] = {
+    [PROFILE_WAKE] = "wake",
+    [PROFILE_I2S_READ] = "i2s_read",
+    [PROFILE_DOWNMIX] = "downmix",
+    [PROFILE_QUEUE_SEND] = "queue send",
+    [PROFILE_PREPARE] = "prepare",
+    [PROFILE_ESPNOW_SEND] = "esp_now_send",
+    [PROFILE_RECV_PARSE] = "recv parse",
+    [PROFILE_RBUF_PUSH] = "rbuf push",
+};
+
+/* Shares of one packet period. The sender's stages run once per packet on
+ * the same core as the receive path of a board that does both, and the
+ * radio needs what is left; together they stay under half. */
+static const uint8_t profile_stage_shares[PROFILE_STAGES] = {
+    [PROFILE_WAKE] = 1,
+    [PROFILE_I2S_READ] = 5,
+    [PROFILE_DOWNMIX] = 5,
+    [PROFILE_QUEUE_SEND] = 2,
+    [PROFILE_PREPARE] = 10,
+    [PROFILE_ESPNOW_SEND] = 10,
+    [PROFILE_RECV_PARSE] = 5,
+    [PROFILE_RBUF_PUSH] = 5,
+};
+
+const char* profile_stage_name(profile_stage_t stage)
+{
+    assert(stage < PROFILE_STAGES);
+    return profile_stage_names[stage];
+}
+
+uint8_t profile_stage_share(profile_stage_t stage)
+{
+    assert(stage < PROFILE_STAGES);
+    return profile_stage_shares[stage];
+}
+
+void profile_reset(void)
+{
+    for (int stage = 0; stage < PROFILE_STAGES; stage++)
+        latency_hist_init(&profile_stages[stage]);
+}
+
+static bool profile_report(uint32_t packet_us, bool all)
+{
+    bool within = true;
+    for (int stage = 0; stage < PROFILE_STAGES; stage++)
+    {
+        const latency_hist_t* hist = &profile_stages[stage];
+        if (hist->count == 0)
+            continue;
+        float budget_us = (float)packet_us * profile_stage_shares[stage] / 100.f;
+        float p99_us = (float)latency_percentile(hist, 99.f) / PROFILE_TICKS_PER_US;
+        bool over = p99_us > budget_us;
+        within = within && !over;
+        if (!over && !all)
+            continue;
+        if (over)
+            ESP_LOGW(TAG, "%-12s p99 %.1f us over its %u%% budget of %.1f us (max %.1f us)",
+                profile_stage_names[stage], p99_us, profile_stage_shares[stage],
+                budget_us, (float)hist->max / PROFILE_TICKS_PER_US);
+        else
+            ESP_LOGI(TAG, "%-12s %8u runs, min %.2f us, avg %.2f, p99 %.2f, max %.2f; "
+                "budget %.1f us",
+                profile_stage_names[stage], hist->count,
+                (float)hist->min / PROFILE_TICKS_PER_US,
+                (float)hist->sum / hist->count / PROFILE_TICKS_PER_US, p99_us,
+                (float)hist->max / PROFILE_TICKS_PER_US, budget_us);
+    }
+    return within;
+}
+
+bool profile_log(uint32_t packet_us)
+{
+    return profile_report(packet_us, true);
+}
+
+bool profile_check(uint32_t packet_us)
+{
+    return profile_report(packet_us, false);
+}
@@ -0,0 +1,114 @@
+#ifndef __WAR_PROFILE_H__
+#define __WAR_PROFILE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "war_latency.h"
+
+#if !defined(__XTENSA__)
+#include <time.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Scoped timers for the pipeline stages. PROFILE_STAGE(stage) at the top of
+ * a block times the rest of the block, however it is left, into that
+ * stage's histogram; PROFILE_SCOPE(hist) does the same into any
+ * latency_hist_t, which is how the benchmarks use it.
+ *
+ * Times are in ticks of the CPU cycle counter on target and nanoseconds of
+ * CLOCK_MONOTONIC on host, PROFILE_TICKS_PER_US either way. The cycle
+ * counter is per core; the audio tasks are pinned, so a scope starts and
+ * ends on one.
+ *
+ * Every stage has one writer, and only adds; profile_log() reads while
+ * they run, which can be off by the sample being added.
+ *
+ * Build with -DPROFILE_ENABLE=0 to compile the timers out.
+ */
+
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE 1
+#endif
+
+typedef enum {
+    PROFILE_WAKE,           // DMA event handling in mixer_read(), once the timer ISR.
+    PROFILE_I2S_READ,
+    PROFILE_DOWNMIX,        // layout_pack().
+    PROFILE_QUEUE_SEND,     // espnow_packet_commit().
+    PROFILE_PREPARE,        // espnow_data_prepare(): encode, copy and CRC.
+    PROFILE_ESPNOW_SEND,    // esp_now_send().
+    PROFILE_RECV_PARSE,     // espnow_data_parse().
+    PROFILE_RBUF_PUSH,      // Into the jitter buffer or ringbuffer.
+    PROFILE_STAGES
+} profile_stage_t;
+
+#if defined(__XTENSA__)
+#include "sdkconfig.h"
+#include "xtensa/hal.h"
+#ifdef CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+#define PROFILE_TICKS_PER_US CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+#else
+#define PROFILE_TICKS_PER_US 240
+#endif
+
+static inline uint32_t profile_now(void)
+{
+    return xthal_get_ccount();
+}
+#else
+#define PROFILE_TICKS_PER_US 1000
+
+static inline uint32_t profile_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+#endif
+
+typedef struct {
+    latency_hist_t* hist;
+    uint32_t start;
+} profile_scope_t;
+
+static inline void profile_scope_end(profile_scope_t* scope)
+{
+    latency_hist_add(scope->hist, (int32_t)(profile_now() - scope->start));
+}
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+
+#if PROFILE_ENABLE
+#define PROFILE_SCOPE(hist_ptr)                                         \
+    profile_scope_t PROFILE_JOIN(profile_scope_, __LINE__)              \
+        __attribute__((cleanup(profile_scope_end))) = {(hist_ptr), profile_now()}
+#else
+#define PROFILE_SCOPE(hist_ptr) ((void)0)
+#endif
+#define PROFILE_STAGE(stage) PROFILE_SCOPE(&profile_stages[stage])
+
+extern latency_hist_t profile_stages[PROFILE_STAGES];
+
+const char* profile_stage_name(profile_stage_t stage);
+// Percent of a packet period the stage may take.
+uint8_t profile_stage_share(profile_stage_t stage);
+void profile_reset(void);
+
+// Logs every stage that has run, min/avg/p99/max in us against its share
+// of packet_us, with a warning for each whose p99 is over. Returns false
+// if any was. Formats: call it off the audio path.
+bool profile_log(uint32_t packet_us);
+// Only the warnings.
+bool profile_check(uint32_t packet_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_PROFILE_H__
@@ -0,0 +1,57 @@
+#include "war_redundant.h"
+#include "assert.h"
+
+#define MULAW_BIAS  0x84
+#define MULAW_CLIP  32635
+
+static uint8_t mulaw_encode(int32_t x)
+{
+    uint8_t sign = 0;
+    if (x < 0)
+    {
+        sign = 0x80;
+        x = -x;
+    }
+    if (x > MULAW_CLIP)
+        x = MULAW_CLIP;
+    x += MULAW_BIAS;
+
+    int exponent = 7;
+    for (int32_t mask = 0x4000; !(x & mask) && exponent > 0; mask >>= 1)
+        exponent--;
+    int mantissa = (x >> (exponent + 3)) & 0x0f;
+    return (uint8_t)~(sign | (exponent << 4) | mantissa);
+}
+
+static int32_t mulaw_decode(uint8_t u)
+{
+    u = ~u;
+    int exponent = (u >> 4) & 0x07;
+    int32_t x = ((((int32_t)u & 0x0f) << 3) + MULAW_BIAS) << exponent;
+    x -= MULAW_BIAS;
+    return (u & 0x80) ? -x : x;
+}
+
+void redundant_encode(const int16_t* frame, size_t samples, uint8_t* out)
+{
+    assert((samples & 1) == 0);
+    for (size_t i = 0; i < samples / 2; i++)
+        out[i] = mulaw_encode(((int32_t)frame[2 * i] + frame[2 * i + 1]) / 2);
+}
+
+void redundant_decode(const uint8_t* in, size_t samples, int16_t* frame)
+{
+    // Each coded sample sits between the two it was averaged from; place
+    // the outputs at a quarter step either side of it.
+    size_t n = samples / 2;
+    int32_t prev = mulaw_decode(in[0]);
+    int32_t cur = prev;
+    for (size_t i = 0; i < n; i++)
+    {
+        int32_t next = i + 1 < n ? mulaw_decode(in[i + 1]) : cur;
+        frame[2 * i] = (int16_t)((prev + 3 * cur) / 4);
+        frame[2 * i + 1] = (int16_t)((3 * cur + next) / 4);
+        prev = cur;
+        cur = next;
+    }
+}
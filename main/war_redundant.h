@@ -0,0 +1,30 @@
+#ifndef __WAR_REDUNDANT_H__
+#define __WAR_REDUNDANT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Low-resolution copy of a mono frame for the redundant payload: pairs of
+ * samples are averaged (half the sample rate) and G.711 mu-law coded, one
+ * byte for every two input samples. Decoding interpolates back up to the
+ * full rate. Good enough to stand in for a lost frame, far cheaper than a
+ * second full-resolution copy.
+ */
+
+#define REDUNDANT_LEN(samples) ((samples) / 2)
+
+// samples must be even; out receives REDUNDANT_LEN(samples) bytes.
+void redundant_encode(const int16_t* frame, size_t samples, uint8_t* out);
+
+void redundant_decode(const uint8_t* in, size_t samples, int16_t* frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_REDUNDANT_H__
@@ -0,0 +1,327 @@
+#include "war_telemetry.h"
+#include "assert.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "Telemetry";
+
+/* Each core's values in snapshot order: counters, peaks, histograms. */
+#define TELEMETRY_PEAK_BASE     TELEMETRY_COUNTERS
+#define TELEMETRY_HIST_BASE     (TELEMETRY_COUNTERS + TELEMETRY_PEAKS)
+
+static _Atomic uint32_t telemetry_cores[portNUM_PROCESSORS][TELEMETRY_WORDS];
+
+static const char* const telemetry_counter_names[TELEMETRY_COUNTERS] = {
+    [TELEMETRY_TX_PACKETS] = "tx.packets",
+    [TELEMETRY_TX_BYTES] = "tx.bytes",
+    [TELEMETRY_TX_COPIES] = "tx.copies",
+    [TELEMETRY_TX_PARITY] = "tx.parity",
+    [TELEMETRY_TX_FAIL] = "tx.fail",
+    [TELEMETRY_TX_RETRY] = "tx.retry",
+    [TELEMETRY_CODEC_FRAMES] = "codec.frames",
+    [TELEMETRY_CODEC_BYTES] = "codec.bytes",
+    [TELEMETRY_RX_PACKETS] = "rx.packets",
+    [TELEMETRY_RX_BYTES] = "rx.bytes",
+    [TELEMETRY_RX_BAD] = "rx.bad",
+    [TELEMETRY_RX_MISSED] = "rx.missed",
+    [TELEMETRY_RX_PARITY] = "rx.parity",
+    [TELEMETRY_RX_POOL_EMPTY] = "rx.pool_empty",
+    [TELEMETRY_RX_QUEUE_FULL] = "rx.queue_full",
+    [TELEMETRY_RX_DECODE_FAIL] = "rx.decode_fail",
+    [TELEMETRY_RX_LAYOUT_MISMATCH] = "rx.layout_mismatch",
+    [TELEMETRY_UNDERRUNS] = "playout.underruns",
+    [TELEMETRY_JITTER_LATE] = "jitter.late",
+    [TELEMETRY_JITTER_LOST] = "jitter.lost",
+    [TELEMETRY_JITTER_DUPLICATE] = "jitter.duplicate",
+    [TELEMETRY_JITTER_DROPPED] = "jitter.dropped",
+    [TELEMETRY_JITTER_STRETCHED] = "jitter.stretched",
+    [TELEMETRY_JITTER_RESYNCS] = "jitter.resyncs",
+    [TELEMETRY_JITTER_REDUNDANT] = "jitter.redundant",
+    [TELEMETRY_FEC_RECOVERED] = "fec.recovered",
+    [TELEMETRY_FEC_UNRECOVERABLE] = "fec.unrecoverable",
+    [TELEMETRY_I2S_READS] = "i2s.reads",
+    [TELEMETRY_I2S_EVENTS_OTHER] = "i2s.events_other",
+    [TELEMETRY_I2S_WRITES] = "i2s.writes",
+    [TELEMETRY_I2S_SHORT_WRITES] = "i2s.short_writes",
+    [TELEMETRY_I2S_SHORT_BYTES] = "i2s.short_bytes",
+    [TELEMETRY_I2S_SAMPLES_WRITTEN] = "i2s.samples_written",
+};
+
+static const char* const telemetry_peak_names[TELEMETRY_PEAKS] = {
+    [TELEMETRY_RX_SLOTS_USED] = "rx.slots_used",
+    [TELEMETRY_JITTER_DEPTH] = "jitter.depth",
+    [TELEMETRY_JITTER_TARGET] = "jitter.target",
+    [TELEMETRY_JITTER_US] = "jitter.us",
+    [TELEMETRY_JITTER_LATENCY_MAX_US] = "jitter.latency_max_us",
+};
+
+static const char* const telemetry_hist_names[TELEMETRY_HISTS] = {
+    [TELEMETRY_TX_QUEUE] = "tx.queue",
+    [TELEMETRY_TX_INFLIGHT] = "tx.inflight",
+    [TELEMETRY_TX_SEND_US] = "tx.send_us",
+    [TELEMETRY_CAPTURE_US] = "capture.to_send_us",
+    [TELEMETRY_WAKE_LAG_US] = "capture.wake_lag_us",
+    [TELEMETRY_DMA_BACKLOG] = "capture.dma_backlog",
+    [TELEMETRY_RX_GAP] = "rx.gap",
+    [TELEMETRY_RX_INTERVAL_US] = "rx.interval_us",
+    [TELEMETRY_RBUF_FREE] = "rbuf.free_bytes",
+};
+
+static uint32_t telemetry_seq = 0;
+static uint32_t telemetry_last_us = 0;
+static uint32_t telemetry_period_ms = 0;
+static telemetry_collect_t telemetry_collect = NULL;
+static telemetry_sink_t telemetry_sink = NULL;
+
+static inline _Atomic uint32_t* telemetry_core(void)
+{
+    return telemetry_cores[xPortGetCoreID()];
+}
+
+static void telemetry_raise(_Atomic uint32_t* peak, uint32_t value)
+{
+    uint32_t seen = atomic_load_explicit(peak, memory_order_relaxed);
+    while (value > seen && !atomic_compare_exchange_weak_explicit(peak, &seen,
+        value, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+void telemetry_count(telemetry_counter_t id, uint32_t n)
+{
+    atomic_fetch_add_explicit(&telemetry_core()[id], n,
+        memory_order_relaxed);
+}
+
+void telemetry_peak(telemetry_peak_t id, uint32_t value)
+{
+    telemetry_raise(&telemetry_core()[TELEMETRY_PEAK_BASE + id], value);
+}
+
+static uint32_t telemetry_bucket(uint32_t value)
+{
+    if (value == 0)
+        return 0;
+    uint32_t bucket = 32 - __builtin_clz(value);
+    return bucket < TELEMETRY_HIST_BUCKETS ? bucket : TELEMETRY_HIST_BUCKETS - 1;
+}
+
+void telemetry_hist_add(telemetry_hist_t id, uint32_t value)
+{
+    _Atomic uint32_t* hist =
+        &telemetry_core()[TELEMETRY_HIST_BASE + id * TELEMETRY_HIST_WORDS];
+    atomic_fetch_add_explicit(&hist[telemetry_bucket(value)], 1,
+        memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist[TELEMETRY_HIST_SUM], value,
+        memory_order_relaxed);
+    telemetry_raise(&hist[TELEMETRY_HIST_MAX], value);
+}
+
+static uint8_t* telemetry_put(uint8_t* out, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+static bool telemetry_is_peak(int word)
+{
+    if (word < TELEMETRY_PEAK_BASE)
+        return false;
+    if (word < TELEMETRY_HIST_BASE)
+        return true;
+    return (word - TELEMETRY_HIST_BASE) % TELEMETRY_HIST_WORDS == TELEMETRY_HIST_MAX;
+}
+
+// Swaps the cores' copies of a value for zero; peaks take the largest.
+static uint32_t telemetry_drain(int word)
+{
+    bool peak = telemetry_is_peak(word);
+    uint32_t total = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++)
+    {
+        uint32_t value = atomic_exchange_explicit(&telemetry_cores[core][word], 0,
+            memory_order_relaxed);
+        if (peak)
+            total = value > total ? value : total;
+        else
+            total += value;
+    }
+    return total;
+}
+
+size_t telemetry_take(uint8_t* out, size_t len)
+{
+    if (len < TELEMETRY_SNAPSHOT_MAX)
+        return 0;
+
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    telemetry_header_t header = {
+        .magic = TELEMETRY_MAGIC,
+        .version = TELEMETRY_VERSION,
+        .counters = TELEMETRY_COUNTERS,
+        .peaks = TELEMETRY_PEAKS,
+        .hists = TELEMETRY_HISTS,
+        .seq = telemetry_seq++,
+        .time_us = now,
+        .interval_us = now - telemetry_last_us,
+    };
+    telemetry_last_us = now;
+    memcpy(out, &header, sizeof(header));
+
+    uint8_t* p = out + sizeof(header);
+    for (int word = 0; word < TELEMETRY_WORDS; word++)
+        p = telemetry_put(p, telemetry_drain(word));
+    return p - out;
+}
+
+static const uint8_t* telemetry_get(const uint8_t* p, const uint8_t* end,
+    uint32_t* value)
+{
+    uint32_t v = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7)
+    {
+        uint8_t byte = *p++;
+        v |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            *value = v;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Reads count values into the first known of them, skipping the rest.
+static const uint8_t* telemetry_get_all(const uint8_t* p, const uint8_t* end,
+    uint32_t* values, int count, int known)
+{
+    for (int i = 0; i < count && p != NULL; i++)
+    {
+        uint32_t value;
+        p = telemetry_get(p, end, &value);
+        if (p != NULL && i < known)
+            values[i] = value;
+    }
+    return p;
+}
+
+bool telemetry_parse(const uint8_t* data, size_t len, telemetry_snapshot_t* snap)
+{
+    memset(snap, 0, sizeof(telemetry_snapshot_t));
+    if (len < sizeof(telemetry_header_t))
+        return false;
+    memcpy(&snap->header, data, sizeof(telemetry_header_t));
+    if (snap->header.magic != TELEMETRY_MAGIC ||
+        snap->header.version != TELEMETRY_VERSION)
+        return false;
+
+    const uint8_t* p = data + sizeof(telemetry_header_t);
+    const uint8_t* end = data + len;
+    p = telemetry_get_all(p, end, snap->counters, snap->header.counters,
+        TELEMETRY_COUNTERS);
+    p = telemetry_get_all(p, end, snap->peaks, snap->header.peaks,
+        TELEMETRY_PEAKS);
+    for (int i = 0; i < snap->header.hists && p != NULL; i++)
+    {
+        uint32_t discard[TELEMETRY_HIST_WORDS];
+        p = telemetry_get_all(p, end,
+            i < TELEMETRY_HISTS ? snap->hists[i] : discard,
+            TELEMETRY_HIST_WORDS, TELEMETRY_HIST_WORDS);
+    }
+    return p != NULL;
+}
+
+const char* telemetry_counter_name(telemetry_counter_t id)
+{
+    assert(id < TELEMETRY_COUNTERS);
+    return telemetry_counter_names[id];
+}
+
+const char* telemetry_peak_name(telemetry_peak_t id)
+{
+    assert(id < TELEMETRY_PEAKS);
+    return telemetry_peak_names[id];
+}
+
+const char* telemetry_hist_name(telemetry_hist_t id)
+{
+    assert(id < TELEMETRY_HISTS);
+    return telemetry_hist_names[id];
+}
+
+uint32_t telemetry_hist_count(const uint32_t* hist)
+{
+    uint32_t count = 0;
+    for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++)
+        count += hist[b];
+    return count;
+}
+
+uint32_t telemetry_hist_percentile(const uint32_t* hist, float pct)
+{
+    uint32_t count = telemetry_hist_count(hist);
+    if (count == 0)
+        return 0;
+    uint64_t want = (uint64_t)(pct * 0.01f * count + 0.5f);
+    if (want == 0)
+        want = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < TELEMETRY_HIST_BUCKETS - 1; b++)
+    {
+        seen += hist[b];
+        if (seen >= want)
+        {
+            uint32_t upper = (1u << b) - 1;
+            return upper < hist[TELEMETRY_HIST_MAX] ? upper : hist[TELEMETRY_HIST_MAX];
+        }
+    }
+    return hist[TELEMETRY_HIST_MAX];
+}
+
+static void telemetry_task(void* param)
+{
+    static uint8_t snapshot[TELEMETRY_SNAPSHOT_MAX];
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(telemetry_period_ms));
+        if (telemetry_collect != NULL)
+            telemetry_collect();
+        size_t len = telemetry_take(snapshot, sizeof(snapshot));
+        telemetry_sink(snapshot, len);
+    }
+}
+
+/* Off the audio tasks' core, below everything else. */
+bool telemetry_start(uint32_t period_ms, telemetry_collect_t collect,
+    telemetry_sink_t sink)
+{
+    assert(period_ms > 0 && sink != NULL);
+    telemetry_period_ms = period_ms;
+    telemetry_collect = collect;
+    telemetry_sink = sink;
+    telemetry_last_us = (uint32_t)esp_timer_get_time();
+    return xTaskCreatePinnedToCore(telemetry_task, "Telemetry Task", 3 * 1024,
+        NULL, 1, NULL, 0) == pdPASS;
+}
+
+void telemetry_sink_log(const uint8_t* snapshot, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    static char hex[2 * TELEMETRY_SNAPSHOT_MAX + 1];
+    for (size_t i = 0; i < len; i++)
+    {
+        hex[2 * i] = digits[snapshot[i] >> 4];
+        hex[2 * i + 1] = digits[snapshot[i] & 0xf];
+    }
+    hex[2 * len] = '\0';
+    ESP_LOGI(TAG, "%s", hex);
+}
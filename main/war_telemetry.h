@@ -0,0 +1,153 @@
+#ifndef __WAR_TELEMETRY_H__
+#define __WAR_TELEMETRY_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Counters, peaks and histograms for the audio path. Every core has its own
+ * copy of each, and an update is a relaxed atomic add (or compare-exchange
+ * for a peak) on the calling core's copy: it never blocks, never formats and
+ * is safe from tasks and ISRs alike.
+ *
+ * telemetry_take() swaps every copy for zero, sums the cores and encodes the
+ * result as a snapshot: a fixed header, then each value as a LEB128 varint,
+ * counters first, then peaks, then TELEMETRY_HIST_WORDS per histogram.
+ * Mostly small or zero values keep it at a few hundred bytes. An update that
+ * races the swap lands in this snapshot or the next, never in neither.
+ *
+ * telemetry_start() runs the export at low priority: every period it calls
+ * the collect hook, takes a snapshot and hands it to the sink. The console
+ * sink writes it as one hex line, which host/telemetry_dump decodes.
+ */
+
+#define TELEMETRY_MAGIC         0x4d4c5454  // "TTLM"
+#define TELEMETRY_VERSION       1
+
+/* Bucket 0 holds 0, bucket b values from 2^(b-1) up to 2^b - 1; the last
+ * also holds everything larger. */
+#define TELEMETRY_HIST_BUCKETS  16
+#define TELEMETRY_HIST_SUM      TELEMETRY_HIST_BUCKETS
+#define TELEMETRY_HIST_MAX      (TELEMETRY_HIST_BUCKETS + 1)
+#define TELEMETRY_HIST_WORDS    (TELEMETRY_HIST_BUCKETS + 2)
+
+typedef enum {
+    TELEMETRY_TX_PACKETS,               // esp_now_send() calls that took.
+    TELEMETRY_TX_BYTES,
+    TELEMETRY_TX_COPIES,                // Duplicates scheduled.
+    TELEMETRY_TX_PARITY,
+    TELEMETRY_TX_FAIL,                  // Send callbacks without success.
+    TELEMETRY_TX_RETRY,                 // Driver queue full.
+    TELEMETRY_CODEC_FRAMES,
+    TELEMETRY_CODEC_BYTES,
+    TELEMETRY_RX_PACKETS,
+    TELEMETRY_RX_BYTES,
+    TELEMETRY_RX_BAD,                   // Short or failed the CRC.
+    TELEMETRY_RX_MISSED,                // Sequence numbers skipped.
+    TELEMETRY_RX_PARITY,
+    TELEMETRY_RX_POOL_EMPTY,
+    TELEMETRY_RX_QUEUE_FULL,
+    TELEMETRY_RX_DECODE_FAIL,
+    TELEMETRY_RX_LAYOUT_MISMATCH,
+    TELEMETRY_UNDERRUNS,                // Playout found nothing to play.
+    TELEMETRY_JITTER_LATE,
+    TELEMETRY_JITTER_LOST,
+    TELEMETRY_JITTER_DUPLICATE,
+    TELEMETRY_JITTER_DROPPED,
+    TELEMETRY_JITTER_STRETCHED,
+    TELEMETRY_JITTER_RESYNCS,
+    TELEMETRY_JITTER_REDUNDANT,
+    TELEMETRY_FEC_RECOVERED,
+    TELEMETRY_FEC_UNRECOVERABLE,
+    TELEMETRY_I2S_READS,
+    TELEMETRY_I2S_EVENTS_OTHER,         // DMA events other than RX done.
+    TELEMETRY_I2S_WRITES,
+    TELEMETRY_I2S_SHORT_WRITES,         // Writes the DMA had no room for.
+    TELEMETRY_I2S_SHORT_BYTES,          // Bytes those left out.
+    TELEMETRY_I2S_SAMPLES_WRITTEN,
+    TELEMETRY_COUNTERS
+} telemetry_counter_t;
+
+typedef enum {
+    TELEMETRY_RX_SLOTS_USED,
+    TELEMETRY_JITTER_DEPTH,             // As collected, in packets.
+    TELEMETRY_JITTER_TARGET,
+    TELEMETRY_JITTER_US,
+    TELEMETRY_JITTER_LATENCY_MAX_US,
+    TELEMETRY_PEAKS
+} telemetry_peak_t;
+
+typedef enum {
+    TELEMETRY_TX_QUEUE,                 // Packets waiting behind the one sent.
+    TELEMETRY_TX_INFLIGHT,
+    TELEMETRY_TX_SEND_US,               // esp_now_send() to its callback.
+    TELEMETRY_CAPTURE_US,               // Capture to the first send.
+    TELEMETRY_WAKE_LAG_US,              // DMA buffer done to mixer_read(), see war_mixer.cpp.
+    TELEMETRY_DMA_BACKLOG,              // DMA buffers queued behind that one.
+    TELEMETRY_RX_GAP,                   // Length of each run of missed packets.
+    TELEMETRY_RX_INTERVAL_US,
+    TELEMETRY_RBUF_FREE,                // Bytes, ringbuffer playout only.
+    TELEMETRY_HISTS
+} telemetry_hist_t;
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t counters;
+    uint8_t peaks;
+    uint8_t hists;
+    uint32_t seq;                       // Snapshots taken before this one.
+    uint32_t time_us;                   // esp_timer_get_time() as it was taken.
+    uint32_t interval_us;               // Since the one before.
+} __attribute__((packed)) telemetry_header_t;
+
+#define TELEMETRY_WORDS \
+    (TELEMETRY_COUNTERS + TELEMETRY_PEAKS + TELEMETRY_HISTS * TELEMETRY_HIST_WORDS)
+#define TELEMETRY_SNAPSHOT_MAX  (sizeof(telemetry_header_t) + 5 * TELEMETRY_WORDS)
+
+/* A decoded snapshot. Values the encoder had no name for are skipped, ones
+ * it did not know are left zero. */
+typedef struct {
+    telemetry_header_t header;
+    uint32_t counters[TELEMETRY_COUNTERS];
+    uint32_t peaks[TELEMETRY_PEAKS];
+    uint32_t hists[TELEMETRY_HISTS][TELEMETRY_HIST_WORDS];
+} telemetry_snapshot_t;
+
+typedef void (*telemetry_collect_t)(void);
+typedef void (*telemetry_sink_t)(const uint8_t* snapshot, size_t len);
+
+void telemetry_count(telemetry_counter_t id, uint32_t n);
+void telemetry_peak(telemetry_peak_t id, uint32_t value);
+void telemetry_hist_add(telemetry_hist_t id, uint32_t value);
+
+// Encodes into out and starts every value over, from one task at a time.
+// Returns the length, 0 if len is below TELEMETRY_SNAPSHOT_MAX.
+size_t telemetry_take(uint8_t* out, size_t len);
+bool telemetry_parse(const uint8_t* data, size_t len, telemetry_snapshot_t* snap);
+
+const char* telemetry_counter_name(telemetry_counter_t id);
+const char* telemetry_peak_name(telemetry_peak_t id);
+const char* telemetry_hist_name(telemetry_hist_t id);
+
+uint32_t telemetry_hist_count(const uint32_t* hist);
+// Upper edge of the bucket holding pct percent of the samples, at most the
+// largest sample; 0 without samples.
+uint32_t telemetry_hist_percentile(const uint32_t* hist, float pct);
+
+// Exports every period_ms from a task of its own; collect may be NULL.
+bool telemetry_start(uint32_t period_ms, telemetry_collect_t collect,
+    telemetry_sink_t sink);
+// One "Telemetry" log line of hex.
+void telemetry_sink_log(const uint8_t* snapshot, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAR_TELEMETRY_H__